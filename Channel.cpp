@@ -0,0 +1,172 @@
+#include "Channel.h"
+
+#include <string.h>
+
+//-----------------------CONSTRUCTORS DESTRUCTORS----------------------------//
+
+/**
+ * C-tor. Creates an empty, open channel.
+ * @param valueSize the size of a value in bytes, a positive number.
+ * @param capacity the number of values the channel buffers, between 0 and
+ * MAX_CHANNEL_CAPACITY.
+ */
+Channel::Channel(int valueSize, int capacity)
+: _valueSize(valueSize),
+  _capacity(capacity),
+  _buffer(nullptr),
+  _mask(0),
+  _head(0),
+  _count(0),
+  _closed(false)
+{
+    if (capacity == 0) {
+        return;
+    }
+
+    // Round the ring up to a power of two, so positions wrap with a mask.
+    unsigned int size = 1;
+    while (size < (unsigned int) capacity) {
+        size <<= 1;
+    }
+    _mask = size - 1;
+
+    _buffer = new(nothrow) char[(size_t) size * valueSize];
+    if (_buffer == nullptr) {
+        ErrorHandler::sysCallError(THREAD_SYS_CALL_ERROR_BAD_ALLOC);
+    }
+}
+
+/**
+ * D-tor.
+ */
+Channel::~Channel()
+{
+    delete[] _buffer;
+}
+
+//------------------------------OPERATIONS-----------------------------------//
+
+/**
+ * Sends a value, if that does not have to wait: the value is handed to the
+ * first waiting receiver, or else buffered.
+ * @param scheduler the Scheduler, which wakes up the receiver.
+ * @param value the value.
+ * @return CHANNEL_DONE, CHANNEL_FULL if the sender has to wait, or
+ * CHANNEL_CLOSED.
+ */
+int Channel::send(Scheduler *scheduler, const void *value)
+{
+    if (_closed) {
+        return CHANNEL_CLOSED;
+    }
+
+    // Receivers only wait while the buffer is empty.
+    Thread *receiver = _receivers.front();
+    if (receiver != nullptr) {
+        memcpy(receiver->getWaitData(), value, _valueSize);
+        receiver->setWaitData(nullptr);
+        scheduler->wakeWaiter(&_receivers);
+        return CHANNEL_DONE;
+    }
+
+    if (_count == _capacity) {
+        return CHANNEL_FULL;
+    }
+    memcpy(_slot(_count), value, _valueSize);
+    _count++;
+    return CHANNEL_DONE;
+}
+
+/**
+ * Receives a value, if that does not have to wait: the first buffered
+ * value, or else the value of the first waiting sender.
+ * @param scheduler the Scheduler, which wakes up a sender.
+ * @param value where the value goes.
+ * @return CHANNEL_DONE, CHANNEL_EMPTY if the receiver has to wait, or
+ * CHANNEL_CLOSED once the channel is closed and drained.
+ */
+int Channel::receive(Scheduler *scheduler, void *value)
+{
+    // Senders only wait while the buffer is full.
+    Thread *sender = _senders.front();
+
+    if (_count > 0) {
+        memcpy(value, _slot(0), _valueSize);
+        _head = (_head + 1) & _mask;
+        _count--;
+
+        // The first waiting sender takes the freed slot.
+        if (sender != nullptr) {
+            memcpy(_slot(_count), sender->getWaitData(), _valueSize);
+            _count++;
+            sender->setWaitData(nullptr);
+            scheduler->wakeWaiter(&_senders);
+        }
+        return CHANNEL_DONE;
+    }
+
+    if (sender != nullptr) {
+        memcpy(value, sender->getWaitData(), _valueSize);
+        sender->setWaitData(nullptr);
+        scheduler->wakeWaiter(&_senders);
+        return CHANNEL_DONE;
+    }
+
+    return _closed ? CHANNEL_CLOSED : CHANNEL_EMPTY;
+}
+
+/**
+ * Closes the channel, and wakes up all of the waiting Threads, whose values
+ * are not handed over. Buffered values may still be received.
+ * @param scheduler the Scheduler, which wakes up the Threads.
+ * @return SUCCESS, or FAILURE if the channel is closed already.
+ */
+int Channel::close(Scheduler *scheduler)
+{
+    if (_closed) {
+        return FAILURE;
+    }
+    _closed = true;
+    scheduler->wakeAllWaiters(&_receivers);
+    scheduler->wakeAllWaiters(&_senders);
+    return SUCCESS;
+}
+
+//--------------------------------GETTERS------------------------------------//
+
+/**
+ * Getter for the queue of the Threads waiting to send.
+ * @return the queue.
+ */
+ThreadQueue *Channel::senders()
+{
+    return &_senders;
+}
+
+/**
+ * Getter for the queue of the Threads waiting to receive.
+ * @return the queue.
+ */
+ThreadQueue *Channel::receivers()
+{
+    return &_receivers;
+}
+
+/**
+ * Checks whether Threads wait on the channel.
+ * @return true if so, false otherwise.
+ */
+bool Channel::hasWaiters() const
+{
+    return !_senders.isEmpty() || !_receivers.isEmpty();
+}
+
+/**
+ * Getter for the address of a buffered value.
+ * @param index the index of the value, 0 for the first one.
+ * @return the address.
+ */
+char *Channel::_slot(int index) const
+{
+    return _buffer + (size_t) ((_head + index) & _mask) * _valueSize;
+}
@@ -0,0 +1,134 @@
+#ifndef EX2_CHANNEL_H
+#define EX2_CHANNEL_H
+
+#include "Scheduler.h"
+
+// The results of the channel operations that do not wait.
+#define CHANNEL_DONE 0
+#define CHANNEL_FULL 1
+#define CHANNEL_EMPTY 2
+#define CHANNEL_CLOSED 3
+
+// The largest capacity of a channel.
+#define MAX_CHANNEL_CAPACITY (1 << 30)
+
+/*
+ * A bounded channel of fixed-size values between Threads. The buffered
+ * values are kept in a ring buffer whose size is a power of two, allocated
+ * once. Threads that wait to send or to receive are kept in two queues
+ * (see Scheduler::waitOn), with a pointer to the value they send, or to
+ * where the value they receive goes, as their wait data. A value is handed
+ * straight to a waiting receiver, without passing through the buffer, and
+ * a receiver refills the buffer from the first waiting sender. The wait
+ * data of a Thread is reset to nullptr once its value was handed over.
+ * An unbuffered channel (of capacity 0) only hands values over.
+ * The channel is guarded by the library (and the Scheduler's lock).
+ */
+class Channel
+{
+public:
+
+    /**
+     * C-tor. Creates an empty, open channel.
+     * @param valueSize the size of a value in bytes, a positive number.
+     * @param capacity the number of values the channel buffers, between 0
+     * and MAX_CHANNEL_CAPACITY.
+     */
+    Channel(int valueSize, int capacity);
+
+    /**
+     * D-tor.
+     */
+    ~Channel();
+
+    /**
+     * Sends a value, if that does not have to wait: the value is handed to
+     * the first waiting receiver, or else buffered.
+     * @param scheduler the Scheduler, which wakes up the receiver.
+     * @param value the value.
+     * @return CHANNEL_DONE, CHANNEL_FULL if the sender has to wait, or
+     * CHANNEL_CLOSED.
+     */
+    int send(Scheduler *scheduler, const void *value);
+
+    /**
+     * Receives a value, if that does not have to wait: the first buffered
+     * value, or else the value of the first waiting sender.
+     * @param scheduler the Scheduler, which wakes up a sender.
+     * @param value where the value goes.
+     * @return CHANNEL_DONE, CHANNEL_EMPTY if the receiver has to wait, or
+     * CHANNEL_CLOSED once the channel is closed and drained.
+     */
+    int receive(Scheduler *scheduler, void *value);
+
+    /**
+     * Closes the channel, and wakes up all of the waiting Threads, whose
+     * values are not handed over. Buffered values may still be received.
+     * @param scheduler the Scheduler, which wakes up the Threads.
+     * @return SUCCESS, or FAILURE if the channel is closed already.
+     */
+    int close(Scheduler *scheduler);
+
+    /**
+     * Getter for the queue of the Threads waiting to send.
+     * @return the queue.
+     */
+    ThreadQueue *senders();
+
+    /**
+     * Getter for the queue of the Threads waiting to receive.
+     * @return the queue.
+     */
+    ThreadQueue *receivers();
+
+    /**
+     * Checks whether Threads wait on the channel.
+     * @return true if so, false otherwise.
+     */
+    bool hasWaiters() const;
+
+private:
+
+    /**
+     * The size of a value in bytes.
+     */
+    int _valueSize;
+
+    /**
+     * The number of values the channel buffers.
+     */
+    int _capacity;
+
+    /**
+     * The ring buffer, of a power of two values (nullptr if the capacity is
+     * 0), and the mask that wraps positions in it.
+     */
+    char *_buffer;
+    unsigned int _mask;
+
+    /**
+     * The position of the first buffered value, and the number of them.
+     */
+    unsigned int _head;
+    int _count;
+
+    /**
+     * Set once the channel is closed.
+     */
+    bool _closed;
+
+    /**
+     * The Threads waiting to send, and to receive.
+     */
+    ThreadQueue _senders;
+    ThreadQueue _receivers;
+
+    /**
+     * Getter for the address of a buffered value.
+     * @param index the index of the value, 0 for the first one.
+     * @return the address.
+     */
+    char *_slot(int index) const;
+};
+
+#endif //EX2_CHANNEL_H
@@ -20,12 +20,29 @@
 #define THREAD_LIB_ERROR_NEGATIVE_QUANTUM "Quantoms must be positive"
 #define THREAD_LIB_ERROR_INPUT "Invalid input"
 #define THREAD_LIB_ERROR_THREADS_AMOUNT "Already reached max number of threads"
+#define THREAD_LIB_ERROR_POLICY "Not supported by the scheduling policy"
+#define THREAD_LIB_ERROR_NOT_READY "Thread is not ready to run"
+#define THREAD_LIB_ERROR_SCHED_EXISTS "Kernel thread already runs a scheduler"
+#define THREAD_LIB_ERROR_NOT_OWNER "Scheduler is not run by this kernel thread"
+#define THREAD_LIB_ERROR_NOT_LOCKED "Mutex is not locked"
+#define THREAD_LIB_ERROR_LOCKED "Mutex is locked"
+#define THREAD_LIB_ERROR_WAITING "Threads are waiting on it"
+#define THREAD_LIB_ERROR_SEM_OVERFLOW "Semaphore value is too large"
+#define THREAD_LIB_ERROR_CHAN_CLOSED "Channel is closed"
+#define THREAD_LIB_ERROR_JOIN_SELF "Thread can not join itself"
+#define THREAD_LIB_ERROR_DETACHED "Thread is detached"
+#define THREAD_LIB_ERROR_JOINED "Thread is already being joined"
+#define THREAD_LIB_ERROR_KEYS "Already reached max number of keys"
+#define THREAD_LIB_ERROR_NO_THREAD "Kernel thread runs no thread"
 
 // Sys Call failures:
 #define THREAD_SYS_CALL_ERROR_BAD_ALLOC "Allocation failed"
 #define THREAD_SYS_CALL_ERROR_TIMER_FAILED "Timer usage failure"
 #define THREAD_SYS_CALL_ERROR_SIGNAL_HANDLE "Signal handling failure"
 #define THREAD_SYS_CALL_ERROR_TIMER "Time initialization failed"
+#define THREAD_SYS_CALL_ERROR_WORKER "Worker creation failed"
+#define THREAD_SYS_CALL_ERROR_POLL "I/O polling failure"
+#define THREAD_SYS_CALL_ERROR_OFFLOAD "Offload helper creation failed"
 
 using namespace std;
 
@@ -0,0 +1,191 @@
+#include "FairQueue.h"
+
+//-----------------------------CONSTRUCTORS----------------------------------//
+
+/**
+ * C-tor. Creates an empty queue.
+ */
+FairQueue::FairQueue()
+: _root(nullptr),
+  _pushCount(0)
+{
+}
+
+//------------------------------OPERATIONS-----------------------------------//
+
+/**
+ * Adds a Thread, keyed on its virtual runtime.
+ * @param thread the Thread to add. Must not be in the queue.
+ * @return None.
+ */
+void FairQueue::push(Thread *thread)
+{
+    thread->_fairOrder = _pushCount++;
+    thread->_fairChild = nullptr;
+    thread->_fairSibling = nullptr;
+    thread->_fairPrev = nullptr;
+    thread->_inFairQueue = true;
+
+    _root = (_root == nullptr) ? thread : _meld(_root, thread);
+}
+
+/**
+ * Getter for the Thread with the lowest virtual runtime.
+ * @return the Thread, or nullptr if the queue is empty.
+ */
+Thread *FairQueue::top() const
+{
+    return _root;
+}
+
+/**
+ * Removes the Thread with the lowest virtual runtime.
+ * @return the removed Thread, or nullptr if the queue is empty.
+ */
+Thread *FairQueue::pop()
+{
+    Thread *thread = _root;
+
+    if (thread != nullptr) {
+        remove(thread);
+    }
+    return thread;
+}
+
+/**
+ * Removes a Thread from the queue.
+ * @param thread the Thread to remove. Must be in the queue.
+ * @return None.
+ */
+void FairQueue::remove(Thread *thread)
+{
+    Thread *children = _mergePairs(thread->_fairChild);
+
+    if (thread == _root) {
+        _root = children;
+    }
+    else {
+        // Cut the Thread's subtree out of the heap. _fairPrev is the parent
+        // of a first child, and the previous sibling of any other child.
+        if (thread->_fairPrev->_fairChild == thread) {
+            thread->_fairPrev->_fairChild = thread->_fairSibling;
+        }
+        else {
+            thread->_fairPrev->_fairSibling = thread->_fairSibling;
+        }
+        if (thread->_fairSibling != nullptr) {
+            thread->_fairSibling->_fairPrev = thread->_fairPrev;
+        }
+
+        if (children != nullptr) {
+            _root = _meld(_root, children);
+        }
+    }
+
+    thread->_fairChild = nullptr;
+    thread->_fairSibling = nullptr;
+    thread->_fairPrev = nullptr;
+    thread->_inFairQueue = false;
+}
+
+/**
+ * Checks whether a Thread is in the queue.
+ * @param thread the Thread to look for.
+ * @return true if the Thread is in the queue, false otherwise.
+ */
+bool FairQueue::contains(const Thread *thread) const
+{
+    return thread->_inFairQueue;
+}
+
+/**
+ * Checks whether the queue is empty.
+ * @return true if the queue is empty, false otherwise.
+ */
+bool FairQueue::isEmpty() const
+{
+    return _root == nullptr;
+}
+
+//-------------------------------HEAP HELPERS--------------------------------//
+
+/**
+ * Checks whether one Thread should run before another.
+ * @param a the first Thread.
+ * @param b the second Thread.
+ * @return true if a comes before b.
+ */
+bool FairQueue::_before(const Thread *a, const Thread *b)
+{
+    if (a->_vruntime != b->_vruntime) {
+        return a->_vruntime < b->_vruntime;
+    }
+    return a->_fairOrder < b->_fairOrder;
+}
+
+/**
+ * Melds two heaps whose roots have no siblings.
+ * @param a the root of the first heap.
+ * @param b the root of the second heap.
+ * @return the root of the melded heap.
+ */
+Thread *FairQueue::_meld(Thread *a, Thread *b)
+{
+    if (_before(b, a)) {
+        Thread *temp = a;
+        a = b;
+        b = temp;
+    }
+
+    // b becomes the first child of a.
+    b->_fairSibling = a->_fairChild;
+    if (a->_fairChild != nullptr) {
+        a->_fairChild->_fairPrev = b;
+    }
+    b->_fairPrev = a;
+    a->_fairChild = b;
+    return a;
+}
+
+/**
+ * Melds a list of sibling heaps into one (the two-pass pairing).
+ * @param first the first heap in the list, may be nullptr.
+ * @return the root of the melded heap, or nullptr if the list is empty.
+ */
+Thread *FairQueue::_mergePairs(Thread *first)
+{
+    // First pass: meld the heaps in pairs from left to right, collecting the
+    // results in reverse order (linked through _fairSibling).
+    Thread *pairs = nullptr;
+    while (first != nullptr) {
+        Thread *a = first;
+        Thread *b = a->_fairSibling;
+        first = (b != nullptr) ? b->_fairSibling : nullptr;
+
+        a->_fairSibling = nullptr;
+        a->_fairPrev = nullptr;
+        if (b != nullptr) {
+            b->_fairSibling = nullptr;
+            b->_fairPrev = nullptr;
+            a = _meld(a, b);
+        }
+        a->_fairSibling = pairs;
+        pairs = a;
+    }
+
+    if (pairs == nullptr) {
+        return nullptr;
+    }
+
+    // Second pass: meld the pairs from right to left into one heap.
+    Thread *root = pairs;
+    pairs = root->_fairSibling;
+    root->_fairSibling = nullptr;
+    while (pairs != nullptr) {
+        Thread *next = pairs->_fairSibling;
+        pairs->_fairSibling = nullptr;
+        root = _meld(root, pairs);
+        pairs = next;
+    }
+    return root;
+}
@@ -0,0 +1,98 @@
+#ifndef EX2_FAIRQUEUE_H
+#define EX2_FAIRQUEUE_H
+
+#include "Thread.h"
+
+/*
+ * The ready Threads of the fair-share policy, kept in a pairing heap ordered
+ * by virtual runtime (Threads with equal virtual runtimes come out in the
+ * order they were added). Like ThreadQueue, the heap links live inside the
+ * Threads, so nothing is ever allocated. Adding and finding the Thread with
+ * the lowest virtual runtime are O(1), removing it (or any other Thread) is
+ * O(log n) amortized.
+ */
+class FairQueue
+{
+public:
+
+    /**
+     * C-tor. Creates an empty queue.
+     */
+    FairQueue();
+
+    /**
+     * Adds a Thread, keyed on its virtual runtime.
+     * @param thread the Thread to add. Must not be in the queue.
+     * @return None.
+     */
+    void push(Thread *thread);
+
+    /**
+     * Getter for the Thread with the lowest virtual runtime.
+     * @return the Thread, or nullptr if the queue is empty.
+     */
+    Thread *top() const;
+
+    /**
+     * Removes the Thread with the lowest virtual runtime.
+     * @return the removed Thread, or nullptr if the queue is empty.
+     */
+    Thread *pop();
+
+    /**
+     * Removes a Thread from the queue.
+     * @param thread the Thread to remove. Must be in the queue.
+     * @return None.
+     */
+    void remove(Thread *thread);
+
+    /**
+     * Checks whether a Thread is in the queue.
+     * @param thread the Thread to look for.
+     * @return true if the Thread is in the queue, false otherwise.
+     */
+    bool contains(const Thread *thread) const;
+
+    /**
+     * Checks whether the queue is empty.
+     * @return true if the queue is empty, false otherwise.
+     */
+    bool isEmpty() const;
+
+private:
+
+    /**
+     * The root of the heap.
+     */
+    Thread *_root;
+
+    /**
+     * The number of Threads ever added (used to order equal runtimes).
+     */
+    unsigned long _pushCount;
+
+    /**
+     * Checks whether one Thread should run before another.
+     * @param a the first Thread.
+     * @param b the second Thread.
+     * @return true if a comes before b.
+     */
+    static bool _before(const Thread *a, const Thread *b);
+
+    /**
+     * Melds two heaps whose roots have no siblings.
+     * @param a the root of the first heap.
+     * @param b the root of the second heap.
+     * @return the root of the melded heap.
+     */
+    static Thread *_meld(Thread *a, Thread *b);
+
+    /**
+     * Melds a list of sibling heaps into one (the two-pass pairing).
+     * @param first the first heap in the list, may be nullptr.
+     * @return the root of the melded heap, or nullptr if the list is empty.
+     */
+    static Thread *_mergePairs(Thread *first);
+};
+
+#endif //EX2_FAIRQUEUE_H
@@ -0,0 +1,146 @@
+#include "FairSharePolicy.h"
+
+#include <time.h>
+
+#define NSECS_PER_SECOND 1000000000LL
+
+template class PolicyAdapter<FairSharePolicy>;
+
+//-----------------------------CONSTRUCTORS----------------------------------//
+
+/**
+ * C-tor. Creates a policy without READY Threads.
+ * @param threads the Scheduler's Thread table (unused).
+ * @param maxThreads the size of the Thread table (unused).
+ * @param totalQuantums the Scheduler's total quantum counter (unused).
+ */
+FairSharePolicy::FairSharePolicy(Thread **threads, int maxThreads,
+                                 const int *totalQuantums)
+: _minVruntime(0)
+{
+}
+
+//--------------------------------HOOKS--------------------------------------//
+
+/**
+ * Adds a Thread that became READY, keyed on its virtual runtime.
+ * @param thread the Thread.
+ * @return None.
+ */
+void FairSharePolicy::enqueue(Thread *thread)
+{
+    _readyThreads.push(thread);
+}
+
+/**
+ * Removes a READY Thread, and starts timing it, as it may be about to run
+ * (yielded to).
+ * @param thread the Thread.
+ * @return None.
+ */
+void FairSharePolicy::dequeue(Thread *thread)
+{
+    _readyThreads.remove(thread);
+    thread->setRunStart(_cpuTime());
+}
+
+/**
+ * Removes the READY Thread with the lowest virtual runtime, and starts
+ * timing it.
+ * @return the Thread, or nullptr if there are no READY Threads.
+ */
+Thread *FairSharePolicy::pickNext()
+{
+    Thread *thread = _readyThreads.pop();
+
+    if (thread != nullptr) {
+        if (thread->getVirtualRuntime() > _minVruntime) {
+            _minVruntime = thread->getVirtualRuntime();
+        }
+        thread->setRunStart(_cpuTime());
+    }
+    return thread;
+}
+
+/**
+ * Called when the RUNNING Thread used up its quantum. Charges it for
+ * the CPU time it used.
+ * @param thread the Thread.
+ * @return None.
+ */
+void FairSharePolicy::onTick(Thread *thread)
+{
+    _chargeRuntime(thread);
+}
+
+/**
+ * Called when the RUNNING Thread blocked or slept. Charges it for the CPU
+ * time it used.
+ * @param thread the Thread.
+ * @return None.
+ */
+void FairSharePolicy::onBlock(Thread *thread)
+{
+    _chargeRuntime(thread);
+}
+
+/**
+ * Called when the RUNNING Thread yielded. Charges it for the CPU time it
+ * used.
+ * @param thread the Thread.
+ * @return None.
+ */
+void FairSharePolicy::onYield(Thread *thread)
+{
+    _chargeRuntime(thread);
+}
+
+/**
+ * Called before a new, resumed or woken Thread is enqueued. Raises its
+ * virtual runtime to no less than SLEEPER_CREDIT below _minVruntime, so
+ * that time spent off the CPU does not earn it a burst.
+ * @param thread the Thread.
+ * @return None.
+ */
+void FairSharePolicy::onWake(Thread *thread)
+{
+    if (thread->getVirtualRuntime() < _minVruntime - SLEEPER_CREDIT) {
+        thread->setVirtualRuntime(_minVruntime - SLEEPER_CREDIT);
+    }
+}
+
+//-------------------------------UTILITIES-----------------------------------//
+
+/**
+ * Getter for the CPU time of the calling kernel thread.
+ * @return the CPU time in nano-seconds.
+ */
+long long FairSharePolicy::_cpuTime()
+{
+    struct timespec now;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &now);
+    return now.tv_sec * NSECS_PER_SECOND + now.tv_nsec;
+}
+
+/**
+ * Charges a Thread for the CPU time it used since it was picked.
+ * @param thread the Thread.
+ * @return None.
+ */
+void FairSharePolicy::_chargeRuntime(Thread *thread)
+{
+    // A Thread is picked and switched out on the same kernel thread. One
+    // that was not picked by this policy (the main Thread, or one running
+    // as the policy was selected) is not charged for the time before.
+    long long used = 0;
+    if (thread->getRunStart() != RUN_START_NOT_SET) {
+        used = _cpuTime() - thread->getRunStart();
+    }
+    thread->setRunStart(RUN_START_NOT_SET);
+
+    long long charge = used * DEFAULT_WEIGHT / thread->getWeight();
+    if (charge < 1) {
+        charge = 1;
+    }
+    thread->setVirtualRuntime(thread->getVirtualRuntime() + charge);
+}
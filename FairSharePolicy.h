@@ -0,0 +1,114 @@
+#ifndef EX2_FAIRSHAREPOLICY_H
+#define EX2_FAIRSHAREPOLICY_H
+
+#include "SchedulingPolicy.h"
+#include "FairQueue.h"
+
+// How far behind the least virtual runtime a woken thread may be placed, in
+// nano-seconds of CPU time of a thread of DEFAULT_WEIGHT.
+#define SLEEPER_CREDIT 1000000LL
+
+/*
+ * The weighted fair-share policy. READY Threads are kept in a FairQueue,
+ * and the one with the lowest virtual runtime runs next. The CPU time a
+ * Thread used each time it ran (on the CPU clock of its kernel thread, from
+ * when it was picked until it gave the CPU up), times DEFAULT_WEIGHT /
+ * weight, is added to its virtual runtime, so Threads get CPU time in
+ * proportion to their weights, whether they use up their quantums or not.
+ */
+class FairSharePolicy
+{
+public:
+
+    /**
+     * C-tor. Creates a policy without READY Threads.
+     * @param threads the Scheduler's Thread table (unused).
+     * @param maxThreads the size of the Thread table (unused).
+     * @param totalQuantums the Scheduler's total quantum counter (unused).
+     */
+    FairSharePolicy(Thread **threads, int maxThreads, const int *totalQuantums);
+
+    /**
+     * Adds a Thread that became READY, keyed on its virtual runtime.
+     * @param thread the Thread.
+     * @return None.
+     */
+    void enqueue(Thread *thread);
+
+    /**
+     * Removes a READY Thread, and starts timing it, as it may be about to
+     * run (yielded to).
+     * @param thread the Thread.
+     * @return None.
+     */
+    void dequeue(Thread *thread);
+
+    /**
+     * Removes the READY Thread with the lowest virtual runtime, and starts
+     * timing it.
+     * @return the Thread, or nullptr if there are no READY Threads.
+     */
+    Thread *pickNext();
+
+    /**
+     * Called when the RUNNING Thread used up its quantum. Charges it for
+     * the CPU time it used.
+     * @param thread the Thread.
+     * @return None.
+     */
+    void onTick(Thread *thread);
+
+    /**
+     * Called when the RUNNING Thread blocked or slept. Charges it for the
+     * CPU time it used.
+     * @param thread the Thread.
+     * @return None.
+     */
+    void onBlock(Thread *thread);
+
+    /**
+     * Called when the RUNNING Thread yielded. Charges it for the CPU time it
+     * used.
+     * @param thread the Thread.
+     * @return None.
+     */
+    void onYield(Thread *thread);
+
+    /**
+     * Called before a new, resumed or woken Thread is enqueued. Raises its
+     * virtual runtime to no less than SLEEPER_CREDIT below _minVruntime, so
+     * that time spent off the CPU does not earn it a burst.
+     * @param thread the Thread.
+     * @return None.
+     */
+    void onWake(Thread *thread);
+
+private:
+
+    /**
+     * The READY Threads, lowest virtual runtime first.
+     */
+    FairQueue _readyThreads;
+
+    /**
+     * The virtual runtime of the last Thread picked. Never decreases.
+     */
+    long long _minVruntime;
+
+    /**
+     * Getter for the CPU time of the calling kernel thread.
+     * @return the CPU time in nano-seconds.
+     */
+    static long long _cpuTime();
+
+    /**
+     * Charges a Thread for the CPU time it used since it was picked.
+     * @param thread the Thread.
+     * @return None.
+     */
+    void _chargeRuntime(Thread *thread);
+};
+
+extern template class PolicyAdapter<FairSharePolicy>;
+
+#endif //EX2_FAIRSHAREPOLICY_H
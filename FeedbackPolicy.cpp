@@ -0,0 +1,195 @@
+#include "FeedbackPolicy.h"
+
+template class PolicyAdapter<FeedbackPolicy>;
+
+//-----------------------------CONSTRUCTORS----------------------------------//
+
+/**
+ * C-tor. Creates a policy without READY Threads.
+ * @param threads the Scheduler's Thread table (unused).
+ * @param maxThreads the size of the Thread table (unused).
+ * @param totalQuantums the Scheduler's total quantum counter.
+ */
+FeedbackPolicy::FeedbackPolicy(Thread **threads, int maxThreads,
+                               const int *totalQuantums)
+: _totalQuantums(totalQuantums),
+  _readyLevels(0),
+  _resetEpoch(_currentEpoch())
+{
+}
+
+//--------------------------------HOOKS--------------------------------------//
+
+/**
+ * Adds a Thread that became READY to the back of the queue of its
+ * priority level.
+ * @param thread the Thread.
+ * @return None.
+ */
+void FeedbackPolicy::enqueue(Thread *thread)
+{
+    _catchUp();
+    int priority = thread->getPriority();
+
+    _readyThreads[priority].pushBack(thread);
+    _readyLevels |= 1U << priority;
+}
+
+/**
+ * Removes a READY Thread from the queue of its priority level.
+ * @param thread the Thread.
+ * @return None.
+ */
+void FeedbackPolicy::dequeue(Thread *thread)
+{
+    int priority = thread->getPriority();
+
+    _readyThreads[priority].remove(thread);
+    if (_readyThreads[priority].isEmpty()) {
+        _readyLevels &= ~(1U << priority);
+    }
+}
+
+/**
+ * Removes the first Thread of the highest non-empty priority level.
+ * @return the Thread, or nullptr if there are no READY Threads.
+ */
+Thread *FeedbackPolicy::pickNext()
+{
+    if (_readyLevels == 0) {
+        return nullptr;
+    }
+
+    // The highest priority level with ready threads.
+    int priority = __builtin_ctz(_readyLevels);
+    Thread *thread = _readyThreads[priority].popFront();
+
+    if (_readyThreads[priority].isEmpty()) {
+        _readyLevels &= ~(1U << priority);
+    }
+    return thread;
+}
+
+/**
+ * Called when the RUNNING Thread used up its quantum. Drops it a level.
+ * @param thread the Thread.
+ * @return None.
+ */
+void FeedbackPolicy::onTick(Thread *thread)
+{
+    _catchUp();
+    _lift(thread);
+    _adjustPriority(thread, 1);
+}
+
+/**
+ * Called when the RUNNING Thread blocked or slept. Raises it a level.
+ * @param thread the Thread.
+ * @return None.
+ */
+void FeedbackPolicy::onBlock(Thread *thread)
+{
+    _catchUp();
+    _lift(thread);
+    _adjustPriority(thread, -1);
+}
+
+/**
+ * Called when the RUNNING Thread yielded. Keeps its level, unless a reset
+ * passed since it last ran.
+ * @param thread the Thread.
+ * @return None.
+ */
+void FeedbackPolicy::onYield(Thread *thread)
+{
+    _catchUp();
+    _lift(thread);
+}
+
+/**
+ * Called before a new, resumed or woken Thread is enqueued. Returns it to
+ * TOP_PRIORITY if a reset passed since it last ran.
+ * @param thread the Thread.
+ * @return None.
+ */
+void FeedbackPolicy::onWake(Thread *thread)
+{
+    _catchUp();
+    _lift(thread);
+}
+
+//-------------------------------UTILITIES-----------------------------------//
+
+/**
+ * Moves a Thread's priority level by delta, within the valid levels.
+ * @param thread the Thread, which must not be READY.
+ * @param delta the number of levels to move by (positive is lower).
+ * @return None.
+ */
+void FeedbackPolicy::_adjustPriority(Thread *thread, int delta)
+{
+    int priority = thread->getPriority() + delta;
+
+    if (priority < TOP_PRIORITY) {
+        priority = TOP_PRIORITY;
+    }
+    else if (priority >= PRIORITY_LEVELS) {
+        priority = PRIORITY_LEVELS - 1;
+    }
+    thread->setPriority(priority);
+}
+
+/**
+ * Getter for the current reset epoch.
+ * @return the number of resets since the Scheduler started.
+ */
+int FeedbackPolicy::_currentEpoch() const
+{
+    // Other workers count quantums meanwhile.
+    return __atomic_load_n(_totalQuantums, __ATOMIC_RELAXED) /
+           FEEDBACK_RESET_PERIOD;
+}
+
+/**
+ * Returns the READY Threads to TOP_PRIORITY if a new reset epoch started
+ * since the last time.
+ * @return None.
+ */
+void FeedbackPolicy::_catchUp()
+{
+    int epoch = _currentEpoch();
+    if (epoch == _resetEpoch) {
+        return;
+    }
+    _resetEpoch = epoch;
+
+    // Keep low priority threads from starving: the READY threads of the
+    // lower levels join the top level in order. The top level ones move up
+    // (in place) the next time they run.
+    for (int priority = TOP_PRIORITY + 1; priority < PRIORITY_LEVELS;
+         ++priority) {
+        Thread *thread;
+        while ((thread = _readyThreads[priority].popFront()) != nullptr) {
+            thread->setPriority(TOP_PRIORITY);
+            thread->setResetEpoch(epoch);
+            _readyThreads[TOP_PRIORITY].pushBack(thread);
+        }
+    }
+    if (!_readyThreads[TOP_PRIORITY].isEmpty()) {
+        _readyLevels = 1U << TOP_PRIORITY;
+    }
+}
+
+/**
+ * Returns a Thread to TOP_PRIORITY if its level belongs to an older reset
+ * epoch.
+ * @param thread the Thread, which must not be READY.
+ * @return None.
+ */
+void FeedbackPolicy::_lift(Thread *thread)
+{
+    if (thread->getResetEpoch() != _resetEpoch) {
+        thread->setPriority(TOP_PRIORITY);
+        thread->setResetEpoch(_resetEpoch);
+    }
+}
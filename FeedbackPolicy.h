@@ -0,0 +1,148 @@
+#ifndef EX2_FEEDBACKPOLICY_H
+#define EX2_FEEDBACKPOLICY_H
+
+#include "SchedulingPolicy.h"
+#include "ThreadQueue.h"
+
+// Number of priority levels of the multi-level feedback policy.
+#define PRIORITY_LEVELS 8
+#define TOP_PRIORITY 0
+// Every FEEDBACK_RESET_PERIOD quantums (counted by the Scheduler) all threads
+// go back to TOP_PRIORITY.
+#define FEEDBACK_RESET_PERIOD 100
+
+/*
+ * The multi-level feedback policy. READY Threads are queued by priority
+ * level, and the first Thread of the highest non-empty level runs next. A
+ * Thread that uses up its quantum drops a level, a Thread that blocks or
+ * sleeps before that rises a level, a Thread that yields keeps its level
+ * (so yielding often does not keep a busy Thread at the top), and every
+ * FEEDBACK_RESET_PERIOD quantums all Threads return to TOP_PRIORITY so that
+ * none of them starves.
+ *
+ * Each reset starts a new epoch. A policy moves its own READY Threads up
+ * the first time one of its hooks runs in the new epoch, and every other
+ * Thread is moved up the next time it becomes READY or gives up the CPU, so
+ * a reset neither scans the Thread table nor touches the Threads another
+ * policy (another worker's) holds.
+ */
+class FeedbackPolicy
+{
+public:
+
+    /**
+     * C-tor. Creates a policy without READY Threads.
+     * @param threads the Scheduler's Thread table (unused).
+     * @param maxThreads the size of the Thread table (unused).
+     * @param totalQuantums the Scheduler's total quantum counter.
+     */
+    FeedbackPolicy(Thread **threads, int maxThreads, const int *totalQuantums);
+
+    /**
+     * Adds a Thread that became READY to the back of the queue of its
+     * priority level.
+     * @param thread the Thread.
+     * @return None.
+     */
+    void enqueue(Thread *thread);
+
+    /**
+     * Removes a READY Thread from the queue of its priority level.
+     * @param thread the Thread.
+     * @return None.
+     */
+    void dequeue(Thread *thread);
+
+    /**
+     * Removes the first Thread of the highest non-empty priority level.
+     * @return the Thread, or nullptr if there are no READY Threads.
+     */
+    Thread *pickNext();
+
+    /**
+     * Called when the RUNNING Thread used up its quantum. Drops it a level.
+     * @param thread the Thread.
+     * @return None.
+     */
+    void onTick(Thread *thread);
+
+    /**
+     * Called when the RUNNING Thread blocked or slept. Raises it a level.
+     * @param thread the Thread.
+     * @return None.
+     */
+    void onBlock(Thread *thread);
+
+    /**
+     * Called when the RUNNING Thread yielded. Keeps its level, unless a
+     * reset passed since it last ran.
+     * @param thread the Thread.
+     * @return None.
+     */
+    void onYield(Thread *thread);
+
+    /**
+     * Called before a new, resumed or woken Thread is enqueued. Returns it to
+     * TOP_PRIORITY if a reset passed since it last ran.
+     * @param thread the Thread.
+     * @return None.
+     */
+    void onWake(Thread *thread);
+
+private:
+
+    /**
+     * The Scheduler's total quantum counter, which the reset epochs are
+     * derived from.
+     */
+    const int *_totalQuantums;
+
+    /**
+     * Queues that hold the READY Threads of each priority level, in the
+     * order they will run.
+     */
+    ThreadQueue _readyThreads[PRIORITY_LEVELS];
+
+    /**
+     * A bit per priority level, set while the level has READY Threads.
+     */
+    unsigned int _readyLevels;
+
+    /**
+     * The reset epoch the levels of the READY Threads belong to.
+     */
+    int _resetEpoch;
+
+    /**
+     * Getter for the current reset epoch.
+     * @return the number of resets since the Scheduler started.
+     */
+    int _currentEpoch() const;
+
+    /**
+     * Returns the READY Threads to TOP_PRIORITY if a new reset epoch started
+     * since the last time.
+     * @return None.
+     */
+    void _catchUp();
+
+    /**
+     * Returns a Thread to TOP_PRIORITY if its level belongs to an older
+     * reset epoch.
+     * @param thread the Thread, which must not be READY.
+     * @return None.
+     */
+    void _lift(Thread *thread);
+
+    /**
+     * Moves a Thread's priority level by delta, within the valid levels.
+     * @param thread the Thread, which must not be READY.
+     * @param delta the number of levels to move by (positive is lower).
+     * @return None.
+     */
+    void _adjustPriority(Thread *thread, int delta);
+};
+
+extern template class PolicyAdapter<FeedbackPolicy>;
+
+#endif //EX2_FEEDBACKPOLICY_H
@@ -0,0 +1,70 @@
+#include "FramePool.h"
+#include "ErrorHandler.h"
+
+#include <new>
+
+//-----------------------CONSTRUCTORS DESTRUCTORS----------------------------//
+
+/**
+ * C-tor. Creates an empty pool.
+ */
+FramePool::FramePool()
+: _freeFrames()
+{
+}
+
+//------------------------------OPERATIONS-----------------------------------//
+
+/**
+ * Takes a frame from the pool, which is refilled if it is empty.
+ * @param size the size of the frame in bytes.
+ * @return the frame.
+ */
+void *FramePool::allocate(size_t size)
+{
+    size_t sizeClass = (size + FRAME_CLASS_SIZE - 1) / FRAME_CLASS_SIZE - 1;
+    if (size == 0 || sizeClass >= FRAME_CLASSES) {
+        void *frame = ::operator new(size, nothrow);
+        if (frame == nullptr) {
+            ErrorHandler::sysCallError(THREAD_SYS_CALL_ERROR_BAD_ALLOC);
+        }
+        return frame;
+    }
+
+    if (_freeFrames[sizeClass] == nullptr) {
+        size_t frameSize = (sizeClass + 1) * FRAME_CLASS_SIZE;
+        char *chunk = new(nothrow) char[frameSize * FRAME_CHUNK];
+        if (chunk == nullptr) {
+            ErrorHandler::sysCallError(THREAD_SYS_CALL_ERROR_BAD_ALLOC);
+        }
+        for (int i = 0; i < FRAME_CHUNK; ++i) {
+            FreeFrame *frame = reinterpret_cast<FreeFrame *>(
+                    chunk + i * frameSize);
+            frame->next = _freeFrames[sizeClass];
+            _freeFrames[sizeClass] = frame;
+        }
+    }
+
+    FreeFrame *frame = _freeFrames[sizeClass];
+    _freeFrames[sizeClass] = frame->next;
+    return frame;
+}
+
+/**
+ * Returns a frame to the pool.
+ * @param frame the frame.
+ * @param size the size it was allocated with.
+ * @return None.
+ */
+void FramePool::free(void *frame, size_t size)
+{
+    size_t sizeClass = (size + FRAME_CLASS_SIZE - 1) / FRAME_CLASS_SIZE - 1;
+    if (size == 0 || sizeClass >= FRAME_CLASSES) {
+        ::operator delete(frame);
+        return;
+    }
+
+    FreeFrame *freed = static_cast<FreeFrame *>(frame);
+    freed->next = _freeFrames[sizeClass];
+    _freeFrames[sizeClass] = freed;
+}
@@ -0,0 +1,59 @@
+#ifndef EX2_FRAMEPOOL_H
+#define EX2_FRAMEPOOL_H
+
+#include <stddef.h>
+
+// Frames are pooled in classes of multiples of FRAME_CLASS_SIZE bytes, up
+// to FRAME_CLASSES * FRAME_CLASS_SIZE bytes. Larger ones are allocated.
+#define FRAME_CLASS_SIZE 64
+#define FRAME_CLASSES 16
+// The number of frames of a class the pool allocates at once.
+#define FRAME_CHUNK 16
+
+/*
+ * A pool of coroutine frames (see uthread_task.h), with a free list per
+ * size class. Each worker has a pool of its own, which needs no lock: a
+ * frame freed on another worker than the one that allocated it joins that
+ * worker's pool. The chunks frames are carved from are never freed.
+ */
+class FramePool
+{
+public:
+
+    /**
+     * C-tor. Creates an empty pool.
+     */
+    FramePool();
+
+    /**
+     * Takes a frame from the pool, which is refilled if it is empty.
+     * @param size the size of the frame in bytes.
+     * @return the frame.
+     */
+    void *allocate(size_t size);
+
+    /**
+     * Returns a frame to the pool.
+     * @param frame the frame.
+     * @param size the size it was allocated with.
+     * @return None.
+     */
+    void free(void *frame, size_t size);
+
+private:
+
+    /**
+     * A free frame, which links the next one of its class.
+     */
+    struct FreeFrame
+    {
+        FreeFrame *next;
+    };
+
+    /**
+     * The free frames of each class.
+     */
+    FreeFrame *_freeFrames[FRAME_CLASSES];
+};
+
+#endif //EX2_FRAMEPOOL_H
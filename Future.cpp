@@ -0,0 +1,263 @@
+#include "Future.h"
+#include "Scheduler.h"
+
+// The free Futures, shared by the Scheduler instances.
+Future *Future::_freeFutures = nullptr;
+SpinLock Future::_poolLock;
+
+//-----------------------CONSTRUCTORS DESTRUCTORS----------------------------//
+
+/**
+ * C-tor. Creates a free Future (Futures are taken with acquire).
+ */
+Future::Future()
+: _function(nullptr),
+  _continuation(nullptr),
+  _arg(nullptr),
+  _input(nullptr),
+  _complete(false),
+  _value(nullptr),
+  _released(false),
+  _watchers(nullptr),
+  _continuations(nullptr),
+  _next(nullptr)
+{
+}
+
+//------------------------------OPERATIONS-----------------------------------//
+
+/**
+ * Takes a Future from the pool.
+ * @param function the function of the task.
+ * @param arg its argument.
+ * @return the Future.
+ */
+Future *Future::acquire(Function function, void *arg)
+{
+    Future *future = _take();
+    future->_function = function;
+    future->_arg = arg;
+    return future;
+}
+
+/**
+ * Takes a Future from the pool, for a continuation.
+ * @param continuation the function of the continuation.
+ * @param arg its argument (the value is the first one).
+ * @return the Future.
+ */
+Future *Future::acquire(Continuation continuation, void *arg)
+{
+    Future *future = _take();
+    future->_continuation = continuation;
+    future->_arg = arg;
+    return future;
+}
+
+/**
+ * Gives the Future up. It goes back to the pool at once if it is complete,
+ * and otherwise once it completes.
+ * @return None.
+ */
+void Future::release()
+{
+    if (_complete) {
+        _recycle();
+        return;
+    }
+    _released = true;
+}
+
+/**
+ * Returns a Future that was never run to the pool at once.
+ * @return None.
+ */
+void Future::discard()
+{
+    _recycle();
+}
+
+/**
+ * Runs the task (without the Scheduler's lock).
+ * @return the value it computed.
+ */
+void *Future::run()
+{
+    if (_continuation != nullptr) {
+        return _continuation(_input, _arg);
+    }
+    return _function(_arg);
+}
+
+/**
+ * Completes the Future with a value, and wakes up the Threads waiting for
+ * it. Its continuations become ready to run.
+ * @param scheduler the Scheduler, which wakes up the Threads.
+ * @param value the value.
+ * @return the Futures the completing Thread runs next: the continuations,
+ * followed by the Futures that were to run after this one.
+ */
+Future *Future::complete(Scheduler *scheduler, void *value)
+{
+    _complete = true;
+    _value = value;
+    scheduler->wakeAllWaiters(&_waiters);
+    for (Watcher *watcher = _watchers; watcher != nullptr;
+         watcher = watcher->next) {
+        scheduler->wakeWaiter(watcher->queue);
+    }
+
+    // The continuations are handed the value, and run before the rest.
+    Future *runNext = _next;
+    if (_continuations != nullptr) {
+        Future *last = _continuations;
+        for (;;) {
+            last->_input = value;
+            if (last->_next == nullptr) {
+                break;
+            }
+            last = last->_next;
+        }
+        last->_next = runNext;
+        runNext = _continuations;
+    }
+    _continuations = nullptr;
+    _next = nullptr;
+
+    if (_released) {
+        _recycle();
+    }
+    return runNext;
+}
+
+/**
+ * Adds a continuation, which runs once the Future completes.
+ * @param continuation the Future of the continuation.
+ * @return true if it was added, false if the Future is complete (the
+ * continuation was handed the value, and has to be run by the caller).
+ */
+bool Future::addContinuation(Future *continuation)
+{
+    if (_complete) {
+        continuation->_input = _value;
+        return false;
+    }
+
+    // Continuations run in the order they were added.
+    Future **last = &_continuations;
+    while (*last != nullptr) {
+        last = &(*last)->_next;
+    }
+    *last = continuation;
+    continuation->_next = nullptr;
+    return true;
+}
+
+/**
+ * Starts to wake up a Thread waiting for any of several Futures.
+ * @param watcher the Watcher.
+ * @return None.
+ */
+void Future::addWatcher(Watcher *watcher)
+{
+    watcher->next = _watchers;
+    _watchers = watcher;
+}
+
+/**
+ * Stops waking up a Thread waiting for any of several Futures.
+ * @param watcher the Watcher, which was added.
+ * @return None.
+ */
+void Future::removeWatcher(Watcher *watcher)
+{
+    Watcher **link = &_watchers;
+    while (*link != nullptr && *link != watcher) {
+        link = &(*link)->next;
+    }
+    if (*link != nullptr) {
+        *link = watcher->next;
+    }
+}
+
+//--------------------------------GETTERS------------------------------------//
+
+/**
+ * Getter for the queue of the Threads waiting for the Future.
+ * @return the queue.
+ */
+ThreadQueue *Future::waiters()
+{
+    return &_waiters;
+}
+
+/**
+ * Checks whether the Future is complete.
+ * @return true if so, false otherwise.
+ */
+bool Future::isComplete() const
+{
+    return _complete;
+}
+
+/**
+ * Getter for the value of a complete Future.
+ * @return the value.
+ */
+void *Future::value() const
+{
+    return _value;
+}
+
+//--------------------------------HELPERS------------------------------------//
+
+/**
+ * Takes a Future from the pool, which is refilled if it is empty.
+ * @return the Future, reset.
+ */
+Future *Future::_take()
+{
+    _poolLock.lock();
+    if (_freeFutures == nullptr) {
+        // The chunks are never freed: their Futures go back to the pool.
+        Future *chunk = new(nothrow) Future[FUTURE_POOL_CHUNK];
+        if (chunk == nullptr) {
+            _poolLock.unlock();
+            ErrorHandler::sysCallError(THREAD_SYS_CALL_ERROR_BAD_ALLOC);
+        }
+        for (int i = 0; i < FUTURE_POOL_CHUNK; ++i) {
+            chunk[i]._next = (i + 1 < FUTURE_POOL_CHUNK) ? &chunk[i + 1] :
+                             nullptr;
+        }
+        _freeFutures = chunk;
+    }
+
+    Future *future = _freeFutures;
+    _freeFutures = future->_next;
+    _poolLock.unlock();
+
+    future->_next = nullptr;
+    return future;
+}
+
+/**
+ * Returns the Future to the pool.
+ * @return None.
+ */
+void Future::_recycle()
+{
+    _function = nullptr;
+    _continuation = nullptr;
+    _arg = nullptr;
+    _input = nullptr;
+    _complete = false;
+    _value = nullptr;
+    _released = false;
+    _watchers = nullptr;
+    _continuations = nullptr;
+
+    _poolLock.lock();
+    _next = _freeFutures;
+    _freeFutures = this;
+    _poolLock.unlock();
+}
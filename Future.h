@@ -0,0 +1,192 @@
+#ifndef EX2_FUTURE_H
+#define EX2_FUTURE_H
+
+#include "ThreadQueue.h"
+#include "SpinLock.h"
+
+// The number of Futures the pool allocates at once when it runs out.
+#define FUTURE_POOL_CHUNK 64
+
+class Scheduler;
+
+/*
+ * The value a task computes, which Threads wait for. A task is a function
+ * run by a Thread of its own, or a continuation: a function of the value of
+ * another Future, run by the Thread that completes that Future. Completing
+ * a Future wakes up the Threads waiting for it (see Scheduler::waitOn),
+ * and the Threads waiting for any of several Futures through Watchers.
+ * Futures are taken from a pool shared by all of the Scheduler instances,
+ * and go back to it once released and complete. A Future is guarded by the
+ * Scheduler's lock.
+ */
+class Future
+{
+public:
+
+    /**
+     * The function of a task, and the function of a continuation.
+     */
+    typedef void *(*Function)(void *arg);
+    typedef void *(*Continuation)(void *value, void *arg);
+
+    /**
+     * A Thread waiting for any of several Futures: the queue it waits on,
+     * which each of them wakes up once complete.
+     */
+    struct Watcher
+    {
+        ThreadQueue *queue;
+        Watcher *next;
+    };
+
+    /**
+     * C-tor. Creates a free Future (Futures are taken with acquire).
+     */
+    Future();
+
+    /**
+     * Takes a Future from the pool.
+     * @param function the function of the task.
+     * @param arg its argument.
+     * @return the Future.
+     */
+    static Future *acquire(Function function, void *arg);
+
+    /**
+     * Takes a Future from the pool, for a continuation.
+     * @param continuation the function of the continuation.
+     * @param arg its argument (the value is the first one).
+     * @return the Future.
+     */
+    static Future *acquire(Continuation continuation, void *arg);
+
+    /**
+     * Gives the Future up. It goes back to the pool at once if it is
+     * complete, and otherwise once it completes.
+     * @return None.
+     */
+    void release();
+
+    /**
+     * Returns a Future that was never run to the pool at once.
+     * @return None.
+     */
+    void discard();
+
+    /**
+     * Runs the task (without the Scheduler's lock).
+     * @return the value it computed.
+     */
+    void *run();
+
+    /**
+     * Completes the Future with a value, and wakes up the Threads waiting
+     * for it. Its continuations become ready to run.
+     * @param scheduler the Scheduler, which wakes up the Threads.
+     * @param value the value.
+     * @return the Futures the completing Thread runs next: the
+     * continuations, followed by the Futures that were to run after this
+     * one.
+     */
+    Future *complete(Scheduler *scheduler, void *value);
+
+    /**
+     * Adds a continuation, which runs once the Future completes.
+     * @param continuation the Future of the continuation.
+     * @return true if it was added, false if the Future is complete (the
+     * continuation was handed the value, and has to be run by the caller).
+     */
+    bool addContinuation(Future *continuation);
+
+    /**
+     * Starts to wake up a Thread waiting for any of several Futures.
+     * @param watcher the Watcher.
+     * @return None.
+     */
+    void addWatcher(Watcher *watcher);
+
+    /**
+     * Stops waking up a Thread waiting for any of several Futures.
+     * @param watcher the Watcher, which was added.
+     * @return None.
+     */
+    void removeWatcher(Watcher *watcher);
+
+    /**
+     * Getter for the queue of the Threads waiting for the Future.
+     * @return the queue.
+     */
+    ThreadQueue *waiters();
+
+    /**
+     * Checks whether the Future is complete.
+     * @return true if so, false otherwise.
+     */
+    bool isComplete() const;
+
+    /**
+     * Getter for the value of a complete Future.
+     * @return the value.
+     */
+    void *value() const;
+
+private:
+
+    /**
+     * The task: a function or a continuation, its argument, and the value a
+     * continuation is handed.
+     */
+    Function _function;
+    Continuation _continuation;
+    void *_arg;
+    void *_input;
+
+    /**
+     * Whether the Future is complete, and its value.
+     */
+    bool _complete;
+    void *_value;
+
+    /**
+     * Set once the Future was released.
+     */
+    bool _released;
+
+    /**
+     * The Threads waiting for the Future, and for any of several Futures.
+     */
+    ThreadQueue _waiters;
+    Watcher *_watchers;
+
+    /**
+     * The first continuation, which links the others.
+     */
+    Future *_continuations;
+
+    /**
+     * The next Future in the same list: the continuations of a Future, the
+     * Futures a Thread is to run, or the free Futures.
+     */
+    Future *_next;
+
+    /**
+     * The free Futures, and the lock that guards them (the pool is shared
+     * by the Scheduler instances).
+     */
+    static Future *_freeFutures;
+    static SpinLock _poolLock;
+
+    /**
+     * Takes a Future from the pool, which is refilled if it is empty.
+     * @return the Future, reset.
+     */
+    static Future *_take();
+
+    /**
+     * Returns the Future to the pool.
+     * @return None.
+     */
+    void _recycle();
+};
+
+#endif //EX2_FUTURE_H
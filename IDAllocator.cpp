@@ -0,0 +1,101 @@
+#include "IDAllocator.h"
+
+//-----------------------CONSTRUCTORS DESTRUCTORS----------------------------//
+
+/**
+ * C-tor. All IDs start out free.
+ * @param maxIDs the number of IDs to manage.
+ */
+IDAllocator::IDAllocator(int maxIDs)
+: _levelCount(0)
+{
+    // The number of bits on the current level.
+    int bits = maxIDs;
+
+    do {
+        int words = (bits + BITS_PER_WORD - 1) / BITS_PER_WORD;
+
+        _levels[_levelCount] = new(nothrow) bitmapWord[words];
+        if (_levels[_levelCount] == nullptr) {
+            ErrorHandler::sysCallError(THREAD_SYS_CALL_ERROR_BAD_ALLOC);
+        }
+
+        // Set exactly the first 'bits' bits: every ID (or every word of the
+        // level below) starts out free.
+        for (int i = 0; i < words; ++i) {
+            int left = bits - i * BITS_PER_WORD;
+            _levels[_levelCount][i] = (left >= BITS_PER_WORD) ? ~0ULL :
+                                      (1ULL << left) - 1;
+        }
+
+        _levelCount++;
+        bits = words;
+    } while (bits > 1);
+}
+
+/**
+ * D-tor.
+ */
+IDAllocator::~IDAllocator()
+{
+    for (int level = 0; level < _levelCount; ++level) {
+        delete[] _levels[level];
+    }
+}
+
+//------------------------------OPERATIONS-----------------------------------//
+
+/**
+ * Takes the smallest free ID.
+ * @return the ID, or FAILURE if all IDs are taken.
+ */
+int IDAllocator::allocate()
+{
+    int index = 0;
+
+    if (_levels[_levelCount - 1][0] == 0) {
+        return FAILURE;
+    }
+
+    // Follow the lowest set bit from the top word down to an ID.
+    for (int level = _levelCount - 1; level >= 0; --level) {
+        index = index * BITS_PER_WORD +
+                __builtin_ctzll(_levels[level][index]);
+    }
+
+    int ID = index;
+
+    // Mark the ID as taken, and clear the summary bits of words that became
+    // full on the way up.
+    for (int level = 0; level < _levelCount; ++level) {
+        bitmapWord *word = &_levels[level][index / BITS_PER_WORD];
+        *word &= ~(1ULL << (index % BITS_PER_WORD));
+        if (*word != 0) {
+            break;
+        }
+        index /= BITS_PER_WORD;
+    }
+    return ID;
+}
+
+/**
+ * Returns an ID that was taken by allocate().
+ * @param ID the ID to free.
+ * @return None.
+ */
+void IDAllocator::release(int ID)
+{
+    int index = ID;
+
+    // Mark the ID as free, and set the summary bits of words that stop being
+    // full on the way up.
+    for (int level = 0; level < _levelCount; ++level) {
+        bitmapWord *word = &_levels[level][index / BITS_PER_WORD];
+        bool wasFull = (*word == 0);
+        *word |= 1ULL << (index % BITS_PER_WORD);
+        if (!wasFull) {
+            break;
+        }
+        index /= BITS_PER_WORD;
+    }
+}
@@ -0,0 +1,64 @@
+#ifndef EX2_IDALLOCATOR_H
+#define EX2_IDALLOCATOR_H
+
+#include "ErrorHandler.h"
+
+// Number of IDs tracked by a single bitmap word.
+#define BITS_PER_WORD 64
+// Enough levels for any non-negative int number of IDs (64^6 > 2^31).
+#define MAX_BITMAP_LEVELS 6
+
+// A single bitmap word.
+typedef unsigned long long bitmapWord;
+
+/*
+ * Hands out the smallest free ID in [0, maxIDs) using a hierarchical bitmap.
+ * On the lowest level, every bit stands for one ID and is set while that ID
+ * is free. On every level above it, a bit is set while the corresponding word
+ * below it still has a set bit. The smallest free ID is found by following
+ * the lowest set bit (ctz) from the single top word down, which takes one
+ * word per level, i.e. O(log64 maxIDs).
+ */
+class IDAllocator
+{
+public:
+
+    /**
+     * C-tor. All IDs start out free.
+     * @param maxIDs the number of IDs to manage.
+     */
+    IDAllocator(int maxIDs);
+
+    /**
+     * D-tor.
+     */
+    ~IDAllocator();
+
+    /**
+     * Takes the smallest free ID.
+     * @return the ID, or FAILURE if all IDs are taken.
+     */
+    int allocate();
+
+    /**
+     * Returns an ID that was taken by allocate().
+     * @param ID the ID to free.
+     * @return None.
+     */
+    void release(int ID);
+
+private:
+
+    /**
+     * The number of levels of the bitmap.
+     */
+    int _levelCount;
+
+    /**
+     * The words of each level. Level 0 holds a bit per ID, the top level is
+     * a single word.
+     */
+    bitmapWord *_levels[MAX_BITMAP_LEVELS];
+};
+
+#endif //EX2_IDALLOCATOR_H
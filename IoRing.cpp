@@ -0,0 +1,403 @@
+#include "IoRing.h"
+#include "Scheduler.h"
+
+#include <errno.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+// The return value of a failed system call.
+#define SYS_CALL_FAILED -1
+// The number of operations an io_uring probe reports at most.
+#define PROBE_OPS 256
+
+//-----------------------CONSTRUCTORS DESTRUCTORS----------------------------//
+
+/**
+ * C-tor. Creates a ring with no io_uring instance yet.
+ * @param slots the number of requests that may be in flight at once.
+ */
+IoRing::IoRing(int slots)
+: _slotCount(slots),
+  _slots(nullptr),
+  _freeSlot(-1),
+  _woken(0),
+  _ringFd(SYS_CALL_FAILED),
+  _unavailable(false),
+  _sqRing(MAP_FAILED),
+  _cqRing(MAP_FAILED),
+  _sqes(static_cast<struct io_uring_sqe *>(MAP_FAILED)),
+  _sqRingSize(0),
+  _cqRingSize(0),
+  _sqesSize(0),
+  _sqHead(nullptr),
+  _sqTail(nullptr),
+  _sqMask(0),
+  _sqArray(nullptr),
+  _cqHead(nullptr),
+  _cqTail(nullptr),
+  _cqMask(0),
+  _cqes(nullptr),
+  _queued(0),
+  _inFlight(0)
+{
+}
+
+/**
+ * D-tor.
+ */
+IoRing::~IoRing()
+{
+    drain();
+    _close();
+    // The removed Threads whose requests were never submitted are left.
+    for (int slot = 0; _inFlight == 0 && _slots != nullptr &&
+                       slot < _slotCount; ++slot) {
+        delete _slots[slot].orphan;
+    }
+    delete[] _slots;
+}
+
+//------------------------------OPERATIONS-----------------------------------//
+
+/**
+ * Queues a request, which is submitted with the next submit.
+ * @param opcode the operation (IORING_OP_READ, IORING_OP_WRITE or
+ * IORING_OP_FSYNC).
+ * @param fd the file descriptor.
+ * @param buffer the buffer to read into or write from.
+ * @param length the number of bytes.
+ * @param offset the offset in the file.
+ * @return the slot of the request, or IO_RING_UNAVAILABLE.
+ */
+int IoRing::prepare(int opcode, int fd, void *buffer, unsigned int length,
+                    off_t offset)
+{
+    if (_ringFd == SYS_CALL_FAILED && (_unavailable || !_open())) {
+        return IO_RING_UNAVAILABLE;
+    }
+    if (_freeSlot == -1) {
+        return IO_RING_UNAVAILABLE;
+    }
+
+    int slot = _freeSlot;
+    _freeSlot = _slots[slot].next;
+
+    // Every Thread has one request at most, so the submission queue has
+    // room: the kernel consumes all of the entries on every submit.
+    unsigned int tail = *_sqTail;
+    unsigned int index = tail & _sqMask;
+    struct io_uring_sqe *sqe = &_sqes[index];
+    memset(sqe, 0, sizeof(*sqe));
+    sqe->opcode = opcode;
+    sqe->fd = fd;
+    sqe->addr = (unsigned long) buffer;
+    sqe->len = length;
+    sqe->off = offset;
+    sqe->user_data = slot;
+    _sqArray[index] = index;
+
+    // The entry is written before the kernel may see the new tail.
+    __atomic_store_n(_sqTail, tail + 1, __ATOMIC_RELEASE);
+    _queued++;
+    return slot;
+}
+
+/**
+ * Getter for the queue the Thread that made a request waits on.
+ * @param slot the slot of the request.
+ * @return the queue.
+ */
+ThreadQueue *IoRing::waiter(int slot)
+{
+    return &_slots[slot].waiter;
+}
+
+/**
+ * Collects the result of a completed request, and frees its slot.
+ * @param slot the slot of the request.
+ * @return the result, as returned by the system call (or a negated errno
+ * value).
+ */
+int IoRing::collect(int slot)
+{
+    int result = _slots[slot].result;
+    if (_slots[slot].woken != nullptr) {
+        _slots[slot].woken = nullptr;
+        _woken--;
+    }
+    _slots[slot].next = _freeSlot;
+    _freeSlot = slot;
+    return result;
+}
+
+/**
+ * Submits the queued requests.
+ * @return None.
+ */
+void IoRing::submit()
+{
+    if (_queued == 0) {
+        return;
+    }
+
+    // A submission that fails for lack of resources is retried with the
+    // next one.
+    long submitted = syscall(__NR_io_uring_enter, _ringFd, _queued, 0, 0,
+                             nullptr, 0);
+    if (submitted > 0) {
+        _queued -= submitted;
+        _inFlight += submitted;
+    }
+}
+
+/**
+ * Wakes up the Threads whose requests completed, and deletes the removed
+ * Threads whose requests completed.
+ * @param scheduler the Scheduler, which wakes up the Threads, or nullptr to
+ * wake up none.
+ * @return None.
+ */
+void IoRing::reap(Scheduler *scheduler)
+{
+    if (_inFlight == 0) {
+        return;
+    }
+
+    unsigned int head = *_cqHead;
+    unsigned int tail = __atomic_load_n(_cqTail, __ATOMIC_ACQUIRE);
+    while (head != tail) {
+        struct io_uring_cqe *cqe = &_cqes[head & _cqMask];
+        int slot = (int) cqe->user_data;
+        Slot *request = &_slots[slot];
+        request->result = cqe->res;
+        head++;
+        _inFlight--;
+
+        // The kernel is done with the buffer, so a Thread that was removed
+        // meanwhile can go, and nobody collects its slot.
+        if (request->orphan != nullptr) {
+            delete request->orphan;
+            request->orphan = nullptr;
+            collect(slot);
+            continue;
+        }
+
+        Thread *waiter = request->waiter.front();
+        if (scheduler != nullptr && scheduler->wakeWaiter(&request->waiter)) {
+            request->woken = waiter;
+            _woken++;
+        } else {
+            collect(slot);
+        }
+    }
+    __atomic_store_n(_cqHead, head, __ATOMIC_RELEASE);
+}
+
+/**
+ * Takes over a Thread that is removed while its request is queued or in
+ * flight, and deletes it once the request completes. A removed Thread that
+ * was woken up but did not collect its result gives its slot up.
+ * @param thread the Thread, unlinked from the queue it waited on.
+ * @param queue the queue it waited on, or nullptr.
+ * @return true if the IoRing took the Thread over, false otherwise.
+ */
+bool IoRing::adopt(Thread *thread, ThreadQueue *queue)
+{
+    if (_slots == nullptr) {
+        return false;
+    }
+
+    // A Thread waiting for its request waits on the queue of its slot.
+    char *first = reinterpret_cast<char *>(_slots);
+    char *address = reinterpret_cast<char *>(queue);
+    if (address >= first &&
+        address < reinterpret_cast<char *>(_slots + _slotCount)) {
+        _slots[(address - first) / sizeof(Slot)].orphan = thread;
+        return true;
+    }
+
+    for (int slot = 0; _woken > 0 && slot < _slotCount; ++slot) {
+        if (_slots[slot].woken == thread) {
+            collect(slot);
+        }
+    }
+    return false;
+}
+
+/**
+ * Waits until the requests in flight complete, without waking up any Thread
+ * (when the Threads are about to be deleted).
+ * @return None.
+ */
+void IoRing::drain()
+{
+    while (_inFlight > 0) {
+        if (syscall(__NR_io_uring_enter, _ringFd, 0, 1,
+                    IORING_ENTER_GETEVENTS, nullptr, 0) == SYS_CALL_FAILED &&
+            errno != EINTR) {
+            // The removed Threads are leaked rather than deleted while the
+            // kernel may still use their stacks.
+            return;
+        }
+        reap(nullptr);
+    }
+}
+
+/**
+ * Checks whether requests are queued but not submitted yet.
+ * @return true if so, false otherwise.
+ */
+bool IoRing::hasQueued() const
+{
+    return _queued > 0;
+}
+
+/**
+ * Checks whether requests are queued or in flight.
+ * @return true if so, false otherwise.
+ */
+bool IoRing::isBusy() const
+{
+    return _queued > 0 || _inFlight > 0;
+}
+
+/**
+ * Getter for the file descriptor of the ring, which is readable while
+ * completions wait to be reaped.
+ * @return the file descriptor, or -1 if there is no ring.
+ */
+int IoRing::fd() const
+{
+    return _ringFd;
+}
+
+//--------------------------------HELPERS------------------------------------//
+
+/**
+ * Sets up the io_uring instance, or marks the ring unavailable.
+ * @return true on success, false otherwise.
+ */
+bool IoRing::_open()
+{
+    struct io_uring_params params;
+    memset(&params, 0, sizeof(params));
+
+    _ringFd = (int) syscall(__NR_io_uring_setup, _slotCount, &params);
+    if (_ringFd == SYS_CALL_FAILED) {
+        _unavailable = true;
+        return false;
+    }
+
+    // Both rings share one mapping on kernels that support it.
+    _sqRingSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    _cqRingSize = params.cq_off.cqes +
+                  params.cq_entries * sizeof(struct io_uring_cqe);
+    if (params.features & IORING_FEAT_SINGLE_MMAP) {
+        if (_cqRingSize > _sqRingSize) {
+            _sqRingSize = _cqRingSize;
+        }
+        _cqRingSize = 0;
+    }
+
+    _sqRing = mmap(nullptr, _sqRingSize, PROT_READ | PROT_WRITE,
+                   MAP_SHARED | MAP_POPULATE, _ringFd, IORING_OFF_SQ_RING);
+    _cqRing = _sqRing;
+    if (_sqRing != MAP_FAILED && _cqRingSize != 0) {
+        _cqRing = mmap(nullptr, _cqRingSize, PROT_READ | PROT_WRITE,
+                       MAP_SHARED | MAP_POPULATE, _ringFd,
+                       IORING_OFF_CQ_RING);
+    }
+    _sqesSize = params.sq_entries * sizeof(struct io_uring_sqe);
+    _sqes = static_cast<struct io_uring_sqe *>(
+            mmap(nullptr, _sqesSize, PROT_READ | PROT_WRITE,
+                 MAP_SHARED | MAP_POPULATE, _ringFd, IORING_OFF_SQES));
+    if (_sqRing == MAP_FAILED || _cqRing == MAP_FAILED ||
+        _sqes == MAP_FAILED || !_probe()) {
+        _close();
+        _unavailable = true;
+        return false;
+    }
+
+    char *sq = static_cast<char *>(_sqRing);
+    _sqHead = reinterpret_cast<unsigned int *>(sq + params.sq_off.head);
+    _sqTail = reinterpret_cast<unsigned int *>(sq + params.sq_off.tail);
+    _sqMask = *reinterpret_cast<unsigned int *>(sq + params.sq_off.ring_mask);
+    _sqArray = reinterpret_cast<unsigned int *>(sq + params.sq_off.array);
+
+    char *cq = static_cast<char *>(_cqRing);
+    _cqHead = reinterpret_cast<unsigned int *>(cq + params.cq_off.head);
+    _cqTail = reinterpret_cast<unsigned int *>(cq + params.cq_off.tail);
+    _cqMask = *reinterpret_cast<unsigned int *>(cq + params.cq_off.ring_mask);
+    _cqes = reinterpret_cast<struct io_uring_cqe *>(cq + params.cq_off.cqes);
+
+    _slots = new(nothrow) Slot[_slotCount];
+    if (_slots == nullptr) {
+        ErrorHandler::sysCallError(THREAD_SYS_CALL_ERROR_BAD_ALLOC);
+    }
+    for (int slot = 0; slot < _slotCount; ++slot) {
+        _slots[slot].next = slot + 1 < _slotCount ? slot + 1 : -1;
+        _slots[slot].woken = nullptr;
+        _slots[slot].orphan = nullptr;
+    }
+    _freeSlot = 0;
+    return true;
+}
+
+/**
+ * Checks that the kernel supports the operations used.
+ * @return true if so, false otherwise.
+ */
+bool IoRing::_probe()
+{
+    size_t size = sizeof(struct io_uring_probe) +
+                  PROBE_OPS * sizeof(struct io_uring_probe_op);
+    char *buffer = new(nothrow) char[size]();
+    if (buffer == nullptr) {
+        ErrorHandler::sysCallError(THREAD_SYS_CALL_ERROR_BAD_ALLOC);
+    }
+    struct io_uring_probe *probe =
+            reinterpret_cast<struct io_uring_probe *>(buffer);
+
+    bool supported = false;
+    if (syscall(__NR_io_uring_register, _ringFd, IORING_REGISTER_PROBE,
+                probe, PROBE_OPS) != SYS_CALL_FAILED) {
+        const int opcodes[] = {IORING_OP_READ, IORING_OP_WRITE,
+                               IORING_OP_FSYNC};
+        supported = true;
+        for (int opcode : opcodes) {
+            if (opcode > probe->last_op ||
+                !(probe->ops[opcode].flags & IO_URING_OP_SUPPORTED)) {
+                supported = false;
+            }
+        }
+    }
+
+    delete[] buffer;
+    return supported;
+}
+
+/**
+ * Releases the io_uring instance and its mappings.
+ * @return None.
+ */
+void IoRing::_close()
+{
+    if (_sqes != MAP_FAILED) {
+        munmap(_sqes, _sqesSize);
+    }
+    if (_cqRing != MAP_FAILED && _cqRing != _sqRing) {
+        munmap(_cqRing, _cqRingSize);
+    }
+    if (_sqRing != MAP_FAILED) {
+        munmap(_sqRing, _sqRingSize);
+    }
+    if (_ringFd != SYS_CALL_FAILED) {
+        close(_ringFd);
+    }
+    _sqes = static_cast<struct io_uring_sqe *>(MAP_FAILED);
+    _cqRing = MAP_FAILED;
+    _sqRing = MAP_FAILED;
+    _ringFd = SYS_CALL_FAILED;
+}
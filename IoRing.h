@@ -0,0 +1,214 @@
+#ifndef EX2_IORING_H
+#define EX2_IORING_H
+
+#include "ThreadQueue.h"
+
+#include <linux/io_uring.h>
+#include <sys/types.h>
+
+// Returned by IoRing::prepare when io_uring can not be used.
+#define IO_RING_UNAVAILABLE -1
+
+class Scheduler;
+
+/*
+ * File I/O requests of Threads, over an io_uring instance (set up with raw
+ * system calls the first time a request is made). A Thread queues a
+ * request, which only writes a submission queue entry, and waits on the
+ * request's slot (see Scheduler::waitOn). The queued requests of all of the
+ * Threads are submitted together with one io_uring_enter, and completions
+ * are reaped from the shared completion queue without a system call. Each
+ * Thread has at most one request in flight, so a ring with a slot per
+ * Thread never overflows. A Thread removed while the kernel may still use
+ * the buffer of its request (which may be on its stack) is kept until the
+ * request completes. If the kernel does not support io_uring, or the
+ * operations used, the ring is unavailable and callers do the I/O
+ * themselves. The IoRing is guarded by the Scheduler's lock.
+ */
+class IoRing
+{
+public:
+
+    /**
+     * C-tor. Creates a ring with no io_uring instance yet.
+     * @param slots the number of requests that may be in flight at once.
+     */
+    IoRing(int slots);
+
+    /**
+     * D-tor.
+     */
+    ~IoRing();
+
+    /**
+     * Queues a request, which is submitted with the next submit.
+     * @param opcode the operation (IORING_OP_READ, IORING_OP_WRITE or
+     * IORING_OP_FSYNC).
+     * @param fd the file descriptor.
+     * @param buffer the buffer to read into or write from.
+     * @param length the number of bytes.
+     * @param offset the offset in the file.
+     * @return the slot of the request, or IO_RING_UNAVAILABLE.
+     */
+    int prepare(int opcode, int fd, void *buffer, unsigned int length,
+                off_t offset);
+
+    /**
+     * Getter for the queue the Thread that made a request waits on.
+     * @param slot the slot of the request.
+     * @return the queue.
+     */
+    ThreadQueue *waiter(int slot);
+
+    /**
+     * Collects the result of a completed request, and frees its slot.
+     * @param slot the slot of the request.
+     * @return the result, as returned by the system call (or a negated
+     * errno value).
+     */
+    int collect(int slot);
+
+    /**
+     * Submits the queued requests.
+     * @return None.
+     */
+    void submit();
+
+    /**
+     * Wakes up the Threads whose requests completed, and deletes the
+     * removed Threads whose requests completed.
+     * @param scheduler the Scheduler, which wakes up the Threads, or
+     * nullptr to wake up none.
+     * @return None.
+     */
+    void reap(Scheduler *scheduler);
+
+    /**
+     * Takes over a Thread that is removed while its request is queued or in
+     * flight, and deletes it once the request completes. A removed Thread
+     * that was woken up but did not collect its result gives its slot up.
+     * @param thread the Thread, unlinked from the queue it waited on.
+     * @param queue the queue it waited on, or nullptr.
+     * @return true if the IoRing took the Thread over, false otherwise.
+     */
+    bool adopt(Thread *thread, ThreadQueue *queue);
+
+    /**
+     * Waits until the requests in flight complete, without waking up any
+     * Thread (when the Threads are about to be deleted).
+     * @return None.
+     */
+    void drain();
+
+    /**
+     * Checks whether requests are queued but not submitted yet.
+     * @return true if so, false otherwise.
+     */
+    bool hasQueued() const;
+
+    /**
+     * Checks whether requests are queued or in flight.
+     * @return true if so, false otherwise.
+     */
+    bool isBusy() const;
+
+    /**
+     * Getter for the file descriptor of the ring, which is readable while
+     * completions wait to be reaped.
+     * @return the file descriptor, or -1 if there is no ring.
+     */
+    int fd() const;
+
+private:
+
+    /**
+     * A request: the Thread waiting for it, and its result.
+     */
+    struct Slot
+    {
+        ThreadQueue waiter;
+        int result;
+        // The index of the next free slot.
+        int next;
+        // The Thread that was woken up once the request completed, until it
+        // collects the result.
+        Thread *woken;
+        // The Thread that was removed while the request was queued or in
+        // flight, which is deleted once it completes.
+        Thread *orphan;
+    };
+
+    /**
+     * The number of slots, the slots, and the first free one (-1 if none).
+     */
+    int _slotCount;
+    Slot *_slots;
+    int _freeSlot;
+
+    /**
+     * The number of slots whose Threads were woken up but did not collect
+     * their results yet.
+     */
+    int _woken;
+
+    /**
+     * The io_uring instance (-1 before the first request), and whether it
+     * turned out to be unavailable.
+     */
+    int _ringFd;
+    bool _unavailable;
+
+    /**
+     * The mapped rings and submission queue entries, and their sizes.
+     */
+    void *_sqRing;
+    void *_cqRing;
+    struct io_uring_sqe *_sqes;
+    size_t _sqRingSize;
+    size_t _cqRingSize;
+    size_t _sqesSize;
+
+    /**
+     * The submission queue: its head and tail (shared with the kernel), its
+     * mask, and its array of entry indices.
+     */
+    unsigned int *_sqHead;
+    unsigned int *_sqTail;
+    unsigned int _sqMask;
+    unsigned int *_sqArray;
+
+    /**
+     * The completion queue: its head and tail (shared with the kernel), its
+     * mask, and its entries.
+     */
+    unsigned int *_cqHead;
+    unsigned int *_cqTail;
+    unsigned int _cqMask;
+    struct io_uring_cqe *_cqes;
+
+    /**
+     * The number of requests queued but not submitted, and in flight.
+     */
+    int _queued;
+    int _inFlight;
+
+    /**
+     * Sets up the io_uring instance, or marks the ring unavailable.
+     * @return true on success, false otherwise.
+     */
+    bool _open();
+
+    /**
+     * Checks that the kernel supports the operations used.
+     * @return true if so, false otherwise.
+     */
+    bool _probe();
+
+    /**
+     * Releases the io_uring instance and its mappings.
+     * @return None.
+     */
+    void _close();
+};
+
+#endif //EX2_IORING_H
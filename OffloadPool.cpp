@@ -0,0 +1,306 @@
+#include "OffloadPool.h"
+#include "Scheduler.h"
+
+#include <errno.h>
+#include <signal.h>
+#include <stdint.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+// The return value of a failed system call.
+#define SYS_CALL_FAILED -1
+
+//-----------------------CONSTRUCTORS DESTRUCTORS----------------------------//
+
+/**
+ * C-tor. Creates a pool with no helpers yet.
+ * @param slots the number of calls that may be in flight at once.
+ */
+OffloadPool::OffloadPool(int slots)
+: _slotCount(slots),
+  _slots(nullptr),
+  _freeSlot(-1),
+  _pending(0),
+  _woken(0),
+  _firstQueued(-1),
+  _lastQueued(-1),
+  _firstCompleted(-1),
+  _eventFd(SYS_CALL_FAILED),
+  _stopping(false)
+{
+    pthread_mutex_init(&_mutex, nullptr);
+    pthread_cond_init(&_queuedCond, nullptr);
+}
+
+/**
+ * D-tor. Stops the helpers, once they finished their calls, and deletes
+ * the removed Threads that waited for them.
+ */
+OffloadPool::~OffloadPool()
+{
+    if (_eventFd != SYS_CALL_FAILED) {
+        pthread_mutex_lock(&_mutex);
+        _stopping = true;
+        pthread_cond_broadcast(&_queuedCond);
+        pthread_mutex_unlock(&_mutex);
+
+        for (int helper = 0; helper < OFFLOAD_HELPERS; ++helper) {
+            pthread_join(_helpers[helper], nullptr);
+        }
+        close(_eventFd);
+    }
+
+    for (int slot = 0; _slots != nullptr && slot < _slotCount; ++slot) {
+        delete _slots[slot].orphan;
+    }
+
+    pthread_cond_destroy(&_queuedCond);
+    pthread_mutex_destroy(&_mutex);
+    delete[] _slots;
+}
+
+//------------------------------OPERATIONS-----------------------------------//
+
+/**
+ * Queues a call, which the first free helper makes.
+ * @param function the function.
+ * @param arg its argument.
+ * @return the slot of the call, or OFFLOAD_POOL_FULL.
+ */
+int OffloadPool::submit(Function function, void *arg)
+{
+    if (_eventFd == SYS_CALL_FAILED) {
+        _start();
+    }
+
+    // Every Thread has one call at most, but the slots of removed Threads
+    // stay taken until their calls complete.
+    if (_freeSlot == -1) {
+        return OFFLOAD_POOL_FULL;
+    }
+    int slot = _freeSlot;
+    _freeSlot = _slots[slot].next;
+    _slots[slot].function = function;
+    _slots[slot].arg = arg;
+    _slots[slot].next = -1;
+    _pending++;
+
+    pthread_mutex_lock(&_mutex);
+    if (_lastQueued == -1) {
+        _firstQueued = slot;
+    }
+    else {
+        _slots[_lastQueued].next = slot;
+    }
+    _lastQueued = slot;
+    pthread_cond_signal(&_queuedCond);
+    pthread_mutex_unlock(&_mutex);
+    return slot;
+}
+
+/**
+ * Getter for the queue the Thread that offloaded a call waits on.
+ * @param slot the slot of the call.
+ * @return the queue.
+ */
+ThreadQueue *OffloadPool::waiter(int slot)
+{
+    return &_slots[slot].waiter;
+}
+
+/**
+ * Collects the result of a completed call, and frees its slot.
+ * @param slot the slot of the call.
+ * @param error where the errno value the call left goes.
+ * @return the result.
+ */
+long OffloadPool::collect(int slot, int *error)
+{
+    *error = _slots[slot].error;
+    if (_slots[slot].woken != nullptr) {
+        _slots[slot].woken = nullptr;
+        _woken--;
+    }
+    _slots[slot].next = _freeSlot;
+    _freeSlot = slot;
+    return _slots[slot].result;
+}
+
+/**
+ * Wakes up the Threads whose calls completed.
+ * @param scheduler the Scheduler, which wakes up the Threads.
+ * @return None.
+ */
+void OffloadPool::reap(Scheduler *scheduler)
+{
+    if (_pending == 0) {
+        return;
+    }
+
+    // The eventfd is drained before the completed calls are taken, so that
+    // a call completed meanwhile signals it again.
+    uint64_t value;
+    ssize_t ignored = read(_eventFd, &value, sizeof(value));
+    (void) ignored;
+
+    pthread_mutex_lock(&_mutex);
+    int slot = _firstCompleted;
+    _firstCompleted = -1;
+    pthread_mutex_unlock(&_mutex);
+
+    while (slot != -1) {
+        int next = _slots[slot].next;
+        _pending--;
+
+        // The call is done with the stack of a Thread that was removed
+        // meanwhile, so it can go, and nobody collects its slot.
+        int error;
+        if (_slots[slot].orphan != nullptr) {
+            delete _slots[slot].orphan;
+            _slots[slot].orphan = nullptr;
+            collect(slot, &error);
+        }
+        else {
+            Thread *waiter = _slots[slot].waiter.front();
+            if (scheduler->wakeWaiter(&_slots[slot].waiter)) {
+                _slots[slot].woken = waiter;
+                _woken++;
+            }
+            else {
+                collect(slot, &error);
+            }
+        }
+        slot = next;
+    }
+}
+
+/**
+ * Takes over a Thread that is removed while its call is queued or in
+ * progress, and deletes it once the call completes. A removed Thread that
+ * was woken up but did not collect its result gives its slot up.
+ * @param thread the Thread, unlinked from the queue it waited on.
+ * @param queue the queue it waited on, or nullptr.
+ * @return true if the pool took the Thread over, false otherwise.
+ */
+bool OffloadPool::adopt(Thread *thread, ThreadQueue *queue)
+{
+    if (_slots == nullptr) {
+        return false;
+    }
+
+    // A Thread waiting for its call waits on the queue of its slot.
+    char *first = reinterpret_cast<char *>(_slots);
+    char *address = reinterpret_cast<char *>(queue);
+    if (address >= first &&
+        address < reinterpret_cast<char *>(_slots + _slotCount)) {
+        _slots[(address - first) / sizeof(Slot)].orphan = thread;
+        return true;
+    }
+
+    for (int slot = 0; _woken > 0 && slot < _slotCount; ++slot) {
+        if (_slots[slot].woken == thread) {
+            int error;
+            collect(slot, &error);
+        }
+    }
+    return false;
+}
+
+/**
+ * Checks whether calls are queued or in progress.
+ * @return true if so, false otherwise.
+ */
+bool OffloadPool::isBusy() const
+{
+    return _pending > 0;
+}
+
+/**
+ * Getter for the eventfd of the pool, which is readable while completed
+ * calls wait to be reaped.
+ * @return the file descriptor, or -1 if there are no helpers yet.
+ */
+int OffloadPool::fd() const
+{
+    return _eventFd;
+}
+
+//--------------------------------HELPERS------------------------------------//
+
+/**
+ * Starts the helpers and creates the eventfd.
+ * @return None.
+ */
+void OffloadPool::_start()
+{
+    _slots = new(nothrow) Slot[_slotCount];
+    if (_slots == nullptr) {
+        ErrorHandler::sysCallError(THREAD_SYS_CALL_ERROR_BAD_ALLOC);
+    }
+    for (int slot = 0; slot < _slotCount; ++slot) {
+        _slots[slot].next = slot + 1 < _slotCount ? slot + 1 : -1;
+        _slots[slot].woken = nullptr;
+        _slots[slot].orphan = nullptr;
+    }
+    _freeSlot = 0;
+
+    _eventFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (_eventFd == SYS_CALL_FAILED) {
+        ErrorHandler::sysCallError(THREAD_SYS_CALL_ERROR_OFFLOAD);
+    }
+
+    // The helpers block every signal, so that the quantum timer never
+    // interrupts them (they inherit the mask of the creating thread).
+    sigset_t all;
+    sigset_t previous;
+    sigfillset(&all);
+    pthread_sigmask(SIG_SETMASK, &all, &previous);
+    for (int helper = 0; helper < OFFLOAD_HELPERS; ++helper) {
+        if (pthread_create(&_helpers[helper], nullptr, &_helperMain, this)) {
+            ErrorHandler::sysCallError(THREAD_SYS_CALL_ERROR_OFFLOAD);
+        }
+    }
+    pthread_sigmask(SIG_SETMASK, &previous, nullptr);
+}
+
+/**
+ * The function of the helpers: makes queued calls until stopped.
+ * @param pool the pool.
+ * @return nullptr.
+ */
+void *OffloadPool::_helperMain(void *pool)
+{
+    OffloadPool *self = static_cast<OffloadPool *>(pool);
+
+    pthread_mutex_lock(&self->_mutex);
+    for (;;) {
+        while (self->_firstQueued == -1 && !self->_stopping) {
+            pthread_cond_wait(&self->_queuedCond, &self->_mutex);
+        }
+        if (self->_stopping) {
+            break;
+        }
+
+        int slot = self->_firstQueued;
+        Slot *call = &self->_slots[slot];
+        self->_firstQueued = call->next;
+        if (self->_firstQueued == -1) {
+            self->_lastQueued = -1;
+        }
+        pthread_mutex_unlock(&self->_mutex);
+
+        errno = 0;
+        call->result = call->function(call->arg);
+        call->error = errno;
+
+        pthread_mutex_lock(&self->_mutex);
+        call->next = self->_firstCompleted;
+        self->_firstCompleted = slot;
+
+        uint64_t one = 1;
+        ssize_t ignored = write(self->_eventFd, &one, sizeof(one));
+        (void) ignored;
+    }
+    pthread_mutex_unlock(&self->_mutex);
+    return nullptr;
+}
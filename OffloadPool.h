@@ -0,0 +1,176 @@
+#ifndef EX2_OFFLOADPOOL_H
+#define EX2_OFFLOADPOOL_H
+
+#include "ThreadQueue.h"
+
+#include <pthread.h>
+
+// The number of helper kernel threads that make offloaded calls.
+#define OFFLOAD_HELPERS 4
+// Returned by submit when every slot is taken.
+#define OFFLOAD_POOL_FULL -1
+
+class Scheduler;
+
+/*
+ * Blocking calls of Threads, made by a few helper kernel threads (started
+ * the first time a call is offloaded) so that the workers keep running the
+ * other Threads. A Thread queues a call and waits on the call's slot (see
+ * Scheduler::waitOn). A helper makes the call, moves it to the completed
+ * calls, and signals an eventfd, which the Scheduler polls with the file
+ * descriptors it waits for; the completed calls are then reaped and their
+ * Threads woken up. Each Thread has at most one call in flight, so a pool
+ * with a slot per Thread only runs out while the calls of removed Threads
+ * are in progress: a removed Thread is deleted once its call completes, as
+ * the call may use its stack. The slots and the waiting Threads are guarded
+ * by the Scheduler's lock, and the queues the helpers touch by a mutex of
+ * the pool.
+ */
+class OffloadPool
+{
+public:
+
+    /**
+     * A call: a function and its argument.
+     */
+    typedef long (*Function)(void *arg);
+
+    /**
+     * C-tor. Creates a pool with no helpers yet.
+     * @param slots the number of calls that may be in flight at once.
+     */
+    OffloadPool(int slots);
+
+    /**
+     * D-tor. Stops the helpers, once they finished their calls, and deletes
+     * the removed Threads that waited for them.
+     */
+    ~OffloadPool();
+
+    /**
+     * Queues a call, which the first free helper makes.
+     * @param function the function.
+     * @param arg its argument.
+     * @return the slot of the call, or OFFLOAD_POOL_FULL.
+     */
+    int submit(Function function, void *arg);
+
+    /**
+     * Getter for the queue the Thread that offloaded a call waits on.
+     * @param slot the slot of the call.
+     * @return the queue.
+     */
+    ThreadQueue *waiter(int slot);
+
+    /**
+     * Collects the result of a completed call, and frees its slot.
+     * @param slot the slot of the call.
+     * @param error where the errno value the call left goes.
+     * @return the result.
+     */
+    long collect(int slot, int *error);
+
+    /**
+     * Wakes up the Threads whose calls completed.
+     * @param scheduler the Scheduler, which wakes up the Threads.
+     * @return None.
+     */
+    void reap(Scheduler *scheduler);
+
+    /**
+     * Takes over a Thread that is removed while its call is queued or in
+     * progress, and deletes it once the call completes. A removed Thread
+     * that was woken up but did not collect its result gives its slot up.
+     * @param thread the Thread, unlinked from the queue it waited on.
+     * @param queue the queue it waited on, or nullptr.
+     * @return true if the pool took the Thread over, false otherwise.
+     */
+    bool adopt(Thread *thread, ThreadQueue *queue);
+
+    /**
+     * Checks whether calls are queued or in progress.
+     * @return true if so, false otherwise.
+     */
+    bool isBusy() const;
+
+    /**
+     * Getter for the eventfd of the pool, which is readable while completed
+     * calls wait to be reaped.
+     * @return the file descriptor, or -1 if there are no helpers yet.
+     */
+    int fd() const;
+
+private:
+
+    /**
+     * A call, the Thread waiting for it, and its result.
+     */
+    struct Slot
+    {
+        ThreadQueue waiter;
+        Function function;
+        void *arg;
+        long result;
+        int error;
+        // The index of the next slot in the same list (free, queued or
+        // completed), or -1.
+        int next;
+        // The Thread that was woken up once the call completed, until it
+        // collects the result.
+        Thread *woken;
+        // The Thread that was removed while the call was queued or in
+        // progress, which is deleted once it completes.
+        Thread *orphan;
+    };
+
+    /**
+     * The number of slots, the slots, and the first free one (-1 if none).
+     */
+    int _slotCount;
+    Slot *_slots;
+    int _freeSlot;
+
+    /**
+     * The number of calls submitted and not reaped yet.
+     */
+    int _pending;
+
+    /**
+     * The number of slots whose Threads were woken up but did not collect
+     * their results yet.
+     */
+    int _woken;
+
+    /**
+     * The queued calls (first and last), and the completed calls that were
+     * not reaped yet, guarded by _mutex. Helpers wait on _queuedCond.
+     */
+    int _firstQueued;
+    int _lastQueued;
+    int _firstCompleted;
+    pthread_mutex_t _mutex;
+    pthread_cond_t _queuedCond;
+
+    /**
+     * The eventfd helpers signal completions on (-1 before the first call),
+     * the helpers, and whether they were told to stop.
+     */
+    int _eventFd;
+    pthread_t _helpers[OFFLOAD_HELPERS];
+    bool _stopping;
+
+    /**
+     * Starts the helpers and creates the eventfd.
+     * @return None.
+     */
+    void _start();
+
+    /**
+     * The function of the helpers: makes queued calls until stopped.
+     * @param pool the pool.
+     * @return nullptr.
+     */
+    static void *_helperMain(void *pool);
+};
+
+#endif //EX2_OFFLOADPOOL_H
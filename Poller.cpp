@@ -0,0 +1,302 @@
+#include "Poller.h"
+#include "Scheduler.h"
+
+#include <errno.h>
+#include <string.h>
+#include <stdint.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+// The return value of a failed system call.
+#define SYS_CALL_FAILED -1
+// The events that wake up the waiting readers and writers of a descriptor.
+#define READ_EVENTS (EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR)
+#define WRITE_EVENTS (EPOLLOUT | EPOLLHUP | EPOLLERR)
+
+//-----------------------CONSTRUCTORS DESTRUCTORS----------------------------//
+
+/**
+ * C-tor. Creates a Poller with no epoll instance yet.
+ */
+Poller::Poller()
+: _epollFd(SYS_CALL_FAILED),
+  _eventFd(SYS_CALL_FAILED),
+  _descriptors(nullptr),
+  _descriptorCount(0),
+  _waiters(0)
+{
+}
+
+/**
+ * D-tor.
+ */
+Poller::~Poller()
+{
+    for (int fd = 0; fd < _descriptorCount; ++fd) {
+        delete _descriptors[fd];
+    }
+    delete[] _descriptors;
+
+    if (_epollFd != SYS_CALL_FAILED) {
+        close(_epollFd);
+        close(_eventFd);
+    }
+}
+
+//------------------------------OPERATIONS-----------------------------------//
+
+/**
+ * Registers the interest of the running Thread in a file descriptor. The
+ * Thread is counted as waiting until it calls removeWaiter.
+ * @param fd the file descriptor.
+ * @param write true to wait until it is writable, false until it is
+ * readable.
+ * @return the queue the Thread waits on, or nullptr if the descriptor can
+ * not be waited for (with errno set).
+ */
+ThreadQueue *Poller::addWaiter(int fd, bool write)
+{
+    if (fd < 0) {
+        errno = EBADF;
+        return nullptr;
+    }
+    if (_epollFd == SYS_CALL_FAILED) {
+        _open();
+    }
+
+    Descriptor *descriptor = _descriptor(fd);
+    ThreadQueue *queue = write ? &descriptor->writers : &descriptor->readers;
+
+    // The descriptor is re-armed even if it is registered for the event, as
+    // an edge may have been consumed before the Thread waited. Re-arming
+    // reports it again if it is ready.
+    uint32_t events = EPOLLET | EPOLLRDHUP;
+    if (write || !descriptor->writers.isEmpty()) {
+        events |= EPOLLOUT;
+    }
+    if (!write || !descriptor->readers.isEmpty()) {
+        events |= EPOLLIN;
+    }
+    if (!_register(fd, descriptor, events)) {
+        return nullptr;
+    }
+
+    _waiters++;
+    return queue;
+}
+
+/**
+ * Stops counting a Thread that stopped waiting (for any reason).
+ * @return None.
+ */
+void Poller::removeWaiter()
+{
+    _waiters--;
+}
+
+/**
+ * Checks whether a queue is one a Thread waits on for a file descriptor, so
+ * that a Thread removed while it waited on the queue, which never calls
+ * removeWaiter, stops being counted.
+ * @param queue the queue, or nullptr.
+ * @return true if so, false otherwise.
+ */
+bool Poller::holds(const ThreadQueue *queue) const
+{
+    // Threads are rarely removed while they wait, so the descriptors are
+    // searched rather than tracked.
+    for (int fd = 0; queue != nullptr && _waiters > 0 &&
+                     fd < _descriptorCount; ++fd) {
+        if (_descriptors[fd] != nullptr &&
+            (queue == &_descriptors[fd]->readers ||
+             queue == &_descriptors[fd]->writers)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * Checks whether Threads wait for file descriptors.
+ * @return true if so, false otherwise.
+ */
+bool Poller::hasWaiters() const
+{
+    return _waiters > 0;
+}
+
+/**
+ * Makes waits return while a file descriptor no Thread waits for is
+ * readable (such as the file descriptor of an IoRing).
+ * @param fd the file descriptor.
+ * @return None.
+ */
+void Poller::watch(int fd)
+{
+    if (_epollFd == SYS_CALL_FAILED) {
+        _open();
+    }
+
+    // The descriptor is level-triggered, so it is reported by every wait
+    // until it is drained.
+    Descriptor *descriptor = _descriptor(fd);
+    if (descriptor->events != EPOLLIN &&
+        !_register(fd, descriptor, EPOLLIN)) {
+        ErrorHandler::sysCallError(THREAD_SYS_CALL_ERROR_POLL);
+    }
+}
+
+/**
+ * Waits for events, without waking anyone up.
+ * @param timeoutMsecs the time to wait at most in milli-seconds, 0 not to
+ * wait, or -1 to wait until an event or an interrupt.
+ * @return the number of events (0 if interrupted by a signal).
+ */
+int Poller::wait(int timeoutMsecs)
+{
+    if (_epollFd == SYS_CALL_FAILED) {
+        return 0;
+    }
+
+    int count = epoll_wait(_epollFd, _events, POLL_BATCH, timeoutMsecs);
+    return count == SYS_CALL_FAILED ? 0 : count;
+}
+
+/**
+ * Wakes up the Threads waiting for the events the last wait returned.
+ * @param scheduler the Scheduler, which wakes up the Threads.
+ * @param count the number of events.
+ * @return None.
+ */
+void Poller::dispatch(Scheduler *scheduler, int count)
+{
+    for (int i = 0; i < count; ++i) {
+        int fd = _events[i].data.fd;
+        uint32_t events = _events[i].events;
+
+        if (fd == _eventFd) {
+            uint64_t value;
+            ssize_t ignored = read(_eventFd, &value, sizeof(value));
+            (void) ignored;
+            continue;
+        }
+        if (fd >= _descriptorCount || _descriptors[fd] == nullptr) {
+            continue;
+        }
+
+        if (events & READ_EVENTS) {
+            scheduler->wakeAllWaiters(&_descriptors[fd]->readers);
+        }
+        if (events & WRITE_EVENTS) {
+            scheduler->wakeAllWaiters(&_descriptors[fd]->writers);
+        }
+    }
+}
+
+/**
+ * Makes a wait in progress (or the next one) return at once.
+ * @return None.
+ */
+void Poller::interrupt()
+{
+    if (_eventFd != SYS_CALL_FAILED) {
+        uint64_t one = 1;
+        ssize_t ignored = write(_eventFd, &one, sizeof(one));
+        (void) ignored;
+    }
+}
+
+//--------------------------------HELPERS------------------------------------//
+
+/**
+ * Creates the epoll instance and the eventfd.
+ * @return None.
+ */
+void Poller::_open()
+{
+    _epollFd = epoll_create1(EPOLL_CLOEXEC);
+    _eventFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (_epollFd == SYS_CALL_FAILED || _eventFd == SYS_CALL_FAILED) {
+        ErrorHandler::sysCallError(THREAD_SYS_CALL_ERROR_POLL);
+    }
+
+    // The eventfd is level-triggered, so it interrupts every wait until it
+    // is read.
+    struct epoll_event event;
+    memset(&event, 0, sizeof(event));
+    event.events = EPOLLIN;
+    event.data.fd = _eventFd;
+    if (epoll_ctl(_epollFd, EPOLL_CTL_ADD, _eventFd, &event) ==
+        SYS_CALL_FAILED) {
+        ErrorHandler::sysCallError(THREAD_SYS_CALL_ERROR_POLL);
+    }
+}
+
+/**
+ * Getter for the Descriptor of a file descriptor, which is created if there
+ * is none.
+ * @param fd the file descriptor, a non-negative number.
+ * @return the Descriptor.
+ */
+Poller::Descriptor *Poller::_descriptor(int fd)
+{
+    // The table grows to the next power of two that fits the descriptor.
+    if (fd >= _descriptorCount) {
+        int count = _descriptorCount == 0 ? 64 : _descriptorCount;
+        while (count <= fd) {
+            count *= 2;
+        }
+
+        Descriptor **descriptors = new(nothrow) Descriptor *[count]();
+        if (descriptors == nullptr) {
+            ErrorHandler::sysCallError(THREAD_SYS_CALL_ERROR_BAD_ALLOC);
+        }
+        if (_descriptorCount > 0) {
+            memcpy(descriptors, _descriptors,
+                   _descriptorCount * sizeof(Descriptor *));
+        }
+        delete[] _descriptors;
+        _descriptors = descriptors;
+        _descriptorCount = count;
+    }
+
+    if (_descriptors[fd] == nullptr) {
+        _descriptors[fd] = new(nothrow) Descriptor();
+        if (_descriptors[fd] == nullptr) {
+            ErrorHandler::sysCallError(THREAD_SYS_CALL_ERROR_BAD_ALLOC);
+        }
+    }
+    return _descriptors[fd];
+}
+
+/**
+ * Registers a file descriptor for events, or re-arms it.
+ * @param fd the file descriptor.
+ * @param descriptor its Descriptor.
+ * @param events the events.
+ * @return true on success, false otherwise (with errno set).
+ */
+bool Poller::_register(int fd, Descriptor *descriptor, uint32_t events)
+{
+    struct epoll_event event;
+    memset(&event, 0, sizeof(event));
+    event.events = events;
+    event.data.fd = fd;
+
+    // The kernel drops the registration of a closed descriptor, and the
+    // number may have been reused since, so either operation may have to be
+    // retried with the other one.
+    int op = descriptor->events == 0 ? EPOLL_CTL_ADD : EPOLL_CTL_MOD;
+    int result = epoll_ctl(_epollFd, op, fd, &event);
+    if (result == SYS_CALL_FAILED && (errno == ENOENT || errno == EEXIST)) {
+        op = (op == EPOLL_CTL_ADD) ? EPOLL_CTL_MOD : EPOLL_CTL_ADD;
+        result = epoll_ctl(_epollFd, op, fd, &event);
+    }
+    if (result == SYS_CALL_FAILED) {
+        descriptor->events = 0;
+        return false;
+    }
+
+    descriptor->events = events;
+    return true;
+}
@@ -0,0 +1,163 @@
+#ifndef EX2_POLLER_H
+#define EX2_POLLER_H
+
+#include "ThreadQueue.h"
+
+#include <sys/epoll.h>
+
+// The largest number of ready file descriptors handled by one poll.
+#define POLL_BATCH 32
+
+class Scheduler;
+
+/*
+ * The Threads waiting for file descriptors to become readable or writable,
+ * over an epoll instance (created the first time a Thread waits). Each file
+ * descriptor has a queue of waiting readers and one of waiting writers
+ * (see Scheduler::waitOn). A descriptor stays registered, edge-triggered,
+ * once a Thread waited for it, so waiting costs one epoll_ctl to re-arm it
+ * and waking up costs none. An event wakes up all of the Threads waiting
+ * for it, which retry their operation. An eventfd in the same epoll
+ * instance interrupts a worker that waits for events (see interrupt).
+ * The Poller is guarded by the Scheduler's lock, but wait may be called
+ * without it by one worker at a time.
+ */
+class Poller
+{
+public:
+
+    /**
+     * C-tor. Creates a Poller with no epoll instance yet.
+     */
+    Poller();
+
+    /**
+     * D-tor.
+     */
+    ~Poller();
+
+    /**
+     * Registers the interest of the running Thread in a file descriptor.
+     * The Thread is counted as waiting until it calls removeWaiter.
+     * @param fd the file descriptor.
+     * @param write true to wait until it is writable, false until it is
+     * readable.
+     * @return the queue the Thread waits on, or nullptr if the descriptor
+     * can not be waited for (with errno set).
+     */
+    ThreadQueue *addWaiter(int fd, bool write);
+
+    /**
+     * Stops counting a Thread that stopped waiting (for any reason).
+     * @return None.
+     */
+    void removeWaiter();
+
+    /**
+     * Checks whether a queue is one a Thread waits on for a file
+     * descriptor, so that a Thread removed while it waited on the queue,
+     * which never calls removeWaiter, stops being counted.
+     * @param queue the queue, or nullptr.
+     * @return true if so, false otherwise.
+     */
+    bool holds(const ThreadQueue *queue) const;
+
+    /**
+     * Checks whether Threads wait for file descriptors.
+     * @return true if so, false otherwise.
+     */
+    bool hasWaiters() const;
+
+    /**
+     * Makes waits return while a file descriptor no Thread waits for is
+     * readable (such as the file descriptor of an IoRing).
+     * @param fd the file descriptor.
+     * @return None.
+     */
+    void watch(int fd);
+
+    /**
+     * Waits for events, without waking anyone up.
+     * @param timeoutMsecs the time to wait at most in milli-seconds, 0 not to
+     * wait, or -1 to wait until an event or an interrupt.
+     * @return the number of events (0 if interrupted by a signal).
+     */
+    int wait(int timeoutMsecs);
+
+    /**
+     * Wakes up the Threads waiting for the events the last wait returned.
+     * @param scheduler the Scheduler, which wakes up the Threads.
+     * @param count the number of events.
+     * @return None.
+     */
+    void dispatch(Scheduler *scheduler, int count);
+
+    /**
+     * Makes a wait in progress (or the next one) return at once.
+     * @return None.
+     */
+    void interrupt();
+
+private:
+
+    /**
+     * The Threads waiting for a file descriptor, and the events it is
+     * registered for (0 if it is not registered).
+     */
+    struct Descriptor
+    {
+        ThreadQueue readers;
+        ThreadQueue writers;
+        uint32_t events;
+    };
+
+    /**
+     * The epoll instance, and the eventfd that interrupts waits (-1 before
+     * the first Thread waits).
+     */
+    int _epollFd;
+    int _eventFd;
+
+    /**
+     * The descriptors Threads waited for, indexed by file descriptor
+     * (nullptr for the others). Each Descriptor is allocated once, so its
+     * queues never move.
+     */
+    Descriptor **_descriptors;
+    int _descriptorCount;
+
+    /**
+     * The number of waiting Threads.
+     */
+    int _waiters;
+
+    /**
+     * The events returned by the last wait.
+     */
+    struct epoll_event _events[POLL_BATCH];
+
+    /**
+     * Creates the epoll instance and the eventfd.
+     * @return None.
+     */
+    void _open();
+
+    /**
+     * Getter for the Descriptor of a file descriptor, which is created if
+     * there is none.
+     * @param fd the file descriptor, a non-negative number.
+     * @return the Descriptor.
+     */
+    Descriptor *_descriptor(int fd);
+
+    /**
+     * Registers a file descriptor for events, or re-arms it.
+     * @param fd the file descriptor.
+     * @param descriptor its Descriptor.
+     * @param events the events.
+     * @return true on success, false otherwise (with errno set).
+     */
+    bool _register(int fd, Descriptor *descriptor, uint32_t events);
+};
+
+#endif //EX2_POLLER_H
@@ -0,0 +1,83 @@
+#include "RoundRobinPolicy.h"
+
+template class PolicyAdapter<RoundRobinPolicy>;
+
+//-----------------------------CONSTRUCTORS----------------------------------//
+
+/**
+ * C-tor. Creates a policy without READY Threads.
+ * @param threads the Scheduler's Thread table (unused).
+ * @param maxThreads the size of the Thread table (unused).
+ * @param totalQuantums the Scheduler's total quantum counter (unused).
+ */
+RoundRobinPolicy::RoundRobinPolicy(Thread **threads, int maxThreads,
+                                   const int *totalQuantums)
+{
+}
+
+//--------------------------------HOOKS--------------------------------------//
+
+/**
+ * Adds a Thread that became READY to the back of the queue.
+ * @param thread the Thread.
+ * @return None.
+ */
+void RoundRobinPolicy::enqueue(Thread *thread)
+{
+    _readyThreads.pushBack(thread);
+}
+
+/**
+ * Removes a READY Thread from the queue.
+ * @param thread the Thread.
+ * @return None.
+ */
+void RoundRobinPolicy::dequeue(Thread *thread)
+{
+    _readyThreads.remove(thread);
+}
+
+/**
+ * Removes the Thread at the front of the queue.
+ * @return the Thread, or nullptr if there are no READY Threads.
+ */
+Thread *RoundRobinPolicy::pickNext()
+{
+    return _readyThreads.popFront();
+}
+
+/**
+ * Called when the RUNNING Thread used up its quantum. Does nothing.
+ * @param thread the Thread.
+ * @return None.
+ */
+void RoundRobinPolicy::onTick(Thread *thread)
+{
+}
+
+/**
+ * Called when the RUNNING Thread blocked or slept. Does nothing.
+ * @param thread the Thread.
+ * @return None.
+ */
+void RoundRobinPolicy::onBlock(Thread *thread)
+{
+}
+
+/**
+ * Called when the RUNNING Thread yielded. Does nothing.
+ * @param thread the Thread.
+ * @return None.
+ */
+void RoundRobinPolicy::onYield(Thread *thread)
+{
+}
+
+/**
+ * Called before a new, resumed or woken Thread is enqueued. Does nothing.
+ * @param thread the Thread.
+ * @return None.
+ */
+void RoundRobinPolicy::onWake(Thread *thread)
+{
+}
@@ -0,0 +1,82 @@
+#ifndef EX2_ROUNDROBINPOLICY_H
+#define EX2_ROUNDROBINPOLICY_H
+
+#include "SchedulingPolicy.h"
+#include "ThreadQueue.h"
+
+/*
+ * The Round-Robin policy (the default): the READY Threads run a quantum
+ * each, in the order they became READY.
+ */
+class RoundRobinPolicy
+{
+public:
+
+    /**
+     * C-tor. Creates a policy without READY Threads.
+     * @param threads the Scheduler's Thread table (unused).
+     * @param maxThreads the size of the Thread table (unused).
+     * @param totalQuantums the Scheduler's total quantum counter (unused).
+     */
+    RoundRobinPolicy(Thread **threads, int maxThreads,
+                     const int *totalQuantums);
+
+    /**
+     * Adds a Thread that became READY to the back of the queue.
+     * @param thread the Thread.
+     * @return None.
+     */
+    void enqueue(Thread *thread);
+
+    /**
+     * Removes a READY Thread from the queue.
+     * @param thread the Thread.
+     * @return None.
+     */
+    void dequeue(Thread *thread);
+
+    /**
+     * Removes the Thread at the front of the queue.
+     * @return the Thread, or nullptr if there are no READY Threads.
+     */
+    Thread *pickNext();
+
+    /**
+     * Called when the RUNNING Thread used up its quantum. Does nothing.
+     * @param thread the Thread.
+     * @return None.
+     */
+    void onTick(Thread *thread);
+
+    /**
+     * Called when the RUNNING Thread blocked or slept. Does nothing.
+     * @param thread the Thread.
+     * @return None.
+     */
+    void onBlock(Thread *thread);
+
+    /**
+     * Called when the RUNNING Thread yielded. Does nothing.
+     * @param thread the Thread.
+     * @return None.
+     */
+    void onYield(Thread *thread);
+
+    /**
+     * Called before a new, resumed or woken Thread is enqueued. Does nothing.
+     * @param thread the Thread.
+     * @return None.
+     */
+    void onWake(Thread *thread);
+
+private:
+
+    /**
+     * The READY Threads, in the order they will run.
+     */
+    ThreadQueue _readyThreads;
+};
+
+extern template class PolicyAdapter<RoundRobinPolicy>;
+
+#endif //EX2_ROUNDROBINPOLICY_H
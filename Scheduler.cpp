@@ -1,6 +1,26 @@
 #include <iostream>
 #include "Scheduler.h"
 
+#include <errno.h>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+// A Thread is preempted by a signal delivered on its own stack, so every
+// stack has room for a signal frame (several KB with wide vector registers)
+// on top of the size requested.
+#define SIGNAL_FRAME_SIZE SIGSTKSZ
+// The return value of a failed system call.
+#define SYS_CALL_FAILED -1
+#define NSECS_PER_SECOND 1000000000LL
+#define NSECS_PER_MSEC 1000000LL
+
+// The index of the worker of the calling kernel thread. It is volatile, so
+// that it is read again after every context switch.
+static __thread volatile int current_worker
+        __attribute__((tls_model("initial-exec"))) = 0;
+
 //------------------------CONSTRUCTORS DESTRUCTORS----------------------------//
 /**
  * C-tor
@@ -9,23 +29,40 @@
  */
 Scheduler::Scheduler(int maxThreads, int stackSize)
         : _maxThreads(maxThreads),
-          _stackSize(stackSize),
-          _idManagar(new(nothrow) int[_maxThreads]{EMPTY_CELL}),
-          _currentScenario(ROUTINE),
+          _stackSize(stackSize + SIGNAL_FRAME_SIZE),
+          _idManagar(maxThreads),
+          _threads(new(nothrow) Thread *[maxThreads]()),
+          _threadCount(0),
+          _joinStates(new(nothrow) JoinState[maxThreads]()),
+          _futureWatches(new(nothrow) FutureWatch[maxThreads]()),
+          _policy(ROUND_ROBIN),
+          _policyOps(&PolicyAdapter<RoundRobinPolicy>::table),
+          _readyCount(0),
+          _workerCount(1),
+          _workGeneration(0),
+          _idleWorkers(0),
+          _polling(false),
+          _lastPollQuantum(0),
+          _lastIdleQuantumNsecs(0),
+          _ioRing(maxThreads),
+          _offloadPool(maxThreads),
+          _sleepThreads(maxThreads),
           _totalQuantumCounter(1),
-          _toDelete(nullptr)
+          _killed(false)
 {
-    if (_idManagar == nullptr) {
+    if (_threads == nullptr || _joinStates == nullptr ||
+        _futureWatches == nullptr) {
         ErrorHandler::sysCallError(THREAD_SYS_CALL_ERROR_BAD_ALLOC);
     }
-
-    // Initialize ID manager with the flag "EMPTY_CELL".
-    for (int j = 0; j < maxThreads; ++j) {
-        _idManagar[j] = EMPTY_CELL;
-    }
+    _initWorker(0);
+    _workers[0].pthread = pthread_self();
 
     // Adding the main Thread (pid 0);
-    _runningThread = addThread(nullptr);
+    Worker *worker = &_workers[0];
+    worker->runningThread = addThread(nullptr);
+    worker->current = _threads[MAIN_THREAD_ID];
+    Thread::setRunning(worker->current);
+    _threads[MAIN_THREAD_ID]->setState(RUNNING);
     _threads[MAIN_THREAD_ID]->incrementQuantum();
 }
 
@@ -34,6 +71,8 @@ Scheduler::Scheduler(int maxThreads, int stackSize)
  */
 Scheduler::~Scheduler() {
     _killProcess();
+    // The calling kernel thread ran the instance, and runs no Thread now.
+    Thread::setRunning(nullptr);
 };
 
 //---------------------------ID RELATED FUNCTIONS----------------------------//
@@ -41,124 +80,596 @@ Scheduler::~Scheduler() {
 /**
  * ID is chosen as follows: The main goal is to chose the
  * smallest non-negative integer not already taken by an existing thread.
- * Therefore,we shall iterate over the vector from the beginning
- * (In ascending order) first cell with NULL is the one we need.
- * When terminating a thread with ID i, the ith cell will be initialized
- * with EMPTY_CELL.
+ * The ID manager finds it in its bitmap without scanning the IDs.
  * @return the new ID.
  */
 int Scheduler::_getNewID() {
-    int last_occupied = 0;
-    for (int i = 0; i < _maxThreads; ++i) {
-        // The cell is empty.
-        if (_idManagar[i] == EMPTY_CELL) {
-            _idManagar[i] = i;
-            last_occupied = i;
-            break;
-        }
-    }
-
-    return last_occupied;
+    return _idManagar.allocate();
 }
 
 /**
  * A function that deletes an ID from idManagar.
  * @param ID the ID to delete
- * @return SUCCESS on success and FAILURE on failure
+ * @return None
  */
 void Scheduler::_deleteID(int ID) {
-    _idManagar[ID] = EMPTY_CELL;
+    _idManagar.release(ID);
 }
 
 /**
  * Calls to the suitable error message according to the bad ID that is given.
  * @param ID the id
- * @return SUCCESS on success and FAILURE on failure
+ * @return FAILURE
  */
 int Scheduler::_badIDChecker(int ID) {
-    if (_idManagar[ID] == EMPTY_CELL) {
-        return ErrorHandler::libError(THREAD_LIB_ERROR_NO_SUCH_ID);
+    if (ID < MAIN_THREAD_ID || ID >= _maxThreads) {
+        return ErrorHandler::libError(THREAD_LIB_ERROR_ID_OUT_RANGE);
     }
-    return ErrorHandler::libError(THREAD_LIB_ERROR_ID_OUT_RANGE);
+    return ErrorHandler::libError(THREAD_LIB_ERROR_NO_SUCH_ID);
+}
 
+/**
+ * Gets the Thread with ID.
+ * @param ID the ID of the Thread.
+ * @return a pointer to the Thread, or nullptr if no such Thread exists.
+ */
+Thread *Scheduler::_getThread(int ID) {
+    if (ID < MAIN_THREAD_ID || ID >= _maxThreads) {
+        return nullptr;
+    }
+    return _threads[ID];
 }
-//----------------------------------UTILITIES--------------------------------//
+
+//----------------------------------WORKERS----------------------------------//
 
 /**
- * Function that is designed to facilitate the readability of the code.
- * @param pushTO the vector to add the thread to.
- * @param deletFrom the vector to remove the thread from.
- * @param ID the id.
- * @param iter the iterator of the thread with this id.
- * @return SUCCESS on success and FAILURE on failure.
+ * Initializes a worker that runs nothing yet.
+ * @param index the index of the worker.
+ * @return None.
  */
-int Scheduler::_accessDBtoInsertAndDelete(vec *pushTO, vec *deletFrom, int ID,
-                                          vecIter iter) {
-    // Try to add and delete
-    try {
-        pushTO->push_back(ID);
-        deletFrom->erase(iter);
+void Scheduler::_initWorker(int index) {
+    Worker *worker = &_workers[index];
+
+    worker->index = index;
+    worker->current = nullptr;
+    worker->idle = nullptr;
+    worker->runningThread = NO_ACTIVE_THREAD;
+    worker->currentScenario = ROUTINE;
+    worker->yieldTarget = NO_ACTIVE_THREAD;
+    worker->waitQueue = nullptr;
+    worker->toDelete = nullptr;
+    worker->deciding = false;
+    worker->locked = false;
+    worker->policyData = _policyOps->create(_threads, _maxThreads,
+                                            &_totalQuantumCounter);
+    if (worker->policyData == nullptr) {
+        ErrorHandler::sysCallError(THREAD_SYS_CALL_ERROR_BAD_ALLOC);
     }
-    catch (std::bad_alloc &ba) {
+}
+
+/**
+ * Getter for the worker of the calling kernel thread. Must be called
+ * again after any context switch, as the calling Thread may resume on
+ * another worker.
+ * @return the worker.
+ */
+Worker *Scheduler::currentWorker() {
+    return &_workers[current_worker];
+}
+
+/**
+ * Takes the Scheduler's lock for the calling worker. Only needed while
+ * there are several workers.
+ * @return None.
+ */
+void Scheduler::lock() {
+    if (_workerCount > 1) {
+        _lock.lock();
+    }
+    currentWorker()->locked = true;
+}
+
+/**
+ * Releases the Scheduler's lock, if the calling worker holds it.
+ * @return None.
+ */
+void Scheduler::unlock() {
+    Worker *worker = currentWorker();
+    if (worker->locked) {
+        worker->locked = false;
+        if (_workerCount > 1) {
+            _lock.unlock();
+        }
+    }
+}
+
+/**
+ * Called by a Thread a worker has just switched to, or returned to without
+ * a switch: releases the lock of the worker's ready Threads, and takes or
+ * releases the Scheduler's lock, so that it is held if and only if the
+ * Thread held it when it was switched out.
+ * @param locked true if the Thread held the Scheduler's lock.
+ * @return None.
+ */
+void Scheduler::finishSwitch(bool locked) {
+    Worker *worker = currentWorker();
+    worker->deciding = false;
+    _unlockQueue(worker);
+
+    // The Scheduler's lock is taken after the worker's, never while holding
+    // it.
+    if (worker->locked && !locked) {
+        unlock();
+    }
+    else if (!worker->locked && locked) {
+        lock();
+    }
+}
+
+/**
+ * Creates the idle Thread of the first worker. Must be called once,
+ * before any Thread may wait.
+ * @param idleLoop the function the idle Thread runs.
+ * @return None.
+ */
+void Scheduler::setIdleLoop(FunctionPointer idleLoop) {
+    // The first worker runs its idle Thread on a stack of its own, as its
+    // kernel thread's stack is the main Thread's.
+    _workers[0].idle = new(nothrow) Thread(NO_ACTIVE_THREAD, _stackSize,
+                                           idleLoop, nullptr, nullptr);
+    if (_workers[0].idle == nullptr) {
         _killProcess();
         ErrorHandler::sysCallError(THREAD_SYS_CALL_ERROR_BAD_ALLOC);
     }
-    return SUCCESS;
 }
 
 /**
- * Gets the vector in which the Thread with ID is stored.
- * Function assumes that the ID is not in running state.
- * @param ID the Thread to remove.
- * @return a pointer to the vector. nullptr is returned if Thread doesn't
- * exists.
+ * Adds workers, up to a total of count. Each new worker must then be
+ * started by a kernel thread of its own, which calls bindWorker. Must be
+ * called once, inside a library call, and the lock is held from here on.
+ * @param count the total number of workers, at most MAX_WORKERS.
+ * @return None.
  */
-vec *Scheduler::_getVectorOfThread(int ID) {
-    state threadState;
+void Scheduler::addWorkers(int count) {
+    // Other workers than the first run their idle Thread on the stack of
+    // their kernel thread.
+    for (int index = 1; index < count; ++index) {
+        _initWorker(index);
+        _workers[index].idle = new(nothrow) Thread(NO_ACTIVE_THREAD,
+                                                   _stackSize, nullptr,
+                                                   nullptr, nullptr);
+        _workers[index].current = _workers[index].idle;
+    }
+    for (int index = 1; index < count; ++index) {
+        if (_workers[index].idle == nullptr) {
+            _killProcess();
+            ErrorHandler::sysCallError(THREAD_SYS_CALL_ERROR_BAD_ALLOC);
+        }
+    }
 
-    // If a thread does'nt exist or its running -> does not belong to any vev.
-    if (_idManagar[ID] == EMPTY_CELL || (ID < MAIN_THREAD_ID || \
-        ID > _maxThreads) || ID == MAIN_THREAD_ID) {
-        return nullptr;
+    // The library call that added the workers, which counts as holding the
+    // lock, releases it when it ends.
+    _workerCount = count;
+    _lock.lock();
+}
+
+/**
+ * Makes the calling kernel thread the given worker, running its idle
+ * Thread.
+ * @param index the index of the worker.
+ * @return None.
+ */
+void Scheduler::bindWorker(int index) {
+    current_worker = index;
+    _workers[index].pthread = pthread_self();
+    Thread::setRunning(_workers[index].current);
+}
+
+/**
+ * Called by an idle worker that found no Thread to run. Waits (without
+ * the lock) until some Thread becomes READY. While Threads sleep, it waits
+ * for a quantum at most, and counts the quantum if none became READY
+ * meanwhile, so that the sleeping Threads wake up. While Threads wait for
+ * file descriptors, file I/O or offloaded calls, one idle worker waits for
+ * their events instead, and wakes them up.
+ * @param quantumNsecs the length of a quantum in nano-seconds.
+ * @return None.
+ */
+void Scheduler::waitForWork(long long quantumNsecs) {
+    if (__atomic_load_n(&_readyCount, __ATOMIC_SEQ_CST) > 0) {
+        return;
     }
-    // Get the Thread state
-    threadState = _threads[ID]->getState();
 
-    // Return the relevant vector
-    switch (threadState) {
-        case READY:
+    // epoll waits in milli-seconds, so a quantum is rounded up.
+    if ((_poller.hasWaiters() || _ioRing.isBusy() ||
+         _offloadPool.isBusy()) && !_polling) {
+        int timeoutMsecs = -1;
+        if (!_sleepThreads.isEmpty()) {
+            timeoutMsecs = (int) ((quantumNsecs + NSECS_PER_MSEC - 1) /
+                                  NSECS_PER_MSEC);
+        }
 
-            return &_readyThreads;
+        __atomic_store_n(&_polling, true, __ATOMIC_RELAXED);
+        __atomic_add_fetch(&_idleWorkers, 1, __ATOMIC_SEQ_CST);
+        unlock();
+        // A Thread made READY by a worker that did not see this one idle
+        // is noticed here.
+        bool waited = (__atomic_load_n(&_readyCount, __ATOMIC_SEQ_CST) == 0);
+        int count = waited ? _poller.wait(timeoutMsecs) : 0;
+        lock();
+        __atomic_sub_fetch(&_idleWorkers, 1, __ATOMIC_SEQ_CST);
+        __atomic_store_n(&_polling, false, __ATOMIC_RELAXED);
+
+        _lastPollQuantum = _totalQuantumCounter;
+        _poller.dispatch(this, count);
+        _ioRing.reap(this);
+        _offloadPool.reap(this);
+        if (waited && count == 0 && timeoutMsecs != -1) {
+            _countIdleQuantum(quantumNsecs);
+        }
+        return;
+    }
 
-        case BLOCKED:
-            return &_blockThreads;
+    struct timespec timeout;
+    struct timespec *timeoutPtr = nullptr;
+    if (!_sleepThreads.isEmpty()) {
+        timeout.tv_sec = quantumNsecs / NSECS_PER_SECOND;
+        timeout.tv_nsec = quantumNsecs % NSECS_PER_SECOND;
+        timeoutPtr = &timeout;
+    }
 
-        case SLEEPING:
-            return &_sleepThreads;
+    // A Thread made READY after the generation is read bumps it, so the
+    // wait returns at once. One made READY by a worker that did not see
+    // this one idle is noticed before waiting.
+    int generation = __atomic_load_n(&_workGeneration, __ATOMIC_SEQ_CST);
+    __atomic_add_fetch(&_idleWorkers, 1, __ATOMIC_SEQ_CST);
+    unlock();
+    bool timedOut = false;
+    if (__atomic_load_n(&_readyCount, __ATOMIC_SEQ_CST) == 0) {
+        long result = syscall(SYS_futex, &_workGeneration,
+                              FUTEX_WAIT_PRIVATE, generation, timeoutPtr,
+                              nullptr, 0);
+        timedOut = (result == SYS_CALL_FAILED && errno == ETIMEDOUT);
+    }
+    lock();
+    __atomic_sub_fetch(&_idleWorkers, 1, __ATOMIC_SEQ_CST);
 
-        default:
-            return nullptr;
+    if (timedOut) {
+        _countIdleQuantum(quantumNsecs);
+    }
+}
+
+/**
+ * Counts a quantum that passed while idle workers waited. Every idle worker
+ * that waited for a whole quantum calls it, but a quantum is only counted
+ * once a whole one passed since the last counted, so that the sleeping
+ * Threads do not wake up sooner the more workers are idle. Called with the
+ * lock.
+ * @param quantumNsecs the length of a quantum in nano-seconds.
+ * @return None.
+ */
+void Scheduler::_countIdleQuantum(long long quantumNsecs) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    long long nowNsecs = now.tv_sec * NSECS_PER_SECOND + now.tv_nsec;
+    if (nowNsecs - _lastIdleQuantumNsecs < quantumNsecs) {
+        return;
+    }
+    _lastIdleQuantumNsecs = nowNsecs;
+    __atomic_add_fetch(&_totalQuantumCounter, 1, __ATOMIC_RELAXED);
+}
+
+/**
+ * Wakes up idle workers, if there are any, after Threads became READY.
+ * @param count the number of Threads that became READY.
+ * @return None.
+ */
+void Scheduler::_notifyIdleWorkers(int count) {
+    // A worker may make Threads READY without the Scheduler's lock, so the
+    // idle workers are counted atomically: either this worker sees one idle,
+    // or the idle worker sees the READY Threads before it waits.
+    if (count > 0 && __atomic_load_n(&_idleWorkers, __ATOMIC_SEQ_CST) > 0) {
+        __atomic_add_fetch(&_workGeneration, 1, __ATOMIC_SEQ_CST);
+        syscall(SYS_futex, &_workGeneration, FUTEX_WAKE_PRIVATE, count,
+                nullptr, nullptr, 0);
+        // The worker that waits for file descriptors does not wait on the
+        // futex.
+        if (__atomic_load_n(&_polling, __ATOMIC_RELAXED)) {
+            _poller.interrupt();
+        }
+    }
+}
+
+/**
+ * Checks whether another worker blocked or terminated the Thread the
+ * calling worker runs, so that it must be switched out.
+ * @return true if so, false otherwise.
+ */
+bool Scheduler::isRunningThreadStopped() {
+    if (_workerCount == 1) {
+        return false;
+    }
+    Worker *worker = currentWorker();
+    return worker->current != worker->idle &&
+           worker->current->getState() != RUNNING;
+}
+
+/**
+ * Getter for the Threads waiting for file descriptors.
+ * @return the Poller.
+ */
+Poller *Scheduler::poller() {
+    return &_poller;
+}
+
+/**
+ * Getter for the file I/O requests of the Threads.
+ * @return the IoRing.
+ */
+IoRing *Scheduler::ioRing() {
+    return &_ioRing;
+}
+
+/**
+ * Getter for the blocking calls the Threads offloaded.
+ * @return the OffloadPool.
+ */
+OffloadPool *Scheduler::offloadPool() {
+    return &_offloadPool;
+}
+
+/**
+ * Takes the lock of a worker's ready Threads, unless the calling worker
+ * already holds it for a scheduling decision.
+ * @param worker the worker.
+ * @return None.
+ */
+void Scheduler::_lockQueue(Worker *worker) {
+    if (_workerCount > 1 &&
+        !(worker == currentWorker() && worker->deciding)) {
+        worker->queueLock.lock();
     }
 }
 
 /**
- * Gets the iterator (location) of the Thread with ID.
- * Function assumes that the ID is not in running state.
- * @param ID The Thread ID
- * @param vecOfThread The vector to search for the Thread in
- * @return an iterator the the Thread. nullptr is returned if Thread doesn't
- * exists.
+ * Releases the lock of a worker's ready Threads, unless the calling worker
+ * holds it for a scheduling decision.
+ * @param worker the worker.
+ * @return None.
  */
-vecIter Scheduler::_getIterOfThread(int ID, vec *vecOfThread) {
-    vecIter retIter;
-    // Check if the ID actually exists in the vector
-    for (auto it = vecOfThread->begin(); it < vecOfThread->end(); ++it) {
-        // If ID exists, move it
-        if (*it == ID) {
-            retIter = it;
+void Scheduler::_unlockQueue(Worker *worker) {
+    if (_workerCount > 1 &&
+        !(worker == currentWorker() && worker->deciding)) {
+        worker->queueLock.unlock();
+    }
+}
+
+/**
+ * Takes the lock of the worker a Thread is READY or RUNNING on, which keeps
+ * the Thread from being picked, stolen or switched out meanwhile.
+ * @param thread the Thread.
+ * @return the worker, whose lock is held.
+ */
+Worker *Scheduler::_lockWorkerOf(const Thread *thread) {
+    // A Thread is only moved to another worker with the lock of the worker
+    // it leaves held, so it is looked up again once the lock is taken.
+    for (;;) {
+        Worker *worker = &_workers[thread->getWorker()];
+        _lockQueue(worker);
+        if (thread->getWorker() == worker->index) {
+            return worker;
         }
+        _unlockQueue(worker);
     }
-    return retIter;
+}
+
+/**
+ * Checks, without the Scheduler's lock, whether a scheduling decision has
+ * shared work to do: Threads to wake up, or file descriptors, file I/O or
+ * offloaded calls to poll.
+ * @return true if so (always with one worker), false otherwise.
+ */
+bool Scheduler::_hasSharedWork() const {
+    // The counters are read while other workers may change them. A stale
+    // value only delays the work to the next scheduling decision.
+    return _workerCount == 1 ||
+           _sleepThreads.earliestWakeUp() <= _totalQuantumCounter ||
+           (_poller.hasWaiters() &&
+            !__atomic_load_n(&_polling, __ATOMIC_RELAXED)) ||
+           _ioRing.isBusy() || _offloadPool.isBusy();
+}
+
+/**
+ * Getter for the policy instance that holds (or will hold) a READY
+ * Thread: the one of the Thread's worker.
+ * @param thread the Thread.
+ * @return the policy instance.
+ */
+void *Scheduler::_policyOf(const Thread *thread) {
+    return _workers[thread->getWorker()].policyData;
+}
+
+/**
+ * Checks whether a Thread is running on another worker than the calling
+ * one.
+ * @param thread the Thread.
+ * @return true if so, false otherwise.
+ */
+bool Scheduler::_isRunningElsewhere(const Thread *thread) {
+    return thread->getWorker() != current_worker &&
+           _workers[thread->getWorker()].current == thread;
+}
+
+/**
+ * Makes the worker running a Thread make a scheduling decision, so that
+ * it notices the Thread was blocked or terminated.
+ * @param thread the Thread, which runs on another worker.
+ * @return None.
+ */
+void Scheduler::_kickWorker(const Thread *thread) {
+    pthread_kill(_workers[thread->getWorker()].pthread, SIGVTALRM);
+}
+
+/**
+ * Makes a READY Thread, just taken out of its policy, RUNNING on a worker.
+ * The lock of the worker it was READY on must be held.
+ * @param worker the worker.
+ * @param thread the Thread.
+ * @return None.
+ */
+void Scheduler::_startRunning(Worker *worker, Thread *thread) {
+    __atomic_sub_fetch(&_readyCount, 1, __ATOMIC_SEQ_CST);
+    thread->setState(RUNNING);
+    thread->setWorker(worker->index);
+}
+
+/**
+ * Removes the READY Thread that runs next on a worker, and makes it
+ * RUNNING: the next one of its own policy, or else one stolen from another
+ * worker whose lock is free.
+ * @param worker the worker, whose lock is held.
+ * @return the Thread, or nullptr if no Thread is READY.
+ */
+Thread *Scheduler::_pickNext(Worker *worker) {
+    Thread *thread = _policyOps->pickNext(worker->policyData);
+    if (thread != nullptr) {
+        _startRunning(worker, thread);
+        return thread;
+    }
+
+    // Steal from the workers that follow, so that the workers do not all
+    // steal from the same one. A worker whose lock is taken is skipped, as
+    // two workers stealing from each other would otherwise wait for each
+    // other forever. An idle worker tries again while Threads are READY.
+    for (int i = 1; thread == nullptr && i < _workerCount; ++i) {
+        Worker *victim = &_workers[(worker->index + i) % _workerCount];
+        if (!victim->queueLock.tryLock()) {
+            continue;
+        }
+        thread = _policyOps->pickNext(victim->policyData);
+        if (thread != nullptr) {
+            _startRunning(worker, thread);
+        }
+        victim->queueLock.unlock();
+    }
+    return thread;
+}
+
+/**
+ * Sets the Thread a worker deletes once it switched away from it. A
+ * Thread set before is deleted right away.
+ * @param worker the worker.
+ * @param thread the Thread to delete.
+ * @return None.
+ */
+void Scheduler::_setToDelete(Worker *worker, Thread *thread) {
+    delete worker->toDelete;
+    worker->toDelete = thread;
+}
+
+/**
+ * Deletes a Thread that was removed while it waited (or was about to),
+ * once nothing uses its stack anymore: the IoRing or the OffloadPool takes
+ * over a Thread whose file I/O request or offloaded call is not complete,
+ * and a worker deletes any other once it switched away from it. A Thread
+ * that waited for a file descriptor stops being counted by the Poller.
+ * @param worker the worker.
+ * @param thread the Thread, unlinked from the queue it waited on.
+ * @param queue the queue it waited on, or nullptr.
+ * @return None.
+ */
+void Scheduler::_deleteRemoved(Worker *worker, Thread *thread,
+                               ThreadQueue *queue) {
+    if (_poller.holds(queue)) {
+        _poller.removeWaiter();
+    }
+
+    // The kernel may still write into the stack of a Thread whose file I/O
+    // request is in flight, and a helper may still use it for an offloaded
+    // call.
+    if (!_ioRing.adopt(thread, queue) &&
+        !_offloadPool.adopt(thread, queue)) {
+        _setToDelete(worker, thread);
+    }
+}
+
+//----------------------------------UTILITIES--------------------------------//
+
+/**
+ * Moves a Thread from the queue it is in to the back of another queue.
+ * @param thread the Thread to move.
+ * @param pushTo the queue to add the thread to.
+ * @return None.
+ */
+void Scheduler::_moveThread(Thread *thread, ThreadQueue *pushTo) {
+    _unlinkThread(thread);
+    pushTo->pushBack(thread);
+}
+
+/**
+ * Removes a Thread from the policy, the queue or the sleeping threads
+ * that holds it, according to its state.
+ * @param thread the Thread to remove.
+ * @return None.
+ */
+void Scheduler::_unlinkThread(Thread *thread) {
+    if (thread->getState() == READY) {
+        _policyOps->dequeue(_policyOf(thread), thread);
+        __atomic_sub_fetch(&_readyCount, 1, __ATOMIC_SEQ_CST);
+        return;
+    }
+    // A Thread that waits with a timeout is in both a queue and the
+    // sleeping threads.
+    if (_sleepThreads.contains(thread)) {
+        _sleepThreads.remove(thread);
+    }
+    if (thread->getQueue() != nullptr) {
+        thread->getQueue()->remove(thread);
+    }
+}
+
+/**
+ * Hands a Thread to the scheduling policy of the calling worker, and sets
+ * its state to READY, without waking up an idle worker.
+ * @param thread the Thread, which must not be held by any DAST.
+ * @param woken true if the Thread was just created, BLOCKED or SLEEPING,
+ * which the policy is told.
+ * @return None.
+ */
+void Scheduler::_enqueueReady(Thread *thread, bool woken) {
+    Worker *worker = currentWorker();
+
+    _lockQueue(worker);
+    if (woken) {
+        _policyOps->onWake(worker->policyData, thread);
+    }
+    thread->setState(READY);
+    thread->setWorker(worker->index);
+    _policyOps->enqueue(worker->policyData, thread);
+    __atomic_add_fetch(&_readyCount, 1, __ATOMIC_SEQ_CST);
+    _unlockQueue(worker);
+}
+
+/**
+ * Hands a Thread to the scheduling policy of the calling worker, and sets
+ * its state to READY.
+ * @param thread the Thread, which must not be held by any DAST.
+ * @param woken true if the Thread was just created, BLOCKED or SLEEPING,
+ * which the policy is told.
+ * @return None.
+ */
+void Scheduler::_makeReady(Thread *thread, bool woken) {
+    _enqueueReady(thread, woken);
+    _notifyIdleWorkers(1);
+}
+
+/**
+ * Makes a Thread that was just created, BLOCKED or SLEEPING READY.
+ * @param thread the Thread, which must not be held by any DAST.
+ * @return None.
+ */
+void Scheduler::_wakeThread(Thread *thread) {
+    _makeReady(thread, true);
 }
 
 /**
@@ -176,88 +687,165 @@ int Scheduler::getTotalQuantumCounter(int dummy) {
 
 /**
  * Thread switching function between environments. if saveTo is
- * NO_ACTIVE_THREAD, no sigsetjmp will happen.
- * @param saveTo The ID of the Thread to save to
- * @param jumpTo The ID of the Thread to jump to
+ * nullptr, no sigsetjmp will happen.
+ * @param saveTo The Thread to save to
+ * @param jumpTo The Thread to jump to
  * @return None
  */
-void Scheduler::_switchThreads(int saveTo, int jumpTo) {
-    int ret_val;
+void Scheduler::_switchThreads(Thread *saveTo, Thread *jumpTo) {
+    // The kernel thread goes on as jumpTo.
+    Thread::setRunning(jumpTo);
+
+#ifdef UTHREAD_ASM_SWITCH
+    // A removed thread will never be resumed, so its context is discarded.
+    Context discarded;
+    Context *saveContext = &discarded;
+    if (saveTo != nullptr) {
+        saveContext = saveTo->context();
+    }
+
+    uthread_context_switch(saveContext, jumpTo->context());
 
-    // increase thread's quantum and total quantums
-    _threads[jumpTo]->incrementQuantum();
-    _totalQuantumCounter++;
+    // If pointer is not null, delete it and reset it to null. The Thread
+    // may now run on another worker.
+    Worker *worker = currentWorker();
+    if (worker->toDelete != nullptr) {
+        delete worker->toDelete;
+        worker->toDelete = nullptr;
+    }
+#else
+    int ret_val;
 
     // if saveTo is illegal, don't set sig
-    if (saveTo == NO_ACTIVE_THREAD) {
-        siglongjmp(*_threads[jumpTo]->environment(), JUMP_RETURN_VALUE);
+    if (saveTo == nullptr) {
+        siglongjmp(*jumpTo->environment(), JUMP_RETURN_VALUE);
     }
     else {
-        ret_val = sigsetjmp(*_threads[saveTo]->environment(), THREAD_SAVE_MASK);
+        ret_val = sigsetjmp(*saveTo->environment(), THREAD_SAVE_MASK);
         if (ret_val == JUMP_RETURN_VALUE) {
-            // If pointer is not null, delete it and reset it to null
-            if (_toDelete != nullptr) {
-                delete _toDelete;
-                _toDelete = nullptr;
+            // If pointer is not null, delete it and reset it to null. The
+            // Thread may now run on another worker.
+            Worker *worker = currentWorker();
+            if (worker->toDelete != nullptr) {
+                delete worker->toDelete;
+                worker->toDelete = nullptr;
             }
             return;
         }
-        siglongjmp(*_threads[jumpTo]->environment(), JUMP_RETURN_VALUE);
+        siglongjmp(*jumpTo->environment(), JUMP_RETURN_VALUE);
     }
+#endif
 }
 
 /**
  * Kills the main process from inside the scheduler.
- * This code will run only ONCE per run (any additional call will not
+ * This code will run only ONCE per Scheduler (any additional call will not
  * take any affect).
  * @return None
  */
 void Scheduler::_killProcess() {
-    // numOfKills is initialized only ONCE!
-    static int numOfKills = 0;
+    // kill only if this code hasn't ran before. Other workers may still be
+    // running Threads, so with several workers everything is left to the
+    // process exit.
+    if (!_killed && _workerCount == 1) {
+        _policyOps->destroy(_workers[0].policyData);
+        // The kernel must be done with the stacks before they are released.
+        _ioRing.drain();
 
-    // kill only if this code hasn't ran before
-    if (numOfKills == 0) {
         // Releasing all resources used for all of the threads.
-        for (auto it = _threads.begin(); it != _threads.end(); it++) {
-            delete it->second;
+        for (int ID = 0; ID < _maxThreads; ++ID) {
+            delete _threads[ID];
         }
 
+        delete _workers[0].idle;
+        _workers[0].idle = nullptr;
+
         // If pointer is not null, delete it and reset it to null
-        if (_toDelete != nullptr) {
-            delete _toDelete;
-            _toDelete = nullptr;
+        if (_workers[0].toDelete != nullptr) {
+            delete _workers[0].toDelete;
+            _workers[0].toDelete = nullptr;
         }
 
-        // Memory allocated for idManager is released.
-        delete[] _idManagar;
-        numOfKills++;
+        // Memory allocated for the thread table is released.
+        delete[] _threads;
+        delete[] _joinStates;
+        delete[] _futureWatches;
+        _killed = true;
     }
 }
 //---------------------------------------------------------------------------//
 
 /**
  * Adding a new Thread.
- * @param f The function of the Thread
+ * @param f The function of the Thread (nullptr for the main Thread)
  * @return The Thread ID on success and FAILURE on failure
  */
 int Scheduler::addThread(FunctionPointer f)
+{
+    return _addThread(f, nullptr, nullptr, nullptr, nullptr);
+}
+
+/**
+ * Adding a new Thread, whose function gets an argument.
+ * @param f The function of the Thread
+ * @param argument The argument of the function
+ * @return The Thread ID on success and FAILURE on failure
+ */
+int Scheduler::addThread(ArgumentFunction f, void *argument)
+{
+    return _addThread(nullptr, f, argument, nullptr, nullptr);
+}
+
+/**
+ * Adding a new Thread, whose function gets a callable the Thread keeps (see
+ * Thread::moveClosure). The callable is moved, and destroyed if the Thread
+ * is removed before its function returns, with the lock held.
+ * @param f The function of the Thread
+ * @param mover The function that moves the callable
+ * @param destroyer The function that destroys the callable, or nullptr
+ * @param closure The callable, of THREAD_CLOSURE_SIZE bytes at most
+ * @return The Thread ID on success and FAILURE on failure
+ */
+int Scheduler::addThread(ArgumentFunction f, ClosureMover mover,
+                         ClosureDestroyer destroyer, void *closure)
+{
+    return _addThread(nullptr, f, closure, mover, destroyer);
+}
+
+/**
+ * Creates a Thread that runs f, or argumentFunction(argument), and makes it
+ * READY (unless it is the main Thread).
+ * @param f The function of the Thread, or nullptr
+ * @param argumentFunction The function that gets an argument, or nullptr
+ * @param argument The argument of argumentFunction
+ * @param mover The function that moves a callable into the Thread (the
+ * argument), or nullptr
+ * @param destroyer The function that destroys the callable, or nullptr
+ * @return The Thread ID on success and FAILURE on failure
+ */
+int Scheduler::_addThread(FunctionPointer f, ArgumentFunction argumentFunction,
+                          void *argument, ClosureMover mover,
+                          ClosureDestroyer destroyer)
 {
     try {
         // don't exceed maximum threads value
-        if ((signed) _threads.size() == _maxThreads) {
+        if (_threadCount == _maxThreads) {
             return ErrorHandler::libError(THREAD_LIB_ERROR_THREADS_AMOUNT);
         }
 
         // get a new ID and create a new thread with that ID
         int aveliableID = _getNewID();
 
-        _threads.insert(std::pair<int, Thread *>(aveliableID,
-                                                 new Thread(aveliableID,
-                                                            _stackSize, f)));
+        Thread *thread = new Thread(aveliableID, _stackSize, f,
+                                    argumentFunction, argument);
+        if (mover != nullptr) {
+            thread->moveClosure(mover, destroyer, argument);
+        }
+        _threads[aveliableID] = thread;
+        _threadCount++;
 
-        if (f != nullptr) {
-            _readyThreads.push_back(aveliableID);
+        if (f != nullptr || argumentFunction != nullptr) {
+            _wakeThread(thread);
         }
         return aveliableID;
 
@@ -273,26 +861,102 @@ int Scheduler::addThread(FunctionPointer f)
 
 /**
  * Delete a thread from the threads DAST including his ID and resources.
- * Moreover, if its the running thread, _runningThread will be updated
- * as NO_RUNNING_THREAD. If not, the thread's id will be erased from the
- * vector of its corresponding thread. (We shall assume that in this case,
- * the only states that will be received are BLOCKED and READY (As we can
- * see, SLEEPING is dealt in the main removing method).
+ * Moreover, if its the running thread, the running thread will be updated
+ * as NO_ACTIVE_THREAD. If it runs on another worker, it is marked
+ * TERMINATED and deleted by that worker. If not, the thread will be removed
+ * from the queue of its corresponding state. A thread waiting to join it is
+ * handed nullptr.
  */
-void Scheduler::_removeThreadHelper(int ID, vec *stateVec)
+void Scheduler::_removeThreadHelper(int ID)
 {
-    vecIter idPosition;
+    Worker *worker = currentWorker();
+    Thread *thread = _threads[ID];
+
+    _handOverExitValue(ID, nullptr);
+    _joinStates[ID].detached = false;
+    _unwatchFutures(ID);
 
-    if (ID == _runningThread) {
-        _runningThread = NO_ACTIVE_THREAD;
+    if (ID == worker->runningThread) {
+        worker->runningThread = NO_ACTIVE_THREAD;
+        _setToDelete(worker, thread);
     }
     else {
-        idPosition = _getIterOfThread(ID, stateVec);
-        *stateVec->erase(idPosition);
+        Worker *owner = _lockWorkerOf(thread);
+        if (_isRunningElsewhere(thread)) {
+            thread->setState(TERMINATED);
+            _kickWorker(thread);
+            _unlockQueue(owner);
+        }
+        else {
+            ThreadQueue *queue = thread->getQueue();
+            _unlinkThread(thread);
+            _unlockQueue(owner);
+            _deleteRemoved(worker, thread, queue);
+        }
+    }
+
+    _threads[ID] = nullptr;
+    _threadCount--;
+    _deleteID(ID);
+}
+
+/**
+ * Unlinks the Watchers of the Futures a Thread ID watches, if any.
+ * @param ID the ID.
+ * @return None.
+ */
+void Scheduler::_unwatchFutures(int ID)
+{
+    FutureWatch *watch = &_futureWatches[ID];
+    for (int i = 0; i < watch->count; ++i) {
+        watch->futures[i]->removeWatcher(&watch->watchers[i]);
+    }
+    if (watch->watchers != watch->localWatchers) {
+        delete[] watch->watchers;
+    }
+    watch->watchers = nullptr;
+    watch->futures = nullptr;
+    watch->count = 0;
+}
+
+/**
+ * Checks whether an ID belongs to a joinable Thread that exited and was not
+ * joined yet.
+ * @param ID the ID.
+ * @return true if so, false otherwise.
+ */
+bool Scheduler::_hasExited(int ID) const {
+    return ID > MAIN_THREAD_ID && ID < _maxThreads && _joinStates[ID].exited;
+}
+
+/**
+ * Hands the exit value of a Thread to the Thread waiting to join it, and
+ * wakes it up.
+ * @param ID the ID of the Thread.
+ * @param value the exit value.
+ * @return true if a Thread was waiting to join, false otherwise.
+ */
+bool Scheduler::_handOverExitValue(int ID, void *value) {
+    ThreadQueue *joiners = &_joinStates[ID].joiners;
+    Thread *joiner = joiners->front();
+    if (joiner == nullptr) {
+        return false;
     }
-    _toDelete = _threads[ID];
 
-    _threads.erase(ID);
+    *static_cast<void **>(joiner->getWaitData()) = value;
+    joiner->setWaitData(nullptr);
+    return wakeWaiter(joiners);
+}
+
+/**
+ * Releases the ID of an exited Thread.
+ * @param ID the ID.
+ * @return None.
+ */
+void Scheduler::_reapThread(int ID) {
+    _joinStates[ID].exited = false;
+    _joinStates[ID].exitValue = nullptr;
+    _threadCount--;
     _deleteID(ID);
 }
 
@@ -311,28 +975,55 @@ int Scheduler::removeThread(int ID) {
         exit(SUCCESS);
     }
 
-    vec *dastOfID = _getVectorOfThread(ID);
-    // ID doesn't exists or its a running thread.
-    if (dastOfID == nullptr) {
-        // Thread's running.
-        if (ID == _runningThread)
-        {
-            _removeThreadHelper(ID, dastOfID);
-            _currentScenario = TOSELFREMOVE;
-            return SUCCESS;
-        }
-            // Bad thread doesn't exist.
-        else
-        {
-            //No thread with this id exists.
-            return _badIDChecker(ID);
-        }
+    // An exited Thread only holds its ID.
+    if (_hasExited(ID)) {
+        _reapThread(ID);
+        return SUCCESS;
     }
-    else {
-        // Thread's BLOCKED or READY.
-        _removeThreadHelper(ID, dastOfID);
+
+    // Bad thread doesn't exist.
+    if (_getThread(ID) == nullptr) {
+        //No thread with this id exists.
+        return _badIDChecker(ID);
+    }
+
+    // Thread's running.
+    if (ID == currentWorker()->runningThread) {
+        _removeThreadHelper(ID);
+        currentWorker()->currentScenario = TOSELFREMOVE;
         return SUCCESS;
     }
+
+    // Thread's BLOCKED, SLEEPING or READY.
+    _removeThreadHelper(ID);
+    return SUCCESS;
+}
+
+/**
+ * Moving the uthread-local storage values out of a Thread that is not
+ * RUNNING, so that their destructors run before it is removed.
+ * @param ID The ID of the Thread.
+ * @param values Receives the THREAD_SPECIFIC_SLOTS values.
+ * @return true if the values were taken, false otherwise
+ */
+bool Scheduler::takeSpecific(int ID, void **values) {
+    Thread *thread = _getThread(ID);
+    if (thread == nullptr) {
+        return false;
+    }
+
+    // A READY Thread does not start running while the values are taken.
+    Worker *owner = _lockWorkerOf(thread);
+    bool running = (thread->getState() == RUNNING);
+    if (!running) {
+        void **slots = thread->specific();
+        for (int key = 0; key < THREAD_SPECIFIC_SLOTS; ++key) {
+            values[key] = slots[key];
+            slots[key] = nullptr;
+        }
+    }
+    _unlockQueue(owner);
+    return !running;
 }
 
 //-------------/
@@ -349,28 +1040,36 @@ int Scheduler::blockThread(int ID) {
         return ErrorHandler::libError(THREAD_LIB_ERROR_ILLEGAL_MAIN_OP);
     }
 
-    if (ID != _runningThread) {
+    Worker *worker = currentWorker();
+    if (ID != worker->runningThread) {
         // Check if ID is valid
-        vec *vecOfThread = _getVectorOfThread(ID);
-
-        if (vecOfThread == nullptr) {
+        if (_getThread(ID) == nullptr) {
             return _badIDChecker(ID);
         }
 
         // if BLOCKED or SLEEPING do nothing.
-        state threadState = _threads.at(ID)->getState();
+        state threadState = _threads[ID]->getState();
         if (threadState == BLOCKED || threadState == SLEEPING) {
             return SUCCESS;
         }
-        // Thread's ready to be blocked. First the state shall be changed.
+        // Thread's running on another worker, which blocks it.
+        Worker *owner = _lockWorkerOf(_threads[ID]);
+        if (_isRunningElsewhere(_threads[ID])) {
+            _threads[ID]->setState(BLOCKED);
+            _kickWorker(_threads[ID]);
+            _unlockQueue(owner);
+            return SUCCESS;
+        }
+        // Thread's ready to be blocked. It leaves the policy before the state
+        // is changed.
+        _moveThread(_threads[ID], &_blockThreads);
         _threads[ID]->setState(BLOCKED);
-
-        return _accessDBtoInsertAndDelete(&_blockThreads, vecOfThread, ID,
-                                          _getIterOfThread(ID, vecOfThread));
+        _unlockQueue(owner);
+        return SUCCESS;
     }
 
     _threads[ID]->setState(BLOCKED);
-    _currentScenario = TOBLOCK;
+    worker->currentScenario = TOBLOCK;
 
     return SUCCESS;
 }
@@ -383,119 +1082,721 @@ int Scheduler::blockThread(int ID) {
 int Scheduler::resumeThread(int ID) {
 
     // Check if ID is valid
-    vec *vecOfThread = _getVectorOfThread(ID);
-    if (ID != _runningThread && vecOfThread == nullptr) {
+    if (_getThread(ID) == nullptr) {
         return _badIDChecker(ID);
     }
 
     // if BLOCKED or SLEEPING do nothing.
-    state threadState = _threads.at(ID)->getState();
+    state threadState = _threads[ID]->getState();
     if (threadState == RUNNING ||
         threadState == SLEEPING || threadState == READY) {
         return SUCCESS;
     }
 
-    _threads[ID]->setState(READY);
+    // Thread's blocked by another worker than the one running it, which has
+    // not switched it out yet. It simply keeps running.
+    Worker *owner = _lockWorkerOf(_threads[ID]);
+    if (_isRunningElsewhere(_threads[ID])) {
+        _threads[ID]->setState(RUNNING);
+        _unlockQueue(owner);
+        return SUCCESS;
+    }
+    _unlockQueue(owner);
 
-    _accessDBtoInsertAndDelete(&_readyThreads, vecOfThread, ID, \
-                               _getIterOfThread(ID, vecOfThread));
+    // Thread's waiting (see waitOn), and only its queue wakes it up.
+    if (_threads[ID]->getQueue() != &_blockThreads) {
+        return SUCCESS;
+    }
 
+    _unlinkThread(_threads[ID]);
+    _wakeThread(_threads[ID]);
+
+    return SUCCESS;
+}
+
+/**
+ * Makes the running Thread wait on a queue, such as the waiters of a
+ * mutex. It is BLOCKED until wakeWaiter picks it or its timeout expires,
+ * and uthread_resume does not wake it up. The main Thread may wait too.
+ * @param queue the queue.
+ * @param numQuantums the number of quantums to wait at most (not including
+ * the current one), or NO_TIMEOUT.
+ * @return SUCCESS
+ */
+int Scheduler::waitOn(ThreadQueue *queue, int numQuantums) {
+    Worker *worker = currentWorker();
+    Thread *thread = worker->current;
+
+    // The Thread joins the queue (and the sleeping threads, if it has a
+    // timeout) after the next scheduling decision.
+    thread->setState(BLOCKED);
+    thread->setTimedOut(false);
+    thread->setWakeUpQuantum(numQuantums == NO_TIMEOUT ? NO_TIMEOUT :
+                             _totalQuantumCounter + numQuantums);
+    worker->waitQueue = queue;
+    worker->currentScenario = TOWAIT;
     return SUCCESS;
 }
 
+/**
+ * Makes a Thread that was taken out of a queue of waiting Threads READY,
+ * without waking up an idle worker.
+ * @param thread the Thread.
+ * @return None.
+ */
+void Scheduler::_stopWaiting(Thread *thread) {
+    if (_sleepThreads.contains(thread)) {
+        _sleepThreads.remove(thread);
+    }
+    _enqueueReady(thread, true);
+}
+
+/**
+ * Wakes up the Thread at the front of a queue of waiting Threads.
+ * @param queue the queue.
+ * @return true if a Thread was woken up, false if the queue is empty.
+ */
+bool Scheduler::wakeWaiter(ThreadQueue *queue) {
+    Thread *thread = queue->popFront();
+
+    if (thread == nullptr) {
+        return false;
+    }
+    _stopWaiting(thread);
+    _notifyIdleWorkers(1);
+    return true;
+}
+
+/**
+ * Wakes up all of the Threads of a queue of waiting Threads, in their
+ * order, at once.
+ * @param queue the queue.
+ * @return the number of Threads woken up.
+ */
+int Scheduler::wakeAllWaiters(ThreadQueue *queue) {
+    int count = 0;
+    Thread *thread = queue->popFront();
+
+    while (thread != nullptr) {
+        _stopWaiting(thread);
+        count++;
+        thread = queue->popFront();
+    }
+    // The idle workers are woken up once for all of the Threads.
+    _notifyIdleWorkers(count);
+    return count;
+}
+
+/**
+ * Checks whether the running Thread stopped waiting because its timeout
+ * expired.
+ * @return true if so, false if it was woken up.
+ */
+bool Scheduler::hasWaitTimedOut() {
+    return currentWorker()->current->hasTimedOut();
+}
+
+/**
+ * Makes the running Thread watch Futures: each of them wakes it up once
+ * complete, until it stops watching them (or is removed).
+ * @param futures the Futures (which must stay valid meanwhile).
+ * @param count the number of Futures.
+ * @return the queue the Thread waits on.
+ */
+ThreadQueue *Scheduler::watchFutures(Future **futures, int count) {
+    FutureWatch *watch = &_futureWatches[currentWorker()->runningThread];
+    watch->watchers = watch->localWatchers;
+    if (count > LOCAL_WATCHERS) {
+        watch->watchers = new(nothrow) Future::Watcher[count];
+        if (watch->watchers == nullptr) {
+            _killProcess();
+            ErrorHandler::sysCallError(THREAD_SYS_CALL_ERROR_BAD_ALLOC);
+        }
+    }
+
+    watch->futures = futures;
+    watch->count = count;
+    for (int i = 0; i < count; ++i) {
+        watch->watchers[i].queue = &watch->queue;
+        futures[i]->addWatcher(&watch->watchers[i]);
+    }
+    return &watch->queue;
+}
+
+/**
+ * Makes the running Thread stop watching its Futures.
+ * @return None.
+ */
+void Scheduler::unwatchFutures() {
+    _unwatchFutures(currentWorker()->runningThread);
+}
+
 //-------------/
 
 /**
- * Make a Thread sleep.
- * @param ID The ID of the Thread that should sleep.
+ * Puts the running Thread to sleep until a given total quantum.
+ * @param wakeUpQuantum the total quantum at which the Thread is woken up.
  * @return SUCCESS on success and FAILURE on failure
  */
-int Scheduler::sleepThread(int num_quantums) {
+int Scheduler::_sleepRunningThread(int wakeUpQuantum) {
+    Worker *worker = currentWorker();
+
     // If trying to block main Thread.
-    if (_runningThread == MAIN_THREAD_ID) {
+    if (worker->runningThread == MAIN_THREAD_ID) {
         return ErrorHandler::libError(THREAD_LIB_ERROR_ILLEGAL_MAIN_OP);
     }
+
+    // Thread is successfully set to sleep. It joins the sleeping threads
+    // after the next scheduling decision.
+    worker->current->setState(SLEEPING);
+    worker->current->setWakeUpQuantum(wakeUpQuantum);
+
+    worker->currentScenario = TOSLEEP;
+
+    return SUCCESS;
+}
+
+/**
+ * Make the runnning Thread sleep.
+ * @param num_quantums The number of quantums to sleep (not including the
+ * current one).
+ * @return SUCCESS on success and FAILURE on failure
+ */
+int Scheduler::sleepThread(int num_quantums) {
     // Check wether the given number of quantums is positive.
     if (num_quantums < 0) {
         return ErrorHandler::libError(THREAD_LIB_ERROR_INPUT);
     }
+    return _sleepRunningThread(_totalQuantumCounter + num_quantums);
+}
 
-    int threadID = _runningThread;
+/**
+ * Make the runnning Thread sleep until a given quantum starts.
+ * @param quantum The total quantum in which the Thread may run again.
+ * @return SUCCESS on success and FAILURE on failure
+ */
+int Scheduler::sleepUntil(int quantum) {
+    // The quantum must be in the future.
+    if (quantum <= _totalQuantumCounter) {
+        return ErrorHandler::libError(THREAD_LIB_ERROR_INPUT);
+    }
+    // A thread woken up at quantum q - 1 gets to run from quantum q.
+    return _sleepRunningThread(quantum - 1);
+}
 
-    // Thread is successfully set to sleep. Quantums to sleep is set.
-    _threads[threadID]->setState(SLEEPING);
-    _threads[threadID]->setQuantumsToSleep(num_quantums);
-    _threads[threadID]->setQuantumsLeftToSleep(num_quantums);
+//---------------------------ROUND ROBIN RELATED-----------------------------//
 
-    _currentScenario = TOSLEEP;
+/**
+ * Manages all of the sleeping threads. Wakes up every thread whose wake up
+ * quantum has come. Only those threads are touched.
+ * @return None
+ */
+void Scheduler::_manageSleepingThreads(void) {
+    Thread *thread = _sleepThreads.top();
+
+    while (thread != nullptr &&
+           thread->getWakeUpQuantum() <= _totalQuantumCounter) {
+        _sleepThreads.pop();
+        // A Thread that waits with a timeout stops waiting.
+        if (thread->getQueue() != nullptr) {
+            thread->getQueue()->remove(thread);
+            thread->setTimedOut(true);
+        }
+        _wakeThread(thread);
+        thread = _sleepThreads.top();
+    }
+}
 
-    return SUCCESS;
+/**
+ * Wakes up the Threads whose file descriptors became ready, polling them
+ * without waiting at most once a quantum.
+ * @return None
+ */
+void Scheduler::_manageWaitingIO(void) {
+    // An idle worker that waits for the events wakes the Threads up itself.
+    if (!_poller.hasWaiters() || _polling ||
+        _lastPollQuantum == _totalQuantumCounter) {
+        return;
+    }
+    _lastPollQuantum = _totalQuantumCounter;
+    _poller.dispatch(this, _poller.wait(0));
 }
 
-//---------------------------ROUND ROBIN RELATED-----------------------------//
+/**
+ * Submits the queued file I/O requests, and wakes up the Threads whose
+ * requests completed.
+ * @return None
+ */
+void Scheduler::_manageFileIO(void) {
+    if (!_ioRing.isBusy()) {
+        return;
+    }
+
+    // Every scheduling decision with the lock submits the requests queued
+    // since the last one at once, so a request waits for no other Thread's
+    // quantum.
+    if (_ioRing.hasQueued()) {
+        // The ring's file descriptor is readable while completions wait to
+        // be reaped, so that it wakes up an idle worker that polls.
+        _poller.watch(_ioRing.fd());
+        _ioRing.submit();
+    }
+    _ioRing.reap(this);
+}
 
 /**
- * Manages all of the sleeping threads. Decreases the time that has left
- * to sleep, and wakes up every thread that finished its sleeping time.
+ * Wakes up the Threads whose offloaded calls completed.
  * @return None
  */
-void Scheduler::_manageSleepingThreads(void) {
-    for (auto it = _sleepThreads.begin(); it < _sleepThreads.end(); ++it) {
-        // decrease sleeping time
-        _threads[*it]->decrementQuantumsToSleep();
-        // Wake up a sleeping thread.
-        if (_threads[*it]->getQuantumsLeftToSleep() == 0) {
-            _threads[*it]->setState(READY);
-            _accessDBtoInsertAndDelete(&_readyThreads, &_sleepThreads, *it, it);
+void Scheduler::_manageOffloads(void) {
+    if (!_offloadPool.isBusy()) {
+        return;
+    }
+
+    // The pool's eventfd wakes up an idle worker that polls once a call
+    // completes.
+    _poller.watch(_offloadPool.fd());
+    _offloadPool.reap(this);
+}
+
+/**
+ * Makes the running Thread give up the CPU. It stays READY, and goes to
+ * the back of the ready Threads.
+ * @param dummy a dummy param that is passed in order to match the caller
+ * signature. Its value is ignored.
+ * @return SUCCESS
+ */
+int Scheduler::yieldThread(int dummy) {
+    currentWorker()->currentScenario = TOYIELD;
+    return SUCCESS;
+}
+
+/**
+ * Makes the running Thread give up the CPU to a given READY Thread,
+ * regardless of the order of the ready Threads. The running Thread
+ * stays READY, and goes to the back of the ready Threads.
+ * @param ID The ID of the Thread to run next.
+ * @return SUCCESS on success and FAILURE on failure
+ */
+int Scheduler::yieldTo(int ID) {
+    Thread *thread = _getThread(ID);
+
+    if (thread == nullptr) {
+        return _badIDChecker(ID);
+    }
+    // Yielding to oneself changes nothing.
+    Worker *worker = currentWorker();
+    if (ID == worker->runningThread) {
+        return SUCCESS;
+    }
+    // The Thread may still be picked by another worker before the calling
+    // one switches to it, which then runs the next READY Thread instead.
+    Worker *owner = _lockWorkerOf(thread);
+    bool ready = (thread->getState() == READY);
+    _unlockQueue(owner);
+    if (!ready) {
+        return ErrorHandler::libError(THREAD_LIB_ERROR_NOT_READY);
+    }
+
+    worker->yieldTarget = ID;
+    worker->currentScenario = TOYIELDTO;
+    return SUCCESS;
+}
+
+/**
+ * Makes the running Thread exit. A Thread waiting to join it is handed the
+ * exit value. A detached Thread, or one that was joined, is removed;
+ * otherwise its resources are released, and its ID is kept with the exit
+ * value until it is joined. The main Thread exits the process.
+ * @param value the exit value.
+ * @return SUCCESS
+ */
+int Scheduler::exitThread(void *value) {
+    Worker *worker = currentWorker();
+    int ID = worker->runningThread;
+
+    if (ID == MAIN_THREAD_ID) {
+        return removeThread(ID);
+    }
+
+    if (_handOverExitValue(ID, value) || _joinStates[ID].detached) {
+        _removeThreadHelper(ID);
+    }
+    else {
+        // The Thread is deleted once the worker switched away from it.
+        _joinStates[ID].exited = true;
+        _joinStates[ID].exitValue = value;
+        worker->runningThread = NO_ACTIVE_THREAD;
+        _setToDelete(worker, _threads[ID]);
+        _threads[ID] = nullptr;
+    }
+
+    worker->currentScenario = TOSELFREMOVE;
+    return SUCCESS;
+}
+
+/**
+ * Joins a Thread: collects the exit value of an exited Thread and releases
+ * its ID, or makes the running Thread wait on the Thread until it exits (or
+ * is removed, which hands over nullptr).
+ * @param ID The ID of the Thread to join.
+ * @param value where the exit value goes.
+ * @return SUCCESS on success and FAILURE on failure
+ */
+int Scheduler::joinThread(int ID, void **value) {
+    if (ID == MAIN_THREAD_ID) {
+        return ErrorHandler::libError(THREAD_LIB_ERROR_ILLEGAL_MAIN_OP);
+    }
+
+    if (_hasExited(ID)) {
+        *value = _joinStates[ID].exitValue;
+        _reapThread(ID);
+        return SUCCESS;
+    }
+
+    if (_getThread(ID) == nullptr) {
+        return _badIDChecker(ID);
+    }
+
+    Worker *worker = currentWorker();
+    if (ID == worker->runningThread) {
+        return ErrorHandler::libError(THREAD_LIB_ERROR_JOIN_SELF);
+    }
+    if (_joinStates[ID].detached) {
+        return ErrorHandler::libError(THREAD_LIB_ERROR_DETACHED);
+    }
+    if (!_joinStates[ID].joiners.isEmpty()) {
+        return ErrorHandler::libError(THREAD_LIB_ERROR_JOINED);
+    }
+
+    worker->current->setWaitData(value);
+    return waitOn(&_joinStates[ID].joiners, NO_TIMEOUT);
+}
+
+/**
+ * Detaching a Thread, which is removed as soon as it exits. An exited Thread
+ * is released at once.
+ * @param ID The ID of the Thread to detach.
+ * @return SUCCESS on success and FAILURE on failure
+ */
+int Scheduler::detachThread(int ID) {
+    if (ID == MAIN_THREAD_ID) {
+        return ErrorHandler::libError(THREAD_LIB_ERROR_ILLEGAL_MAIN_OP);
+    }
+
+    if (_hasExited(ID)) {
+        _reapThread(ID);
+        return SUCCESS;
+    }
+
+    if (_getThread(ID) == nullptr) {
+        return _badIDChecker(ID);
+    }
+    if (_joinStates[ID].detached) {
+        return ErrorHandler::libError(THREAD_LIB_ERROR_DETACHED);
+    }
+    if (!_joinStates[ID].joiners.isEmpty()) {
+        return ErrorHandler::libError(THREAD_LIB_ERROR_JOINED);
+    }
+
+    _joinStates[ID].detached = true;
+    return SUCCESS;
+}
+
+/**
+ * Setter for the scheduling policy. The ready Threads are handed over to
+ * the new policy.
+ * @param newPolicy the policy.
+ * @return None.
+ */
+void Scheduler::setPolicy(policy newPolicy) {
+    const PolicyTable *newOps;
+
+    switch (newPolicy) {
+        case MULTI_LEVEL_FEEDBACK:
+            newOps = &PolicyAdapter<FeedbackPolicy>::table;
+            break;
+        case FAIR_SHARE:
+            newOps = &PolicyAdapter<FairSharePolicy>::table;
+            break;
+        default:
+            newOps = &PolicyAdapter<RoundRobinPolicy>::table;
+            break;
+    }
+
+    void *newData[MAX_WORKERS];
+    for (int index = 0; index < _workerCount; ++index) {
+        newData[index] = newOps->create(_threads, _maxThreads,
+                                        &_totalQuantumCounter);
+        if (newData[index] == nullptr) {
+            _killProcess();
+            ErrorHandler::sysCallError(THREAD_SYS_CALL_ERROR_BAD_ALLOC);
         }
     }
+
+    // Hand the ready threads over, in the order of their IDs. Each stays
+    // with its worker, whose lock keeps it from using the policy meanwhile.
+    for (int index = 0; index < _workerCount; ++index) {
+        _lockQueue(&_workers[index]);
+    }
+    for (int ID = 0; ID < _maxThreads; ++ID) {
+        if (_threads[ID] != nullptr && _threads[ID]->getState() == READY) {
+            _policyOps->dequeue(_policyOf(_threads[ID]), _threads[ID]);
+            newOps->enqueue(newData[_threads[ID]->getWorker()], _threads[ID]);
+        }
+    }
+
+    for (int index = 0; index < _workerCount; ++index) {
+        _policyOps->destroy(_workers[index].policyData);
+        _workers[index].policyData = newData[index];
+    }
+    _policy = newPolicy;
+    _policyOps = newOps;
+    for (int index = 0; index < _workerCount; ++index) {
+        _unlockQueue(&_workers[index]);
+    }
+}
+
+/**
+ * Setter for a Thread's priority level. The Thread keeps being moved
+ * between levels by the MULTI_LEVEL_FEEDBACK policy afterwards.
+ * @param ID The ID of the Thread.
+ * @param priority The priority level, between TOP_PRIORITY and
+ * PRIORITY_LEVELS - 1.
+ * @return SUCCESS on success and FAILURE on failure
+ */
+int Scheduler::setPriority(int ID, int priority) {
+    Thread *thread = _getThread(ID);
+
+    if (thread == nullptr) {
+        return _badIDChecker(ID);
+    }
+    if (_policy != MULTI_LEVEL_FEEDBACK) {
+        return ErrorHandler::libError(THREAD_LIB_ERROR_POLICY);
+    }
+    if (priority < TOP_PRIORITY || priority >= PRIORITY_LEVELS) {
+        return ErrorHandler::libError(THREAD_LIB_ERROR_INPUT);
+    }
+
+    // A ready thread moves to the queue of its new level. The level belongs
+    // to the current reset epoch, so the policy does not reset it to the top
+    // one right away.
+    Worker *owner = _lockWorkerOf(thread);
+    thread->setResetEpoch(__atomic_load_n(&_totalQuantumCounter,
+                                          __ATOMIC_RELAXED) /
+                          FEEDBACK_RESET_PERIOD);
+    if (thread->getState() == READY) {
+        _policyOps->dequeue(_policyOf(thread), thread);
+        thread->setPriority(priority);
+        _policyOps->enqueue(_policyOf(thread), thread);
+    }
+    else {
+        thread->setPriority(priority);
+    }
+    _unlockQueue(owner);
+    return SUCCESS;
+}
+
+/**
+ * Setter for a Thread's weight under FAIR_SHARE. The Thread's share of
+ * the CPU is its weight divided by the sum of the weights of the
+ * runnable Threads.
+ * @param ID The ID of the Thread.
+ * @param weight The weight, a positive number (DEFAULT_WEIGHT unless set).
+ * @return SUCCESS on success and FAILURE on failure
+ */
+int Scheduler::setWeight(int ID, int weight) {
+    Thread *thread = _getThread(ID);
+
+    if (thread == nullptr) {
+        return _badIDChecker(ID);
+    }
+    if (_policy != FAIR_SHARE) {
+        return ErrorHandler::libError(THREAD_LIB_ERROR_POLICY);
+    }
+    if (weight <= 0) {
+        return ErrorHandler::libError(THREAD_LIB_ERROR_INPUT);
+    }
+
+    // The weight only affects what the Thread is charged from now on, so a
+    // ready Thread keeps its place in the policy.
+    Worker *owner = _lockWorkerOf(thread);
+    thread->setWeight(weight);
+    _unlockQueue(owner);
+    return SUCCESS;
 }
 
 /**
- * Manages the Threads. This is where the Round-Robin decisions are being
- * made. Every scenario will be dealt in this code, and all states and
- * DASTs will be updated as needed.
+ * Manages the Threads. This is where the scheduling policy is told how
+ * the running Thread's quantum ended and asked which Thread runs next.
+ * Every scenario will be dealt in this code, and all states and DASTs
+ * will be updated as needed.
  * @return None
  */
 void Scheduler::manageThreads(void) {
     try
     {
-        int newThread;
-        int oldThread;
+        Worker *worker = currentWorker();
+        Thread *oldThread = worker->current;
+        bool wasIdle = (oldThread == worker->idle);
+        bool stoppable = !wasIdle && (worker->currentScenario == ROUTINE ||
+                                      worker->currentScenario == TOYIELD);
+        // A yield hands the rest of the current quantum over, so no new
+        // quantum starts.
+        bool handOff = (worker->currentScenario == TOYIELD ||
+                        worker->currentScenario == TOYIELDTO);
+
+        // A preemption or a yield only takes the Scheduler's lock when there
+        // is shared work to do. The lock is taken before the worker's, and
+        // whether the calling Thread held it is restored once it runs again.
+        bool locked = worker->locked;
+        if (!locked && _hasSharedWork()) {
+            lock();
+        }
+        _lockQueue(worker);
+        worker->deciding = true;
+
+        // A thread stopped by another worker is switched out with the
+        // Scheduler's lock, as a blocked one joins the blocked threads.
+        if (stoppable && !worker->locked && oldThread->getState() != RUNNING) {
+            worker->deciding = false;
+            _unlockQueue(worker);
+            lock();
+            _lockQueue(worker);
+            worker->deciding = true;
+        }
+        void *policyData = worker->policyData;
 
-        oldThread = _runningThread;
+        if (worker->locked) {
+            _manageSleepingThreads();
+        }
 
-        _manageSleepingThreads();
+        // A thread blocked or terminated by another worker is switched out
+        // like one that blocked or terminated itself.
+        if (stoppable) {
+            if (oldThread->getState() == BLOCKED) {
+                worker->currentScenario = TOBLOCK;
+            }
+            else if (oldThread->getState() == TERMINATED) {
+                // A thread terminated as it went to wait is deleted like
+                // one that waited.
+                _deleteRemoved(worker, oldThread,
+                               worker->currentScenario == TOWAIT ?
+                               worker->waitQueue : nullptr);
+                worker->waitQueue = nullptr;
+                worker->currentScenario = TOSELFREMOVE;
+            }
+        }
 
-        // Deal with each scenario
-        switch (_currentScenario) {
+        // Deal with each scenario, telling the policy whether the thread gave
+        // up the CPU, yielded, or used up its quantum.
+        switch (worker->currentScenario) {
             case TOSLEEP:
-                _sleepThreads.push_back(oldThread);
-                _currentScenario = ROUTINE;
+                _policyOps->onBlock(policyData, oldThread);
+                _sleepThreads.push(oldThread);
+                worker->currentScenario = ROUTINE;
                 break;
             case TOBLOCK:
-                _blockThreads.push_back(oldThread);
-                _currentScenario = ROUTINE;
+                _policyOps->onBlock(policyData, oldThread);
+                _blockThreads.pushBack(oldThread);
+                worker->currentScenario = ROUTINE;
+                break;
+            case TOWAIT:
+                _policyOps->onBlock(policyData, oldThread);
+                worker->waitQueue->pushBack(oldThread);
+                if (oldThread->getWakeUpQuantum() != NO_TIMEOUT) {
+                    _sleepThreads.push(oldThread);
+                }
+                worker->waitQueue = nullptr;
+                worker->currentScenario = ROUTINE;
                 break;
             case TOSELFREMOVE:
-                _currentScenario = ROUTINE;
+                oldThread = nullptr;
+                worker->currentScenario = ROUTINE;
+                break;
+            case TOYIELD:
+            case TOYIELDTO:
+                _policyOps->onYield(policyData, oldThread);
+                _makeReady(oldThread, false);
+                worker->currentScenario = ROUTINE;
                 break;
                 // Routine.
             default:
-                _readyThreads.push_back(oldThread);
-                _threads[oldThread]->setState(READY);
+                if (!wasIdle) {
+                    _policyOps->onTick(policyData, oldThread);
+                    _makeReady(oldThread, false);
+                }
                 break;
         }
 
-        // Assign threads to DASTs
-        newThread = _readyThreads.front();
-        _runningThread = newThread;
+        // A Thread that has just started waiting for a file descriptor is in
+        // its queue by now, so an event reported when it re-armed the
+        // descriptor wakes it up.
+        if (worker->locked) {
+            _manageWaitingIO();
+            _manageFileIO();
+            _manageOffloads();
+        }
+
+        // Assign threads to DASTs. A thread yielded to skips the policy's
+        // order, unless another worker picked it meanwhile.
+        Thread *next = nullptr;
+        if (worker->yieldTarget != NO_ACTIVE_THREAD) {
+            Thread *target = _threads[worker->yieldTarget];
+            Worker *owner = _lockWorkerOf(target);
+            if (target->getState() == READY) {
+                _policyOps->dequeue(owner->policyData, target);
+                _startRunning(worker, target);
+                next = target;
+            }
+            _unlockQueue(owner);
+            worker->yieldTarget = NO_ACTIVE_THREAD;
+        }
+        if (next == nullptr) {
+            next = _pickNext(worker);
+        }
+
+        if (next != nullptr) {
+            worker->runningThread = next->getID();
+        }
+        else {
+            // Nothing to run: the worker goes idle.
+            if (wasIdle) {
+                finishSwitch(locked);
+                return;
+            }
+            next = worker->idle;
+            worker->runningThread = NO_ACTIVE_THREAD;
+        }
+
+        // increase thread's quantum and total quantums (an idle worker does
+        // not start a quantum). A Thread handed the rest of a quantum has
+        // only run in it if it never ran before.
+        if (next != worker->idle) {
+            if (!handOff) {
+                next->incrementQuantum();
+                __atomic_add_fetch(&_totalQuantumCounter, 1, __ATOMIC_RELAXED);
+            }
+            else if (next->getQuantums() == 0) {
+                next->incrementQuantum();
+            }
+        }
 
-        _readyThreads.erase(_readyThreads.begin());
-        _threads[newThread]->setState(RUNNING);
+        // The Thread that gave up the CPU is the only one to run, and goes on
+        // without a context switch. A Thread it removed meanwhile is deleted
+        // right away.
+        if (next == oldThread) {
+            _setToDelete(worker, nullptr);
+            finishSwitch(locked);
+            return;
+        }
+        worker->current = next;
 
-        // Make a context switch
-        _switchThreads(oldThread, newThread);
+        // Make a context switch. The worker keeps its locks across it, so
+        // that no other worker runs or wakes up oldThread before its context
+        // is saved.
+        _switchThreads(oldThread, next);
+        finishSwitch(locked);
     }
     catch (std::bad_alloc &ba) {
         _killProcess();
@@ -511,7 +1812,7 @@ void Scheduler::manageThreads(void) {
  */
 int Scheduler::getRunningThreadID(int dummy) {
     dummy = 0;
-    return _runningThread + dummy;
+    return currentWorker()->runningThread + dummy;
 }
 
 /**
@@ -521,17 +1822,15 @@ int Scheduler::getRunningThreadID(int dummy) {
  * @return the number of quantums until the thread wakes up.
  */
 int Scheduler::getTimeToWakeUp(int ID) {
-    // Check whether a thread exists.
-    vec *vecOfThread = _getVectorOfThread(ID);
-
     // Check if ID is illegal
-    if (ID != _runningThread && vecOfThread == nullptr) {
+    if (_getThread(ID) == nullptr) {
         return _badIDChecker(ID);
     }
 
-    // If thread's sleeping 0 shall be returned.
+    // If thread's not sleeping 0 shall be returned. The current quantum is
+    // included in the count.
     if (_threads[ID]->getState() == SLEEPING) {
-        return _threads[ID]->getQuantumsLeftToSleep();
+        return _threads[ID]->getWakeUpQuantum() - _totalQuantumCounter + 1;
     }
     else {
         return 0;
@@ -546,24 +1845,33 @@ int Scheduler::getTimeToWakeUp(int ID) {
  * @return the number of quantums the tread was in running state.
  */
 int Scheduler::getNumOfQuantums(int ID) {
-    // Check whether a thread exists.
-    vec *vecOfThread = _getVectorOfThread(ID);
-
     // Check if ID is illegal
-    if (ID != _runningThread && vecOfThread == nullptr) {
-        if (ID != MAIN_THREAD_ID)
-            return _badIDChecker(ID);
+    if (_getThread(ID) == nullptr) {
+        return _badIDChecker(ID);
     }
 
     // If thread's sleeping 0 shall be returned.
     return _threads[ID]->getQuantums();
 }
 
+/**
+ * Checks whether the running Thread may have to be preempted when its
+ * quantum expires: some other Thread is READY, SLEEPING (and sleeps are
+ * counted in quantums) or waiting for a file descriptor, file I/O or an
+ * offloaded call (which are polled once a quantum).
+ * @return true if so, false if the quantum timer may be stopped.
+ */
+bool Scheduler::isPreemptionNeeded() const {
+    return _readyCount > 0 || !_sleepThreads.isEmpty() ||
+           _poller.hasWaiters() || _ioRing.isBusy() ||
+           _offloadPool.isBusy();
+}
+
 /**
  * Getter for the current scenario.
  * @return the current scenario.
  */
 int Scheduler::getScenario() {
-    return _currentScenario;
+    return currentWorker()->currentScenario;
 }
 
@@ -3,27 +3,114 @@
 
 // Includes
 #include "Thread.h"
+#include "ThreadQueue.h"
+#include "Future.h"
+#include "SleepQueue.h"
+#include "Poller.h"
+#include "IoRing.h"
+#include "OffloadPool.h"
+#include "SchedulingPolicy.h"
+#include "RoundRobinPolicy.h"
+#include "FeedbackPolicy.h"
+#include "FairSharePolicy.h"
+#include "IDAllocator.h"
+#include "SpinLock.h"
 #include "ErrorHandler.h"
 
-// Data structures.
-#include <queue>
-#include <map>
+#include <pthread.h>
 
 // Macros
 #define MAIN_THREAD_ID 0
-#define EMPTY_CELL -1
 #define NO_ACTIVE_THREAD -1
 #define JUMP_RETURN_VALUE 1
 #define SECOND 1000000
+#define MAX_WORKERS 64
+// The timeout of a Thread that waits until it is woken up (see waitOn).
+#define NO_TIMEOUT -1
 
-// The type of data structure to hold the IDs
-typedef vector<int> vec;
+// All possible scenarios that may occur during a round-robin cycle
+enum scenario {ROUTINE, TOBLOCK, TOSLEEP, TOSELFREMOVE, TOYIELD, TOYIELDTO,
+               TOWAIT};
 
-// Iterator of vec
-typedef vec::iterator vecIter;
+// The available scheduling policies.
+enum policy {ROUND_ROBIN, MULTI_LEVEL_FEEDBACK, FAIR_SHARE};
 
-// All possible scenarios that may occur during a round-robin cycle
-enum scenario {ROUTINE, TOBLOCK, TOSLEEP, TOSELFREMOVE};
+/*
+ * A worker is a kernel thread that runs Threads. There is one worker unless
+ * the library runs in M:N mode (see Scheduler::addWorkers). Each worker has
+ * its own running Thread, scenario and ready Threads (its own instance of
+ * the scheduling policy), which are guarded by its own lock.
+ */
+struct Worker
+{
+    // The index of the worker in the Scheduler.
+    int index;
+    // The kernel thread of the worker.
+    pthread_t pthread;
+    // The Thread the worker runs, which is idle while there is no other.
+    Thread *current;
+    // The Thread the worker runs when no Thread is READY.
+    Thread *idle;
+    // The ID of the running Thread, NO_ACTIVE_THREAD while idle.
+    int runningThread;
+    // The scenario of the running Thread.
+    scenario currentScenario;
+    // The ID of the Thread the running Thread yields to (TOYIELDTO).
+    int yieldTarget;
+    // The queue the running Thread waits on (TOWAIT).
+    ThreadQueue *waitQueue;
+    // A Thread that will be deleted once the worker switched away from it.
+    Thread *toDelete;
+    // The policy instance holding the ready Threads of the worker.
+    void *policyData;
+    // Guards policyData, current, and the state and worker of the Threads
+    // they hold, while there are several workers. The worker holds it for
+    // the whole of a scheduling decision, context switch included.
+    SpinLock queueLock;
+    // Set while the worker makes a scheduling decision.
+    bool deciding;
+    // Set while the worker holds the Scheduler's lock.
+    bool locked;
+};
+
+/*
+ * The joining state of a Thread ID: the Thread waiting to join it, whether
+ * it is detached, and once a joinable Thread exited, its exit value (the ID
+ * stays taken until the Thread is joined).
+ */
+struct JoinState
+{
+    // The Thread waiting to join (at most one), with a pointer to where the
+    // exit value goes as its wait data.
+    ThreadQueue joiners;
+    // Set once the Thread is detached.
+    bool detached;
+    // Set once a joinable Thread exited, until it is joined.
+    bool exited;
+    // The exit value of an exited Thread.
+    void *exitValue;
+};
+
+// The number of Futures a Thread watches without allocating.
+#define LOCAL_WATCHERS 8
+
+/*
+ * The Futures a Thread waits for any of (see Scheduler::watchFutures): the
+ * queue it waits on, and the Watchers through which each of them wakes it
+ * up. It is kept by the Scheduler, so that removing the Thread unlinks the
+ * Watchers.
+ */
+struct FutureWatch
+{
+    // The queue the Thread waits on.
+    ThreadQueue queue;
+    // The watched Futures, and a Watcher for each of them (localWatchers,
+    // unless there are more of them).
+    Future **futures;
+    Future::Watcher *watchers;
+    int count;
+    Future::Watcher localWatchers[LOCAL_WATCHERS];
+};
 
 
 /**
@@ -32,6 +119,18 @@ enum scenario {ROUTINE, TOBLOCK, TOSLEEP, TOSELFREMOVE};
  * expires. The Scheduler holds all of the threads, and assigns them to different
  * data structures according to their state (which is changed by the algorithm
  * or by the user).
+ * The ready threads are held by the scheduling policy, which also decides
+ * which of them runs next (see SchedulingPolicy.h). ROUND_ROBIN is the
+ * default, MULTI_LEVEL_FEEDBACK and FAIR_SHARE may be selected at start up.
+ * With several workers, each worker picks from its own ready threads first,
+ * and steals from the others' when it has none. The ready threads of each
+ * worker are guarded by a lock of their own, and the shared state (the
+ * thread table, the sleeping, blocked and waiting threads) by the
+ * Scheduler's lock, which the library holds for the whole of a call. A
+ * worker holds its locks across a context switch, so they are released by
+ * whichever Thread it switched to. A preemption or a yield only takes the
+ * Scheduler's lock when there is shared work to do, such as waking up
+ * sleeping threads.
  */
 class Scheduler {
 private:
@@ -47,111 +146,369 @@ private:
     int _stackSize;
 
     /**
-     * An array the manages the thread IDs.
+     * Manages the thread IDs (hands out the smallest free one).
+     */
+    IDAllocator _idManagar;
+
+    /**
+     * A table that holds all of the available Threads, indexed by ID.
+     * Cells of IDs that are not in use hold nullptr.
+     */
+    Thread **_threads;
+
+    /**
+     * The number of Threads in the table, and of exited Threads that were
+     * not joined yet.
+     */
+    int _threadCount;
+
+    /**
+     * The joining state of each Thread ID.
+     */
+    JoinState *_joinStates;
+
+    /**
+     * The Futures each Thread ID waits for any of.
      */
-    pid_t *_idManagar;
+    FutureWatch *_futureWatches;
 
     /**
-     * The current scenario
+     * The scheduling policy.
      */
-    scenario _currentScenario;
+    policy _policy;
+
+    /**
+     * The hooks of the scheduling policy (each worker has its own instance
+     * of the policy).
+     */
+    const PolicyTable *_policyOps;
+
+    /**
+     * The number of READY Threads (held by the policies of all workers).
+     */
+    int _readyCount;
+
     /**
-     * A map that holds all of the available Threads.
-     * Pairs of (ID, pointer to Thread)
+     * The workers, and the number of them in use.
      */
-    map<int, Thread *> _threads;
+    Worker _workers[MAX_WORKERS];
+    int _workerCount;
 
     /**
-     * A vector that holds all of the keys of the map to the ready Threads.
+     * Guards the shared state of the Scheduler while there are several
+     * workers (see Worker::queueLock for the ready Threads).
      */
-    vec _readyThreads;
+    SpinLock _lock;
 
     /**
-     * A vector that holds all of the keys of the map to the sleeping Threads.
+     * The futex idle workers wait on, bumped whenever a Thread becomes READY
+     * while some worker is idle, and the number of idle workers.
      */
-    vec _sleepThreads;
+    int _workGeneration;
+    int _idleWorkers;
 
     /**
-     * A vector that holds all of the keys of the map to the blocked Threads.
+     * The Threads waiting for file descriptors, whether an idle worker
+     * waits for their events (without the lock), and the total quantum at
+     * which they were last polled.
      */
-    vec _blockThreads;
+    Poller _poller;
+    bool _polling;
+    int _lastPollQuantum;
 
     /**
-     * The key of the map to the running Thread.
+     * The time (CLOCK_MONOTONIC, in nano-seconds) at which idle workers last
+     * counted a quantum.
      */
-    int _runningThread;
+    long long _lastIdleQuantumNsecs;
+
+    /**
+     * The file I/O requests of the Threads.
+     */
+    IoRing _ioRing;
+
+    /**
+     * The blocking calls the Threads offloaded to helper kernel threads.
+     */
+    OffloadPool _offloadPool;
+
+    /**
+     * A heap that holds the sleeping Threads, earliest wake up first.
+     */
+    SleepQueue _sleepThreads;
+
+    /**
+     * A queue that holds the blocked Threads.
+     */
+    ThreadQueue _blockThreads;
 
     /**
     * The quantum counter for the whole process
     */
     int _totalQuantumCounter;
 
-    /*
-     * A pointer to a thread that will be deleted next round.
+    /**
+     * Set once the resources of the Threads were released.
      */
-    Thread* _toDelete;
+    bool _killed;
 //-------------
 
     /**
      * ID is chosen as follows: The main goal is to chose the
      * smallest non-negative integer not already taken by an existing thread.
-     * Therefore,we shall iterate over the vector from the beginning
-     * (In ascending order) first cell with NULL is the one we need.
-     * When terminating a thread with ID i, the ith cell will be initialized
-     * with EMPTY_CELL.
+     * The ID manager finds it in its bitmap without scanning the IDs.
      * @return the new ID.
      */
-    pid_t _getNewID();
+    int _getNewID();
 
     /**
      * A function that deletes an ID from idManagar.
      * @param ID the ID to delete
-     * @return SUCCESS on success and FAILURE on failure
+     * @return None
      */
-    void _deleteID(pid_t ID);
+    void _deleteID(int ID);
 
     /**
      * Calls to the suitable error message according to the bad ID that is given.
      * @param ID the id
-     * @return SUCCESS on success and FAILURE on failure
+     * @return FAILURE
      */
     int _badIDChecker(int ID);
 
     /**
-     * Gets the vector in which the Thread with ID is stored.
-     * Function assumes that the ID is not in running state.
-     * @param ID the Thread to remove.
-     * @return a pointer to the vector. nullptr is returned if Thread doesn't
-     * exists.
+     * Gets the Thread with ID.
+     * @param ID the ID of the Thread.
+     * @return a pointer to the Thread, or nullptr if no such Thread exists.
+     */
+    Thread *_getThread(int ID);
+
+    /**
+     * Initializes a worker that runs nothing yet.
+     * @param index the index of the worker.
+     * @return None.
+     */
+    void _initWorker(int index);
+
+    /**
+     * Takes the lock of a worker's ready Threads, unless the calling worker
+     * already holds it for a scheduling decision.
+     * @param worker the worker.
+     * @return None.
+     */
+    void _lockQueue(Worker *worker);
+
+    /**
+     * Releases the lock of a worker's ready Threads, unless the calling
+     * worker holds it for a scheduling decision.
+     * @param worker the worker.
+     * @return None.
+     */
+    void _unlockQueue(Worker *worker);
+
+    /**
+     * Takes the lock of the worker a Thread is READY or RUNNING on, which
+     * keeps the Thread from being picked, stolen or switched out meanwhile.
+     * @param thread the Thread.
+     * @return the worker, whose lock is held.
+     */
+    Worker *_lockWorkerOf(const Thread *thread);
+
+    /**
+     * Checks, without the Scheduler's lock, whether a scheduling decision
+     * has shared work to do: Threads to wake up, or file descriptors, file
+     * I/O or offloaded calls to poll.
+     * @return true if so (always with one worker), false otherwise.
+     */
+    bool _hasSharedWork() const;
+
+    /**
+     * Getter for the policy instance that holds (or will hold) a READY
+     * Thread: the one of the Thread's worker.
+     * @param thread the Thread.
+     * @return the policy instance.
+     */
+    void *_policyOf(const Thread *thread);
+
+    /**
+     * Checks whether a Thread is running on another worker than the calling
+     * one.
+     * @param thread the Thread.
+     * @return true if so, false otherwise.
+     */
+    bool _isRunningElsewhere(const Thread *thread);
+
+    /**
+     * Makes the worker running a Thread make a scheduling decision, so that
+     * it notices the Thread was blocked or terminated.
+     * @param thread the Thread, which runs on another worker.
+     * @return None.
+     */
+    void _kickWorker(const Thread *thread);
+
+    /**
+     * Wakes up idle workers, if there are any, after Threads became READY.
+     * @param count the number of Threads that became READY.
+     * @return None.
+     */
+    void _notifyIdleWorkers(int count);
+
+    /**
+     * Counts a quantum that passed while idle workers waited. Every idle
+     * worker that waited for a whole quantum calls it, but a quantum is only
+     * counted once a whole one passed since the last counted, so that the
+     * sleeping Threads do not wake up sooner the more workers are idle.
+     * Called with the lock.
+     * @param quantumNsecs the length of a quantum in nano-seconds.
+     * @return None.
+     */
+    void _countIdleQuantum(long long quantumNsecs);
+
+    /**
+     * Makes a READY Thread, just taken out of its policy, RUNNING on a
+     * worker. The lock of the worker it was READY on must be held.
+     * @param worker the worker.
+     * @param thread the Thread.
+     * @return None.
+     */
+    void _startRunning(Worker *worker, Thread *thread);
+
+    /**
+     * Removes the READY Thread that runs next on a worker, and makes it
+     * RUNNING: the next one of its own policy, or else one stolen from
+     * another worker whose lock is free.
+     * @param worker the worker, whose lock is held.
+     * @return the Thread, or nullptr if no Thread is READY.
      */
-    vec *_getVectorOfThread(int ID);
+    Thread *_pickNext(Worker *worker);
 
     /**
-     * Gets the iterator (location) of the Thread with ID.
-     * Function assumes that the ID is not in running state.
-     * @param ID The Thread ID
-     * @param vecOfThread The vector to search for the Thread in
-     * @return an iterator the the Thread. nullptr is returned if Thread doesn't
-     * exists.
+     * Sets the Thread a worker deletes once it switched away from it. A
+     * Thread set before is deleted right away.
+     * @param worker the worker.
+     * @param thread the Thread to delete.
+     * @return None.
      */
-    vecIter _getIterOfThread(int ID, vec *vecOfThread);
+    void _setToDelete(Worker *worker, Thread *thread);
+
+    /**
+     * Deletes a Thread that was removed while it waited (or was about to),
+     * once nothing uses its stack anymore: the IoRing or the OffloadPool
+     * takes over a Thread whose file I/O request or offloaded call is not
+     * complete, and a worker deletes any other once it switched away from
+     * it. A Thread that waited for a file descriptor stops being counted by
+     * the Poller.
+     * @param worker the worker.
+     * @param thread the Thread, unlinked from the queue it waited on.
+     * @param queue the queue it waited on, or nullptr.
+     * @return None.
+     */
+    void _deleteRemoved(Worker *worker, Thread *thread, ThreadQueue *queue);
+
+    /**
+     * Hands a Thread to the scheduling policy of the calling worker, and
+     * sets its state to READY, without waking up an idle worker.
+     * @param thread the Thread, which must not be held by any DAST.
+     * @param woken true if the Thread was just created, BLOCKED or
+     * SLEEPING, which the policy is told.
+     * @return None.
+     */
+    void _enqueueReady(Thread *thread, bool woken);
+
+    /**
+     * Hands a Thread to the scheduling policy, and sets its state to READY.
+     * @param thread the Thread, which must not be held by any DAST.
+     * @param woken true if the Thread was just created, BLOCKED or
+     * SLEEPING, which the policy is told.
+     * @return None.
+     */
+    void _makeReady(Thread *thread, bool woken);
+
+    /**
+     * Makes a Thread that was taken out of a queue of waiting Threads READY,
+     * without waking up an idle worker.
+     * @param thread the Thread.
+     * @return None.
+     */
+    void _stopWaiting(Thread *thread);
+
+    /**
+     * Makes a Thread that was just created, BLOCKED or SLEEPING READY.
+     * @param thread the Thread, which must not be held by any DAST.
+     * @return None.
+     */
+    void _wakeThread(Thread *thread);
+
+    /**
+     * Removes a Thread from the policy, the queue or the sleeping threads
+     * that holds it, according to its state.
+     * @param thread the Thread to remove. If it is READY, the lock of its
+     * worker must be held.
+     * @return None.
+     */
+    void _unlinkThread(Thread *thread);
 
     /**
      * Thread switching function between environments. if saveTo is
-     * NO_ACTIVE_THREAD, no sigsetjmp will happen.
-     * @param saveTo The ID of the Thread to save to
-     * @param jumpTo The ID of the Thread to jump to
+     * nullptr, no sigsetjmp will happen.
+     * @param saveTo The Thread to save to
+     * @param jumpTo The Thread to jump to
      * @return None
      */
-    void _switchThreads(int saveTo, int jumpTo);
+    void _switchThreads(Thread *saveTo, Thread *jumpTo);
 
     /**
-     * Remove a running thread. Update _runningThread, delete ID and free the
+     * Remove a thread. Update the running thread, delete ID and free the
      * resources of the removed thread.
      * @param ID of the thread
      * @return SUCCESS or FAILURE accordingly.
      */
-    void _removeThreadHelper(int ID, vec *stateVec);
+    void _removeThreadHelper(int ID);
+
+    /**
+     * Unlinks the Watchers of the Futures a Thread ID watches, if any.
+     * @param ID the ID.
+     * @return None.
+     */
+    void _unwatchFutures(int ID);
+
+    /**
+     * Checks whether an ID belongs to a joinable Thread that exited and was
+     * not joined yet.
+     * @param ID the ID.
+     * @return true if so, false otherwise.
+     */
+    bool _hasExited(int ID) const;
+
+    /**
+     * Hands the exit value of a Thread to the Thread waiting to join it, and
+     * wakes it up.
+     * @param ID the ID of the Thread.
+     * @param value the exit value.
+     * @return true if a Thread was waiting to join, false otherwise.
+     */
+    bool _handOverExitValue(int ID, void *value);
+
+    /**
+     * Releases the ID of an exited Thread.
+     * @param ID the ID.
+     * @return None.
+     */
+    void _reapThread(int ID);
+
+    /**
+     * Creates a Thread that runs f, or argumentFunction(argument), and
+     * makes it READY (unless it is the main Thread).
+     * @param f The function of the Thread, or nullptr
+     * @param argumentFunction The function that gets an argument, or nullptr
+     * @param argument The argument of argumentFunction
+     * @param mover The function that moves a callable into the Thread (the
+     * argument), or nullptr
+     * @param destroyer The function that destroys the callable, or nullptr
+     * @return The Thread ID on success and FAILURE on failure
+     */
+    int _addThread(FunctionPointer f, ArgumentFunction argumentFunction,
+                   void *argument, ClosureMover mover,
+                   ClosureDestroyer destroyer);
 
     /**
      * Kills the main process from inside the scheduler.
@@ -162,23 +519,47 @@ private:
     void _killProcess();
 
     /**
-     * Function that is designed to facilitate the readability of the code.
-	 * @param pushTO the vector to add the thread to.
-	 * @param deletFrom the vector to remove the thread from.
-	 * @param ID the id.
-	 * @param iter the iterator of the thread with this id.
-	 * @return SUCCESS on success and FAILURE on failure.
+     * Moves a Thread from the queue it is in to the back of another queue.
+	 * @param thread the Thread to move.
+	 * @param pushTo the queue to add the thread to.
+	 * @return None.
      */
-    int _accessDBtoInsertAndDelete(vec *pushTO, vec *deletFrom, int ID, \
-                                  vecIter iter);
+    void _moveThread(Thread *thread, ThreadQueue *pushTo);
 
     /**
-     * Manages all of the sleeping threads. Decreases the time that has left
-     * to sleep, and wakes up every thread that finished its sleeping time.
+     * Manages all of the sleeping threads. Wakes up every thread whose wake up
+     * quantum has come. Only those threads are touched.
      * @return None
      */
     void _manageSleepingThreads(void);
 
+    /**
+     * Wakes up the Threads whose file descriptors became ready, polling them
+     * without waiting at most once a quantum.
+     * @return None
+     */
+    void _manageWaitingIO(void);
+
+    /**
+     * Submits the queued file I/O requests, and wakes up the Threads whose
+     * requests completed.
+     * @return None
+     */
+    void _manageFileIO(void);
+
+    /**
+     * Wakes up the Threads whose offloaded calls completed.
+     * @return None
+     */
+    void _manageOffloads(void);
+
+    /**
+     * Puts the running Thread to sleep until a given total quantum.
+     * @param wakeUpQuantum the total quantum at which the Thread is woken up.
+     * @return SUCCESS on success and FAILURE on failure
+     */
+    int _sleepRunningThread(int wakeUpQuantum);
+
 public:
     /**
      * C-tor
@@ -194,10 +575,32 @@ public:
 
     /**
      * Adding a new Thread.
+     * @param f The function of the Thread (nullptr for the main Thread)
+     * @return The Thread ID on success and FAILURE on failure
+     */
+    int addThread(FunctionPointer f);
+
+    /**
+     * Adding a new Thread, whose function gets an argument.
+     * @param f The function of the Thread
+     * @param argument The argument of the function
+     * @return The Thread ID on success and FAILURE on failure
+     */
+    int addThread(ArgumentFunction f, void *argument);
+
+    /**
+     * Adding a new Thread, whose function gets a callable the Thread keeps
+     * (see Thread::moveClosure). The callable is moved, and destroyed if
+     * the Thread is removed before its function returns, with the lock
+     * held.
      * @param f The function of the Thread
+     * @param mover The function that moves the callable
+     * @param destroyer The function that destroys the callable, or nullptr
+     * @param closure The callable, of THREAD_CLOSURE_SIZE bytes at most
      * @return The Thread ID on success and FAILURE on failure
      */
-    int addThread(void (*f)(void));
+    int addThread(ArgumentFunction f, ClosureMover mover,
+                  ClosureDestroyer destroyer, void *closure);
 
     /**
      * Removing a Thread.
@@ -206,6 +609,15 @@ public:
      */
     int removeThread(int ID);
 
+    /**
+     * Moving the uthread-local storage values out of a Thread that is not
+     * RUNNING, so that their destructors run before it is removed.
+     * @param ID The ID of the Thread.
+     * @param values Receives the THREAD_SPECIFIC_SLOTS values.
+     * @return true if the values were taken, false otherwise
+     */
+    bool takeSpecific(int ID, void **values);
+
     /**
      * Blocking a Thread.
      * @param ID The ID of the Thread to block.
@@ -222,15 +634,147 @@ public:
 
     /**
      * Make the runnning Thread sleep.
-     * @param num_quantums The ID of the Thread that should sleep.
+     * @param num_quantums The number of quantums to sleep (not including the
+     * current one).
      * @return SUCCESS on success and FAILURE on failure
      */
     int sleepThread(int num_quantums);
 
     /**
-     * Manages the Threads. This is where the Round-Robin decisions are being
-	 * made. Every scenario will be dealt in this code, and all states and
-	 * DASTs will be updated as needed.
+     * Make the runnning Thread sleep until a given quantum starts.
+     * @param quantum The total quantum in which the Thread may run again.
+     * @return SUCCESS on success and FAILURE on failure
+     */
+    int sleepUntil(int quantum);
+
+    /**
+     * Makes the running Thread give up the CPU. It stays READY, and goes to
+     * the back of the ready Threads.
+     * @param dummy a dummy param that is passed in order to match the caller
+	 * signature. Its value is ignored.
+     * @return SUCCESS
+     */
+    int yieldThread(int dummy);
+
+    /**
+     * Makes the running Thread give up the CPU to a given READY Thread,
+     * regardless of the order of the ready Threads. The running Thread
+     * stays READY, and goes to the back of the ready Threads.
+     * @param ID The ID of the Thread to run next.
+     * @return SUCCESS on success and FAILURE on failure
+     */
+    int yieldTo(int ID);
+
+    /**
+     * Makes the running Thread exit. A Thread waiting to join it is handed
+     * the exit value. A detached Thread, or one that was joined, is removed;
+     * otherwise its resources are released, and its ID is kept with the exit
+     * value until it is joined. The main Thread exits the process.
+     * @param value the exit value.
+     * @return SUCCESS
+     */
+    int exitThread(void *value);
+
+    /**
+     * Joins a Thread: collects the exit value of an exited Thread and
+     * releases its ID, or makes the running Thread wait on the Thread until
+     * it exits (or is removed, which hands over nullptr).
+     * @param ID The ID of the Thread to join.
+     * @param value where the exit value goes.
+     * @return SUCCESS on success and FAILURE on failure
+     */
+    int joinThread(int ID, void **value);
+
+    /**
+     * Detaching a Thread, which is removed as soon as it exits. An exited
+     * Thread is released at once.
+     * @param ID The ID of the Thread to detach.
+     * @return SUCCESS on success and FAILURE on failure
+     */
+    int detachThread(int ID);
+
+    /**
+     * Makes the running Thread wait on a queue, such as the waiters of a
+     * mutex. It is BLOCKED until wakeWaiter picks it or its timeout
+     * expires, and uthread_resume does not wake it up. The main Thread may
+     * wait too.
+     * @param queue the queue.
+     * @param numQuantums the number of quantums to wait at most (not
+     * including the current one), or NO_TIMEOUT.
+     * @return SUCCESS
+     */
+    int waitOn(ThreadQueue *queue, int numQuantums);
+
+    /**
+     * Wakes up the Thread at the front of a queue of waiting Threads.
+     * @param queue the queue.
+     * @return true if a Thread was woken up, false if the queue is empty.
+     */
+    bool wakeWaiter(ThreadQueue *queue);
+
+    /**
+     * Wakes up all of the Threads of a queue of waiting Threads, in their
+     * order, at once.
+     * @param queue the queue.
+     * @return the number of Threads woken up.
+     */
+    int wakeAllWaiters(ThreadQueue *queue);
+
+    /**
+     * Checks whether the running Thread stopped waiting because its timeout
+     * expired.
+     * @return true if so, false if it was woken up.
+     */
+    bool hasWaitTimedOut();
+
+    /**
+     * Makes the running Thread watch Futures: each of them wakes it up once
+     * complete, until it stops watching them (or is removed).
+     * @param futures the Futures (which must stay valid meanwhile).
+     * @param count the number of Futures.
+     * @return the queue the Thread waits on.
+     */
+    ThreadQueue *watchFutures(Future **futures, int count);
+
+    /**
+     * Makes the running Thread stop watching its Futures.
+     * @return None.
+     */
+    void unwatchFutures();
+
+    /**
+     * Setter for the scheduling policy. The ready Threads are handed over to
+     * the new policy.
+     * @param newPolicy the policy.
+     * @return None.
+     */
+    void setPolicy(policy newPolicy);
+
+    /**
+     * Setter for a Thread's priority level. The Thread keeps being moved
+     * between levels by the MULTI_LEVEL_FEEDBACK policy afterwards.
+     * @param ID The ID of the Thread.
+     * @param priority The priority level, between TOP_PRIORITY and
+     * PRIORITY_LEVELS - 1.
+     * @return SUCCESS on success and FAILURE on failure
+     */
+    int setPriority(int ID, int priority);
+
+    /**
+     * Setter for a Thread's weight under FAIR_SHARE. The Thread's share of
+     * the CPU is its weight divided by the sum of the weights of the
+     * runnable Threads.
+     * @param ID The ID of the Thread.
+     * @param weight The weight, a positive number (DEFAULT_WEIGHT unless set).
+     * @return SUCCESS on success and FAILURE on failure
+     */
+    int setWeight(int ID, int weight);
+
+    /**
+     * Manages the Threads. This is where the scheduling policy is told how
+	 * the running Thread's quantum ended and asked which Thread runs next.
+	 * Every scenario will be dealt in this code, and all states and DASTs
+	 * will be updated as needed.
      * @return None
      */
     void manageThreads(void);
@@ -259,12 +803,115 @@ public:
      */
     int getNumOfQuantums(int ID);
 
+    /**
+     * Checks whether the running Thread may have to be preempted when its
+     * quantum expires: some other Thread is READY, SLEEPING (and sleeps
+     * are counted in quantums) or waiting for a file descriptor, file I/O
+     * or an offloaded call (which are polled once a quantum).
+     * @return true if so, false if the quantum timer may be stopped.
+     */
+    bool isPreemptionNeeded() const;
+
     /**
      * Getter for the current scenario.
      * @return the current scenario.
      */
     int getScenario();
 
+    /**
+     * Getter for the worker of the calling kernel thread. Must be called
+     * again after any context switch, as the calling Thread may resume on
+     * another worker.
+     * @return the worker.
+     */
+    Worker *currentWorker();
+
+    /**
+     * Takes the Scheduler's lock for the calling worker. Only needed while
+     * there are several workers.
+     * @return None.
+     */
+    void lock();
+
+    /**
+     * Releases the Scheduler's lock, if the calling worker holds it.
+     * @return None.
+     */
+    void unlock();
+
+    /**
+     * Called by a Thread a worker has just switched to, or returned to
+     * without a switch: releases the lock of the worker's ready Threads,
+     * and takes or releases the Scheduler's lock, so that it is held if and
+     * only if the Thread held it when it was switched out.
+     * @param locked true if the Thread held the Scheduler's lock.
+     * @return None.
+     */
+    void finishSwitch(bool locked);
+
+    /**
+     * Creates the idle Thread of the first worker. Must be called once,
+     * before any Thread may wait.
+     * @param idleLoop the function the idle Thread runs.
+     * @return None.
+     */
+    void setIdleLoop(FunctionPointer idleLoop);
+
+    /**
+     * Adds workers, up to a total of count. Each new worker must then be
+     * started by a kernel thread of its own, which calls bindWorker. Must be
+     * called once, inside a library call, and the Scheduler's lock is held
+     * from here on.
+     * @param count the total number of workers, at most MAX_WORKERS.
+     * @return None.
+     */
+    void addWorkers(int count);
+
+    /**
+     * Makes the calling kernel thread the given worker, running its idle
+     * Thread.
+     * @param index the index of the worker.
+     * @return None.
+     */
+    void bindWorker(int index);
+
+    /**
+     * Called by an idle worker that found no Thread to run. Waits (without
+     * the lock) until some Thread becomes READY. While Threads sleep, it
+     * waits for a quantum at most, and counts the quantum if none became
+     * READY meanwhile, so that the sleeping Threads wake up. While Threads
+     * wait for file descriptors, file I/O or offloaded calls, one idle
+     * worker waits for their events instead, and wakes them up.
+     * @param quantumNsecs the length of a quantum in nano-seconds.
+     * @return None.
+     */
+    void waitForWork(long long quantumNsecs);
+
+    /**
+     * Checks whether another worker blocked or terminated the Thread the
+     * calling worker runs, so that it must be switched out.
+     * @return true if so, false otherwise.
+     */
+    bool isRunningThreadStopped();
+
+    /**
+     * Getter for the Threads waiting for file descriptors.
+     * @return the Poller.
+     */
+    Poller *poller();
+
+    /**
+     * Getter for the file I/O requests of the Threads.
+     * @return the IoRing.
+     */
+    IoRing *ioRing();
+
+    /**
+     * Getter for the blocking calls the Threads offloaded.
+     * @return the OffloadPool.
+     */
+    OffloadPool *offloadPool();
+
     /**
      * Getter for the total quantum counter.
      * @param dummy a dummy param that is passed in order to match the caller
@@ -0,0 +1,124 @@
+#ifndef EX2_SCHEDULINGPOLICY_H
+#define EX2_SCHEDULINGPOLICY_H
+
+#include "Thread.h"
+
+/*
+ * A scheduling policy owns the READY Threads and decides which of them runs
+ * next. The Scheduler keeps the RUNNING, BLOCKED and SLEEPING Threads itself
+ * and calls the policy's hooks on every state change:
+ *
+ *   void enqueue(Thread *thread)  - thread became READY.
+ *   void dequeue(Thread *thread)  - a READY thread is no longer READY (it was
+ *                                   blocked, terminated or is re-queued).
+ *   Thread *pickNext()            - removes and returns the READY Thread that
+ *                                   runs next, or nullptr if there is none.
+ *   void onTick(Thread *thread)   - the RUNNING thread used up its quantum.
+ *                                   It is enqueued right after.
+ *   void onBlock(Thread *thread)  - the RUNNING thread blocked or went to
+ *                                   sleep before its quantum expired.
+ *   void onYield(Thread *thread)  - the RUNNING thread yielded the rest of
+ *                                   its quantum. It is enqueued right after.
+ *   void onWake(Thread *thread)   - thread is about to be enqueued after
+ *                                   being created, resumed or woken up.
+ *
+ * A policy is a class with these (non-virtual) member functions and a
+ * constructor taking the Scheduler's Thread table, its size, and the
+ * Scheduler's total quantum counter (which the policy only reads). The
+ * Scheduler reaches it through a PolicyTable, a table of functions fixed
+ * when the policy is selected, so no scheduling decision makes a virtual
+ * call, and adding a policy does not touch the Scheduler.
+ */
+struct PolicyTable
+{
+    void *(*create)(Thread **threads, int maxThreads,
+                    const int *totalQuantums);
+    void (*enqueue)(void *policy, Thread *thread);
+    void (*dequeue)(void *policy, Thread *thread);
+    Thread *(*pickNext)(void *policy);
+    void (*onTick)(void *policy, Thread *thread);
+    void (*onBlock)(void *policy, Thread *thread);
+    void (*onYield)(void *policy, Thread *thread);
+    void (*onWake)(void *policy, Thread *thread);
+    void (*destroy)(void *policy);
+};
+
+/*
+ * Builds the PolicyTable of a policy class. Each entry of the table forwards
+ * to the member function of the same name. Every policy explicitly
+ * instantiates its PolicyAdapter in its own source file, next to the member
+ * functions, so that the compiler inlines them into the table entries.
+ */
+template <class Policy>
+class PolicyAdapter
+{
+public:
+
+    /**
+     * The PolicyTable of Policy.
+     */
+    static const PolicyTable table;
+
+private:
+
+    static void *_create(Thread **threads, int maxThreads,
+                         const int *totalQuantums)
+    {
+        return new(nothrow) Policy(threads, maxThreads, totalQuantums);
+    }
+
+    static void _enqueue(void *policy, Thread *thread)
+    {
+        static_cast<Policy *>(policy)->enqueue(thread);
+    }
+
+    static void _dequeue(void *policy, Thread *thread)
+    {
+        static_cast<Policy *>(policy)->dequeue(thread);
+    }
+
+    static Thread *_pickNext(void *policy)
+    {
+        return static_cast<Policy *>(policy)->pickNext();
+    }
+
+    static void _onTick(void *policy, Thread *thread)
+    {
+        static_cast<Policy *>(policy)->onTick(thread);
+    }
+
+    static void _onBlock(void *policy, Thread *thread)
+    {
+        static_cast<Policy *>(policy)->onBlock(thread);
+    }
+
+    static void _onYield(void *policy, Thread *thread)
+    {
+        static_cast<Policy *>(policy)->onYield(thread);
+    }
+
+    static void _onWake(void *policy, Thread *thread)
+    {
+        static_cast<Policy *>(policy)->onWake(thread);
+    }
+
+    static void _destroy(void *policy)
+    {
+        delete static_cast<Policy *>(policy);
+    }
+};
+
+template <class Policy>
+const PolicyTable PolicyAdapter<Policy>::table = {
+    &PolicyAdapter<Policy>::_create,
+    &PolicyAdapter<Policy>::_enqueue,
+    &PolicyAdapter<Policy>::_dequeue,
+    &PolicyAdapter<Policy>::_pickNext,
+    &PolicyAdapter<Policy>::_onTick,
+    &PolicyAdapter<Policy>::_onBlock,
+    &PolicyAdapter<Policy>::_onYield,
+    &PolicyAdapter<Policy>::_onWake,
+    &PolicyAdapter<Policy>::_destroy
+};
+
+#endif //EX2_SCHEDULINGPOLICY_H
@@ -0,0 +1,200 @@
+#include "SleepQueue.h"
+
+//-----------------------CONSTRUCTORS DESTRUCTORS----------------------------//
+
+/**
+ * C-tor. Creates an empty queue.
+ * @param capacity the maximal number of Threads in the queue.
+ */
+SleepQueue::SleepQueue(int capacity)
+: _heap(new(nothrow) Thread *[capacity]),
+  _size(0),
+  _pushCount(0),
+  _earliestWakeUp(NO_WAKE_UP)
+{
+    if (_heap == nullptr) {
+        ErrorHandler::sysCallError(THREAD_SYS_CALL_ERROR_BAD_ALLOC);
+    }
+}
+
+/**
+ * D-tor.
+ */
+SleepQueue::~SleepQueue()
+{
+    delete[] _heap;
+}
+
+//------------------------------OPERATIONS-----------------------------------//
+
+/**
+ * Adds a Thread, keyed on its wake up quantum.
+ * @param thread the Thread to add. Must not be in the queue.
+ * @return None.
+ */
+void SleepQueue::push(Thread *thread)
+{
+    thread->_sleepOrder = _pushCount++;
+    _place(_size, thread);
+    _size++;
+    _siftUp(_size - 1);
+    _updateEarliestWakeUp();
+}
+
+/**
+ * Getter for the Thread that wakes up first.
+ * @return the Thread, or nullptr if the queue is empty.
+ */
+Thread *SleepQueue::top() const
+{
+    return (_size == 0) ? nullptr : _heap[0];
+}
+
+/**
+ * Removes the Thread that wakes up first.
+ * @return the removed Thread, or nullptr if the queue is empty.
+ */
+Thread *SleepQueue::pop()
+{
+    Thread *thread = top();
+
+    if (thread != nullptr) {
+        remove(thread);
+    }
+    return thread;
+}
+
+/**
+ * Removes a Thread from the queue.
+ * @param thread the Thread to remove. Must be in the queue.
+ * @return None.
+ */
+void SleepQueue::remove(Thread *thread)
+{
+    int index = thread->_sleepIndex;
+
+    thread->_sleepIndex = NOT_SLEEPING;
+    _size--;
+
+    // Fill the hole with the last Thread and restore the heap order.
+    if (index != _size) {
+        _place(index, _heap[_size]);
+        _siftUp(index);
+        _siftDown(_heap[index]->_sleepIndex);
+    }
+    _updateEarliestWakeUp();
+}
+
+/**
+ * Checks whether a Thread is in the queue.
+ * @param thread the Thread to look for.
+ * @return true if the Thread is in the queue, false otherwise.
+ */
+bool SleepQueue::contains(const Thread *thread) const
+{
+    return thread->_sleepIndex != NOT_SLEEPING;
+}
+
+/**
+ * Checks whether the queue is empty.
+ * @return true if the queue is empty, false otherwise.
+ */
+bool SleepQueue::isEmpty() const
+{
+    return _size == 0;
+}
+
+/**
+ * Getter for the quantum at which the first Thread wakes up. It may be read
+ * while the queue is changed by another kernel thread, which yields either
+ * the old or the new quantum.
+ * @return the quantum, or NO_WAKE_UP if the queue is empty.
+ */
+int SleepQueue::earliestWakeUp() const
+{
+    return __atomic_load_n(&_earliestWakeUp, __ATOMIC_RELAXED);
+}
+
+//-------------------------------HEAP HELPERS--------------------------------//
+
+/**
+ * Checks whether one Thread should wake up before another.
+ * @param a the first Thread.
+ * @param b the second Thread.
+ * @return true if a comes before b.
+ */
+bool SleepQueue::_before(const Thread *a, const Thread *b)
+{
+    if (a->_wakeUpQuantum != b->_wakeUpQuantum) {
+        return a->_wakeUpQuantum < b->_wakeUpQuantum;
+    }
+    return a->_sleepOrder < b->_sleepOrder;
+}
+
+/**
+ * Places a Thread at a position of the heap.
+ * @param index the position.
+ * @param thread the Thread.
+ * @return None.
+ */
+void SleepQueue::_place(int index, Thread *thread)
+{
+    _heap[index] = thread;
+    thread->_sleepIndex = index;
+}
+
+/**
+ * Moves the Thread at index up until the heap order holds.
+ * @param index the position of the Thread.
+ * @return None.
+ */
+void SleepQueue::_siftUp(int index)
+{
+    Thread *thread = _heap[index];
+
+    while (index > 0) {
+        int parent = (index - 1) / 2;
+        if (!_before(thread, _heap[parent])) {
+            break;
+        }
+        _place(index, _heap[parent]);
+        index = parent;
+    }
+    _place(index, thread);
+}
+
+/**
+ * Moves the Thread at index down until the heap order holds.
+ * @param index the position of the Thread.
+ * @return None.
+ */
+void SleepQueue::_siftDown(int index)
+{
+    Thread *thread = _heap[index];
+
+    for (;;) {
+        int child = 2 * index + 1;
+        if (child >= _size) {
+            break;
+        }
+        if (child + 1 < _size && _before(_heap[child + 1], _heap[child])) {
+            child++;
+        }
+        if (!_before(_heap[child], thread)) {
+            break;
+        }
+        _place(index, _heap[child]);
+        index = child;
+    }
+    _place(index, thread);
+}
+
+/**
+ * Updates the earliest wake up quantum after the heap changed.
+ * @return None.
+ */
+void SleepQueue::_updateEarliestWakeUp()
+{
+    int quantum = (_size == 0) ? NO_WAKE_UP : _heap[0]->_wakeUpQuantum;
+    __atomic_store_n(&_earliestWakeUp, quantum, __ATOMIC_RELAXED);
+}
@@ -0,0 +1,140 @@
+#ifndef EX2_SLEEPQUEUE_H
+#define EX2_SLEEPQUEUE_H
+
+#include "Thread.h"
+
+#include <climits>
+
+// The earliest wake up quantum of an empty queue.
+#define NO_WAKE_UP INT_MAX
+
+/*
+ * The sleeping Threads, kept in a binary min-heap keyed on the absolute
+ * quantum at which each of them wakes up. Threads that wake up at the same
+ * quantum come out in the order they were added. The heap array is
+ * allocated once, and each Thread remembers its position in it, so adding,
+ * removing the earliest and removing an arbitrary Thread are O(log n)
+ * without any allocation, and finding the earliest is O(1).
+ */
+class SleepQueue
+{
+public:
+
+    /**
+     * C-tor. Creates an empty queue.
+     * @param capacity the maximal number of Threads in the queue.
+     */
+    SleepQueue(int capacity);
+
+    /**
+     * D-tor.
+     */
+    ~SleepQueue();
+
+    /**
+     * Adds a Thread, keyed on its wake up quantum.
+     * @param thread the Thread to add. Must not be in the queue.
+     * @return None.
+     */
+    void push(Thread *thread);
+
+    /**
+     * Getter for the Thread that wakes up first.
+     * @return the Thread, or nullptr if the queue is empty.
+     */
+    Thread *top() const;
+
+    /**
+     * Removes the Thread that wakes up first.
+     * @return the removed Thread, or nullptr if the queue is empty.
+     */
+    Thread *pop();
+
+    /**
+     * Removes a Thread from the queue.
+     * @param thread the Thread to remove. Must be in the queue.
+     * @return None.
+     */
+    void remove(Thread *thread);
+
+    /**
+     * Checks whether a Thread is in the queue.
+     * @param thread the Thread to look for.
+     * @return true if the Thread is in the queue, false otherwise.
+     */
+    bool contains(const Thread *thread) const;
+
+    /**
+     * Checks whether the queue is empty.
+     * @return true if the queue is empty, false otherwise.
+     */
+    bool isEmpty() const;
+
+    /**
+     * Getter for the quantum at which the first Thread wakes up. It may be
+     * read while the queue is changed by another kernel thread, which
+     * yields either the old or the new quantum.
+     * @return the quantum, or NO_WAKE_UP if the queue is empty.
+     */
+    int earliestWakeUp() const;
+
+private:
+
+    /**
+     * The heap array.
+     */
+    Thread **_heap;
+
+    /**
+     * The number of Threads in the heap.
+     */
+    int _size;
+
+    /**
+     * The number of Threads ever added (used to order equal wake ups).
+     */
+    unsigned long _pushCount;
+
+    /**
+     * The quantum at which the first Thread wakes up (see earliestWakeUp).
+     */
+    volatile int _earliestWakeUp;
+
+    /**
+     * Checks whether one Thread should wake up before another.
+     * @param a the first Thread.
+     * @param b the second Thread.
+     * @return true if a comes before b.
+     */
+    static bool _before(const Thread *a, const Thread *b);
+
+    /**
+     * Places a Thread at a position of the heap.
+     * @param index the position.
+     * @param thread the Thread.
+     * @return None.
+     */
+    void _place(int index, Thread *thread);
+
+    /**
+     * Moves the Thread at index up until the heap order holds.
+     * @param index the position of the Thread.
+     * @return None.
+     */
+    void _siftUp(int index);
+
+    /**
+     * Moves the Thread at index down until the heap order holds.
+     * @param index the position of the Thread.
+     * @return None.
+     */
+    void _siftDown(int index);
+
+    /**
+     * Updates the earliest wake up quantum after the heap changed.
+     * @return None.
+     */
+    void _updateEarliestWakeUp();
+};
+
+#endif //EX2_SLEEPQUEUE_H
@@ -0,0 +1,65 @@
+#include "SpinLock.h"
+
+#include <sched.h>
+
+// The number of times the lock is polled before giving up the CPU. The
+// holder may have been descheduled, when there are more workers than CPUs.
+#define SPIN_LIMIT 128
+
+// Tells the CPU it is spinning, which saves power and lets a hyper-thread
+// sibling run.
+#if defined(__x86_64__) || defined(__i386__)
+#define CPU_RELAX() asm volatile("pause" ::: "memory")
+#else
+#define CPU_RELAX() asm volatile("" ::: "memory")
+#endif
+
+//-----------------------------CONSTRUCTORS----------------------------------//
+
+/**
+ * C-tor. Creates an unlocked lock.
+ */
+SpinLock::SpinLock()
+: _locked(0)
+{
+}
+
+//------------------------------OPERATIONS-----------------------------------//
+
+/**
+ * Takes the lock, spinning until it is free.
+ * @return None.
+ */
+void SpinLock::lock()
+{
+    while (__atomic_exchange_n(&_locked, 1, __ATOMIC_ACQUIRE)) {
+        // Wait with plain loads, so the cache line is not bounced around.
+        int spins = 0;
+        while (__atomic_load_n(&_locked, __ATOMIC_RELAXED)) {
+            if (++spins == SPIN_LIMIT) {
+                sched_yield();
+                spins = 0;
+            }
+            CPU_RELAX();
+        }
+    }
+}
+
+/**
+ * Takes the lock if it is free, without spinning.
+ * @return true if the lock was taken, false otherwise.
+ */
+bool SpinLock::tryLock()
+{
+    return __atomic_load_n(&_locked, __ATOMIC_RELAXED) == 0 &&
+           !__atomic_exchange_n(&_locked, 1, __ATOMIC_ACQUIRE);
+}
+
+/**
+ * Releases the lock.
+ * @return None.
+ */
+void SpinLock::unlock()
+{
+    __atomic_store_n(&_locked, 0, __ATOMIC_RELEASE);
+}
@@ -0,0 +1,46 @@
+#ifndef EX2_SPINLOCK_H
+#define EX2_SPINLOCK_H
+
+/*
+ * A test-and-test-and-set spin lock, which gives up the CPU after spinning
+ * for a while. Unlike a pthread mutex it has no owner,
+ * so it may be released by another context than the one that took it (the
+ * Scheduler holds its lock across context switches), and taking it is
+ * async-signal-safe.
+ */
+class SpinLock
+{
+public:
+
+    /**
+     * C-tor. Creates an unlocked lock.
+     */
+    SpinLock();
+
+    /**
+     * Takes the lock, spinning until it is free.
+     * @return None.
+     */
+    void lock();
+
+    /**
+     * Takes the lock if it is free, without spinning.
+     * @return true if the lock was taken, false otherwise.
+     */
+    bool tryLock();
+
+    /**
+     * Releases the lock.
+     * @return None.
+     */
+    void unlock();
+
+private:
+
+    /**
+     * Non-zero while the lock is taken.
+     */
+    volatile int _locked;
+};
+
+#endif //EX2_SPINLOCK_H
@@ -0,0 +1,465 @@
+#include "TaskRunner.h"
+#include "ErrorHandler.h"
+
+#include <errno.h>
+#include <string.h>
+#include <stdint.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+// The return value of a failed system call.
+#define SYS_CALL_FAILED -1
+// The events that make the tasks waiting to read and to write ready.
+#define READ_EVENTS (EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR)
+#define WRITE_EVENTS (EPOLLOUT | EPOLLHUP | EPOLLERR)
+
+//-----------------------------TASK PROMISE----------------------------------//
+
+/**
+ * Allocates the frame of a task from the pool of the worker.
+ * @param size the size of the frame.
+ * @return the frame.
+ */
+void *TaskPromise::operator new(size_t size)
+{
+    return uthread_frame_alloc(size);
+}
+
+/**
+ * Returns the frame of a task to the pool of the worker.
+ * @param frame the frame.
+ * @param size the size of the frame.
+ * @return None.
+ */
+void TaskPromise::operator delete(void *frame, size_t size)
+{
+    uthread_frame_free(frame, size);
+}
+
+//-----------------------CONSTRUCTORS DESTRUCTORS----------------------------//
+
+/**
+ * C-tor. Creates a runner with no tasks.
+ */
+TaskRunner::TaskRunner()
+: _handOff(nullptr),
+  _firstReady(nullptr),
+  _lastReady(nullptr),
+  _roundLeft(0),
+  _sleepers(nullptr),
+  _descriptors(nullptr),
+  _descriptorCount(0),
+  _ioWaiters(0),
+  _epollFd(SYS_CALL_FAILED),
+  _wakeFd(SYS_CALL_FAILED),
+  _remote(nullptr),
+  _parked(false),
+  _live(0)
+{
+    _epollFd = epoll_create1(EPOLL_CLOEXEC);
+    _wakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (_epollFd == SYS_CALL_FAILED || _wakeFd == SYS_CALL_FAILED) {
+        ErrorHandler::sysCallError(THREAD_SYS_CALL_ERROR_POLL);
+    }
+
+    // The eventfd is level-triggered, so it interrupts every wait until it
+    // is read.
+    struct epoll_event event;
+    memset(&event, 0, sizeof(event));
+    event.events = EPOLLIN;
+    event.data.fd = _wakeFd;
+    if (epoll_ctl(_epollFd, EPOLL_CTL_ADD, _wakeFd, &event) ==
+        SYS_CALL_FAILED) {
+        ErrorHandler::sysCallError(THREAD_SYS_CALL_ERROR_POLL);
+    }
+}
+
+/**
+ * D-tor.
+ */
+TaskRunner::~TaskRunner()
+{
+    close(_epollFd);
+    close(_wakeFd);
+    delete[] _descriptors;
+}
+
+//------------------------------OPERATIONS-----------------------------------//
+
+/**
+ * Runs a task, and the tasks it spawns, until all of them completed.
+ * @param root the task, which is not started yet.
+ * @return None.
+ */
+void TaskRunner::run(TaskPromise *root)
+{
+    root->runner = this;
+    ++_live;
+    schedule(root);
+
+    while (_live > 0) {
+        TaskPromise *task = _handOff;
+        if (task != nullptr) {
+            _handOff = nullptr;
+        } else {
+            task = _popReady();
+        }
+        if (task == nullptr) {
+            _poll();
+            continue;
+        }
+        task->handle.resume();
+    }
+}
+
+/**
+ * Adds a task, which runs detached: its frame is destroyed once it
+ * completes.
+ * @param task the task, which is not started yet.
+ * @return None.
+ */
+void TaskRunner::spawn(TaskPromise *task)
+{
+    task->runner = this;
+    task->detached = true;
+    ++_live;
+    schedule(task);
+}
+
+/**
+ * Makes a task run next, once the running one suspended: a task it awaits,
+ * or the task awaiting it.
+ * @param task the task.
+ * @return None.
+ */
+void TaskRunner::handOff(TaskPromise *task)
+{
+    _handOff = task;
+}
+
+/**
+ * Makes a task of the runner ready. Must be called by the runner's thread.
+ * @param task the task.
+ * @return None.
+ */
+void TaskRunner::schedule(TaskPromise *task)
+{
+    task->next = nullptr;
+    if (_lastReady == nullptr) {
+        _firstReady = task;
+    } else {
+        _lastReady->next = task;
+    }
+    _lastReady = task;
+}
+
+/**
+ * Makes a waiting task of the runner ready. May be called by any thread,
+ * inside the library too (it takes no lock).
+ * @param task the task.
+ * @return None.
+ */
+void TaskRunner::wake(TaskPromise *task)
+{
+    TaskPromise *first = __atomic_load_n(&_remote, __ATOMIC_RELAXED);
+    do {
+        task->next = first;
+    } while (!__atomic_compare_exchange_n(&_remote, &first, task, true,
+                                          __ATOMIC_SEQ_CST,
+                                          __ATOMIC_RELAXED));
+
+    // Only a waiting runner is written to, once.
+    if (__atomic_exchange_n(&_parked, false, __ATOMIC_SEQ_CST)) {
+        uint64_t one = 1;
+        ssize_t ignored = write(_wakeFd, &one, sizeof(one));
+        (void) ignored;
+    }
+}
+
+/**
+ * Makes a task sleep.
+ * @param task the task.
+ * @param numQuantums the number of quantums to sleep, a positive number.
+ * @return None.
+ */
+void TaskRunner::sleep(TaskPromise *task, int numQuantums)
+{
+    task->wakeQuantum = uthread_get_total_quantums() + numQuantums;
+
+    // Tasks that wake up at the same quantum keep the order they slept in.
+    TaskPromise **link = &_sleepers;
+    while (*link != nullptr && (*link)->wakeQuantum <= task->wakeQuantum) {
+        link = &(*link)->next;
+    }
+    task->next = *link;
+    *link = task;
+}
+
+/**
+ * Makes a task wait until a file descriptor is ready.
+ * @param task the task.
+ * @param fd the file descriptor.
+ * @param write true to wait until it is writable, false until it is
+ * readable.
+ * @return SUCCESS, or FAILURE if the file descriptor can not be waited for
+ * (with errno set).
+ */
+int TaskRunner::waitForFd(TaskPromise *task, int fd, bool write)
+{
+    if (fd < 0) {
+        errno = EBADF;
+        return FAILURE;
+    }
+
+    // The table grows to the next power of two that fits the descriptor.
+    if (fd >= _descriptorCount) {
+        int count = _descriptorCount == 0 ? 64 : _descriptorCount;
+        while (count <= fd) {
+            count *= 2;
+        }
+
+        Descriptor *descriptors = new(nothrow) Descriptor[count]();
+        if (descriptors == nullptr) {
+            ErrorHandler::sysCallError(THREAD_SYS_CALL_ERROR_BAD_ALLOC);
+        }
+        if (_descriptorCount > 0) {
+            memcpy(descriptors, _descriptors,
+                   _descriptorCount * sizeof(Descriptor));
+        }
+        delete[] _descriptors;
+        _descriptors = descriptors;
+        _descriptorCount = count;
+    }
+
+    TaskPromise **list = write ? &_descriptors[fd].writers :
+                         &_descriptors[fd].readers;
+    task->next = *list;
+    *list = task;
+    if (!_register(fd)) {
+        *list = task->next;
+        return FAILURE;
+    }
+    ++_ioWaiters;
+    return SUCCESS;
+}
+
+/**
+ * Called once a task completed: the task awaiting it runs next, and the
+ * frame of a detached task is destroyed.
+ * @param task the task.
+ * @return None.
+ */
+void TaskRunner::finish(TaskPromise *task)
+{
+    TaskRunner *runner = task->runner;
+    if (task->continuation != nullptr) {
+        runner->handOff(task->continuation);
+        return;
+    }
+
+    // A task nobody awaits is the root, or a spawned one.
+    --runner->_live;
+    if (task->detached) {
+        task->handle.destroy();
+    }
+}
+
+//--------------------------------HELPERS------------------------------------//
+
+/**
+ * Takes the next ready task.
+ * @return the task, or nullptr if none is ready.
+ */
+TaskPromise *TaskRunner::_popReady()
+{
+    // A round ends once the tasks that were ready when it began had a turn.
+    if (_roundLeft == 0) {
+        if (_sleepers != nullptr || _ioWaiters > 0 ||
+            __atomic_load_n(&_remote, __ATOMIC_RELAXED) != nullptr) {
+            _wakeSleepers();
+            _takeRemote(false);
+            if (_ioWaiters > 0) {
+                _dispatch(epoll_wait(_epollFd, _events, TASK_POLL_BATCH, 0));
+            }
+        }
+        for (TaskPromise *task = _firstReady; task != nullptr;
+             task = task->next) {
+            ++_roundLeft;
+        }
+    }
+
+    TaskPromise *task = _firstReady;
+    if (task == nullptr) {
+        return nullptr;
+    }
+    _firstReady = task->next;
+    if (_firstReady == nullptr) {
+        _lastReady = nullptr;
+    }
+    --_roundLeft;
+    return task;
+}
+
+/**
+ * Makes the tasks that are done waiting ready, and waits until one is if
+ * none is ready.
+ * @return None.
+ */
+void TaskRunner::_poll()
+{
+    _wakeSleepers();
+    _takeRemote(true);
+    if (_firstReady != nullptr) {
+        return;
+    }
+
+    // The thread waits until a descriptor is ready, another thread wakes a
+    // task up, or the first sleeper wakes up (a negative number of quantums
+    // waits with no limit).
+    int timeout = -1;
+    if (_sleepers != nullptr) {
+        timeout = _sleepers->wakeQuantum - uthread_get_total_quantums();
+        if (timeout < 1) {
+            timeout = 1;
+        }
+    }
+    uthread_poll_fd(_epollFd, UTHREAD_POLL_IN, timeout);
+
+    _takeRemote(false);
+    _wakeSleepers();
+    _dispatch(epoll_wait(_epollFd, _events, TASK_POLL_BATCH, 0));
+}
+
+/**
+ * Makes the tasks whose sleep ended ready.
+ * @return None.
+ */
+void TaskRunner::_wakeSleepers()
+{
+    int now = uthread_get_total_quantums();
+    while (_sleepers != nullptr && _sleepers->wakeQuantum <= now) {
+        TaskPromise *task = _sleepers;
+        _sleepers = task->next;
+        schedule(task);
+    }
+}
+
+/**
+ * Makes the tasks other threads woke up ready.
+ * @param park true to mark the runner's thread as waiting if no task is
+ * ready then.
+ * @return None.
+ */
+void TaskRunner::_takeRemote(bool park)
+{
+    __atomic_store_n(&_parked, false, __ATOMIC_SEQ_CST);
+    TaskPromise *list = __atomic_exchange_n(&_remote, nullptr,
+                                            __ATOMIC_SEQ_CST);
+    if (park && list == nullptr && _firstReady == nullptr) {
+        // The runner is marked before it looks again, so a task woken up
+        // after that is either taken now or written about.
+        __atomic_store_n(&_parked, true, __ATOMIC_SEQ_CST);
+        list = __atomic_exchange_n(&_remote, nullptr, __ATOMIC_SEQ_CST);
+        if (list != nullptr) {
+            __atomic_store_n(&_parked, false, __ATOMIC_SEQ_CST);
+        }
+    }
+
+    // The list is in the reverse order of the wake-ups.
+    TaskPromise *reversed = nullptr;
+    while (list != nullptr) {
+        TaskPromise *task = list;
+        list = task->next;
+        task->next = reversed;
+        reversed = task;
+    }
+    while (reversed != nullptr) {
+        TaskPromise *task = reversed;
+        reversed = task->next;
+        schedule(task);
+    }
+}
+
+/**
+ * Makes the tasks waiting for the events the last poll returned ready.
+ * @param count the number of events.
+ * @return None.
+ */
+void TaskRunner::_dispatch(int count)
+{
+    for (int i = 0; i < count; ++i) {
+        int fd = _events[i].data.fd;
+        uint32_t events = _events[i].events;
+        if (fd == _wakeFd) {
+            uint64_t value;
+            ssize_t ignored = read(_wakeFd, &value, sizeof(value));
+            (void) ignored;
+            continue;
+        }
+
+        Descriptor *descriptor = &_descriptors[fd];
+        if (events & READ_EVENTS) {
+            _ioWaiters -= _scheduleAll(&descriptor->readers);
+        }
+        if (events & WRITE_EVENTS) {
+            _ioWaiters -= _scheduleAll(&descriptor->writers);
+        }
+
+        // The registration is one-shot: it is re-armed for the tasks left.
+        if (descriptor->readers != nullptr || descriptor->writers != nullptr) {
+            if (!_register(fd)) {
+                _ioWaiters -= _scheduleAll(&descriptor->readers);
+                _ioWaiters -= _scheduleAll(&descriptor->writers);
+            }
+        }
+    }
+}
+
+/**
+ * Makes all of the tasks of a list ready.
+ * @param list the list, which is emptied.
+ * @return the number of tasks.
+ */
+int TaskRunner::_scheduleAll(TaskPromise **list)
+{
+    int count = 0;
+    while (*list != nullptr) {
+        TaskPromise *task = *list;
+        *list = task->next;
+        schedule(task);
+        ++count;
+    }
+    return count;
+}
+
+/**
+ * Registers a file descriptor for the events its tasks wait for, once.
+ * @param fd the file descriptor.
+ * @return true on success, false otherwise (with errno set).
+ */
+bool TaskRunner::_register(int fd)
+{
+    Descriptor *descriptor = &_descriptors[fd];
+    struct epoll_event event;
+    memset(&event, 0, sizeof(event));
+    event.events = EPOLLONESHOT;
+    if (descriptor->readers != nullptr) {
+        event.events |= EPOLLIN | EPOLLRDHUP;
+    }
+    if (descriptor->writers != nullptr) {
+        event.events |= EPOLLOUT;
+    }
+    event.data.fd = fd;
+
+    // The kernel drops the registration of a closed descriptor, and the
+    // number may have been reused since, so either operation may have to be
+    // retried with the other one.
+    int op = descriptor->registered ? EPOLL_CTL_MOD : EPOLL_CTL_ADD;
+    int result = epoll_ctl(_epollFd, op, fd, &event);
+    if (result == SYS_CALL_FAILED && (errno == ENOENT || errno == EEXIST)) {
+        op = (op == EPOLL_CTL_ADD) ? EPOLL_CTL_MOD : EPOLL_CTL_ADD;
+        result = epoll_ctl(_epollFd, op, fd, &event);
+    }
+    descriptor->registered = result != SYS_CALL_FAILED;
+    return descriptor->registered;
+}
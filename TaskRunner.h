@@ -0,0 +1,321 @@
+#ifndef EX2_TASKRUNNER_H
+#define EX2_TASKRUNNER_H
+
+#include "uthreads_ext.h"
+
+#include <coroutine>
+#include <exception>
+#include <stddef.h>
+#include <sys/epoll.h>
+
+// The largest number of ready file descriptors handled by one poll.
+#define TASK_POLL_BATCH 16
+
+class TaskRunner;
+
+/*
+ * The part of the promise of a task (see uthread_task.h) the TaskRunner
+ * works with. Its frame comes from the pool of the worker (see
+ * uthread_frame_alloc). A task starts suspended, and once it completes it
+ * resumes the task awaiting it, if any.
+ */
+struct TaskPromise
+{
+    /**
+     * Suspends the completed task, and resumes the task awaiting it.
+     */
+    struct FinalAwaiter
+    {
+        bool await_ready() noexcept
+        {
+            return false;
+        }
+
+        template <typename Promise>
+        void await_suspend(std::coroutine_handle<Promise> task) noexcept;
+
+        void await_resume() noexcept
+        {
+        }
+    };
+
+    // The coroutine of the task.
+    std::coroutine_handle<> handle;
+    // The runner the task runs on.
+    TaskRunner *runner = nullptr;
+    // The task awaiting this one, which is resumed once it completes.
+    TaskPromise *continuation = nullptr;
+    // Set for a spawned task, whose frame is destroyed once it completes.
+    bool detached = false;
+    // The exception the task ended with, rethrown to the awaiting task.
+    std::exception_ptr exception;
+    // The total quantum a sleeping task wakes up at.
+    int wakeQuantum = 0;
+    // The next task in the same list: the ready tasks, the sleeping ones,
+    // the ones waiting for a file descriptor, or the ones woken by other
+    // threads.
+    TaskPromise *next = nullptr;
+
+    /**
+     * Allocates the frame of a task from the pool of the worker.
+     * @param size the size of the frame.
+     * @return the frame.
+     */
+    static void *operator new(size_t size);
+
+    /**
+     * Returns the frame of a task to the pool of the worker.
+     * @param frame the frame.
+     * @param size the size of the frame.
+     * @return None.
+     */
+    static void operator delete(void *frame, size_t size);
+
+    /**
+     * Tasks start suspended, and run once awaited or spawned.
+     * @return the awaiter.
+     */
+    std::suspend_always initial_suspend() noexcept
+    {
+        return {};
+    }
+
+    /**
+     * Tasks resume the task awaiting them once they complete.
+     * @return the awaiter.
+     */
+    FinalAwaiter final_suspend() noexcept
+    {
+        return {};
+    }
+
+    /**
+     * Keeps the exception the task ended with.
+     * @return None.
+     */
+    void unhandled_exception()
+    {
+        exception = std::current_exception();
+    }
+};
+
+/*
+ * Runs tasks on the stack of the calling thread: the tasks it was given,
+ * and the tasks they spawn or await. Resuming a task costs no system call.
+ * A task that awaits another one (or completes) hands off to it through
+ * the runner's loop rather than resuming it itself, so the stack does not
+ * grow with chains of tasks (the compiler only turns symmetric transfer
+ * into a tail call when optimizing).
+ * A task that waits (for a number of quantums, a file descriptor, or
+ * another thread) leaves the ready tasks, and the runner's thread only
+ * waits (BLOCKED) once none is ready. Its file descriptors, and an eventfd
+ * other threads wake it up with, are in an epoll instance of its own,
+ * which the thread waits for with uthread_poll_fd. The ready tasks take
+ * turns in rounds, and the sleeping tasks, the file descriptors and the
+ * other threads are checked once a round.
+ */
+class TaskRunner
+{
+public:
+
+    /**
+     * C-tor. Creates a runner with no tasks.
+     */
+    TaskRunner();
+
+    /**
+     * D-tor.
+     */
+    ~TaskRunner();
+
+    /**
+     * Runs a task, and the tasks it spawns, until all of them completed.
+     * @param root the task, which is not started yet.
+     * @return None.
+     */
+    void run(TaskPromise *root);
+
+    /**
+     * Adds a task, which runs detached: its frame is destroyed once it
+     * completes.
+     * @param task the task, which is not started yet.
+     * @return None.
+     */
+    void spawn(TaskPromise *task);
+
+    /**
+     * Makes a task run next, once the running one suspended: a task it
+     * awaits, or the task awaiting it.
+     * @param task the task.
+     * @return None.
+     */
+    void handOff(TaskPromise *task);
+
+    /**
+     * Makes a task of the runner ready. Must be called by the runner's
+     * thread.
+     * @param task the task.
+     * @return None.
+     */
+    void schedule(TaskPromise *task);
+
+    /**
+     * Makes a waiting task of the runner ready. May be called by any
+     * thread, inside the library too (it takes no lock).
+     * @param task the task.
+     * @return None.
+     */
+    void wake(TaskPromise *task);
+
+    /**
+     * Makes a task sleep.
+     * @param task the task.
+     * @param numQuantums the number of quantums to sleep, a positive number.
+     * @return None.
+     */
+    void sleep(TaskPromise *task, int numQuantums);
+
+    /**
+     * Makes a task wait until a file descriptor is ready.
+     * @param task the task.
+     * @param fd the file descriptor.
+     * @param write true to wait until it is writable, false until it is
+     * readable.
+     * @return SUCCESS, or FAILURE if the file descriptor can not be waited
+     * for (with errno set).
+     */
+    int waitForFd(TaskPromise *task, int fd, bool write);
+
+    /**
+     * Called once a task completed: the task awaiting it runs next, and the
+     * frame of a detached task is destroyed.
+     * @param task the task.
+     * @return None.
+     */
+    static void finish(TaskPromise *task);
+
+private:
+
+    /**
+     * The tasks waiting for a file descriptor, and whether it was
+     * registered in the epoll instance.
+     */
+    struct Descriptor
+    {
+        TaskPromise *readers;
+        TaskPromise *writers;
+        bool registered;
+    };
+
+    /**
+     * The task that runs next, ahead of the ready ones.
+     */
+    TaskPromise *_handOff;
+
+    /**
+     * The ready tasks (first and last), and the number of them left in the
+     * current round.
+     */
+    TaskPromise *_firstReady;
+    TaskPromise *_lastReady;
+    int _roundLeft;
+
+    /**
+     * The sleeping tasks, in the order they wake up.
+     */
+    TaskPromise *_sleepers;
+
+    /**
+     * The file descriptors tasks waited for, indexed by file descriptor,
+     * and the number of tasks waiting.
+     */
+    Descriptor *_descriptors;
+    int _descriptorCount;
+    int _ioWaiters;
+
+    /**
+     * The epoll instance, and the eventfd other threads wake the runner up
+     * with.
+     */
+    int _epollFd;
+    int _wakeFd;
+
+    /**
+     * The tasks other threads woke up (pushed with no lock), and whether
+     * the runner's thread waits.
+     */
+    TaskPromise *_remote;
+    bool _parked;
+
+    /**
+     * The number of tasks that did not complete yet.
+     */
+    int _live;
+
+    /**
+     * The events returned by the last poll.
+     */
+    struct epoll_event _events[TASK_POLL_BATCH];
+
+    /**
+     * Takes the next ready task.
+     * @return the task, or nullptr if none is ready.
+     */
+    TaskPromise *_popReady();
+
+    /**
+     * Makes the tasks that are done waiting ready, and waits until one is
+     * if none is ready then.
+     * @return None.
+     */
+    void _poll();
+
+    /**
+     * Makes the tasks whose sleep ended ready.
+     * @return None.
+     */
+    void _wakeSleepers();
+
+    /**
+     * Makes the tasks other threads woke up ready.
+     * @param park true to mark the runner's thread as waiting if no task is
+     * ready then.
+     * @return None.
+     */
+    void _takeRemote(bool park);
+
+    /**
+     * Makes the tasks waiting for the events the last poll returned ready.
+     * @param count the number of events.
+     * @return None.
+     */
+    void _dispatch(int count);
+
+    /**
+     * Makes all of the tasks of a list ready.
+     * @param list the list, which is emptied.
+     * @return the number of tasks.
+     */
+    int _scheduleAll(TaskPromise **list);
+
+    /**
+     * Registers a file descriptor for the events its tasks wait for, once.
+     * @param fd the file descriptor.
+     * @return true on success, false otherwise (with errno set).
+     */
+    bool _register(int fd);
+};
+
+/**
+ * Suspends the completed task, and resumes the task awaiting it.
+ * @param task the completed task.
+ * @return None.
+ */
+template <typename Promise>
+void TaskPromise::FinalAwaiter::await_suspend(
+        std::coroutine_handle<Promise> task) noexcept
+{
+    TaskRunner::finish(&task.promise());
+}
+
+#endif //EX2_TASKRUNNER_H
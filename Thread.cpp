@@ -1,10 +1,12 @@
 // To print errors.
 
 #include "Thread.h"
+#include "uthreads_ext.h"
 
 
 //---------------------------------------------------------------------------//
 
+#ifndef UTHREAD_ASM_SWITCH
 /* A translation is required when using an address of a variable.
    Use this as a black box in your code. */
 static address_t translate_address(address_t addr)
@@ -16,23 +18,128 @@ static address_t translate_address(address_t addr)
     : "0" (addr));
     return ret;
 }
+#else
+/*
+ * uthread_context_switch(Context *saveTo, const Context *jumpTo)
+ * Only what the ABI requires a callee to preserve is saved. The signal mask
+ * is left alone, as the library never changes it.
+ */
+asm(".text\n"
+    ".globl uthread_context_switch\n"
+    ".type uthread_context_switch, @function\n"
+    "uthread_context_switch:\n"
+    "    movq %rsp, 0(%rdi)\n"
+    "    movq %rbx, 8(%rdi)\n"
+    "    movq %rbp, 16(%rdi)\n"
+    "    movq %r12, 24(%rdi)\n"
+    "    movq %r13, 32(%rdi)\n"
+    "    movq %r14, 40(%rdi)\n"
+    "    movq %r15, 48(%rdi)\n"
+    "    stmxcsr 56(%rdi)\n"
+    "    fnstcw 60(%rdi)\n"
+    "    movq 0(%rsi), %rsp\n"
+    "    movq 8(%rsi), %rbx\n"
+    "    movq 16(%rsi), %rbp\n"
+    "    movq 24(%rsi), %r12\n"
+    "    movq 32(%rsi), %r13\n"
+    "    movq 40(%rsi), %r14\n"
+    "    movq 48(%rsi), %r15\n"
+    "    ldmxcsr 56(%rsi)\n"
+    "    fldcw 60(%rsi)\n"
+    "    ret\n"
+    ".size uthread_context_switch, .-uthread_context_switch\n");
+#endif
+
+/*
+ * uthread_context_start is where a new thread's context first jumps to. It
+ * calls the function kept in r12 with the argument kept in r13.
+ */
+asm(".text\n"
+    "uthread_context_start:\n"
+    "    movq %r13, %rdi\n"
+    "    callq *%r12\n"
+    "    ud2\n");
+
+extern "C" void uthread_context_start(void);
+
+// The hook every new thread runs before its function.
+FunctionPointer Thread::_startHook = nullptr;
+// The hook every thread runs when its function returns.
+FunctionPointer Thread::_exitHook = nullptr;
+// The slots of a kernel thread that runs no Thread, which stay NULL.
+static void *no_thread_slots[THREAD_SPECIFIC_SLOTS];
+// The slots of the Thread each kernel thread runs (see Thread::setRunning),
+// declared in uthreads_ext.h for uthread_getspecific.
+__thread void **volatile uthread_running_slots
+        __attribute__((tls_model("initial-exec"))) = no_thread_slots;
 
 //-----------------------CONSTRUCTORS DESTRUCTORS----------------------------//
 
 /**
- * C-tor.
+ * C-tor. The Thread runs f, or argumentFunction(argument) (the main Thread
+ * has neither).
  * @param ID the ID of the Thread.
  * @param stackSize the size of the stack (in bytes).
- * @param f a pointer to the Thread's function.
+ * @param f a pointer to the Thread's function, or nullptr.
+ * @param argumentFunction a pointer to the Thread's function that gets an
+ * argument, or nullptr.
+ * @param argument the argument of argumentFunction.
  */
-Thread::Thread(int ID, int stackSize, FunctionPointer f)
+Thread::Thread(int ID, int stackSize, FunctionPointer f,
+               ArgumentFunction argumentFunction, void *argument)
 : _ID(ID),
   _state(READY),
   _function(f),
+  _argumentFunction(argumentFunction),
+  _argument(argument),
+  _closureDestroyer(nullptr),
+  _specific(),
   _quantums(0),
-  _quantumsToSleep(QUANTUMS_NOT_SET),
-  _quantumsLeftToSleep(QUANTUMS_NOT_SET)
+  _priority(0),
+  _resetEpoch(0),
+  _worker(0),
+  _vruntime(0),
+  _weight(DEFAULT_WEIGHT),
+  _runStart(RUN_START_NOT_SET),
+  _wakeUpQuantum(QUANTUMS_NOT_SET),
+  _timedOut(false),
+  _waitData(nullptr),
+  _sleepIndex(NOT_SLEEPING),
+  _sleepOrder(0),
+  _stack(nullptr),
+  _next(nullptr),
+  _prev(nullptr),
+  _queue(nullptr),
+  _fairChild(nullptr),
+  _fairSibling(nullptr),
+  _fairPrev(nullptr),
+  _fairOrder(0),
+  _inFairQueue(false)
 {
+#ifdef UTHREAD_ASM_SWITCH
+    _context = Context();
+
+    // If its not the main thread.
+    if (f != nullptr || argumentFunction != nullptr) {
+        // Allocate stack
+        _stack = new(nothrow)char[stackSize];
+        if (_stack == nullptr) {
+            ErrorHandler::sysCallError(THREAD_SYS_CALL_ERROR_BAD_ALLOC);
+        }
+
+        // The first switch to the thread "returns" to the start stub, which
+        // then calls _start(this) on a 16 byte aligned stack.
+        address_t sp = ((address_t) _stack + stackSize) & ~(address_t) 0xF;
+        sp -= sizeof(address_t);
+        *(address_t *) sp = (address_t) uthread_context_start;
+
+        _context.sp = sp;
+        _context.r12 = (address_t) _start;
+        _context.r13 = (address_t) this;
+        _context.mxcsr = INITIAL_MXCSR;
+        _context.fpuControl = INITIAL_FPU_CW;
+    }
+#else
     // Construct and initialize env buffer
     _env = new(nothrow) sigjmp_buf[JMP_BUFFER_SIZE];
     if (_env == nullptr) {
@@ -40,7 +147,7 @@ Thread::Thread(int ID, int stackSize, FunctionPointer f)
     }
 
     // If its not the main thread.
-    if (f != nullptr) {
+    if (f != nullptr || argumentFunction != nullptr) {
         // Allocate stack
         _stack = new(nothrow)char[stackSize];
         if (_stack == nullptr) {
@@ -51,13 +158,17 @@ Thread::Thread(int ID, int stackSize, FunctionPointer f)
         // The address to the given function and created memory.
         address_t sp, pc;
 
-        // translate and init stack and PC pointers
-        sp = (address_t) _stack + stackSize - sizeof(address_t);
-        pc = (address_t) _function;
+        // translate and init stack and PC pointers. The thread starts in
+        // the start stub, which calls _start(this) on an aligned stack.
+        sp = ((address_t) _stack + stackSize) & ~(address_t) 0xF;
+        sp -= 2 * sizeof(address_t);
+        pc = (address_t) uthread_context_start;
         sigsetjmp(_env[JMP_BUFFER_INDX], THREAD_SAVE_MASK);
 
         (_env[JMP_BUFFER_INDX]->__jmpbuf)[JB_SP] = translate_address(sp);
         (_env[JMP_BUFFER_INDX]->__jmpbuf)[JB_PC] = translate_address(pc);
+        (_env[JMP_BUFFER_INDX]->__jmpbuf)[JB_R12] = (address_t) _start;
+        (_env[JMP_BUFFER_INDX]->__jmpbuf)[JB_R13] = (address_t) this;
 
         // reset buffer mask
         if(sigemptyset(&(_env[JMP_BUFFER_INDX]->__saved_mask)) < 0)
@@ -65,12 +176,89 @@ Thread::Thread(int ID, int stackSize, FunctionPointer f)
             ErrorHandler::sysCallError(THREAD_SYS_CALL_ERROR_SIGNAL_HANDLE);
         }
     }
+#endif
 }
 
 Thread::~Thread()
 {
+    // The Thread ended before its function returned.
+    if (_closureDestroyer != nullptr) {
+        _closureDestroyer(_closure);
+    }
     delete [] _stack;
+#ifndef UTHREAD_ASM_SWITCH
     delete [] _env;
+#endif
+}
+
+/**
+ * Sets the hook every new thread runs before its function (for example, to
+ * finish the library call that switched to it).
+ * @param hook the hook to run, or nullptr for none.
+ * @return None.
+ */
+void Thread::setStartHook(FunctionPointer hook)
+{
+    _startHook = hook;
+}
+
+/**
+ * Sets the hook a thread runs when its function returns (for example, to
+ * exit the thread). The hook must not return.
+ * @param hook the hook to run.
+ * @return None.
+ */
+void Thread::setExitHook(FunctionPointer hook)
+{
+    _exitHook = hook;
+}
+
+/**
+ * Records the Thread the calling kernel thread runs (or is about to switch
+ * to), whose slots uthread_getspecific reads with one load.
+ * @param thread the Thread, or nullptr if it runs none from now on.
+ * @return None.
+ */
+void Thread::setRunning(Thread *thread)
+{
+    uthread_running_slots = (thread != nullptr) ? thread->_specific
+                                                : no_thread_slots;
+}
+
+/**
+ * Checks whether the calling kernel thread runs no Thread (it runs no
+ * scheduler instance, or has not started one yet).
+ * @return true if so, false otherwise.
+ */
+bool Thread::noneRunning()
+{
+    return uthread_running_slots == no_thread_slots;
+}
+
+/**
+ * The first code a new thread runs (reached from uthread_context_start).
+ * Runs the start hook, the Thread's function and then the exit hook.
+ * @param thread the Thread that is starting.
+ * @return None.
+ */
+void Thread::_start(Thread *thread)
+{
+    if (_startHook != nullptr) {
+        _startHook();
+    }
+    if (thread->_argumentFunction != nullptr) {
+        thread->_argumentFunction(thread->_argument);
+        if (thread->_closureDestroyer != nullptr) {
+            ClosureDestroyer destroyer = thread->_closureDestroyer;
+            thread->_closureDestroyer = nullptr;
+            destroyer(thread->_closure);
+        }
+    } else {
+        thread->_function();
+    }
+    if (_exitHook != nullptr) {
+        _exitHook();
+    }
 }
 
 //-------------------------------GETTERS-------------------------------------//
@@ -132,52 +320,233 @@ void Thread::incrementQuantum(void)
 }
 
 /**
- * Decrease thread's quantums by one.
- * @return None
+ * Setter for the Thread's priority level (0 is the highest).
+ * @param priority the priority level to change to.
+ * @return None.
  */
-void Thread::decrementQuantumsToSleep(void)
+void Thread::setPriority(int priority)
 {
-    _quantumsLeftToSleep--;
+    _priority = priority;
 }
 
 /**
- * Setter for the Thread's quantums sleeping period.
- * @param newQuantums the quantums to change to.
+ * Getter for the Thread's priority level (0 is the highest).
+ * @return the Thread's priority level.
+ */
+int Thread::getPriority(void) const
+{
+    return _priority;
+}
+
+/**
+ * Setter for the reset epoch the Thread's priority level belongs to (the
+ * multi-level feedback policy returns it to the top level once a newer
+ * epoch starts).
+ * @param epoch the reset epoch.
  * @return None.
  */
-void Thread::setQuantumsToSleep(int newQuantums)
+void Thread::setResetEpoch(int epoch)
 {
-    _quantumsToSleep = newQuantums;
+    _resetEpoch = epoch;
 }
 
 /**
- * Getter for the Thread's quantums sleeping period.
- * @return the Thread's quantums.
+ * Getter for the reset epoch the Thread's priority level belongs to.
+ * @return the reset epoch.
  */
-int Thread::getQuantumsToSleep(void) const
+int Thread::getResetEpoch(void) const
 {
-    return _quantumsToSleep;
+    return _resetEpoch;
 }
 
 /**
- * Setter for the Thread's quantums left to sleeping.
- * @param newQuantums the quantums to change to.
+ * Setter for the worker the Thread runs on, or whose ready Threads hold
+ * it.
+ * @param worker the index of the worker.
  * @return None.
  */
-void Thread::setQuantumsLeftToSleep(int newQuantums)
+void Thread::setWorker(int worker)
 {
-    _quantumsLeftToSleep = newQuantums;
+    _worker = worker;
 }
 
 /**
- * Getter for the Thread's quantums left to sleeping.
- * @return the Thread's quantums.
+ * Getter for the worker the Thread runs on, or whose ready Threads hold
+ * it.
+ * @return the index of the worker.
+ */
+int Thread::getWorker(void) const
+{
+    return _worker;
+}
+
+/**
+ * Setter for the Thread's virtual runtime (the fair-share policy runs
+ * the Thread with the lowest one).
+ * @param vruntime the virtual runtime.
+ * @return None.
+ */
+void Thread::setVirtualRuntime(long long vruntime)
+{
+    _vruntime = vruntime;
+}
+
+/**
+ * Getter for the Thread's virtual runtime.
+ * @return the Thread's virtual runtime.
+ */
+long long Thread::getVirtualRuntime(void) const
+{
+    return _vruntime;
+}
+
+/**
+ * Setter for the Thread's weight under the fair-share policy. The
+ * virtual runtime of a Thread grows in inverse proportion to its weight.
+ * @param weight the weight, a positive number.
+ * @return None.
+ */
+void Thread::setWeight(int weight)
+{
+    _weight = weight;
+}
+
+/**
+ * Getter for the Thread's weight under the fair-share policy.
+ * @return the Thread's weight.
+ */
+int Thread::getWeight(void) const
+{
+    return _weight;
+}
+
+/**
+ * Setter for the CPU time of its kernel thread (in nano-seconds) at which
+ * the Thread last started running, as timed by the fair-share policy.
+ * @param runStart the CPU time, or RUN_START_NOT_SET.
+ * @return None.
+ */
+void Thread::setRunStart(long long runStart)
+{
+    _runStart = runStart;
+}
+
+/**
+ * Getter for the CPU time of its kernel thread at which the Thread last
+ * started running.
+ * @return the CPU time in nano-seconds, or RUN_START_NOT_SET.
+ */
+long long Thread::getRunStart(void) const
+{
+    return _runStart;
+}
+
+/**
+ * Setter for the total quantum at which the Thread stops SLEEPING.
+ * @param wakeUpQuantum the quantum to wake up at.
+ * @return None.
+ */
+void Thread::setWakeUpQuantum(int wakeUpQuantum)
+{
+    _wakeUpQuantum = wakeUpQuantum;
+}
+
+/**
+ * Getter for the total quantum at which the Thread stops SLEEPING.
+ * @return the quantum to wake up at.
+ */
+int Thread::getWakeUpQuantum(void) const
+{
+    return _wakeUpQuantum;
+}
+
+/**
+ * Setter for whether the Thread stopped waiting because its timeout
+ * expired (see Scheduler::waitOn).
+ * @param timedOut whether the timeout expired.
+ * @return None.
  */
-int Thread::getQuantumsLeftToSleep(void) const
+void Thread::setTimedOut(bool timedOut)
 {
-    return _quantumsLeftToSleep;
+    _timedOut = timedOut;
 }
 
+/**
+ * Getter for whether the Thread stopped waiting because its timeout
+ * expired.
+ * @return true if the timeout expired, false otherwise.
+ */
+bool Thread::hasTimedOut(void) const
+{
+    return _timedOut;
+}
+
+/**
+ * Setter for the data a waiting Thread hands over, or is handed (for
+ * example, the value it sends on a channel).
+ * @param waitData the data, or nullptr once it was handed over.
+ * @return None.
+ */
+void Thread::setWaitData(void *waitData)
+{
+    _waitData = waitData;
+}
+
+/**
+ * Getter for the data a waiting Thread hands over, or is handed.
+ * @return the data, or nullptr once it was handed over.
+ */
+void *Thread::getWaitData(void) const
+{
+    return _waitData;
+}
+
+/**
+ * Moves a callable into the storage of the Thread, which becomes the
+ * argument of its function. Must be called before the Thread starts.
+ * The callable is destroyed once the function returns, or when the
+ * Thread is deleted before then.
+ * @param mover the function that moves the callable.
+ * @param destroyer the function that destroys the callable, or nullptr.
+ * @param closure the callable, of THREAD_CLOSURE_SIZE bytes at most.
+ * @return None.
+ */
+void Thread::moveClosure(ClosureMover mover, ClosureDestroyer destroyer,
+                         void *closure)
+{
+    mover(_closure, closure);
+    _argument = _closure;
+    _closureDestroyer = destroyer;
+}
+
+/**
+ * Getter for the uthread-local storage slots of the Thread.
+ * @return the THREAD_SPECIFIC_SLOTS slots.
+ */
+void **Thread::specific(void)
+{
+    return _specific;
+}
+
+/**
+ * Getter for the queue the Thread is linked into.
+ * @return the queue, or nullptr if the Thread is not in any queue.
+ */
+ThreadQueue * Thread::getQueue(void) const
+{
+    return _queue;
+}
+
+#ifdef UTHREAD_ASM_SWITCH
+/**
+ * Access the Thread's saved context.
+ * @return a pointer to the Thread's context.
+ */
+Context * Thread::context(void)
+{
+    return &_context;
+}
+#else
 /**
  * Access the Thread's environment.
  * @return a pointer to the Thread's environment.
@@ -186,3 +555,4 @@ sigjmp_buf * Thread::environment(void)
 {
     return &_env[JMP_BUFFER_INDX];
 }
+#endif
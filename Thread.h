@@ -7,25 +7,100 @@
 
 // Typedef for 'unsigned long' , used as a type for addresses.
 typedef unsigned long address_t;
-// Macros for register numbers.
+// Macros for register numbers (in the glibc x86-64 jmp_buf).
+#define JB_R12 2
+#define JB_R13 3
 #define JB_SP 6
 #define JB_PC 7
 
 // Used in sigsetjmp() to save the current signal mask.
 #define THREAD_SAVE_MASK 1
 
+// Threads are switched by a hand-written routine (see Thread.cpp). Define
+// UTHREAD_SIGJMP_SWITCH to fall back to sigsetjmp()/siglongjmp(). Both
+// paths are written for x86-64: the routine and the thread entry stub are
+// x86-64 assembly, and the register numbers above are those of the glibc
+// x86-64 jmp_buf.
+#ifndef __x86_64__
+#error "The thread library supports x86-64 only"
+#endif
+#ifndef UTHREAD_SIGJMP_SWITCH
+#define UTHREAD_ASM_SWITCH
+#endif
+
+// Initial values of the FPU control words of a new thread (as set by the ABI).
+#define INITIAL_MXCSR 0x1F80
+#define INITIAL_FPU_CW 0x037F
+
 // Size of "environment" array is 1. (As said in README - used as wrapper).
 #define JMP_BUFFER_SIZE 1
 // The index of the buffer itself inside the array.
 #define JMP_BUFFER_INDX 0
 // Initial value of the quantums is updated inside of the constructor.
 #define QUANTUMS_NOT_SET -1
+// The heap position of a Thread that is not in the SleepQueue.
+#define NOT_SLEEPING -1
+// The weight of a Thread under the fair-share policy, unless changed.
+#define DEFAULT_WEIGHT 1024
+// The run start of a Thread the fair-share policy did not time yet.
+#define RUN_START_NOT_SET -1
 
 // Typedef for a void function that gets
 typedef void (*FunctionPointer)(void);
+// Typedef for a void function that gets the argument of a Thread.
+typedef void (*ArgumentFunction)(void *argument);
+// Typedef for a function that move-constructs a callable at to from the one
+// at from.
+typedef void (*ClosureMover)(void *to, void *from);
+// Typedef for a function that destroys the callable at closure.
+typedef void (*ClosureDestroyer)(void *closure);
+
+// The size and alignment of the storage a Thread keeps a callable in (see
+// Thread::moveClosure).
+#define THREAD_CLOSURE_SIZE 64
+#define THREAD_CLOSURE_ALIGN 16
+// The number of uthread-local storage slots of a Thread (one per key, see
+// uthread_key_create).
+#define THREAD_SPECIFIC_SLOTS 32
+
+// The queue a Thread is linked into (see ThreadQueue.h).
+class ThreadQueue;
+
+// All possible states the thread can be. A thread is TERMINATED when it was
+// terminated by another worker while RUNNING, until it stops running.
+enum state {READY, RUNNING, BLOCKED, SLEEPING, TERMINATED};
+
+#ifdef UTHREAD_ASM_SWITCH
+/*
+ * The part of a thread's CPU state that has to survive a context switch:
+ * the stack pointer, the callee-saved registers and the FPU control words.
+ * Everything else is either caller-saved (and therefore already spilled by
+ * the compiler around the call to uthread_context_switch) or lives on the
+ * stack. The program counter is the return address at the top of the saved
+ * stack. The field offsets are used by the assembly in Thread.cpp.
+ */
+struct Context
+{
+    address_t sp;
+    address_t rbx;
+    address_t rbp;
+    address_t r12;
+    address_t r13;
+    address_t r14;
+    address_t r15;
+    unsigned int mxcsr;
+    unsigned short fpuControl;
+};
 
-// All possible states the thread can be.
-enum state {READY, RUNNING, BLOCKED, SLEEPING};
+/**
+ * Saves the current context to saveTo and continues from jumpTo. Returns
+ * when some other thread switches back to saveTo.
+ * @param saveTo the context to save the current thread to.
+ * @param jumpTo the context to continue from.
+ * @return None.
+ */
+extern "C" void uthread_context_switch(Context *saveTo, const Context *jumpTo);
+#endif
 
 //---------------------------------------------------------------------------//
 
@@ -42,15 +117,27 @@ enum state {READY, RUNNING, BLOCKED, SLEEPING};
  */
 class Thread
 {
+    // ThreadQueue links Threads through their _next and _prev members.
+    friend class ThreadQueue;
+    // SleepQueue keeps a Thread's position in its heap inside the Thread.
+    friend class SleepQueue;
+    // FairQueue links Threads through their _fair* members.
+    friend class FairQueue;
+
 public:
 
     /**
-     * C-tor.
+     * C-tor. The Thread runs f, or argumentFunction(argument) (the main
+     * Thread has neither).
      * @param ID the ID of the Thread.
      * @param stackSize the size of the stack (in bytes).
-     * @param f a pointer to the Thread's function.
+     * @param f a pointer to the Thread's function, or nullptr.
+     * @param argumentFunction a pointer to the Thread's function that gets
+     * an argument, or nullptr.
+     * @param argument the argument of argumentFunction.
      */
-    Thread(int ID, int stackSize, FunctionPointer f);
+    Thread(int ID, int stackSize, FunctionPointer f,
+           ArgumentFunction argumentFunction, void *argument);
 
     /**
      * D-tor.
@@ -96,46 +183,225 @@ public:
     void incrementQuantum(void);
 
     /**
-     * Decrease thread's quantums by one.
-     * @return None
+     * Setter for the Thread's priority level (0 is the highest).
+     * @param priority the priority level to change to.
+     * @return None.
      */
-    void decrementQuantumsToSleep(void);
+    void setPriority(int priority);
 
+    /**
+     * Getter for the Thread's priority level (0 is the highest).
+     * @return the Thread's priority level.
+     */
+    int getPriority() const;
 
     /**
-     * Setter for the Thread's quantums sleeping period.
-     * @param newQuantums the quantums to change to.
+     * Setter for the reset epoch the Thread's priority level belongs to (the
+     * multi-level feedback policy returns it to the top level once a newer
+     * epoch starts).
+     * @param epoch the reset epoch.
      * @return None.
      */
-    void setQuantumsToSleep(int newQuantums);
+    void setResetEpoch(int epoch);
 
     /**
-     * Getter for the Thread's quantums sleeping period.
-     * @return the Thread's quantums.
+     * Getter for the reset epoch the Thread's priority level belongs to.
+     * @return the reset epoch.
      */
-    int getQuantumsToSleep() const;
+    int getResetEpoch() const;
 
     /**
-     * Setter for the Thread's quantums left to sleeping.
-     * @param newQuantums the quantums to change to.
+     * Setter for the worker the Thread runs on, or whose ready Threads hold
+     * it.
+     * @param worker the index of the worker.
      * @return None.
      */
-    void setQuantumsLeftToSleep(int newQuantums);
+    void setWorker(int worker);
 
     /**
-     * Getter for the Thread's quantums left to sleeping.
-     * @return the Thread's quantums.
+     * Getter for the worker the Thread runs on, or whose ready Threads hold
+     * it.
+     * @return the index of the worker.
+     */
+    int getWorker() const;
+
+    /**
+     * Setter for the Thread's virtual runtime (the fair-share policy runs
+     * the Thread with the lowest one).
+     * @param vruntime the virtual runtime.
+     * @return None.
+     */
+    void setVirtualRuntime(long long vruntime);
+
+    /**
+     * Getter for the Thread's virtual runtime.
+     * @return the Thread's virtual runtime.
+     */
+    long long getVirtualRuntime() const;
+
+    /**
+     * Setter for the Thread's weight under the fair-share policy. The
+     * virtual runtime of a Thread grows in inverse proportion to its weight.
+     * @param weight the weight, a positive number.
+     * @return None.
+     */
+    void setWeight(int weight);
+
+    /**
+     * Getter for the Thread's weight under the fair-share policy.
+     * @return the Thread's weight.
+     */
+    int getWeight() const;
+
+    /**
+     * Setter for the CPU time of its kernel thread (in nano-seconds) at
+     * which the Thread last started running, as timed by the fair-share
+     * policy.
+     * @param runStart the CPU time, or RUN_START_NOT_SET.
+     * @return None.
+     */
+    void setRunStart(long long runStart);
+
+    /**
+     * Getter for the CPU time of its kernel thread at which the Thread last
+     * started running.
+     * @return the CPU time in nano-seconds, or RUN_START_NOT_SET.
+     */
+    long long getRunStart() const;
+
+    /**
+     * Setter for the total quantum at which the Thread stops SLEEPING.
+     * @param wakeUpQuantum the quantum to wake up at.
+     * @return None.
+     */
+    void setWakeUpQuantum(int wakeUpQuantum);
+
+    /**
+     * Getter for the total quantum at which the Thread stops SLEEPING.
+     * @return the quantum to wake up at.
+     */
+    int getWakeUpQuantum() const;
+
+    /**
+     * Setter for whether the Thread stopped waiting because its timeout
+     * expired (see Scheduler::waitOn).
+     * @param timedOut whether the timeout expired.
+     * @return None.
      */
-    int getQuantumsLeftToSleep() const;
+    void setTimedOut(bool timedOut);
 
+    /**
+     * Getter for whether the Thread stopped waiting because its timeout
+     * expired.
+     * @return true if the timeout expired, false otherwise.
+     */
+    bool hasTimedOut() const;
+
+    /**
+     * Setter for the data a waiting Thread hands over, or is handed (for
+     * example, the value it sends on a channel).
+     * @param waitData the data, or nullptr once it was handed over.
+     * @return None.
+     */
+    void setWaitData(void *waitData);
+
+    /**
+     * Getter for the data a waiting Thread hands over, or is handed.
+     * @return the data, or nullptr once it was handed over.
+     */
+    void *getWaitData() const;
+
+    /**
+     * Moves a callable into the storage of the Thread, which becomes the
+     * argument of its function. Must be called before the Thread starts.
+     * The callable is destroyed once the function returns, or when the
+     * Thread is deleted before then.
+     * @param mover the function that moves the callable.
+     * @param destroyer the function that destroys the callable, or nullptr.
+     * @param closure the callable, of THREAD_CLOSURE_SIZE bytes at most.
+     * @return None.
+     */
+    void moveClosure(ClosureMover mover, ClosureDestroyer destroyer,
+                     void *closure);
+
+    /**
+     * Getter for the uthread-local storage slots of the Thread.
+     * @return the THREAD_SPECIFIC_SLOTS slots.
+     */
+    void **specific();
+
+    /**
+     * Getter for the queue the Thread is linked into.
+     * @return the queue, or nullptr if the Thread is not in any queue.
+     */
+    ThreadQueue * getQueue() const;
+
+#ifdef UTHREAD_ASM_SWITCH
+    /**
+     * Access the Thread's saved context.
+     * @return a pointer to the Thread's context.
+     */
+    Context * context();
+#else
     /**
      * Access the Thread's environment.
      * @return a pointer to the Thread's environment.
      */
     sigjmp_buf * environment();
+#endif
+
+    /**
+     * Sets the hook every new thread runs before its function (for example,
+     * to finish the library call that switched to it).
+     * @param hook the hook to run, or nullptr for none.
+     * @return None.
+     */
+    static void setStartHook(FunctionPointer hook);
+
+    /**
+     * Sets the hook a thread runs when its function returns (for example, to
+     * exit the thread). The hook must not return.
+     * @param hook the hook to run.
+     * @return None.
+     */
+    static void setExitHook(FunctionPointer hook);
+
+    /**
+     * Records the Thread the calling kernel thread runs (or is about to
+     * switch to), whose slots uthread_getspecific reads with one load.
+     * @param thread the Thread, or nullptr if it runs none from now on.
+     * @return None.
+     */
+    static void setRunning(Thread *thread);
+
+    /**
+     * Checks whether the calling kernel thread runs no Thread (it runs no
+     * scheduler instance, or has not started one yet).
+     * @return true if so, false otherwise.
+     */
+    static bool noneRunning();
 
 private:
 
+    /**
+     * The hook every new thread runs before its function.
+     */
+    static FunctionPointer _startHook;
+
+    /**
+     * The hook a thread runs when its function returns.
+     */
+    static FunctionPointer _exitHook;
+
+    /**
+     * The first code a new thread runs (reached from the start stub in
+     * Thread.cpp). Runs the start hook, the Thread's function and then the
+     * exit hook.
+     * @param thread the Thread that is starting.
+     * @return None.
+     */
+    static void _start(Thread *thread);
+
     /**
      * The ID of the Thread
      */
@@ -151,35 +417,128 @@ private:
      */
     FunctionPointer _function;
 
+    /**
+     * The function of the Thread that gets an argument, and its argument.
+     */
+    ArgumentFunction _argumentFunction;
+    void *_argument;
+
+    /**
+     * The storage the Thread keeps a callable in (see moveClosure), which
+     * saves its allocation.
+     */
+    alignas(THREAD_CLOSURE_ALIGN) unsigned char _closure[THREAD_CLOSURE_SIZE];
+
+    /**
+     * The function that destroys the callable in _closure, or nullptr if
+     * there is none (or it was destroyed).
+     */
+    ClosureDestroyer _closureDestroyer;
+
+    /**
+     * The uthread-local storage slots of the Thread.
+     */
+    void *_specific[THREAD_SPECIFIC_SLOTS];
+
     /**
      * The number of quantums the Thread was in RUNNING state.
      */
     int _quantums;
 
     /**
-     * The number of quantums the Thread will be in SLEEPING state.
-     * Initialized to QUANTUMS_NOT_SET
+     * The priority level of the Thread (0 is the highest).
+     */
+    int _priority;
+
+    /**
+     * The reset epoch of the multi-level feedback policy the priority level
+     * belongs to.
+     */
+    int _resetEpoch;
+
+    /**
+     * The worker the Thread runs on, or whose ready Threads hold it.
+     */
+    int _worker;
+
+    /**
+     * The virtual runtime and the weight of the Thread (fair-share policy).
+     */
+    long long _vruntime;
+    int _weight;
+
+    /**
+     * The CPU time of its kernel thread (in nano-seconds) at which the
+     * Thread last started running (fair-share policy).
      */
-    int _quantumsToSleep;
+    long long _runStart;
 
     /**
-     * The number of quantums the Thread has left to be in SLEEPING state.
+     * The total quantum at which the Thread stops SLEEPING.
      * Initialized to QUANTUMS_NOT_SET
      */
-    int _quantumsLeftToSleep;
+    int _wakeUpQuantum;
 
+    /**
+     * Set if the Thread stopped waiting because its timeout expired.
+     */
+    bool _timedOut;
 
+    /**
+     * The data the Thread hands over, or is handed, while it waits.
+     */
+    void *_waitData;
+
+    /**
+     * The position of the Thread in the SleepQueue heap (NOT_SLEEPING if it
+     * is not in it), and the order in which it was added to it.
+     */
+    int _sleepIndex;
+    unsigned long _sleepOrder;
 
     /**
      * Pointer to the stack of the Thread
      */
     char* _stack;
 
+    /**
+     * The next and previous Threads in the queue the Thread is linked into.
+     */
+    Thread* _next;
+    Thread* _prev;
+
+    /**
+     * The queue the Thread is linked into (nullptr if none).
+     */
+    ThreadQueue* _queue;
+
+    /**
+     * The links of the Thread in the FairQueue heap: its first child, its
+     * next sibling, and its parent (first child) or previous sibling.
+     */
+    Thread* _fairChild;
+    Thread* _fairSibling;
+    Thread* _fairPrev;
+
+    /**
+     * The order in which the Thread was added to the FairQueue, and whether
+     * it is in it.
+     */
+    unsigned long _fairOrder;
+    bool _inFairQueue;
+
+#ifdef UTHREAD_ASM_SWITCH
+    /**
+     * The saved context of the Thread (valid while it is not RUNNING).
+     */
+    Context _context;
+#else
     /**
      * The environments of the Thread (an array that holds the buffers)
      * Note that only 1 is used by default.
      */
     sigjmp_buf * _env;
+#endif
 
 };
 
@@ -0,0 +1,126 @@
+#include "ThreadQueue.h"
+
+//-----------------------------CONSTRUCTORS----------------------------------//
+
+/**
+ * C-tor. Creates an empty queue.
+ */
+ThreadQueue::ThreadQueue()
+: _head(nullptr),
+  _tail(nullptr),
+  _size(0)
+{
+}
+
+//------------------------------OPERATIONS-----------------------------------//
+
+/**
+ * Adds a Thread to the back of the queue.
+ * @param thread the Thread to add. Must not be in any queue.
+ * @return None.
+ */
+void ThreadQueue::pushBack(Thread *thread)
+{
+    thread->_next = nullptr;
+    thread->_prev = _tail;
+    thread->_queue = this;
+
+    if (_tail == nullptr) {
+        _head = thread;
+    }
+    else {
+        _tail->_next = thread;
+    }
+    _tail = thread;
+    _size++;
+}
+
+/**
+ * Removes the Thread at the front of the queue.
+ * @return the removed Thread, or nullptr if the queue is empty.
+ */
+Thread *ThreadQueue::popFront()
+{
+    Thread *thread = _head;
+
+    if (thread != nullptr) {
+        remove(thread);
+    }
+    return thread;
+}
+
+/**
+ * Removes a Thread from the queue.
+ * @param thread the Thread to remove. Must be in this queue.
+ * @return None.
+ */
+void ThreadQueue::remove(Thread *thread)
+{
+    if (thread->_prev == nullptr) {
+        _head = thread->_next;
+    }
+    else {
+        thread->_prev->_next = thread->_next;
+    }
+
+    if (thread->_next == nullptr) {
+        _tail = thread->_prev;
+    }
+    else {
+        thread->_next->_prev = thread->_prev;
+    }
+
+    thread->_next = nullptr;
+    thread->_prev = nullptr;
+    thread->_queue = nullptr;
+    _size--;
+}
+
+//-------------------------------GETTERS-------------------------------------//
+
+/**
+ * Getter for the Thread at the front of the queue.
+ * @return the first Thread, or nullptr if the queue is empty.
+ */
+Thread *ThreadQueue::front() const
+{
+    return _head;
+}
+
+/**
+ * Getter for the Thread that follows a given one in the queue.
+ * @param thread a Thread in this queue.
+ * @return the next Thread, or nullptr if thread is the last one.
+ */
+Thread *ThreadQueue::next(const Thread *thread) const
+{
+    return thread->_next;
+}
+
+/**
+ * Checks whether a Thread is in this queue.
+ * @param thread the Thread to look for.
+ * @return true if the Thread is in this queue, false otherwise.
+ */
+bool ThreadQueue::contains(const Thread *thread) const
+{
+    return thread->_queue == this;
+}
+
+/**
+ * Checks whether the queue is empty.
+ * @return true if the queue is empty, false otherwise.
+ */
+bool ThreadQueue::isEmpty() const
+{
+    return _size == 0;
+}
+
+/**
+ * Getter for the number of Threads in the queue.
+ * @return the number of Threads in the queue.
+ */
+int ThreadQueue::size() const
+{
+    return _size;
+}
@@ -0,0 +1,92 @@
+#ifndef EX2_THREADQUEUE_H
+#define EX2_THREADQUEUE_H
+
+#include "Thread.h"
+
+/*
+ * A FIFO queue of Threads, implemented as an intrusive doubly-linked list:
+ * the links live inside the Threads themselves, so inserting and removing
+ * never allocate, and every operation (including removing a Thread from the
+ * middle of the queue) is O(1). A Thread can be in at most one ThreadQueue
+ * at a time, and it knows which one it is in.
+ */
+class ThreadQueue
+{
+public:
+
+    /**
+     * C-tor. Creates an empty queue.
+     */
+    ThreadQueue();
+
+    /**
+     * Adds a Thread to the back of the queue.
+     * @param thread the Thread to add. Must not be in any queue.
+     * @return None.
+     */
+    void pushBack(Thread *thread);
+
+    /**
+     * Removes the Thread at the front of the queue.
+     * @return the removed Thread, or nullptr if the queue is empty.
+     */
+    Thread *popFront();
+
+    /**
+     * Removes a Thread from the queue.
+     * @param thread the Thread to remove. Must be in this queue.
+     * @return None.
+     */
+    void remove(Thread *thread);
+
+    /**
+     * Getter for the Thread at the front of the queue.
+     * @return the first Thread, or nullptr if the queue is empty.
+     */
+    Thread *front() const;
+
+    /**
+     * Getter for the Thread that follows a given one in the queue.
+     * @param thread a Thread in this queue.
+     * @return the next Thread, or nullptr if thread is the last one.
+     */
+    Thread *next(const Thread *thread) const;
+
+    /**
+     * Checks whether a Thread is in this queue.
+     * @param thread the Thread to look for.
+     * @return true if the Thread is in this queue, false otherwise.
+     */
+    bool contains(const Thread *thread) const;
+
+    /**
+     * Checks whether the queue is empty.
+     * @return true if the queue is empty, false otherwise.
+     */
+    bool isEmpty() const;
+
+    /**
+     * Getter for the number of Threads in the queue.
+     * @return the number of Threads in the queue.
+     */
+    int size() const;
+
+private:
+
+    /**
+     * The first Thread in the queue.
+     */
+    Thread *_head;
+
+    /**
+     * The last Thread in the queue.
+     */
+    Thread *_tail;
+
+    /**
+     * The number of Threads in the queue.
+     */
+    int _size;
+};
+
+#endif //EX2_THREADQUEUE_H
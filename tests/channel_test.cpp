@@ -0,0 +1,155 @@
+/*
+ * Checks channels: values pass in order through a buffered and an unbuffered
+ * channel, a value sent while a thread waits to receive goes straight to it
+ * (leaving the buffer free), the try operations fail rather than wait, and
+ * once a channel is closed its buffered values are still received, after
+ * which receivers (waiting ones too) get UTHREAD_CLOSED.
+ * Usage: channel_test [workers]. Exits with 0 on success.
+ */
+#include "uthreads.h"
+#include "uthreads_ext.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#define QUANTUM_USECS 10000
+// The number of values passed through each channel.
+#define VALUES 1000
+// The capacity of the buffered channel.
+#define CAPACITY 3
+// The number of times the main thread lets the others run.
+#define YIELDS 100
+
+// The channel the threads receive from.
+static uthread_chan_t *chan;
+
+/**
+* Receives VALUES values, which must come in order.
+* @param arg where the number of values received in order goes.
+* @return None.
+*/
+static void consumer(void *arg)
+{
+    int *received = static_cast<int *>(arg);
+    for (int i = 0; i < VALUES; ++i)
+    {
+        int value;
+        if (uthread_chan_recv(chan, &value) != 0 || value != i)
+        {
+            return;
+        }
+        (*received)++;
+    }
+}
+
+/**
+* Receives a single value.
+* @param arg where the result goes.
+* @return None.
+*/
+static void receiver(void *arg)
+{
+    int value;
+    *static_cast<int *>(arg) = uthread_chan_recv(chan, &value);
+}
+
+/**
+* Lets the other threads run.
+* @return None.
+*/
+static void let_run(void)
+{
+    for (int i = 0; i < YIELDS; ++i)
+    {
+        uthread_yield();
+    }
+}
+
+/**
+* Passes VALUES values through a channel to a consumer.
+* @param capacity the capacity of the channel.
+* @return true if all of them were received in order, false otherwise.
+*/
+static bool pass_values(int capacity)
+{
+    int received = 0;
+    chan = uthread_chan_create(sizeof(int), capacity);
+    int tid = uthread_spawn_arg(consumer, &received);
+    for (int i = 0; i < VALUES; ++i)
+    {
+        uthread_chan_send(chan, &i);
+    }
+    uthread_join(tid, nullptr);
+    uthread_chan_destroy(chan);
+    if (received != VALUES)
+    {
+        printf("capacity %d: %d values received\n", capacity, received);
+        return false;
+    }
+    return true;
+}
+
+int main(int argc, char **argv)
+{
+    int workers = argc > 1 ? atoi(argv[1]) : 1;
+    if ((workers == 1 ? uthread_init(QUANTUM_USECS) :
+         uthread_init_mp(QUANTUM_USECS, workers)) != 0)
+    {
+        return EXIT_FAILURE;
+    }
+
+    if (!pass_values(CAPACITY) || !pass_values(0))
+    {
+        return EXIT_FAILURE;
+    }
+
+    // The value sent to a waiting receiver does not take up the buffer.
+    int value = 0;
+    int result = -1;
+    chan = uthread_chan_create(sizeof(int), 1);
+    int tid = uthread_spawn_arg(receiver, &result);
+    let_run();
+    if (uthread_chan_try_recv(chan, &value) != UTHREAD_BUSY ||
+        uthread_chan_send(chan, &value) != 0 ||
+        uthread_chan_try_send(chan, &value) != 0 ||
+        uthread_chan_try_send(chan, &value) != UTHREAD_BUSY ||
+        uthread_join(tid, nullptr) != 0 || result != 0)
+    {
+        printf("the value was not handed over to the receiver\n");
+        return EXIT_FAILURE;
+    }
+
+    // The buffered value is received after the channel is closed, and then
+    // receivers get UTHREAD_CLOSED.
+    int results[2] = {-1, -1};
+    if (uthread_chan_close(chan) != 0)
+    {
+        return EXIT_FAILURE;
+    }
+    for (int i = 0; i < 2; ++i)
+    {
+        tid = uthread_spawn_arg(receiver, &results[i]);
+        uthread_join(tid, nullptr);
+    }
+    if (results[0] != 0 || results[1] != UTHREAD_CLOSED ||
+        uthread_chan_try_recv(chan, &value) != UTHREAD_CLOSED ||
+        uthread_chan_destroy(chan) != 0)
+    {
+        printf("after closing: %d, %d\n", results[0], results[1]);
+        return EXIT_FAILURE;
+    }
+
+    // A waiting receiver is woken up by closing the channel.
+    chan = uthread_chan_create(sizeof(int), 0);
+    tid = uthread_spawn_arg(receiver, &result);
+    let_run();
+    if (uthread_chan_close(chan) != 0 || uthread_join(tid, nullptr) != 0 ||
+        result != UTHREAD_CLOSED || uthread_chan_destroy(chan) != 0)
+    {
+        printf("the waiting receiver got %d\n", result);
+        return EXIT_FAILURE;
+    }
+
+    printf("ok\n");
+    return EXIT_SUCCESS;
+}
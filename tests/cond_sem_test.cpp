@@ -0,0 +1,166 @@
+/*
+ * Checks condition variables and semaphores: timed waits time out (with the
+ * mutex locked again), a broadcast wakes every waiting thread, trywait fails
+ * on a semaphore of 0, and the units posted go to the waiting threads in the
+ * order they came (with a single worker, where that order is known).
+ * Usage: cond_sem_test [workers]. Exits with 0 on success.
+ */
+#include "uthreads.h"
+#include "uthreads_ext.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#define QUANTUM_USECS 10000
+// The number of waiting threads.
+#define WAITERS 5
+// The number of quantums the timed waits wait.
+#define TIMEOUT_QUANTUMS 2
+// The number of times the main thread lets the others run.
+#define YIELDS 100
+
+static uthread_mutex_t mutex = UTHREAD_MUTEX_INITIALIZER;
+static uthread_cond_t cond = UTHREAD_COND_INITIALIZER;
+static uthread_sem_t sem;
+// Set under the mutex before the broadcast.
+static bool go = false;
+// The number of threads woken up by the broadcast.
+static volatile int woken = 0;
+// The order the waiting threads got their units in.
+static int order[WAITERS];
+static volatile int served = 0;
+
+/**
+* Waits on the condition variable with no signal, and on the semaphore of 0.
+* @param arg where the results go: the cond wait's, whether the mutex was
+* locked again, and the semaphore wait's.
+* @return None.
+*/
+static void timed_waiter(void *arg)
+{
+    int *results = static_cast<int *>(arg);
+    uthread_mutex_lock(&mutex);
+    results[0] = uthread_cond_timedwait(&cond, &mutex, TIMEOUT_QUANTUMS);
+    results[1] = uthread_mutex_trylock(&mutex);
+    uthread_mutex_unlock(&mutex);
+    results[2] = uthread_sem_timedwait(&sem, TIMEOUT_QUANTUMS);
+}
+
+/**
+* Waits until go is set.
+* @return None.
+*/
+static void cond_waiter(void)
+{
+    uthread_mutex_lock(&mutex);
+    while (!go)
+    {
+        uthread_cond_wait(&cond, &mutex);
+    }
+    woken++;
+    uthread_mutex_unlock(&mutex);
+}
+
+/**
+* Waits for a unit of the semaphore, and keeps the order it got it in.
+* @param arg the index of the thread.
+* @return None.
+*/
+static void sem_waiter(void *arg)
+{
+    uthread_sem_wait(&sem);
+    order[__atomic_fetch_add(&served, 1, __ATOMIC_RELAXED)] =
+            (int) (long) arg;
+}
+
+/**
+* Lets the other threads run.
+* @return None.
+*/
+static void let_run(void)
+{
+    for (int i = 0; i < YIELDS; ++i)
+    {
+        uthread_yield();
+    }
+}
+
+int main(int argc, char **argv)
+{
+    int workers = argc > 1 ? atoi(argv[1]) : 1;
+    if ((workers == 1 ? uthread_init(QUANTUM_USECS) :
+         uthread_init_mp(QUANTUM_USECS, workers)) != 0 ||
+        uthread_sem_init(&sem, 0) != 0)
+    {
+        return EXIT_FAILURE;
+    }
+
+    // Timed waits time out, and the mutex is locked again.
+    int results[3] = {0, 0, 0};
+    int tid = uthread_spawn_arg(timed_waiter, results);
+    if (tid < 0 || uthread_join(tid, nullptr) != 0 ||
+        results[0] != UTHREAD_TIMEDOUT || results[1] != UTHREAD_BUSY ||
+        results[2] != UTHREAD_TIMEDOUT)
+    {
+        printf("timed waits returned %d, %d, %d\n", results[0], results[1],
+               results[2]);
+        return EXIT_FAILURE;
+    }
+
+    // A broadcast wakes every waiting thread.
+    int tids[WAITERS];
+    for (int i = 0; i < WAITERS; ++i)
+    {
+        tids[i] = uthread_spawn(cond_waiter);
+    }
+    let_run();
+    uthread_mutex_lock(&mutex);
+    go = true;
+    uthread_cond_broadcast(&cond);
+    uthread_mutex_unlock(&mutex);
+    for (int i = 0; i < WAITERS; ++i)
+    {
+        uthread_join(tids[i], nullptr);
+    }
+    if (woken != WAITERS)
+    {
+        printf("the broadcast woke %d threads\n", woken);
+        return EXIT_FAILURE;
+    }
+
+    // The units go to the waiting threads, in the order they came.
+    if (uthread_sem_trywait(&sem) != UTHREAD_BUSY)
+    {
+        printf("trywait took a unit of 0\n");
+        return EXIT_FAILURE;
+    }
+    for (long i = 0; i < WAITERS; ++i)
+    {
+        tids[i] = uthread_spawn_arg(sem_waiter, (void *) i);
+        let_run();
+    }
+    for (int i = 0; i < WAITERS; ++i)
+    {
+        uthread_sem_post(&sem);
+    }
+    for (int i = 0; i < WAITERS; ++i)
+    {
+        uthread_join(tids[i], nullptr);
+    }
+    for (int i = 0; i < WAITERS; ++i)
+    {
+        if (served != WAITERS || (workers == 1 && order[i] != i))
+        {
+            printf("unit %d of %d went to thread %d\n", i, served,
+                   order[i]);
+            return EXIT_FAILURE;
+        }
+    }
+    if (uthread_sem_destroy(&sem) != 0 || uthread_cond_destroy(&cond) != 0)
+    {
+        return EXIT_FAILURE;
+    }
+
+    printf("ok\n");
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,98 @@
+/*
+ * Checks that the fair-share policy charges threads for the CPU time they
+ * use: a thread that yields often gets about as much CPU time as one that
+ * uses up its quantums.
+ * Usage: fair_share_test [workers]. The policy runs on a single worker, so
+ * the number of workers is ignored. Exits with 0 on success.
+ */
+#include "uthreads.h"
+#include "uthreads_ext.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#define QUANTUM_USECS 10000
+// How long the threads run.
+#define RUN_NSECS 500000000LL
+// The number of steps the yielding thread makes between yields.
+#define STEPS_PER_YIELD 2000
+// The least share of the spinning thread's steps the yielding thread makes.
+#define MIN_RATIO 0.5
+#define NSECS_PER_SECOND 1000000000LL
+
+// The steps each thread made: spinning, then yielding.
+static volatile long steps[2];
+// Set to stop the threads.
+static volatile int stop = 0;
+
+/**
+* Reads the monotonic clock.
+* @return the time in nano-seconds.
+*/
+static long long now_nsecs(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec * NSECS_PER_SECOND + now.tv_nsec;
+}
+
+/**
+* Makes steps until stopped.
+* @param arg unused.
+* @return None.
+*/
+static void spinner(void *arg)
+{
+    (void) arg;
+    while (!stop)
+    {
+        steps[0]++;
+    }
+}
+
+/**
+* Makes steps until stopped, yielding every STEPS_PER_YIELD of them.
+* @param arg unused.
+* @return None.
+*/
+static void yielder(void *arg)
+{
+    (void) arg;
+    while (!stop)
+    {
+        if (++steps[1] % STEPS_PER_YIELD == 0)
+        {
+            uthread_yield();
+        }
+    }
+}
+
+int main(void)
+{
+    if (uthread_init_ex(QUANTUM_USECS, UTHREAD_POLICY_FAIR) != 0)
+    {
+        return EXIT_FAILURE;
+    }
+
+    int spinning = uthread_spawn_arg(spinner, nullptr);
+    int yielding = uthread_spawn_arg(yielder, nullptr);
+    long long end = now_nsecs() + RUN_NSECS;
+    while (now_nsecs() < end)
+    {
+        uthread_yield();
+    }
+    stop = 1;
+    uthread_join(spinning, nullptr);
+    uthread_join(yielding, nullptr);
+
+    double ratio = (double) steps[1] / steps[0];
+    if (ratio < MIN_RATIO)
+    {
+        printf("the yielding thread made %.2f of the steps of the other\n",
+               ratio);
+        return EXIT_FAILURE;
+    }
+    printf("ok\n");
+    return EXIT_SUCCESS;
+}
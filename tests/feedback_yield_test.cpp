@@ -0,0 +1,96 @@
+/*
+ * Checks that a yield keeps the level of a thread under the multi-level
+ * feedback policy: a busy thread that yields often still drops a level each
+ * time its quantum expires, so a thread of the lowest level gets to run well
+ * before all threads return to the top level.
+ * Usage: feedback_yield_test [workers]. The policy runs on a single worker,
+ * so the number of workers is ignored. Exits with 0 on success.
+ */
+#include "uthreads.h"
+#include "uthreads_ext.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#define QUANTUM_USECS 10000
+// How long the busy thread runs, in quantums: well below the reset period.
+#define BUSY_QUANTUMS 30
+// The number of steps the busy thread makes between yields.
+#define STEPS_PER_YIELD 1000
+#define NSECS_PER_USEC 1000LL
+#define NSECS_PER_SECOND 1000000000LL
+
+// The steps the thread of the lowest level made.
+static volatile long low_steps = 0;
+// Set to stop the thread of the lowest level.
+static volatile int stop = 0;
+
+/**
+* Reads the monotonic clock.
+* @return the time in nano-seconds.
+*/
+static long long now_nsecs(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec * NSECS_PER_SECOND + now.tv_nsec;
+}
+
+/**
+* Runs for BUSY_QUANTUMS quantums, yielding every STEPS_PER_YIELD steps.
+* @return None.
+*/
+static void busy(void)
+{
+    long long end = now_nsecs() +
+                    BUSY_QUANTUMS * QUANTUM_USECS * NSECS_PER_USEC;
+    long steps = 0;
+    while (now_nsecs() < end)
+    {
+        if (++steps % STEPS_PER_YIELD == 0)
+        {
+            uthread_yield();
+        }
+    }
+}
+
+/**
+* Makes steps until stopped.
+* @return None.
+*/
+static void low(void)
+{
+    while (!stop)
+    {
+        low_steps++;
+    }
+}
+
+int main(void)
+{
+    if (uthread_init_ex(QUANTUM_USECS, UTHREAD_POLICY_MLFQ) != 0)
+    {
+        return EXIT_FAILURE;
+    }
+
+    int lowest = uthread_spawn(low);
+    int busiest = uthread_spawn(busy);
+    if (lowest < 0 || busiest < 0 ||
+        uthread_set_priority(lowest, UTHREAD_PRIORITY_LEVELS - 1) != 0)
+    {
+        return EXIT_FAILURE;
+    }
+    uthread_join(busiest, nullptr);
+    long steps = low_steps;
+    stop = 1;
+    uthread_join(lowest, nullptr);
+
+    if (steps == 0)
+    {
+        printf("the thread of the lowest level never ran\n");
+        return EXIT_FAILURE;
+    }
+    printf("ok\n");
+    return EXIT_SUCCESS;
+}
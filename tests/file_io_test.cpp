@@ -0,0 +1,138 @@
+/*
+ * Checks file I/O through the io_uring (or the calling kernel thread, where
+ * the kernel does not support it): writes and reads come back with their
+ * results or errors, a thread terminated while its read is in flight is
+ * kept until the read completes, and a request is submitted by the
+ * scheduling decision right after it was made, rather than once a quantum,
+ * while another thread is busy.
+ * Usage: file_io_test [workers]. Exits with 0 on success.
+ */
+#include "uthreads.h"
+#include "uthreads_ext.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+// A quantum long enough for the busy thread to keep its whole quantums.
+#define QUANTUM_USECS 20000
+// The number of reads made while another thread is busy.
+#define READS 10
+// The number of times the main thread lets the others run.
+#define YIELDS 100
+
+// The file the threads read from, and the pipe of the terminated reader.
+static int file_fd;
+static int pipe_fds[2];
+// Set to stop the busy thread.
+static volatile int stop = 0;
+// The number of quantums the reads took.
+static volatile int read_quantums = 0;
+
+/**
+* Runs until stopped.
+* @return None.
+*/
+static void busy(void)
+{
+    while (!stop)
+    {
+    }
+}
+
+/**
+* Reads the file READS times.
+* @return None.
+*/
+static void reader(void)
+{
+    char byte;
+    int before = uthread_get_total_quantums();
+    for (int i = 0; i < READS; ++i)
+    {
+        if (uthread_pread(file_fd, &byte, 1, 0) != 1)
+        {
+            read_quantums = -1;
+            return;
+        }
+    }
+    read_quantums = uthread_get_total_quantums() - before;
+}
+
+/**
+* Reads a byte from the pipe into its stack, which waits until one is
+* written.
+* @return None.
+*/
+static void pipe_reader(void)
+{
+    char byte;
+    uthread_pread(pipe_fds[0], &byte, 1, 0);
+}
+
+int main(int argc, char **argv)
+{
+    int workers = argc > 1 ? atoi(argv[1]) : 1;
+    char path[] = "/tmp/file_io_testXXXXXX";
+    if ((workers == 1 ? uthread_init(QUANTUM_USECS) :
+         uthread_init_mp(QUANTUM_USECS, workers)) != 0 ||
+        (file_fd = mkstemp(path)) < 0 || pipe(pipe_fds) != 0)
+    {
+        return EXIT_FAILURE;
+    }
+    unlink(path);
+
+    // A write, an fsync and a read come back with their results, and a bad
+    // file descriptor with its error.
+    const char text[] = "file I/O";
+    char buffer[sizeof(text)] = {0};
+    if (uthread_pwrite(file_fd, text, sizeof(text), 0) != sizeof(text) ||
+        uthread_fsync(file_fd) != 0 ||
+        uthread_pread(file_fd, buffer, sizeof(buffer), 0) != sizeof(text) ||
+        memcmp(buffer, text, sizeof(text)) != 0)
+    {
+        printf("the text read is not the one written\n");
+        return EXIT_FAILURE;
+    }
+    errno = 0;
+    if (uthread_pread(-1, buffer, 1, 0) != -1 || errno != EBADF)
+    {
+        printf("a bad file descriptor left errno %d\n", errno);
+        return EXIT_FAILURE;
+    }
+
+    // The reader terminated while its read is in flight is gone once the
+    // read completes, and its ID is used again.
+    for (int round = 0; round < 2; ++round)
+    {
+        int tid = uthread_spawn(pipe_reader);
+        for (int i = 0; i < YIELDS; ++i)
+        {
+            uthread_yield();
+        }
+        if (tid < 0 || uthread_terminate(tid) != 0 ||
+            write(pipe_fds[1], "x", 1) != 1)
+        {
+            return EXIT_FAILURE;
+        }
+    }
+
+    // Each read takes two quantums: the one the busy thread starts once the
+    // reader waits, and the reader's own, which follows as soon as the read
+    // completes.
+    int busiest = uthread_spawn(busy);
+    int reading = uthread_spawn(reader);
+    uthread_join(reading, nullptr);
+    stop = 1;
+    uthread_join(busiest, nullptr);
+    if (read_quantums < 0 || read_quantums > 2 * READS + READS / 2)
+    {
+        printf("%d reads took %d quantums\n", READS, read_quantums);
+        return EXIT_FAILURE;
+    }
+
+    printf("ok\n");
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,136 @@
+/*
+ * Checks futures: get waits for the value of a task, wait_any returns a
+ * complete future while another one is not, wait_all returns once every
+ * future is complete, a continuation is handed the value of the future it
+ * follows, and released futures are reused round after round.
+ * Usage: future_test [workers]. Exits with 0 on success.
+ */
+#include "uthreads.h"
+#include "uthreads_ext.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#define QUANTUM_USECS 10000
+// The number of quantums the slow task sleeps.
+#define SLEEP_QUANTUMS 2
+// The number of futures made one after the other, well above MAX_THREAD_NUM.
+#define ROUNDS 1000
+
+// The semaphore the gated task waits on.
+static uthread_sem_t gate;
+
+/**
+* Returns its argument at once.
+* @param arg the value.
+* @return arg.
+*/
+static void *echo(void *arg)
+{
+    return arg;
+}
+
+/**
+* Returns its argument after sleeping.
+* @param arg the value.
+* @return arg.
+*/
+static void *slow_echo(void *arg)
+{
+    uthread_sleep(SLEEP_QUANTUMS);
+    return arg;
+}
+
+/**
+* Returns its argument once the gate is posted.
+* @param arg the value.
+* @return arg.
+*/
+static void *gated_echo(void *arg)
+{
+    uthread_sem_wait(&gate);
+    return arg;
+}
+
+/**
+* Adds its argument to the value of the future it follows.
+* @param value the value.
+* @param arg the number to add.
+* @return the sum.
+*/
+static void *add(void *value, void *arg)
+{
+    return (void *) ((long) value + (long) arg);
+}
+
+int main(int argc, char **argv)
+{
+    int workers = argc > 1 ? atoi(argv[1]) : 1;
+    if ((workers == 1 ? uthread_init(QUANTUM_USECS) :
+         uthread_init_mp(QUANTUM_USECS, workers)) != 0 ||
+        uthread_sem_init(&gate, 0) != 0)
+    {
+        return EXIT_FAILURE;
+    }
+
+    // get waits for the value of the task.
+    void *value = nullptr;
+    uthread_future_t *future = uthread_async(slow_echo, (void *) 1L);
+    if (future == nullptr || uthread_future_get(future, &value) != 0 ||
+        value != (void *) 1L || uthread_future_release(future) != 0)
+    {
+        printf("get returned %p\n", value);
+        return EXIT_FAILURE;
+    }
+
+    // wait_any returns the complete future, and wait_all waits for the
+    // other one too.
+    uthread_future_t *futures[2] = {uthread_async(gated_echo, (void *) 2L),
+                                    uthread_async(echo, (void *) 3L)};
+    if (futures[0] == nullptr || futures[1] == nullptr)
+    {
+        return EXIT_FAILURE;
+    }
+    int index = uthread_future_wait_any(futures, 2);
+    if (index != 1)
+    {
+        printf("wait_any returned %d\n", index);
+        return EXIT_FAILURE;
+    }
+    uthread_sem_post(&gate);
+    if (uthread_future_wait_all(futures, 2) != 0 ||
+        uthread_future_get(futures[0], &value) != 0 ||
+        value != (void *) 2L)
+    {
+        printf("wait_all: the gated task returned %p\n", value);
+        return EXIT_FAILURE;
+    }
+
+    // The continuation is handed the value of the future it follows.
+    uthread_future_t *next = uthread_future_then(futures[0], add,
+                                                 (void *) 10L);
+    if (next == nullptr || uthread_future_get(next, &value) != 0 ||
+        value != (void *) 12L)
+    {
+        printf("the continuation returned %p\n", value);
+        return EXIT_FAILURE;
+    }
+    uthread_future_release(next);
+    uthread_future_release(futures[0]);
+    uthread_future_release(futures[1]);
+
+    // Released futures are reused.
+    for (long i = 0; i < ROUNDS; ++i)
+    {
+        future = uthread_async(echo, (void *) i);
+        if (future == nullptr || uthread_future_get(future, &value) != 0 ||
+            value != (void *) i || uthread_future_release(future) != 0)
+        {
+            printf("round %ld failed\n", i);
+            return EXIT_FAILURE;
+        }
+    }
+
+    printf("ok\n");
+    return EXIT_SUCCESS;
+}
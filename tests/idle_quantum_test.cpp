@@ -0,0 +1,74 @@
+/*
+ * Checks that idle workers count the quantums that pass while no thread
+ * runs only once between them: a thread sleeping while every worker is
+ * idle sleeps for as long as it would with a single worker.
+ * Usage: idle_quantum_test [workers]. Exits with 0 on success.
+ */
+#include "uthreads.h"
+#include "uthreads_ext.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+// A quantum long enough for the idle workers to time out on their own.
+#define QUANTUM_USECS 20000
+// The number of quantums the main thread sleeps.
+#define SLEEP_QUANTUMS 20
+#define NSECS_PER_USEC 1000LL
+#define NSECS_PER_SECOND 1000000000LL
+
+/**
+* Reads the monotonic clock.
+* @return the time in nano-seconds.
+*/
+static long long now_nsecs(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec * NSECS_PER_SECOND + now.tv_nsec;
+}
+
+/**
+* Sleeps for a few quantums, and exits with how long it took.
+* @param arg unused.
+* @return None.
+*/
+static void sleeper(void *arg)
+{
+    (void) arg;
+    long long start = now_nsecs();
+    uthread_sleep(SLEEP_QUANTUMS);
+    uthread_exit((void *) (now_nsecs() - start));
+}
+
+int main(int argc, char **argv)
+{
+    int workers = argc > 1 ? atoi(argv[1]) : 1;
+    if ((workers == 1 ? uthread_init(QUANTUM_USECS) :
+         uthread_init_mp(QUANTUM_USECS, workers)) != 0)
+    {
+        return EXIT_FAILURE;
+    }
+
+    // The quantum the thread goes to sleep in may be almost over. The main
+    // thread may not sleep, but waits for the sleeping one, so that every
+    // worker is idle meanwhile.
+    void *result = nullptr;
+    int sleeping = uthread_spawn_arg(sleeper, nullptr);
+    if (sleeping < 0 || uthread_join(sleeping, &result) != 0)
+    {
+        return EXIT_FAILURE;
+    }
+    long long slept = (long long) result;
+    long long least = (SLEEP_QUANTUMS - 1) * QUANTUM_USECS * NSECS_PER_USEC;
+    if (slept < least)
+    {
+        printf("slept %lld usecs instead of at least %lld\n",
+               slept / NSECS_PER_USEC, least / NSECS_PER_USEC);
+        return EXIT_FAILURE;
+    }
+
+    printf("ok\n");
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,176 @@
+/*
+ * Checks joining and detaching: a join waits until the thread exits and
+ * collects its exit value (NULL for one that returned, or was terminated
+ * while joined), a thread that exited before it was joined keeps its value
+ * until then, and detached threads release their IDs as soon as they exit,
+ * so that spawning keeps working round after round.
+ * Usage: join_test [workers]. Exits with 0 on success.
+ */
+#include "uthreads.h"
+#include "uthreads_ext.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#define QUANTUM_USECS 10000
+// The number of quantums the exiting thread sleeps first.
+#define SLEEP_QUANTUMS 3
+// The number of rounds of detached threads.
+#define ROUNDS 3
+// The number of times the main thread lets the others run.
+#define YIELDS 100
+
+// The value the exiting thread exits with.
+static int exit_value;
+// The number of detached threads that ran.
+static volatile int detached_runs = 0;
+
+/**
+* Sleeps, and exits with exit_value.
+* @return None.
+*/
+static void sleeper(void)
+{
+    uthread_sleep(SLEEP_QUANTUMS);
+    uthread_exit(&exit_value);
+}
+
+/**
+* Exits with exit_value at once.
+* @return None.
+*/
+static void exiter(void)
+{
+    uthread_exit(&exit_value);
+}
+
+/**
+* Returns at once.
+* @return None.
+*/
+static void returner(void)
+{
+}
+
+/**
+* Waits until terminated.
+* @return None.
+*/
+static void blocker(void)
+{
+    uthread_block(uthread_get_tid());
+}
+
+/**
+* Joins the thread whose ID is in the array given, and keeps the result and
+* the exit value there.
+* @param arg the ID, the result and the exit value.
+* @return None.
+*/
+static void joiner(void *arg)
+{
+    long *join = static_cast<long *>(arg);
+    void *value = &exit_value;
+    join[1] = uthread_join((int) join[0], &value);
+    join[2] = (long) value;
+}
+
+/**
+* Counts its run.
+* @return None.
+*/
+static void detached(void)
+{
+    __atomic_add_fetch(&detached_runs, 1, __ATOMIC_RELAXED);
+}
+
+/**
+* Lets the other threads run.
+* @return None.
+*/
+static void let_run(void)
+{
+    for (int i = 0; i < YIELDS; ++i)
+    {
+        uthread_yield();
+    }
+}
+
+int main(int argc, char **argv)
+{
+    int workers = argc > 1 ? atoi(argv[1]) : 1;
+    if ((workers == 1 ? uthread_init(QUANTUM_USECS) :
+         uthread_init_mp(QUANTUM_USECS, workers)) != 0)
+    {
+        return EXIT_FAILURE;
+    }
+
+    // The join waits for the sleeping thread's exit value.
+    void *value = nullptr;
+    int before = uthread_get_total_quantums();
+    int tid = uthread_spawn(sleeper);
+    if (tid < 0 || uthread_join(tid, &value) != 0 || value != &exit_value ||
+        uthread_get_total_quantums() - before < SLEEP_QUANTUMS)
+    {
+        printf("the join returned %p after %d quantums\n", value,
+               uthread_get_total_quantums() - before);
+        return EXIT_FAILURE;
+    }
+
+    // A thread that exited keeps its value until joined, and a thread that
+    // returned or was terminated hands over NULL.
+    tid = uthread_spawn(exiter);
+    let_run();
+    value = nullptr;
+    if (tid < 0 || uthread_join(tid, &value) != 0 || value != &exit_value)
+    {
+        printf("the exited thread handed over %p\n", value);
+        return EXIT_FAILURE;
+    }
+    tid = uthread_spawn(returner);
+    value = &exit_value;
+    if (tid < 0 || uthread_join(tid, &value) != 0 || value != nullptr)
+    {
+        printf("the returning thread handed over %p\n", value);
+        return EXIT_FAILURE;
+    }
+    long join[3] = {uthread_spawn(blocker), -1, -1};
+    int joining = uthread_spawn_arg(joiner, join);
+    let_run();
+    if (join[0] < 0 || joining < 0 || uthread_terminate((int) join[0]) != 0 ||
+        uthread_join(joining, nullptr) != 0 || join[1] != 0 || join[2] != 0)
+    {
+        printf("the terminated thread handed over %ld\n", join[2]);
+        return EXIT_FAILURE;
+    }
+
+    // Detached threads release every ID they took, round after round.
+    for (int round = 0; round < ROUNDS; ++round)
+    {
+        for (int i = 0; i < MAX_THREAD_NUM - 1; ++i)
+        {
+            tid = uthread_spawn(detached);
+            if (tid < 0 || uthread_detach(tid) != 0)
+            {
+                printf("round %d: spawn %d failed\n", round, i);
+                return EXIT_FAILURE;
+            }
+        }
+        for (int i = 0; i < YIELDS &&
+                        detached_runs < (round + 1) * (MAX_THREAD_NUM - 1);
+             ++i)
+        {
+            let_run();
+        }
+        // The last of them exit.
+        let_run();
+    }
+    if (detached_runs != ROUNDS * (MAX_THREAD_NUM - 1))
+    {
+        printf("%d detached threads ran\n", detached_runs);
+        return EXIT_FAILURE;
+    }
+
+    printf("ok\n");
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,164 @@
+/*
+ * Checks the M:N mode: threads spawned by the main thread spread over the
+ * workers (the idle ones steal them), sleeping threads wake up wherever they
+ * are, and a thread running on another worker stops once blocked, goes on
+ * once resumed, and is gone once terminated.
+ * Usage: mp_test [workers]. Exits with 0 on success.
+ */
+#include "uthreads.h"
+#include "uthreads_ext.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+#define QUANTUM_USECS 10000
+// The number of threads spawned at once, and how long each of them runs.
+#define THREADS 20
+#define RUN_QUANTUMS 2
+// How long the main thread waits for the spinning thread to stop, or go on.
+#define SETTLE_QUANTUMS 10
+#define NSECS_PER_USEC 1000LL
+#define NSECS_PER_SECOND 1000000000LL
+
+// The kernel thread each thread ran on, and the number of threads done.
+static long kernel_threads[THREADS];
+static volatile int done = 0;
+// The steps the spinning thread made.
+static volatile long spins = 0;
+
+/**
+* Reads the monotonic clock.
+* @return the time in nano-seconds.
+*/
+static long long now_nsecs(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec * NSECS_PER_SECOND + now.tv_nsec;
+}
+
+/**
+* Runs for a number of quantums of wall-clock time.
+* @param num_quantums the number of quantums.
+* @return None.
+*/
+static void run_for(int num_quantums)
+{
+    long long end = now_nsecs() +
+                    num_quantums * QUANTUM_USECS * NSECS_PER_USEC;
+    while (now_nsecs() < end)
+    {
+    }
+}
+
+/**
+* Runs for a while, sleeps, and keeps the kernel thread it ran on.
+* @param arg the index of the thread.
+* @return None.
+*/
+static void runner(void *arg)
+{
+    long index = (long) arg;
+    run_for(RUN_QUANTUMS);
+    uthread_sleep(1);
+    kernel_threads[index] = syscall(SYS_gettid);
+    __atomic_add_fetch(&done, 1, __ATOMIC_RELAXED);
+}
+
+/**
+* Makes steps until terminated.
+* @return None.
+*/
+static void spinner(void)
+{
+    for (;;)
+    {
+        spins++;
+    }
+}
+
+int main(int argc, char **argv)
+{
+    int workers = argc > 1 ? atoi(argv[1]) : 1;
+    if ((workers == 1 ? uthread_init(QUANTUM_USECS) :
+         uthread_init_mp(QUANTUM_USECS, workers)) != 0)
+    {
+        return EXIT_FAILURE;
+    }
+
+    // Every thread runs, sleeps and completes, on more than one worker if
+    // there are several.
+    int tids[THREADS];
+    for (long i = 0; i < THREADS; ++i)
+    {
+        tids[i] = uthread_spawn_arg(runner, (void *) i);
+        if (tids[i] < 0)
+        {
+            return EXIT_FAILURE;
+        }
+    }
+    for (int i = 0; i < THREADS; ++i)
+    {
+        uthread_join(tids[i], nullptr);
+    }
+    bool spread = false;
+    for (int i = 1; i < THREADS; ++i)
+    {
+        spread = spread || kernel_threads[i] != kernel_threads[0];
+    }
+    if (done != THREADS || (workers > 1 && !spread))
+    {
+        printf("%d threads done, spread: %d\n", done, spread);
+        return EXIT_FAILURE;
+    }
+
+    // A blocked thread stops, a resumed one goes on, and a terminated one is
+    // gone.
+    int tid = uthread_spawn(spinner);
+    uthread_yield();
+    run_for(SETTLE_QUANTUMS);
+    if (tid < 0 || uthread_block(tid) != 0)
+    {
+        return EXIT_FAILURE;
+    }
+    run_for(SETTLE_QUANTUMS);
+    long blocked = spins;
+    run_for(SETTLE_QUANTUMS);
+    if (spins != blocked)
+    {
+        printf("the blocked thread made %ld steps\n", spins - blocked);
+        return EXIT_FAILURE;
+    }
+    if (uthread_resume(tid) != 0)
+    {
+        return EXIT_FAILURE;
+    }
+    for (int i = 0; i < SETTLE_QUANTUMS && spins == blocked; ++i)
+    {
+        uthread_yield();
+        run_for(1);
+    }
+    if (spins == blocked)
+    {
+        printf("the resumed thread made no steps\n");
+        return EXIT_FAILURE;
+    }
+    if (uthread_terminate(tid) != 0)
+    {
+        return EXIT_FAILURE;
+    }
+    run_for(SETTLE_QUANTUMS);
+    long terminated = spins;
+    run_for(SETTLE_QUANTUMS);
+    if (spins != terminated)
+    {
+        printf("the terminated thread is still there\n");
+        return EXIT_FAILURE;
+    }
+
+    printf("ok\n");
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,92 @@
+/*
+ * Checks the mutex: threads that contend for it (each yields while holding
+ * it) never hold it together and lose no update, trylock fails on a locked
+ * mutex, and a mutex is destroyed once no thread holds it.
+ * Usage: mutex_test [workers]. Exits with 0 on success.
+ */
+#include "uthreads.h"
+#include "uthreads_ext.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#define QUANTUM_USECS 10000
+// The number of contending threads, and how many times each locks.
+#define THREADS 8
+#define ITERATIONS 200
+
+static uthread_mutex_t mutex;
+// Updated while holding the mutex.
+static int counter = 0;
+static bool inside = false;
+// Set if two threads held the mutex together.
+static volatile bool overlapped = false;
+
+/**
+* Increments the counter ITERATIONS times, holding the mutex across a yield.
+* @return None.
+*/
+static void incrementer(void)
+{
+    for (int i = 0; i < ITERATIONS; ++i)
+    {
+        uthread_mutex_lock(&mutex);
+        if (inside)
+        {
+            overlapped = true;
+        }
+        inside = true;
+        int value = counter;
+        uthread_yield();
+        counter = value + 1;
+        inside = false;
+        uthread_mutex_unlock(&mutex);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    int workers = argc > 1 ? atoi(argv[1]) : 1;
+    if ((workers == 1 ? uthread_init(QUANTUM_USECS) :
+         uthread_init_mp(QUANTUM_USECS, workers)) != 0 ||
+        uthread_mutex_init(&mutex) != 0)
+    {
+        return EXIT_FAILURE;
+    }
+
+    // A locked mutex is not taken by trylock.
+    if (uthread_mutex_trylock(&mutex) != 0 ||
+        uthread_mutex_trylock(&mutex) != UTHREAD_BUSY ||
+        uthread_mutex_unlock(&mutex) != 0)
+    {
+        printf("trylock took a locked mutex\n");
+        return EXIT_FAILURE;
+    }
+
+    int tids[THREADS];
+    for (int i = 0; i < THREADS; ++i)
+    {
+        tids[i] = uthread_spawn(incrementer);
+        if (tids[i] < 0)
+        {
+            return EXIT_FAILURE;
+        }
+    }
+    for (int i = 0; i < THREADS; ++i)
+    {
+        uthread_join(tids[i], nullptr);
+    }
+    if (counter != THREADS * ITERATIONS || overlapped)
+    {
+        printf("counter %d of %d, overlapped: %d\n", counter,
+               THREADS * ITERATIONS, overlapped);
+        return EXIT_FAILURE;
+    }
+    if (uthread_mutex_destroy(&mutex) != 0)
+    {
+        return EXIT_FAILURE;
+    }
+
+    printf("ok\n");
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,166 @@
+/*
+ * Checks uthread_offload: a call runs on a helper kernel thread and hands
+ * its result and errno back, a thread terminated while its call is in
+ * progress leaves the call to complete, and once the calls of terminated
+ * threads take up every slot, a call is made on the calling kernel thread.
+ * Usage: offload_test [workers]. Exits with 0 on success.
+ */
+#include "uthreads.h"
+#include "uthreads_ext.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+// A quantum long enough for the blocking threads to offload their calls.
+#define QUANTUM_USECS 100000
+// The number of times the main thread lets the others run, or tries again.
+#define ATTEMPTS 1000
+// How long the main thread waits for the helpers at a time.
+#define WAIT_USECS 1000
+// The value the plain call returns.
+#define ANSWER 42
+
+// The pipe the blocking calls read from.
+static int pipe_fds[2];
+// The number of blocking threads that started.
+static volatile int started = 0;
+
+/**
+* A plain call: leaves errno at EAGAIN.
+* @param arg unused.
+* @return ANSWER.
+*/
+static long answer(void *arg)
+{
+    (void) arg;
+    errno = EAGAIN;
+    return ANSWER;
+}
+
+/**
+* Returns the kernel thread the call runs on.
+* @param arg unused.
+* @return its ID.
+*/
+static long kernel_thread(void *arg)
+{
+    (void) arg;
+    return syscall(SYS_gettid);
+}
+
+/**
+* Reads a byte from the pipe into the buffer given, which is on the stack
+* of the calling thread.
+* @param arg the buffer.
+* @return the result of read.
+*/
+static long read_byte(void *arg)
+{
+    return read(pipe_fds[0], arg, 1);
+}
+
+/**
+* Offloads a read from the pipe, which blocks until the main thread writes.
+* @return None.
+*/
+static void blocker(void)
+{
+    char byte;
+    __atomic_add_fetch(&started, 1, __ATOMIC_RELAXED);
+    uthread_offload(read_byte, &byte);
+}
+
+/**
+* Spawns blocking threads, lets them offload their calls, and terminates
+* them while the calls are in progress.
+* @param count the number of threads.
+* @return true on success, false otherwise.
+*/
+static bool spawn_and_terminate(int count)
+{
+    int tids[MAX_THREAD_NUM];
+    started = 0;
+    for (int i = 0; i < count; ++i)
+    {
+        tids[i] = uthread_spawn(blocker);
+        if (tids[i] < 0)
+        {
+            printf("spawn failed\n");
+            return false;
+        }
+    }
+    for (int i = 0; i < ATTEMPTS && started < count; ++i)
+    {
+        uthread_yield();
+    }
+    for (int i = 0; i < count; ++i)
+    {
+        uthread_yield();
+    }
+    for (int i = 0; i < count; ++i)
+    {
+        uthread_terminate(tids[i]);
+    }
+    return true;
+}
+
+int main(int argc, char **argv)
+{
+    int workers = argc > 1 ? atoi(argv[1]) : 1;
+    if ((workers == 1 ? uthread_init(QUANTUM_USECS) :
+         uthread_init_mp(QUANTUM_USECS, workers)) != 0 ||
+        pipe(pipe_fds) != 0)
+    {
+        return EXIT_FAILURE;
+    }
+
+    // A helper makes the call.
+    errno = 0;
+    long result = uthread_offload(answer, nullptr);
+    if (result != ANSWER || errno != EAGAIN)
+    {
+        printf("offload returned %ld, errno %d\n", result, errno);
+        return EXIT_FAILURE;
+    }
+
+    // The calls of the terminated threads take up every slot, the last one
+    // made after the first threads were gone, so that their IDs are reused.
+    if (!spawn_and_terminate(MAX_THREAD_NUM - 1) || !spawn_and_terminate(1))
+    {
+        return EXIT_FAILURE;
+    }
+    errno = 0;
+    result = uthread_offload(answer, nullptr);
+    if (result != ANSWER || errno != EAGAIN)
+    {
+        printf("full: offload returned %ld, errno %d\n", result, errno);
+        return EXIT_FAILURE;
+    }
+
+    // Once the calls complete, their slots are free again.
+    char bytes[MAX_THREAD_NUM] = {0};
+    if (write(pipe_fds[1], bytes, sizeof(bytes)) != (ssize_t) sizeof(bytes))
+    {
+        return EXIT_FAILURE;
+    }
+    bool helped = false;
+    for (int i = 0; i < ATTEMPTS && !helped; ++i)
+    {
+        // The helpers need the CPU to complete the calls.
+        usleep(WAIT_USECS);
+        uthread_yield();
+        long self = syscall(SYS_gettid);
+        helped = (uthread_offload(kernel_thread, nullptr) != self);
+    }
+    if (!helped)
+    {
+        printf("the slots of the terminated threads were not freed\n");
+        return EXIT_FAILURE;
+    }
+
+    printf("ok\n");
+    return EXIT_SUCCESS;
+}
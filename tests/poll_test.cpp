@@ -0,0 +1,138 @@
+/*
+ * Checks waiting for file descriptors: a thread reading an empty pipe waits
+ * until data is written, a poll times out, and a thread terminated while it
+ * waits stops counting as waiting, so that the quantum timer of the tickless
+ * mode stops once the main thread runs alone.
+ * Usage: poll_test [workers]. Exits with 0 on success.
+ */
+#include "uthreads.h"
+#include "uthreads_ext.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+// A short quantum, so that the timer would tick often while the main thread
+// spins.
+#define QUANTUM_USECS 10000
+// The number of quantums the main thread spins, and polls wait.
+#define SPIN_QUANTUMS 20
+#define POLL_QUANTUMS 2
+// The quantums that may start meanwhile: the timer may still expire.
+#define SLACK 2
+// The number of times the main thread lets the others run.
+#define YIELDS 100
+#define NSECS_PER_USEC 1000LL
+#define NSECS_PER_SECOND 1000000000LL
+
+// The pipe the threads read from.
+static int pipe_fds[2];
+// The byte the reading thread read, and whether it started.
+static volatile char byte_read = 0;
+static volatile int started = 0;
+
+/**
+* Reads the monotonic clock.
+* @return the time in nano-seconds.
+*/
+static long long now_nsecs(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec * NSECS_PER_SECOND + now.tv_nsec;
+}
+
+/**
+* Reads a byte from the pipe, waiting until one is written.
+* @return None.
+*/
+static void reader(void)
+{
+    char byte;
+    started = 1;
+    if (uthread_read(pipe_fds[0], &byte, 1) == 1)
+    {
+        byte_read = byte;
+    }
+}
+
+/**
+* Polls the empty pipe for a few quantums.
+* @param arg where the result goes.
+* @return None.
+*/
+static void poller(void *arg)
+{
+    *static_cast<int *>(arg) = uthread_poll_fd(pipe_fds[0], UTHREAD_POLL_IN,
+                                               POLL_QUANTUMS);
+}
+
+/**
+* Spawns a reading thread, and lets it start waiting.
+* @return its ID.
+*/
+static int spawn_waiting_reader(void)
+{
+    started = 0;
+    int tid = uthread_spawn(reader);
+    for (int i = 0; i < YIELDS; ++i)
+    {
+        uthread_yield();
+    }
+    return started ? tid : -1;
+}
+
+int main(int argc, char **argv)
+{
+    int workers = argc > 1 ? atoi(argv[1]) : 1;
+    if ((workers == 1 ? uthread_init(QUANTUM_USECS) :
+         uthread_init_mp(QUANTUM_USECS, workers)) != 0 ||
+        pipe(pipe_fds) != 0)
+    {
+        return EXIT_FAILURE;
+    }
+
+    // A waiting reader gets the byte written.
+    int tid = spawn_waiting_reader();
+    if (tid < 0 || write(pipe_fds[1], "x", 1) != 1 ||
+        uthread_join(tid, nullptr) != 0 || byte_read != 'x')
+    {
+        printf("the reader did not read the byte written\n");
+        return EXIT_FAILURE;
+    }
+
+    // A poll of the empty pipe times out.
+    int result = 0;
+    tid = uthread_spawn_arg(poller, &result);
+    if (tid < 0 || uthread_join(tid, nullptr) != 0 ||
+        result != UTHREAD_TIMEDOUT)
+    {
+        printf("poll returned %d\n", result);
+        return EXIT_FAILURE;
+    }
+
+    // Once the waiting reader is gone, the main thread runs alone.
+    tid = spawn_waiting_reader();
+    if (tid < 0 || uthread_terminate(tid) != 0 ||
+        uthread_set_tickless(1) != 0)
+    {
+        return EXIT_FAILURE;
+    }
+    uthread_yield();
+    int before = uthread_get_total_quantums();
+    long long end = now_nsecs() +
+                    SPIN_QUANTUMS * QUANTUM_USECS * NSECS_PER_USEC;
+    while (now_nsecs() < end)
+    {
+    }
+    int started_quantums = uthread_get_total_quantums() - before;
+    if (started_quantums > SLACK)
+    {
+        printf("alone: %d quantums started\n", started_quantums);
+        return EXIT_FAILURE;
+    }
+
+    printf("ok\n");
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,108 @@
+/*
+ * Checks that the callable a thread keeps (see uthread_spawn) is destroyed
+ * whether its thread returns, exits, or is terminated (before it started, or
+ * while it waits), by counting the owners of a shared_ptr it captures.
+ * Usage: spawn_closure_test [workers]. Exits with 0 on success.
+ */
+#include "uthreads.h"
+#include "uthreads_ext.h"
+
+#include <memory>
+#include <stdio.h>
+#include <stdlib.h>
+
+// The number of rounds, and the number of threads of each kind per round.
+#define ROUNDS 20
+#define THREADS 10
+
+// The number of threads that started in the current round.
+static volatile int started = 0;
+
+/**
+* Counts a thread that started.
+* @return None.
+*/
+static void count_start(void)
+{
+    __atomic_add_fetch(&started, 1, __ATOMIC_RELAXED);
+}
+
+/**
+* Lets the other threads run for a while.
+* @return None.
+*/
+static void yield_for_a_while(void)
+{
+    for (int i = 0; i < 4 * THREADS; ++i)
+    {
+        uthread_yield();
+    }
+}
+
+int main(int argc, char **argv)
+{
+    int workers = argc > 1 ? atoi(argv[1]) : 1;
+    if ((workers == 1 ? uthread_init(1000) : uthread_init_mp(1000, workers))
+        != 0)
+    {
+        return EXIT_FAILURE;
+    }
+
+    std::shared_ptr<int> shared = std::make_shared<int>(0);
+    for (int round = 0; round < ROUNDS; ++round)
+    {
+        int waiting[THREADS], exiting[THREADS], returning[THREADS];
+        started = 0;
+        for (int i = 0; i < THREADS; ++i)
+        {
+            waiting[i] = uthread_spawn([shared]() {
+                count_start();
+                for (;;)
+                {
+                    uthread_sleep(1000);
+                }
+            });
+            exiting[i] = uthread_spawn([shared]() {
+                count_start();
+                uthread_exit(nullptr);
+            });
+            returning[i] = uthread_spawn([shared]() {
+                count_start();
+                uthread_yield();
+            });
+        }
+
+        // Half of the waiting threads are terminated before they start, the
+        // other half once they all wait.
+        for (int i = 0; i < THREADS / 2; ++i)
+        {
+            uthread_terminate(waiting[i]);
+        }
+        while (started < 3 * THREADS - THREADS / 2)
+        {
+            uthread_yield();
+        }
+        for (int i = THREADS / 2; i < THREADS; ++i)
+        {
+            uthread_yield();
+            uthread_terminate(waiting[i]);
+        }
+        for (int i = 0; i < THREADS; ++i)
+        {
+            uthread_join(exiting[i], nullptr);
+            uthread_join(returning[i], nullptr);
+        }
+        // Threads terminated while RUNNING on another worker are deleted
+        // once they stop.
+        yield_for_a_while();
+
+        if (shared.use_count() != 1)
+        {
+            printf("round %d: use_count %ld\n", round, shared.use_count());
+            return EXIT_FAILURE;
+        }
+    }
+
+    printf("ok\n");
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,154 @@
+/*
+ * Checks uthread-local storage: each thread sees the value it set, across
+ * switches (and workers), and the destructor of a key is called once with
+ * the value a thread left, whether it returned, exited or was terminated,
+ * and not for a thread that left none.
+ * Usage: specific_test [workers]. Exits with 0 on success.
+ */
+#include "uthreads.h"
+#include "uthreads_ext.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#define QUANTUM_USECS 10000
+// The number of threads that check their values, and how often.
+#define THREADS 10
+#define CHECKS 100
+// The number of times the main thread lets the others run.
+#define YIELDS 100
+
+static uthread_key_t key;
+// The values the threads set, and the number of times the destructor was
+// called with each of them.
+static int values[THREADS + 2];
+static volatile int destroyed[THREADS + 2];
+// Set if a thread saw a value other than its own, or if the destructor was
+// called with NULL.
+static volatile bool mixed = false;
+static volatile bool destroyed_null = false;
+// Set once the blocking thread set its value.
+static volatile bool blocker_set = false;
+
+/**
+* Counts a call with a value.
+* @param value the value.
+* @return None.
+*/
+static void destructor(void *value)
+{
+    if (value == nullptr)
+    {
+        destroyed_null = true;
+        return;
+    }
+    __atomic_add_fetch(&destroyed[static_cast<int *>(value) - values], 1,
+                       __ATOMIC_RELAXED);
+}
+
+/**
+* Sets its value, and checks it across yields.
+* @param arg the index of the thread.
+* @return None.
+*/
+static void checker(void *arg)
+{
+    long index = (long) arg;
+    if (uthread_getspecific(key) != nullptr)
+    {
+        mixed = true;
+    }
+    uthread_setspecific(key, &values[index]);
+    for (int i = 0; i < CHECKS; ++i)
+    {
+        uthread_yield();
+        if (uthread_getspecific(key) != &values[index])
+        {
+            mixed = true;
+        }
+    }
+}
+
+/**
+* Sets its value, and exits.
+* @param arg the index of the thread.
+* @return None.
+*/
+static void exiter(void *arg)
+{
+    uthread_setspecific(key, &values[(long) arg]);
+    uthread_exit(nullptr);
+}
+
+/**
+* Sets its value, and waits until terminated.
+* @param arg the index of the thread.
+* @return None.
+*/
+static void blocker(void *arg)
+{
+    uthread_setspecific(key, &values[(long) arg]);
+    blocker_set = true;
+    uthread_block(uthread_get_tid());
+}
+
+/**
+* Sets no value.
+* @param arg unused.
+* @return None.
+*/
+static void idler(void *arg)
+{
+    (void) arg;
+}
+
+int main(int argc, char **argv)
+{
+    int workers = argc > 1 ? atoi(argv[1]) : 1;
+    if ((workers == 1 ? uthread_init(QUANTUM_USECS) :
+         uthread_init_mp(QUANTUM_USECS, workers)) != 0 ||
+        uthread_key_create(&key, destructor) != 0)
+    {
+        return EXIT_FAILURE;
+    }
+
+    int tids[THREADS];
+    for (long i = 0; i < THREADS; ++i)
+    {
+        tids[i] = uthread_spawn_arg(checker, (void *) i);
+    }
+    for (int i = 0; i < THREADS; ++i)
+    {
+        uthread_join(tids[i], nullptr);
+    }
+    int exiting = uthread_spawn_arg(exiter, (void *) THREADS);
+    int blocking = uthread_spawn_arg(blocker, (void *) (THREADS + 1));
+    int idling = uthread_spawn_arg(idler, nullptr);
+    while (!blocker_set)
+    {
+        uthread_yield();
+    }
+    for (int i = 0; i < YIELDS; ++i)
+    {
+        uthread_yield();
+    }
+    if (uthread_join(exiting, nullptr) != 0 ||
+        uthread_terminate(blocking) != 0 ||
+        uthread_join(idling, nullptr) != 0)
+    {
+        return EXIT_FAILURE;
+    }
+
+    for (int i = 0; i < THREADS + 2; ++i)
+    {
+        if (destroyed[i] != 1 || mixed || destroyed_null)
+        {
+            printf("value %d destroyed %d times, mixed: %d, null: %d\n", i,
+                   destroyed[i], mixed, destroyed_null);
+            return EXIT_FAILURE;
+        }
+    }
+
+    printf("ok\n");
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,174 @@
+/*
+ * Checks that tasks wait for a mutex or a semaphore themselves. Every thread
+ * slot is taken, so that no other thread could wait in a task's place: tasks
+ * that find a mutex held by another task of the same thread take it in the
+ * order they came, and tasks acquiring a semaphore get the units another
+ * thread posts while the tasks' thread waits.
+ * Usage: task_test [workers]. Exits with 0 on success.
+ */
+#include "uthreads.h"
+#include "uthreads_ext.h"
+#include "uthread_task.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#define QUANTUM_USECS 10000
+// The number of tasks that wait for the mutex, and for the semaphore.
+#define WAITERS 10
+// The threads besides the fillers: the main one, the tasks' and the poster.
+#define OTHER_THREADS 3
+
+// The mutex the tasks take, and the semaphores the tasks acquire and the
+// fillers wait on.
+static uthread_mutex_t mutex = UTHREAD_MUTEX_INITIALIZER;
+static uthread_sem_t units;
+static uthread_sem_t release;
+// Set once the tasks acquiring the semaphore were spawned.
+static volatile int spawned = 0;
+// The tasks that took the mutex, and whether one of them holds it.
+static int locked = 0;
+static bool inside = false;
+// The tasks that acquired the semaphore.
+static int acquired = 0;
+// Set if a task took the mutex out of turn, or while another held it.
+static bool out_of_turn = false;
+
+/**
+* Takes the mutex, and holds it for a while.
+* @param index the order the task came in.
+* @return None.
+*/
+static uthread::task<> locker(int index)
+{
+    co_await uthread::lock(&mutex);
+    if (index != locked || inside)
+    {
+        out_of_turn = true;
+    }
+    inside = true;
+    co_await uthread::yield();
+    inside = false;
+    locked++;
+    uthread_mutex_unlock(&mutex);
+}
+
+/**
+* Takes the mutex, and releases it once the lockers wait for it.
+* @return None.
+*/
+static uthread::task<> holder()
+{
+    co_await uthread::lock(&mutex);
+    for (int i = 0; i < WAITERS; ++i)
+    {
+        co_await uthread::spawn(locker(i));
+    }
+    co_await uthread::sleep(1);
+    uthread_mutex_unlock(&mutex);
+}
+
+/**
+* Acquires a unit of the semaphore.
+* @return None.
+*/
+static uthread::task<> acquirer()
+{
+    co_await uthread::acquire(&units);
+    acquired++;
+}
+
+/**
+* Spawns the tasks.
+* @return None.
+*/
+static uthread::task<> root()
+{
+    co_await uthread::spawn(holder());
+    for (int i = 0; i < WAITERS; ++i)
+    {
+        co_await uthread::spawn(acquirer());
+    }
+    spawned = 1;
+}
+
+/**
+* Runs the tasks.
+* @return None.
+*/
+static void run_tasks(void)
+{
+    uthread::run(root());
+}
+
+/**
+* Posts a unit of the semaphore for each acquiring task.
+* @return None.
+*/
+static void poster(void)
+{
+    while (!spawned)
+    {
+        uthread_yield();
+    }
+    for (int i = 0; i < WAITERS; ++i)
+    {
+        uthread_yield();
+        uthread_sem_post(&units);
+    }
+}
+
+/**
+* Takes up a thread slot until released.
+* @return None.
+*/
+static void filler(void)
+{
+    uthread_sem_wait(&release);
+}
+
+int main(int argc, char **argv)
+{
+    int workers = argc > 1 ? atoi(argv[1]) : 1;
+    if ((workers == 1 ? uthread_init(QUANTUM_USECS) :
+         uthread_init_mp(QUANTUM_USECS, workers)) != 0 ||
+        uthread_sem_init(&units, 0) != 0 ||
+        uthread_sem_init(&release, 0) != 0)
+    {
+        return EXIT_FAILURE;
+    }
+
+    int running = uthread_spawn(run_tasks);
+    int posting = uthread_spawn(poster);
+    int fillers[MAX_THREAD_NUM];
+    for (int i = 0; i < MAX_THREAD_NUM - OTHER_THREADS; ++i)
+    {
+        fillers[i] = uthread_spawn(filler);
+        if (fillers[i] < 0)
+        {
+            return EXIT_FAILURE;
+        }
+    }
+    if (running < 0 || posting < 0 || uthread_join(running, nullptr) != 0 ||
+        uthread_join(posting, nullptr) != 0)
+    {
+        return EXIT_FAILURE;
+    }
+    for (int i = 0; i < MAX_THREAD_NUM - OTHER_THREADS; ++i)
+    {
+        uthread_sem_post(&release);
+    }
+    for (int i = 0; i < MAX_THREAD_NUM - OTHER_THREADS; ++i)
+    {
+        uthread_join(fillers[i], nullptr);
+    }
+
+    if (locked != WAITERS || acquired != WAITERS || out_of_turn)
+    {
+        printf("%d tasks took the mutex (out of turn: %d), %d acquired\n",
+               locked, out_of_turn, acquired);
+        return EXIT_FAILURE;
+    }
+    printf("ok\n");
+    return EXIT_SUCCESS;
+}
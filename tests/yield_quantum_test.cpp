@@ -0,0 +1,119 @@
+/*
+ * Checks that uthread_yield and uthread_yield_to hand the rest of the
+ * current quantum over instead of starting a new one: yielding, alone or
+ * to another thread, leaves the total quantum count and the wake up time of
+ * a sleeping thread alone.
+ * Usage: yield_quantum_test [workers]. Exits with 0 on success.
+ */
+#include "uthreads.h"
+#include "uthreads_ext.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+// A quantum long enough for the test to run within a few of them.
+#define QUANTUM_USECS 200000
+// The number of yields of each kind.
+#define YIELDS 1000
+// The number of quantums the sleeping thread sleeps.
+#define SLEEP_QUANTUMS 5
+// The quantums that may start meanwhile: the timer may still expire.
+#define SLACK 2
+
+// Set once the sleeping thread woke up.
+static volatile int woke_up = 0;
+// Set to stop the yielding thread.
+static volatile int stop = 0;
+
+/**
+* Yields until stopped.
+* @return None.
+*/
+static void yielder(void)
+{
+    while (!stop)
+    {
+        uthread_yield();
+    }
+}
+
+/**
+* Sleeps for a few quantums.
+* @return None.
+*/
+static void sleeper(void)
+{
+    uthread_sleep(SLEEP_QUANTUMS);
+    woke_up = 1;
+}
+
+/**
+* Checks how many quantums started during a phase of the test.
+* @param phase the name of the phase.
+* @param before the total quantum count before it.
+* @return true if few enough did, false otherwise.
+*/
+static bool check(const char *phase, int before)
+{
+    int started = uthread_get_total_quantums() - before;
+    if (started > SLACK)
+    {
+        printf("%s: %d quantums started\n", phase, started);
+        return false;
+    }
+    return true;
+}
+
+int main(int argc, char **argv)
+{
+    int workers = argc > 1 ? atoi(argv[1]) : 1;
+    if ((workers == 1 ? uthread_init(QUANTUM_USECS) :
+         uthread_init_mp(QUANTUM_USECS, workers)) != 0)
+    {
+        return EXIT_FAILURE;
+    }
+
+    // Alone, a yield keeps running the calling thread.
+    int before = uthread_get_total_quantums();
+    for (int i = 0; i < YIELDS; ++i)
+    {
+        uthread_yield();
+    }
+    if (!check("alone", before))
+    {
+        return EXIT_FAILURE;
+    }
+
+    // With a thread to yield to, and a sleeping one.
+    int sleeping = uthread_spawn(sleeper);
+    int yielding = uthread_spawn(yielder);
+    while (uthread_get_time_until_wakeup(sleeping) == 0 && !woke_up)
+    {
+        uthread_yield();
+    }
+    before = uthread_get_total_quantums();
+    for (int i = 0; i < YIELDS; ++i)
+    {
+        uthread_yield();
+        // With several workers, the thread may be running on another one.
+        if (workers == 1)
+        {
+            uthread_yield_to(yielding);
+        }
+    }
+    if (!check("with others", before))
+    {
+        return EXIT_FAILURE;
+    }
+    if (woke_up)
+    {
+        printf("the sleeping thread woke up early\n");
+        return EXIT_FAILURE;
+    }
+
+    stop = 1;
+    uthread_terminate(sleeping);
+    uthread_join(yielding, nullptr);
+    printf("ok\n");
+    return EXIT_SUCCESS;
+}
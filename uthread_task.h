@@ -0,0 +1,654 @@
+#ifndef EX2_UTHREAD_TASK_H
+#define EX2_UTHREAD_TASK_H
+
+#include "TaskRunner.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <new>
+#include <unistd.h>
+#include <utility>
+
+/*
+ * C++20 coroutine tasks on top of the thread library (built with
+ * -std=gnu++20, see the uthreads20 target of the Makefile). A task is a
+ * coroutine returning uthread::task<T>: it starts once awaited (or spawned,
+ * or run), and switching between tasks is a return to the loop of the
+ * thread running them, with no context switch and no system call. Tasks run
+ * on the stack of the thread that runs them (see uthread::run), and their
+ * frames come from a pool of the worker (see uthread_frame_alloc). While a
+ * task waits, for a number of quantums, a file descriptor, a future or a
+ * lock, the other tasks of the thread run, and the thread only waits
+ * (BLOCKED) once none of them can. Tasks must not call the blocking
+ * uthread_* functions themselves: they await the awaitables below instead.
+ *
+ *     uthread::task<int> child() { co_await uthread::sleep(2); co_return 1; }
+ *     uthread::task<int> parent() { co_return co_await child() + 1; }
+ *     int value = uthread::run(parent());
+ */
+namespace uthread
+{
+
+template <typename T>
+class task;
+
+/*
+ * The value a task completes with, kept in its promise.
+ */
+template <typename T>
+class TaskValue
+{
+public:
+
+    /**
+     * D-tor. Destroys the value, if the task completed with one.
+     */
+    ~TaskValue()
+    {
+        if (_hasValue) {
+            reinterpret_cast<T *>(_storage)->~T();
+        }
+    }
+
+    /**
+     * Completes the task with a value (co_return).
+     * @param value the value.
+     * @return None.
+     */
+    template <typename V>
+    void return_value(V &&value)
+    {
+        new (_storage) T(std::forward<V>(value));
+        _hasValue = true;
+    }
+
+protected:
+
+    /**
+     * Takes the value of the completed task.
+     * @return the value.
+     */
+    T _take()
+    {
+        return std::move(*reinterpret_cast<T *>(_storage));
+    }
+
+private:
+
+    alignas(T) unsigned char _storage[sizeof(T)];
+    bool _hasValue = false;
+};
+
+/*
+ * A task that completes with no value.
+ */
+template <>
+class TaskValue<void>
+{
+public:
+
+    /**
+     * Completes the task (co_return, or the end of the coroutine).
+     * @return None.
+     */
+    void return_void()
+    {
+    }
+
+protected:
+
+    /**
+     * Takes the value of the completed task, which is none.
+     * @return None.
+     */
+    void _take()
+    {
+    }
+};
+
+/*
+ * A coroutine that completes with a value of type T (or none), which the
+ * task awaiting it is resumed with. An exception the coroutine ends with is
+ * rethrown to it. The task object owns the frame, unless it was spawned.
+ */
+template <typename T = void>
+class task
+{
+public:
+
+    /*
+     * The promise of the task.
+     */
+    struct promise_type : TaskPromise, TaskValue<T>
+    {
+        /**
+         * Creates the task object of the coroutine.
+         * @return the task.
+         */
+        task get_return_object()
+        {
+            handle = std::coroutine_handle<promise_type>::from_promise(*this);
+            return task(this);
+        }
+
+        /**
+         * Takes the value of the completed task, rethrowing its exception.
+         * @return the value.
+         */
+        T result()
+        {
+            if (exception) {
+                std::rethrow_exception(exception);
+            }
+            return this->_take();
+        }
+    };
+
+    /*
+     * Runs the awaited task, and resumes the awaiting one with its value.
+     */
+    class awaiter
+    {
+    public:
+
+        explicit awaiter(promise_type *child)
+        : _child(child)
+        {
+        }
+
+        bool await_ready() noexcept
+        {
+            return false;
+        }
+
+        /**
+         * Hands off to the awaited task, which hands back once it
+         * completes.
+         * @param parent the awaiting task.
+         * @return None.
+         */
+        template <typename Promise>
+        void await_suspend(std::coroutine_handle<Promise> parent) noexcept
+        {
+            _child->runner = parent.promise().runner;
+            _child->continuation = &parent.promise();
+            _child->runner->handOff(_child);
+        }
+
+        T await_resume()
+        {
+            return _child->result();
+        }
+
+    private:
+
+        promise_type *_child;
+    };
+
+    task(task &&other) noexcept
+    : _promise(other._promise)
+    {
+        other._promise = nullptr;
+    }
+
+    task(const task &) = delete;
+    task &operator=(const task &) = delete;
+
+    /**
+     * D-tor. Destroys the frame the task owns.
+     */
+    ~task()
+    {
+        if (_promise != nullptr) {
+            _promise->handle.destroy();
+        }
+    }
+
+    /**
+     * Awaits the task: it runs, and the awaiting task is resumed with its
+     * value once it completes.
+     * @return the awaiter.
+     */
+    awaiter operator co_await() && noexcept
+    {
+        return awaiter(_promise);
+    }
+
+    /**
+     * Getter for the promise of the task.
+     * @return the promise.
+     */
+    promise_type *promise() const
+    {
+        return _promise;
+    }
+
+    /**
+     * Gives the frame up, to a runner that destroys it once the task
+     * completes.
+     * @return the promise.
+     */
+    promise_type *release()
+    {
+        promise_type *promise = _promise;
+        _promise = nullptr;
+        return promise;
+    }
+
+private:
+
+    explicit task(promise_type *promise)
+    : _promise(promise)
+    {
+    }
+
+    promise_type *_promise;
+};
+
+/**
+ * Runs a task on the calling thread, with the tasks it spawns, until all of
+ * them completed.
+ * @param root the task.
+ * @return the value of the task (its exception is rethrown).
+ */
+template <typename T>
+T run(task<T> root)
+{
+    {
+        TaskRunner runner;
+        runner.run(root.promise());
+    }
+    return root.promise()->result();
+}
+
+/*
+ * Awaiting a spawn starts a task that runs detached, next to the awaiting
+ * one, which continues at once. Its value and exception are dropped.
+ */
+class spawn
+{
+public:
+
+    template <typename T>
+    explicit spawn(task<T> &&child)
+    : _child(child.release())
+    {
+    }
+
+    spawn(const spawn &) = delete;
+    spawn &operator=(const spawn &) = delete;
+
+    /**
+     * D-tor. Destroys a task that was never spawned.
+     */
+    ~spawn()
+    {
+        if (_child != nullptr) {
+            _child->handle.destroy();
+        }
+    }
+
+    bool await_ready() noexcept
+    {
+        return false;
+    }
+
+    template <typename Promise>
+    bool await_suspend(std::coroutine_handle<Promise> parent) noexcept
+    {
+        parent.promise().runner->spawn(_child);
+        _child = nullptr;
+        return false;
+    }
+
+    void await_resume() noexcept
+    {
+    }
+
+private:
+
+    TaskPromise *_child;
+};
+
+/*
+ * Awaiting a yield lets the other ready tasks of the thread run first.
+ */
+class yield
+{
+public:
+
+    bool await_ready() noexcept
+    {
+        return false;
+    }
+
+    template <typename Promise>
+    void await_suspend(std::coroutine_handle<Promise> parent) noexcept
+    {
+        parent.promise().runner->schedule(&parent.promise());
+    }
+
+    void await_resume() noexcept
+    {
+    }
+};
+
+/*
+ * Awaiting a sleep suspends the task for a number of quantums (counted like
+ * uthread_get_total_quantums), while the other tasks run.
+ */
+class sleep
+{
+public:
+
+    explicit sleep(int numQuantums)
+    : _numQuantums(numQuantums)
+    {
+    }
+
+    bool await_ready() noexcept
+    {
+        return _numQuantums <= 0;
+    }
+
+    template <typename Promise>
+    void await_suspend(std::coroutine_handle<Promise> parent) noexcept
+    {
+        parent.promise().runner->sleep(&parent.promise(), _numQuantums);
+    }
+
+    void await_resume() noexcept
+    {
+    }
+
+private:
+
+    int _numQuantums;
+};
+
+/*
+ * Awaiting a readable (or writable) suspends the task until a file
+ * descriptor can be read from (or written to) without blocking. It resumes
+ * with 0, or with -1 and errno set if the descriptor can not be waited for.
+ */
+class readable
+{
+public:
+
+    explicit readable(int fd, bool write = false)
+    : _fd(fd),
+      _write(write),
+      _error(0)
+    {
+    }
+
+    bool await_ready() noexcept
+    {
+        return false;
+    }
+
+    template <typename Promise>
+    bool await_suspend(std::coroutine_handle<Promise> parent) noexcept
+    {
+        if (parent.promise().runner->waitForFd(&parent.promise(), _fd,
+                                               _write) == -1) {
+            _error = errno;
+            return false;
+        }
+        return true;
+    }
+
+    int await_resume() noexcept
+    {
+        if (_error != 0) {
+            errno = _error;
+            return -1;
+        }
+        return 0;
+    }
+
+private:
+
+    int _fd;
+    bool _write;
+    int _error;
+};
+
+class writable : public readable
+{
+public:
+
+    explicit writable(int fd)
+    : readable(fd, true)
+    {
+    }
+};
+
+/*
+ * Awaiting a get suspends the task until a future (see uthread_async) is
+ * complete, and resumes it with its value. The future is not released.
+ */
+class get
+{
+public:
+
+    explicit get(uthread_future_t *future)
+    : _future(future),
+      _value(nullptr),
+      _task(nullptr)
+    {
+    }
+
+    bool await_ready() noexcept
+    {
+        return false;
+    }
+
+    /**
+     * Chains a continuation to the future, which wakes the task up.
+     * @param parent the awaiting task.
+     * @return true if it waits, false if it continues at once.
+     */
+    template <typename Promise>
+    bool await_suspend(std::coroutine_handle<Promise> parent) noexcept
+    {
+        _task = &parent.promise();
+        uthread_future_t *next = uthread_future_then(_future, &get::_complete,
+                                                     this);
+        if (next == nullptr) {
+            // Only a complete future fails to take a continuation (when no
+            // thread is left to run it), so getting it does not wait.
+            uthread_future_get(_future, &_value);
+            return false;
+        }
+        uthread_future_release(next);
+        return true;
+    }
+
+    void *await_resume() noexcept
+    {
+        return _value;
+    }
+
+private:
+
+    uthread_future_t *_future;
+    void *_value;
+    TaskPromise *_task;
+
+    /**
+     * The continuation: keeps the value, and wakes the task up.
+     * @param value the value of the future.
+     * @param arg the awaiter.
+     * @return None.
+     */
+    static void *_complete(void *value, void *arg)
+    {
+        get *self = static_cast<get *>(arg);
+        self->_value = value;
+        TaskPromise *task = self->_task;
+        task->runner->wake(task);
+        return nullptr;
+    }
+};
+
+/*
+ * Takes a mutex or decrements a semaphore. If that can not be done at once,
+ * the task itself waits for it (see uthread_waiter_t), and is woken up once
+ * the mutex or a unit is handed over to it.
+ */
+class blocking
+{
+public:
+
+    typedef int (*Attempt)(void *object, uthread_waiter_t *waiter);
+
+    blocking(void *object, Attempt attempt)
+    : _object(object),
+      _attempt(attempt),
+      _task(nullptr)
+    {
+    }
+
+    bool await_ready() noexcept
+    {
+        return false;
+    }
+
+    /**
+     * Takes the mutex or the unit, or makes the task wait for it.
+     * @param parent the awaiting task.
+     * @return true if it waits, false if it continues at once.
+     */
+    template <typename Promise>
+    bool await_suspend(std::coroutine_handle<Promise> parent) noexcept
+    {
+        _task = &parent.promise();
+        _waiter.wake = &blocking::_wake;
+        _waiter.arg = this;
+        // The runner resumes the task only once it suspended, even if it is
+        // woken up at once.
+        return _attempt(_object, &_waiter) == UTHREAD_BUSY;
+    }
+
+    void await_resume() noexcept
+    {
+    }
+
+private:
+
+    void *_object;
+    Attempt _attempt;
+    TaskPromise *_task;
+    uthread_waiter_t _waiter;
+
+    /**
+     * Wakes the task up, once the mutex or a unit was handed over to it.
+     * @param arg the awaiter.
+     * @return None.
+     */
+    static void _wake(void *arg)
+    {
+        TaskPromise *task = static_cast<blocking *>(arg)->_task;
+        task->runner->wake(task);
+    }
+};
+
+/*
+ * Awaiting a lock takes a mutex (see blocking), which the task releases
+ * with uthread_mutex_unlock.
+ */
+class lock : public blocking
+{
+public:
+
+    explicit lock(uthread_mutex_t *mutex)
+    : blocking(mutex, &lock::_lock)
+    {
+    }
+
+private:
+
+    static int _lock(void *mutex, uthread_waiter_t *waiter)
+    {
+        return uthread_mutex_lock_waiter(static_cast<uthread_mutex_t *>(mutex),
+                                         waiter);
+    }
+};
+
+/*
+ * Awaiting an acquire decrements a semaphore (see blocking), which the task
+ * increments with uthread_sem_post.
+ */
+class acquire : public blocking
+{
+public:
+
+    explicit acquire(uthread_sem_t *sem)
+    : blocking(sem, &acquire::_wait)
+    {
+    }
+
+private:
+
+    static int _wait(void *sem, uthread_waiter_t *waiter)
+    {
+        return uthread_sem_wait_waiter(static_cast<uthread_sem_t *>(sem),
+                                       waiter);
+    }
+};
+
+/**
+ * Reads up to count bytes from fd into buf like read(2), suspending the
+ * task while nothing can be read. fd is put in non-blocking mode.
+ * @param fd the file descriptor.
+ * @param buf the buffer.
+ * @param count the number of bytes.
+ * @return the number of bytes read, 0 at the end of the file, or -1 with
+ * errno set.
+ */
+inline task<ssize_t> read(int fd, void *buf, size_t count)
+{
+    int flags = fcntl(fd, F_GETFL);
+    if (flags != -1 && !(flags & O_NONBLOCK)) {
+        fcntl(fd, F_SETFL, flags | O_NONBLOCK);
+    }
+    for (;;) {
+        ssize_t result = ::read(fd, buf, count);
+        if (result != -1 || (errno != EAGAIN && errno != EWOULDBLOCK)) {
+            co_return result;
+        }
+        if (co_await readable(fd) == -1) {
+            co_return -1;
+        }
+    }
+}
+
+/**
+ * Writes up to count bytes from buf to fd like write(2), suspending the
+ * task while fd is not writable. fd is put in non-blocking mode.
+ * @param fd the file descriptor.
+ * @param buf the buffer.
+ * @param count the number of bytes.
+ * @return the number of bytes written, or -1 with errno set.
+ */
+inline task<ssize_t> write(int fd, const void *buf, size_t count)
+{
+    int flags = fcntl(fd, F_GETFL);
+    if (flags != -1 && !(flags & O_NONBLOCK)) {
+        fcntl(fd, F_SETFL, flags | O_NONBLOCK);
+    }
+    for (;;) {
+        ssize_t result = ::write(fd, buf, count);
+        if (result != -1 || (errno != EAGAIN && errno != EWOULDBLOCK)) {
+            co_return result;
+        }
+        if (co_await writable(fd) == -1) {
+            co_return -1;
+        }
+    }
+}
+
+} // namespace uthread
+
+#endif //EX2_UTHREAD_TASK_H
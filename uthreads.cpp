@@ -1,19 +1,90 @@
 #include "uthreads.h"
+#include "uthreads_ext.h"
 #include "Scheduler.h"
+#include "Channel.h"
+#include "Future.h"
+#include "FramePool.h"
 
 #include <sys/time.h>
-#include <bits/sigset.h>
+#include <sys/syscall.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <signal.h>
+#include <limits.h>
+#include <stdint.h>
+#include <time.h>
+#include <unistd.h>
+
+// The state of each worker (kernel thread) that is only touched by the
+// worker itself is thread-local. It is volatile and accessed straight
+// through the thread pointer, so that a Thread that moved to another worker
+// during a context switch reaches the state of the new one, and setting a
+// flag is a single instruction a signal cannot split.
+#define WORKER_LOCAL __thread __attribute__((tls_model("initial-exec")))
 
 // sigaction and timers
 struct sigaction sa;
 struct itimerval timer;
-sigset_t maskSet, pendingSet;
+// The timer of every clock but UTHREAD_CLOCK_VIRTUAL.
+static WORKER_LOCAL timer_t posix_timer;
+
+// A scheduler instance: the Scheduler that manages its Threads, and the
+// settings it was initialized with.
+struct uthread_sched
+{
+    Scheduler *scheduler;
+    long long quantumNsecs;
+    // The clock quantums are measured on (one of the UTHREAD_CLOCK_* values).
+    int clock;
+    // The number of workers (see uthread_init_mp).
+    int workers;
+    // Set in tickless mode (see uthread_set_tickless).
+    bool tickless;
+    // The kernel thread that initialized the instance.
+    pthread_t owner;
+};
+
+// The threads and the waiters (see uthread_waiter_t) waiting for a mutex or
+// a semaphore, in its waiters member. Each of them is kept in the order it
+// came, and while both wait, they take turns.
+struct LockWaiters
+{
+    ThreadQueue threads;
+    uthread_waiter_t *firstWaiter;
+    uthread_waiter_t *lastWaiter;
+    // Set once a thread was handed over the mutex (or a unit) while waiters
+    // waited, so that the first waiter is next.
+    bool waiterTurn;
+};
+
+// The instance uthread_init sets up. Kernel threads that run no instance of
+// their own reach it through the uthread_* functions.
+static uthread_sched_t default_sched = {
+    new Scheduler(MAX_THREAD_NUM, STACK_SIZE), 0, UTHREAD_CLOCK_VIRTUAL, 1,
+    false, 0
+};
+// The instance the calling kernel thread runs, or nullptr if it runs none.
+static WORKER_LOCAL uthread_sched_t *current_sched = nullptr;
+// Set while the quantum timer is armed.
+static WORKER_LOCAL volatile bool timer_armed = false;
 
-// the Scheduler objects that manages the Threads
-//static Scheduler sch(MAX_THREAD_NUM, STACK_SIZE);
-static Scheduler* sch = new Scheduler(MAX_THREAD_NUM, STACK_SIZE);
-// Global library counters
-static int lib_quantum_usecs = 0;
+// Set while the library is inside a call (or inside a scheduling decision).
+// The timer handler does not preempt a thread while it is set. With several
+// workers, a library call holds the Scheduler's lock while it is set.
+static WORKER_LOCAL volatile sig_atomic_t in_library = 0;
+// Set by the timer handler when it fired while in_library was set. The
+// preemption is then carried out when the library call exits.
+static WORKER_LOCAL volatile sig_atomic_t preemption_pending = 0;
+// The coroutine frames of the worker, created the first time one is
+// allocated on it.
+static WORKER_LOCAL FramePool *frame_pool = nullptr;
+
+// The number of uthread-local storage keys created, and the destructor of
+// each key, shared by all of the instances.
+static int key_count = 0;
+static uthread_key_destructor_fn key_destructors[UTHREAD_KEYS_MAX];
 
 // Typedef for pointers to member functions of Scheduler
 typedef int (Scheduler::*SchedulerMemberFunction)(int num);
@@ -26,12 +97,61 @@ typedef int (Scheduler::*SchedulerMemberFunction)(int num);
 #define NO_PARAM 666
 // Macro used as indicator for syscalls failures.
 #define SIG_FAILED -1
-// Given signal does exist in a set.
-#define SIG_IN_SET 1
+// Keeps the compiler from moving memory accesses across the library flags.
+#define COMPILER_BARRIER() asm volatile("" ::: "memory")
 // Bad number of usecs
 #define BAD_USEC 0
+// The states of a mutex: unlocked, locked, and locked while threads may wait
+// for it (so that unlocking it enters the library).
+#define MUTEX_UNLOCKED 0
+#define MUTEX_LOCKED 1
+#define MUTEX_CONTENDED 2
+// The most bytes one file I/O request moves, as read(2) does.
+#define MAX_RING_IO_SIZE 0x7ffff000
+// Time unit conversions.
+#define NSECS_PER_USEC 1000
+#define NSECS_PER_SECOND 1000000000LL
+// The number of times the destructors of the uthread-local storage keys are
+// called over the values of an ending thread, as destructors may set values
+// again.
+#define KEY_DESTRUCTOR_ROUNDS 4
+// Older C libraries only name the target thread of SIGEV_THREAD_ID through
+// the sigevent union.
+#ifndef sigev_notify_thread_id
+#define sigev_notify_thread_id _sigev_un._tid
+#endif
+
+static_assert(UTHREAD_PRIORITY_LEVELS == PRIORITY_LEVELS,
+              "uthreads_ext.h and Scheduler.h disagree on the priority levels");
+static_assert(UTHREAD_MAX_WORKERS == MAX_WORKERS,
+              "uthreads_ext.h and Scheduler.h disagree on the workers");
+static_assert(UTHREAD_CLOSURE_SIZE == THREAD_CLOSURE_SIZE &&
+              UTHREAD_CLOSURE_ALIGN == THREAD_CLOSURE_ALIGN,
+              "uthreads_ext.h and Thread.h disagree on the closures");
+static_assert(UTHREAD_KEYS_MAX == THREAD_SPECIFIC_SLOTS,
+              "uthreads_ext.h and Thread.h disagree on the keys");
 //--------------------------------------------------------------------------//
 
+/**
+* Getter for the instance the library calls of the calling kernel thread act
+* on: its own, or the default one if it runs none.
+* @return the instance.
+*/
+static inline uthread_sched_t *current_lib(void)
+{
+    uthread_sched_t *lib = current_sched;
+    return (lib != nullptr) ? lib : &default_sched;
+}
+
+/**
+* Getter for the Scheduler of current_lib().
+* @return the Scheduler.
+*/
+static inline Scheduler *current_scheduler(void)
+{
+    return current_lib()->scheduler;
+}
+
 /*
  * Deleting the scheduler triggers the destructor in which all memory allocated
  * for the threads spawned (and for ID array) is released. Used specially
@@ -41,7 +161,7 @@ typedef int (Scheduler::*SchedulerMemberFunction)(int num);
  */
 static void killProcessAfterMemoryAllocs(void)
 {
-    delete &sch;
+    delete current_scheduler();
     ErrorHandler::sysCallError(THREAD_SYS_CALL_ERROR_TIMER_FAILED);
 }
 
@@ -49,69 +169,339 @@ static void killProcessAfterMemoryAllocs(void)
 
 
 /**
-* Resets the main timer with lib_quantum_usecs.
+* Sets the main timer of the instance's clock to expire every nsecs
+* nano-seconds, from now on.
+* @param nsecs the period, or 0 to disarm the timer.
+* @return None.
+*/
+static void set_timer(long long nsecs) {
+    if (current_lib()->clock == UTHREAD_CLOCK_VIRTUAL)
+    {
+        // The virtual timer counts micro-seconds. A quantum is never rounded
+        // down to 0, which would disarm it.
+        long long usecs = (nsecs + NSECS_PER_USEC - 1) / NSECS_PER_USEC;
+
+        // Configure the timer to expire after usecs, and every usecs after
+        // that.
+        timer.it_value.tv_sec = usecs / SECOND;
+        timer.it_value.tv_usec = usecs % SECOND;
+        timer.it_interval = timer.it_value;
+
+        // Start a virtual timer. It counts down whenever this process is
+        // executing
+        if (setitimer(ITIMER_VIRTUAL, &timer, NULL))
+        {
+            killProcessAfterMemoryAllocs();
+        }
+        return;
+    }
+
+    struct itimerspec spec;
+    spec.it_value.tv_sec = nsecs / NSECS_PER_SECOND;
+    spec.it_value.tv_nsec = nsecs % NSECS_PER_SECOND;
+    spec.it_interval = spec.it_value;
+
+    if (timer_settime(posix_timer, 0, &spec, NULL))
+    {
+        killProcessAfterMemoryAllocs();
+    }
+}
+
+/**
+* Resets the main timer with the instance's quantum, starting a new quantum.
 * @param None.
 * @return None.
 */
 static void reset_timer(void) {
-    // Configure the timer to expire after quantum_usecs ms
-    timer.it_value.tv_sec = lib_quantum_usecs / SECOND;
-    timer.it_value.tv_usec = lib_quantum_usecs % SECOND;
+    set_timer(current_lib()->quantumNsecs);
+    timer_armed = true;
+}
+
+/**
+* Disarms the main timer. No quantum expires until it is reset.
+* @param None.
+* @return None.
+*/
+static void stop_timer(void) {
+    set_timer(0);
+    timer_armed = false;
+}
 
-    // configure the timer to expire every quantum_usecs ms after tha
-    timer.it_interval.tv_sec = lib_quantum_usecs / SECOND;
-    timer.it_interval.tv_usec = lib_quantum_usecs % SECOND;
+/**
+* Creates the POSIX timer of the instance's clock for the calling worker. It
+* raises SIGVTALRM, like the virtual timer, in the calling kernel thread.
+* @param None.
+* @return None.
+*/
+static void create_timer(void) {
+    clockid_t clockID;
 
-    // Start a virtual timer. It counts down whenever this process is executing
-    if (setitimer(ITIMER_VIRTUAL, &timer, NULL))
+    switch (current_lib()->clock)
     {
-        killProcessAfterMemoryAllocs();
+        case UTHREAD_CLOCK_MONOTONIC:
+            clockID = CLOCK_MONOTONIC;
+            break;
+        case UTHREAD_CLOCK_PROCESS_CPU:
+            clockID = CLOCK_PROCESS_CPUTIME_ID;
+            break;
+        default:
+            clockID = CLOCK_THREAD_CPUTIME_ID;
+            break;
+    }
+
+    struct sigevent event;
+    event.sigev_notify = SIGEV_THREAD_ID;
+    event.sigev_signo = SIGVTALRM;
+    event.sigev_value.sival_ptr = NULL;
+    event.sigev_notify_thread_id = syscall(SYS_gettid);
+
+    if (timer_create(clockID, &event, &posix_timer))
+    {
+        ErrorHandler::sysCallError(THREAD_SYS_CALL_ERROR_TIMER_FAILED);
     }
 }
 
 /**
-* The timer handler function. Intermediate between the Scheduler and timer.
-* By this function, when needed
+* In tickless mode, disarms the timer while preempting the running thread
+* is pointless (no other thread is READY and none is SLEEPING, so a quantum
+* expiring would only switch to the same thread), and re-arms it once that
+* changes. Must be called with in_library set.
+* @return None.
+*/
+static void update_timer(void)
+{
+    if (!current_lib()->tickless)
+    {
+        return;
+    }
+    bool needed = current_scheduler()->isPreemptionNeeded();
+    if (needed && !timer_armed)
+    {
+        reset_timer();
+    }
+    else if (!needed && timer_armed)
+    {
+        stop_timer();
+    }
+}
+
+/**
+* Makes a scheduling decision, without touching the timer: either the
+* quantum has just expired (and the timer started the next one by itself),
+* or the running thread yielded the rest of its quantum. Must be called with
+* in_library set. Returns when the calling thread runs again.
+* @return None.
+*/
+static void schedule(void)
+{
+    preemption_pending = 0;
+    current_scheduler()->manageThreads();
+}
+
+/**
+* Makes a scheduling decision and starts a new quantum. Must be called with
+* in_library set. Returns when the calling thread runs again.
 * @return None.
 */
-static void timer_handler(int sig)
+static void schedule_new_quantum(void)
 {
     reset_timer();
-    sch->manageThreads();
+    schedule();
+}
+
+/**
+* Takes the Scheduler's lock, which guards its shared state while there are
+* several workers.
+* @return None.
+*/
+static void lock_scheduler(void)
+{
+    current_scheduler()->lock();
+}
+
+/**
+* Releases the Scheduler's lock, if the calling worker holds it. A
+* preemption or a yield may have made a scheduling decision without it.
+* @return None.
+*/
+static void unlock_scheduler(void)
+{
+    current_scheduler()->unlock();
+}
+
+/**
+* Marks the start of a library call. From here on the timer handler will not
+* preempt the running thread. If another worker blocked or terminated the
+* running thread, it is switched out first.
+* @return None.
+*/
+static void enter_library(void)
+{
+    in_library = 1;
+    COMPILER_BARRIER();
+    lock_scheduler();
+    uthread_sched_t *lib = current_lib();
+    if (lib->workers > 1 && lib->scheduler->isRunningThreadStopped())
+    {
+        schedule_new_quantum();
+    }
+}
+
+/**
+* Marks the end of a library call, carrying out a preemption that was
+* deferred while inside the library.
+* @return None.
+*/
+static void leave_library(void)
+{
+    for (;;)
+    {
+        if (preemption_pending)
+        {
+            schedule();
+            continue;
+        }
+        update_timer();
+        COMPILER_BARRIER();
+        unlock_scheduler();
+        in_library = 0;
+        COMPILER_BARRIER();
+        // The timer may have fired just before the flag was cleared. The
+        // scheduling decision takes the Scheduler's lock if it needs it.
+        if (!preemption_pending)
+        {
+            return;
+        }
+        in_library = 1;
+        COMPILER_BARRIER();
+    }
+}
+
+/**
+* Marks the start of a section the running thread must not be preempted in,
+* without taking the Scheduler's lock: the section only touches state of
+* the worker (which the thread can not leave inside it).
+* @return None.
+*/
+static void enter_worker_section(void)
+{
+    in_library = 1;
+    COMPILER_BARRIER();
+}
+
+/**
+* Marks the end of a section entered with enter_worker_section, carrying out
+* a preemption that was deferred inside it.
+* @return None.
+*/
+static void leave_worker_section(void)
+{
+    COMPILER_BARRIER();
+    in_library = 0;
+    COMPILER_BARRIER();
+    if (preemption_pending)
+    {
+        enter_library();
+        leave_library();
+    }
+}
+
+/**
+* Getter for the coroutine frames of the worker, which are created the
+* first time. Must be called inside a worker section.
+* @return the FramePool.
+*/
+static FramePool *worker_frame_pool(void)
+{
+    if (frame_pool == nullptr)
+    {
+        frame_pool = new(nothrow) FramePool();
+        if (frame_pool == nullptr)
+        {
+            ErrorHandler::sysCallError(THREAD_SYS_CALL_ERROR_BAD_ALLOC);
+        }
+    }
+    return frame_pool;
 }
 
 //----------------//
 
 /**
-* Blocks the SIG_SETMASK in maskSet.
+* The timer handler function. Intermediate between the Scheduler and timer.
+* If the timer expired in the middle of a library call, the preemption is
+* only recorded and carried out by leave_library().
 * @return None.
 */
-static void block_signal(void)
+static void timer_handler(int sig, siginfo_t *info, void *context)
 {
-    if(sigprocmask(SIG_BLOCK, &maskSet, NULL) == SIG_FAILED)
+    // The virtual timer signals the whole process, so its signal may reach a
+    // kernel thread that runs no instance, or another instance than the
+    // default one, which owns that timer. It is passed on to the kernel
+    // thread that runs the default instance. The other instances only use
+    // POSIX timers.
+    uthread_sched_t *lib = current_sched;
+    if (lib == nullptr ||
+        (lib != &default_sched && info->si_code != SI_TIMER))
     {
-        killProcessAfterMemoryAllocs();
+        if (default_sched.quantumNsecs > BAD_USEC)
+        {
+            pthread_kill(default_sched.owner, sig);
+        }
+        return;
     }
+    if (in_library)
+    {
+        preemption_pending = 1;
+        return;
+    }
+    // The scheduling decision takes the Scheduler's lock if it needs it.
+    in_library = 1;
+    COMPILER_BARRIER();
+    schedule();
+    leave_library();
 }
 
+//----------------//
+
 /**
-* Unblocks the SIG_SETMASK in maskSet.
+* What a worker runs while it has no thread to run: it keeps looking for a
+* READY thread, and waits for one while there is none. Quantums that pass
+* meanwhile are measured on the wall clock. Never leaves the library.
 * @return None.
 */
-static void unblock_signal(void)
+static void idle_loop(void)
 {
-    if (sigprocmask(SIG_UNBLOCK, &maskSet, NULL) == SIG_FAILED)
+    enter_library();
+    for (;;)
     {
-        killProcessAfterMemoryAllocs();
+        schedule();
+        current_scheduler()->waitForWork(current_lib()->quantumNsecs);
     }
 }
 
+/**
+* The function of the kernel thread of every worker but the first.
+* @param index the index of the worker.
+* @return None.
+*/
+static void *worker_main(void *index)
+{
+    current_sched = &default_sched;
+    default_sched.scheduler->bindWorker((int) (intptr_t) index);
+    create_timer();
+    reset_timer();
+    idle_loop();
+    return NULL;
+}
+
 //----------------//
 
 
 /**
 * Invokes func on scheduler with the parameter value and returns retured data.
 * Note: only functions with the following sig will work: int func(int value)
+* The call is atomic with respect to the timer without any system call: the
+* timer handler only records a preemption that happens during it.
 * @param scheduler the Scheduler object to invoke the function on
 * @param func the member function to call
 * @param value the parameter to invoke func with
@@ -122,13 +512,9 @@ static int invoke_member_function(Scheduler *scheduler,
                                   FunctionPointer spawnFunction,int isSpawn,\
                                   int value)
 {
-    int result;
-    int sig;
     int retVal;
 
-    // Block signal
-    block_signal();
-    sigpending(&pendingSet);
+    enter_library();
 
     // Call function depending on what type.
     if(isSpawn == SPAWN)
@@ -140,210 +526,2404 @@ static int invoke_member_function(Scheduler *scheduler,
         retVal = (scheduler->*func)(value);
     }
 
-    if(sch->getScenario() != ROUTINE)
-    {
-        raise(SIGVTALRM);
-    }
-
-    if(sigemptyset(&pendingSet) == SIG_FAILED)
+    // The running thread yielded. The next thread runs out the rest of the
+    // quantum, so the timer is left alone.
+    if(scheduler->getScenario() == TOYIELD ||
+       scheduler->getScenario() == TOYIELDTO)
     {
-        ErrorHandler::sysCallError(THREAD_SYS_CALL_ERROR_SIGNAL_HANDLE);
+        schedule();
     }
-    if(sigpending(&pendingSet) == SIG_FAILED)
+    // The running thread blocked, slept or terminated itself.
+    else if(scheduler->getScenario() != ROUTINE)
     {
-        ErrorHandler::sysCallError(THREAD_SYS_CALL_ERROR_SIGNAL_HANDLE);
+        schedule_new_quantum();
     }
-    // Checking if SIGVTALARM was caught when blocked.
-    if (sigismember(&pendingSet, SIGVTALRM) == SIG_IN_SET)
+
+    leave_library();
+    return retVal;
+}
+
+//----------------//
+
+/**
+* Getter for the queue of the threads waiting for a mutex, a condition
+* variable or a semaphore, which is created the first time a thread waits.
+* Must be called with in_library set.
+* @param waiters the waiters member of the object.
+* @return the queue.
+*/
+static ThreadQueue *wait_queue(void **waiters)
+{
+    if (*waiters == nullptr)
     {
-        result = sigwait(&pendingSet, &sig);
-        sigpending(&pendingSet);
-        // Removing SIGVTALARM from pending list was successful.
-        if (result == SUCCESS)
+        *waiters = new(nothrow) ThreadQueue();
+        if (*waiters == nullptr)
         {
-            unblock_signal();
-            raise(SIGVTALRM);
-            return retVal;
+            ErrorHandler::sysCallError(THREAD_SYS_CALL_ERROR_BAD_ALLOC);
         }
     }
-    // Unblock signal
-    unblock_signal();
-    return retVal;
+    return static_cast<ThreadQueue *>(*waiters);
 }
 
-//---------------------------------------------------------------------------//
-
-
-/*
-* Description: This function initializes the thread library.
-* You may assume that this function is called before any other thread library
-* function, and that it is called exactly once. The input to the function is
-* the length of a quantum in micro-seconds. It is an error to call this
-* function with non-positive quantum_usecs.
-* @param quantum_usecs
-* @return On success, return 0. On failure, return -1.
+/**
+* Getter for the threads and the waiters waiting for a mutex or a semaphore,
+* which are created the first time one waits. Must be called with
+* in_library set.
+* @param waiters the waiters member of the object.
+* @return the threads and the waiters.
 */
-int uthread_init(int quantum_usecs) {
-    if(quantum_usecs <= BAD_USEC)
+static LockWaiters *lock_waiters(void **waiters)
+{
+    if (*waiters == nullptr)
     {
-        ErrorHandler::sysCallError(THREAD_SYS_CALL_ERROR_TIMER);
+        *waiters = new(nothrow) LockWaiters();
+        if (*waiters == nullptr)
+        {
+            ErrorHandler::sysCallError(THREAD_SYS_CALL_ERROR_BAD_ALLOC);
+        }
     }
+    return static_cast<LockWaiters *>(*waiters);
+}
 
-    // quantum_usecs is local, but we need it for further uses.
-    lib_quantum_usecs = quantum_usecs;
-
-    // Install timer_handler as the signal handler for SIGVTALRM.
-    sa.sa_handler = &timer_handler;
+/**
+* Checks whether threads or waiters wait for a mutex or a semaphore.
+* @param waiters the threads and the waiters.
+* @return true if one of them waits, false otherwise.
+*/
+static bool has_lock_waiters(const LockWaiters *waiters)
+{
+    return !waiters->threads.isEmpty() || waiters->firstWaiter != nullptr;
+}
 
-    // Set the maskset - later be used to block timer signals.
-    if(sigemptyset(&maskSet) == SIG_FAILED)
+/**
+* Makes a waiter wait for a mutex or a semaphore, after the others. Must be
+* called with in_library set.
+* @param waiters the threads and the waiters.
+* @param waiter the waiter.
+* @return None.
+*/
+static void queue_waiter(LockWaiters *waiters, uthread_waiter_t *waiter)
+{
+    waiter->next = nullptr;
+    if (waiters->lastWaiter == nullptr)
     {
-        ErrorHandler::sysCallError(THREAD_SYS_CALL_ERROR_SIGNAL_HANDLE);
+        waiters->firstWaiter = waiter;
     }
-    if(sigaddset(&maskSet, SIGVTALRM) == SIG_FAILED)
+    else
     {
-        ErrorHandler::sysCallError(THREAD_SYS_CALL_ERROR_SIGNAL_HANDLE);
+        waiters->lastWaiter->next = waiter;
     }
+    waiters->lastWaiter = waiter;
+}
 
-    if (sigaction(SIGVTALRM, &sa, NULL) == SIG_FAILED)
+/**
+* Hands a mutex or a unit of a semaphore over to the thread or the waiter
+* that is next, which is woken up. Must be called with in_library set.
+* @param waiters the threads and the waiters.
+* @return true if one of them was woken up, false if none waits.
+*/
+static bool wake_lock_waiter(LockWaiters *waiters)
+{
+    uthread_waiter_t *waiter = waiters->firstWaiter;
+    if (waiter != nullptr &&
+        (waiters->waiterTurn || waiters->threads.isEmpty()))
     {
-        ErrorHandler::sysCallError(THREAD_SYS_CALL_ERROR_SIGNAL_HANDLE);
+        waiters->firstWaiter = waiter->next;
+        if (waiters->firstWaiter == nullptr)
+        {
+            waiters->lastWaiter = nullptr;
+        }
+        waiters->waiterTurn = false;
+        // The waiter may be gone once it was woken up.
+        waiter->wake(waiter->arg);
+        return true;
     }
-
-    reset_timer();
-    return SUCCESS;
+    if (!current_scheduler()->wakeWaiter(&waiters->threads))
+    {
+        return false;
+    }
+    waiters->waiterTurn = (waiters->firstWaiter != nullptr);
+    return true;
 }
 
-/*
-* Description: This function creates a new thread, whose entry point is the
-* function f with the signature void f(void). The thread is added to the end
-* of the READY threads list. The uthread_spawn function should fail if it
-* would cause the number of concurrent threads to exceed the limit
-* (MAX_THREAD_NUM). Each thread should be allocated with a stack of size
-* STACK_SIZE bytes.
-* Return value: On success, return the ID of the created thread.
-* On failure, return -1.
+/**
+* Makes the running thread wait on a queue, and makes a scheduling decision.
+* Must be called with in_library set. Returns when the thread was woken up
+* or its timeout expired.
+* @param queue the queue.
+* @param num_quantums the number of quantums to wait at most, or NO_TIMEOUT.
+* @return SUCCESS if the thread was woken up, UTHREAD_TIMEDOUT otherwise.
 */
-int uthread_spawn(FunctionPointer f)
+static int wait_on(ThreadQueue *queue, int num_quantums)
 {
-    return invoke_member_function(sch, nullptr , f, SPAWN, NO_PARAM);
+    current_scheduler()->waitOn(queue, num_quantums);
+    schedule_new_quantum();
+    return current_scheduler()->hasWaitTimedOut() ? UTHREAD_TIMEDOUT :
+           SUCCESS;
 }
 
-/*
-* Description: This function terminates the thread with ID tid and deletes
-* it from all relevant control structures. All the resources allocated by
-* the library for this thread should be released. If no thread with ID tid
-* exists it is considered as an error. Terminating the main thread
-* (tid == 0) will result in the termination of the entire process using
-* exit(0) [after releasing the assigned library memory].
-* Return value: The function returns 0 if the thread was successfully
-* terminated and -1 otherwise. If a thread terminates itself or the main
-* thread is terminated, the function does not return.
+/**
+* Locks a mutex that was found locked. The mutex is marked contended, so
+* that its owner enters the library to unlock it. If it was unlocked
+* meanwhile, it is taken, and otherwise the calling thread (or the waiter)
+* waits until the mutex is handed over to it.
+* @param mutex the mutex.
+* @param waiter the waiter, or nullptr for the calling thread.
+* @return SUCCESS if the mutex was taken, UTHREAD_BUSY if the waiter waits.
 */
-int uthread_terminate(int tid)
+static int lock_contended(uthread_mutex_t *mutex, uthread_waiter_t *waiter)
 {
-    return invoke_member_function(sch, &Scheduler::removeThread, nullptr, \
-                                  NOT_SPAWN, tid);
-}
+    int retVal = SUCCESS;
 
+    enter_library();
+    if (__atomic_exchange_n(&mutex->state, MUTEX_CONTENDED,
+                            __ATOMIC_ACQUIRE) != MUTEX_UNLOCKED)
+    {
+        LockWaiters *waiters = lock_waiters(&mutex->waiters);
+        if (waiter == nullptr)
+        {
+            wait_on(&waiters->threads, NO_TIMEOUT);
+        }
+        else
+        {
+            queue_waiter(waiters, waiter);
+            retVal = UTHREAD_BUSY;
+        }
+    }
+    leave_library();
+    return retVal;
+}
 
-/*
-* Description: This function blocks the thread with ID tid. The thread may
-* be resumed later using uthread_resume. If no thread with ID tid exists it
-* is considered as an error. In addition, it is an error to try blocking the
-* main thread (tid == 0). If a thread blocks itself, a scheduling decision
-* should be made. Blocking a thread in BLOCKED or SLEEPING states has no
-* effect and is not considered as an error.
-* Return value: On success, return 0. On failure, return -1.
+/**
+* Unlocks a contended mutex, handing it over to the next waiting thread (or
+* waiter) if there is one. The mutex stays contended while others wait. Must
+* be called with in_library set.
+* @param mutex the mutex.
+* @return None.
 */
-int uthread_block(int tid)
+static void hand_over_mutex(uthread_mutex_t *mutex)
 {
-    return invoke_member_function(sch, &Scheduler::blockThread,nullptr, \
-                                  NOT_SPAWN, tid);
+    LockWaiters *waiters = static_cast<LockWaiters *>(mutex->waiters);
+    if (waiters != nullptr && wake_lock_waiter(waiters))
+    {
+        if (!has_lock_waiters(waiters))
+        {
+            __atomic_store_n(&mutex->state, MUTEX_LOCKED, __ATOMIC_RELAXED);
+        }
+    }
+    else
+    {
+        __atomic_store_n(&mutex->state, MUTEX_UNLOCKED, __ATOMIC_RELEASE);
+    }
 }
 
-
-/*
-* Description: This function resumes a blocked thread with ID tid and moves
-* it to the READY state. Resuming a thread in the RUNNING, READY or SLEEPING
+/**
+* Unlocks a mutex, without entering the library if no thread waits for it.
+* Must be called with in_library set if the mutex may be contended.
+* @param mutex the mutex.
+* @return SUCCESS, or FAILURE if the mutex is not locked.
+*/
+static int release_mutex(uthread_mutex_t *mutex)
+{
+    int expected = MUTEX_LOCKED;
+    if (__atomic_compare_exchange_n(&mutex->state, &expected, MUTEX_UNLOCKED,
+                                    false, __ATOMIC_RELEASE, __ATOMIC_RELAXED))
+    {
+        return SUCCESS;
+    }
+    if (expected == MUTEX_UNLOCKED)
+    {
+        return ErrorHandler::libError(THREAD_LIB_ERROR_NOT_LOCKED);
+    }
+    hand_over_mutex(mutex);
+    return SUCCESS;
+}
+
+/**
+* Waits on a condition variable.
+* @param cond the condition variable.
+* @param mutex the mutex, which is unlocked while the thread waits and
+* locked again after.
+* @param num_quantums the number of quantums to wait at most, or NO_TIMEOUT.
+* @return SUCCESS if the thread was woken up, UTHREAD_TIMEDOUT if the timeout
+* expired, FAILURE if the mutex is not locked.
+*/
+static int wait_on_cond(uthread_cond_t *cond, uthread_mutex_t *mutex,
+                        int num_quantums)
+{
+    int retVal;
+
+    enter_library();
+    // The mutex is released and the thread waits in one library call, so a
+    // signal sent once the mutex is released reaches the thread.
+    retVal = release_mutex(mutex);
+    if (retVal == SUCCESS)
+    {
+        retVal = wait_on(wait_queue(&cond->waiters), num_quantums);
+    }
+    leave_library();
+
+    if (retVal != FAILURE)
+    {
+        uthread_mutex_lock(mutex);
+    }
+    return retVal;
+}
+
+/**
+* Decrements a semaphore if its value is positive.
+* @param sem the semaphore.
+* @return true if the semaphore was decremented, false otherwise.
+*/
+static bool take_sem(uthread_sem_t *sem)
+{
+    int value = __atomic_load_n(&sem->value, __ATOMIC_SEQ_CST);
+    while (value > 0)
+    {
+        if (__atomic_compare_exchange_n(&sem->value, &value, value - 1, false,
+                                        __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST))
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+* Decrements a semaphore, waiting for a unit to be posted if its value is 0.
+* @param sem the semaphore.
+* @param num_quantums the number of quantums to wait at most, or NO_TIMEOUT.
+* @param waiter the waiter that waits, or nullptr for the calling thread.
+* @return SUCCESS, UTHREAD_TIMEDOUT if the timeout expired, or UTHREAD_BUSY
+* if the waiter waits.
+*/
+static int wait_for_sem(uthread_sem_t *sem, int num_quantums,
+                        uthread_waiter_t *waiter)
+{
+    int retVal = SUCCESS;
+
+    if (take_sem(sem))
+    {
+        return SUCCESS;
+    }
+
+    enter_library();
+    // A post that finds no waiting threads does not enter the library, so
+    // the thread is counted before it looks at the value again.
+    __atomic_add_fetch(&sem->waiting, 1, __ATOMIC_SEQ_CST);
+    if (take_sem(sem))
+    {
+        __atomic_sub_fetch(&sem->waiting, 1, __ATOMIC_SEQ_CST);
+    }
+    else if (waiter != nullptr)
+    {
+        queue_waiter(lock_waiters(&sem->waiters), waiter);
+        retVal = UTHREAD_BUSY;
+    }
+    else
+    {
+        // A thread that was woken up was handed a unit, and no longer
+        // counted, by the post.
+        retVal = wait_on(&lock_waiters(&sem->waiters)->threads,
+                         num_quantums);
+        if (retVal == UTHREAD_TIMEDOUT)
+        {
+            __atomic_sub_fetch(&sem->waiting, 1, __ATOMIC_SEQ_CST);
+        }
+    }
+    leave_library();
+    return retVal;
+}
+
+/**
+* Makes the running thread wait on a channel with the data it hands over, and
+* makes a scheduling decision. Must be called with in_library set.
+* @param queue the queue of the channel's senders or receivers.
+* @param data the value the thread sends, or where the value it receives goes.
+* @return true if the value was handed over, false if the thread was woken
+* up by closing the channel.
+*/
+static bool wait_on_chan(ThreadQueue *queue, void *data)
+{
+    current_scheduler()->currentWorker()->current->setWaitData(data);
+    wait_on(queue, NO_TIMEOUT);
+
+    // The worker may have changed while the thread waited.
+    Thread *thread = current_scheduler()->currentWorker()->current;
+    bool handedOver = thread->getWaitData() == nullptr;
+    thread->setWaitData(nullptr);
+    return handedOver;
+}
+
+/**
+* Sends a value on a channel.
+* @param chan the channel.
+* @param value the value.
+* @param wait whether to wait while the channel is full.
+* @return SUCCESS, UTHREAD_BUSY if the value can not be sent without waiting,
+* or FAILURE if the channel is closed.
+*/
+static int send_on_chan(uthread_chan_t *chan, const void *value, bool wait)
+{
+    Channel *channel = reinterpret_cast<Channel *>(chan);
+    int result;
+
+    enter_library();
+    result = channel->send(current_scheduler(), value);
+    if (result == CHANNEL_FULL && wait)
+    {
+        // A sender the channel was closed on fails below.
+        result = wait_on_chan(channel->senders(), const_cast<void *>(value)) ?
+                 CHANNEL_DONE : CHANNEL_CLOSED;
+    }
+    leave_library();
+
+    if (result == CHANNEL_CLOSED)
+    {
+        return ErrorHandler::libError(THREAD_LIB_ERROR_CHAN_CLOSED);
+    }
+    return result == CHANNEL_DONE ? SUCCESS : UTHREAD_BUSY;
+}
+
+/**
+* Receives a value from a channel.
+* @param chan the channel.
+* @param value where the value goes.
+* @param wait whether to wait while the channel is empty.
+* @return SUCCESS, UTHREAD_BUSY if no value can be received without waiting,
+* or UTHREAD_CLOSED if the channel is closed and empty.
+*/
+static int receive_on_chan(uthread_chan_t *chan, void *value, bool wait)
+{
+    Channel *channel = reinterpret_cast<Channel *>(chan);
+    int result;
+
+    enter_library();
+    result = channel->receive(current_scheduler(), value);
+    if (result == CHANNEL_EMPTY && wait)
+    {
+        // Receivers only wait on an empty channel, so one the channel was
+        // closed on finds it drained.
+        result = wait_on_chan(channel->receivers(), value) ? CHANNEL_DONE :
+                 CHANNEL_CLOSED;
+    }
+    leave_library();
+
+    if (result == CHANNEL_DONE)
+    {
+        return SUCCESS;
+    }
+    return result == CHANNEL_CLOSED ? UTHREAD_CLOSED : UTHREAD_BUSY;
+}
+
+/**
+* Puts a file descriptor in non-blocking mode, if it is not already.
+* @param fd the file descriptor.
+* @return SUCCESS, or FAILURE (with errno set).
+*/
+static int set_nonblocking(int fd)
+{
+    int flags = fcntl(fd, F_GETFL);
+    if (flags == SIG_FAILED)
+    {
+        return FAILURE;
+    }
+    if ((flags & O_NONBLOCK) == 0 &&
+        fcntl(fd, F_SETFL, flags | O_NONBLOCK) == SIG_FAILED)
+    {
+        return FAILURE;
+    }
+    return SUCCESS;
+}
+
+/**
+* Checks whether a non-blocking system call failed because it would have
+* blocked.
+* @return true if so, false otherwise.
+*/
+static bool would_block(void)
+{
+    return errno == EAGAIN || errno == EWOULDBLOCK;
+}
+
+/**
+* Makes the running thread wait until a file descriptor is ready, and makes
+* a scheduling decision.
+* @param fd the file descriptor.
+* @param write true to wait until it is writable, false until it is
+* readable.
+* @param num_quantums the number of quantums to wait at most, or NO_TIMEOUT.
+* @return SUCCESS, UTHREAD_TIMEDOUT if the timeout expired, or FAILURE if
+* the file descriptor can not be waited for (with errno set).
+*/
+static int wait_for_fd(int fd, bool write, int num_quantums)
+{
+    int retVal = FAILURE;
+    int error;
+
+    enter_library();
+    Poller *poller = current_scheduler()->poller();
+    ThreadQueue *queue = poller->addWaiter(fd, write);
+    error = errno;
+    if (queue != nullptr)
+    {
+        retVal = wait_on(queue, num_quantums);
+        // The thread may run on another worker, but the Poller is shared.
+        current_scheduler()->poller()->removeWaiter();
+    }
+    leave_library();
+
+    // errno belongs to the kernel thread, which may have run other threads.
+    errno = error;
+    return retVal;
+}
+
+/**
+* Makes the running thread do file I/O through the scheduler instance's
+* io_uring, waiting until the request completes, and makes a scheduling
+* decision.
+* @param opcode the operation (IORING_OP_READ, IORING_OP_WRITE or
+* IORING_OP_FSYNC).
+* @param fd the file descriptor.
+* @param buf the buffer to read into or write from.
+* @param count the number of bytes, MAX_RING_IO_SIZE at most.
+* @param offset the offset in the file.
+* @param result where the result goes: like the system call's, or -1 with
+* errno set.
+* @return true if the request was made, false if io_uring is unavailable.
+*/
+static bool ring_io(int opcode, int fd, void *buf, size_t count, off_t offset,
+                    ssize_t *result)
+{
+    int retVal;
+
+    enter_library();
+    IoRing *ring = current_scheduler()->ioRing();
+    int slot = ring->prepare(opcode, fd, buf, (unsigned int) count, offset);
+    if (slot == IO_RING_UNAVAILABLE)
+    {
+        leave_library();
+        return false;
+    }
+    wait_on(ring->waiter(slot), NO_TIMEOUT);
+    // The thread may run on another worker, but the IoRing is shared.
+    retVal = current_scheduler()->ioRing()->collect(slot);
+    leave_library();
+
+    if (retVal < 0)
+    {
+        errno = -retVal;
+        retVal = SIG_FAILED;
+    }
+    *result = retVal;
+    return true;
+}
+
+/**
+* The function of the thread of a task: runs the task, and then its
+* continuations and theirs, completing each one's future.
+* @param arg the future of the task.
+* @return None.
+*/
+static void run_futures(void *arg)
+{
+    Future *future = static_cast<Future *>(arg);
+    while (future != nullptr)
+    {
+        void *value = future->run();
+        enter_library();
+        future = future->complete(current_scheduler(), value);
+        leave_library();
+    }
+}
+
+/**
+* Spawns a detached thread that runs a task. Must be called with in_library
+* set.
+* @param future the future of the task.
+* @return SUCCESS, or FAILURE if the thread can not be spawned.
+*/
+static int spawn_future(Future *future)
+{
+    Scheduler *scheduler = current_scheduler();
+    int tid = scheduler->addThread(run_futures, future);
+    if (tid == FAILURE)
+    {
+        return FAILURE;
+    }
+    return scheduler->detachThread(tid);
+}
+
+/**
+* Finds a complete future. Must be called with in_library set.
+* @param futures the futures.
+* @param count the number of futures.
+* @return the index of the first complete future, or -1 if none is.
+*/
+static int find_complete(uthread_future_t **futures, int count)
+{
+    for (int index = 0; index < count; ++index)
+    {
+        if (reinterpret_cast<Future *>(futures[index])->isComplete())
+        {
+            return index;
+        }
+    }
+    return -1;
+}
+
+/**
+* Checks the futures given to the functions that wait for several.
+* @param futures the futures.
+* @param count the number of futures.
+* @return SUCCESS, or FAILURE if any of them is missing.
+*/
+static int check_futures(uthread_future_t **futures, int count)
+{
+    if (futures == nullptr || count <= 0)
+    {
+        return FAILURE;
+    }
+    for (int index = 0; index < count; ++index)
+    {
+        if (futures[index] == nullptr)
+        {
+            return FAILURE;
+        }
+    }
+    return SUCCESS;
+}
+
+//----------------//
+
+/**
+* Calls the destructors of the uthread-local storage keys with the non-NULL
+* values of an ending thread, clearing each value before its destructor is
+* called. Must be called outside of the library.
+* @param values the values, one per key.
+* @return None.
+*/
+static void run_key_destructors(void **values)
+{
+    for (int round = 0; round < KEY_DESTRUCTOR_ROUNDS; ++round)
+    {
+        bool called = false;
+        for (int key = 0; key < UTHREAD_KEYS_MAX; ++key)
+        {
+            void *value = values[key];
+            if (value == nullptr)
+            {
+                continue;
+            }
+            values[key] = nullptr;
+
+            uthread_key_destructor_fn destructor =
+                    __atomic_load_n(&key_destructors[key], __ATOMIC_ACQUIRE);
+            if (destructor != nullptr)
+            {
+                destructor(value);
+                called = true;
+            }
+        }
+        if (!called)
+        {
+            return;
+        }
+    }
+}
+
+/**
+* Starts a new thread by finishing the scheduling decision and the library
+* call that switched to it (see Thread::setStartHook).
+* @return None.
+*/
+static void start_thread(void)
+{
+    current_scheduler()->finishSwitch(false);
+    leave_library();
+}
+
+/**
+* Exits a thread whose function returned (see Thread::setExitHook).
+* @return None.
+*/
+static void exit_returned_thread(void)
+{
+    uthread_exit(nullptr);
+}
+
+/**
+* Initializes an instance on the calling kernel thread, which becomes its
+* owner, and whose context becomes the instance's main thread.
+* @param lib the instance.
+* @param quantum_nsecs the length of a quantum in nano-seconds.
+* @param policy the scheduling policy (one of the UTHREAD_POLICY_* values).
+* @param clock the clock quantums are measured on.
+* @return On success, return 0. On failure, return -1.
+*/
+static int init_instance(uthread_sched_t *lib, long long quantum_nsecs,
+                         int policy, int clock)
+{
+    switch (policy)
+    {
+        case UTHREAD_POLICY_RR:
+            lib->scheduler->setPolicy(ROUND_ROBIN);
+            break;
+        case UTHREAD_POLICY_MLFQ:
+            lib->scheduler->setPolicy(MULTI_LEVEL_FEEDBACK);
+            break;
+        case UTHREAD_POLICY_FAIR:
+            lib->scheduler->setPolicy(FAIR_SHARE);
+            break;
+        default:
+            return ErrorHandler::libError(THREAD_LIB_ERROR_INPUT);
+    }
+
+    // quantum_nsecs is local, but we need it for further uses.
+    lib->quantumNsecs = quantum_nsecs;
+    lib->clock = clock;
+    lib->owner = pthread_self();
+    lib->scheduler->bindWorker(0);
+    lib->scheduler->setIdleLoop(&idle_loop);
+    current_sched = lib;
+
+    // Install timer_handler as the signal handler for SIGVTALRM. The handler
+    // guards itself with in_library, so the signal is never masked and no
+    // thread's signal mask ever has to be saved or restored. A wall-clock
+    // quantum may expire in the middle of a system call, which is restarted
+    // once the interrupted thread runs again.
+    sa.sa_sigaction = &timer_handler;
+    sa.sa_flags = SA_SIGINFO | SA_NODEFER | SA_RESTART;
+    if(sigemptyset(&sa.sa_mask) == SIG_FAILED)
+    {
+        ErrorHandler::sysCallError(THREAD_SYS_CALL_ERROR_SIGNAL_HANDLE);
+    }
+
+    if (sigaction(SIGVTALRM, &sa, NULL) == SIG_FAILED)
+    {
+        ErrorHandler::sysCallError(THREAD_SYS_CALL_ERROR_SIGNAL_HANDLE);
+    }
+
+    if (clock != UTHREAD_CLOCK_VIRTUAL)
+    {
+        create_timer();
+    }
+
+    // New threads start by finishing the library call that switched to them.
+    Thread::setStartHook(&start_thread);
+    // A thread whose function returns exits with NULL.
+    Thread::setExitHook(&exit_returned_thread);
+
+    reset_timer();
+    return SUCCESS;
+}
+
+//---------------------------------------------------------------------------//
+
+
+/*
+* Description: This function initializes the thread library.
+* You may assume that this function is called before any other thread library
+* function, and that it is called exactly once. The input to the function is
+* the length of a quantum in micro-seconds. It is an error to call this
+* function with non-positive quantum_usecs.
+* @param quantum_usecs
+* @return On success, return 0. On failure, return -1.
+*/
+int uthread_init(int quantum_usecs) {
+    return uthread_init_ex(quantum_usecs, UTHREAD_POLICY_RR);
+}
+
+/*
+* Description: This function initializes the thread library like uthread_init,
+* and selects the scheduling policy (one of the UTHREAD_POLICY_* values).
+* @param quantum_usecs
+* @param policy
+* @return On success, return 0. On failure, return -1.
+*/
+int uthread_init_ex(int quantum_usecs, int policy) {
+    if(quantum_usecs <= BAD_USEC)
+    {
+        ErrorHandler::sysCallError(THREAD_SYS_CALL_ERROR_TIMER);
+    }
+    return uthread_init_clock((long long) quantum_usecs * NSECS_PER_USEC,
+                              policy, UTHREAD_CLOCK_VIRTUAL);
+}
+
+/*
+* Description: This function initializes the thread library like
+* uthread_init_ex, with a quantum of quantum_nsecs nano-seconds measured on
+* the given clock (one of the UTHREAD_CLOCK_* values).
+* @param quantum_nsecs
+* @param policy
+* @param clock
+* @return On success, return 0. On failure, return -1.
+*/
+int uthread_init_clock(long long quantum_nsecs, int policy, int clock) {
+    if(quantum_nsecs <= BAD_USEC)
+    {
+        ErrorHandler::sysCallError(THREAD_SYS_CALL_ERROR_TIMER);
+    }
+
+    switch (clock)
+    {
+        case UTHREAD_CLOCK_VIRTUAL:
+        case UTHREAD_CLOCK_MONOTONIC:
+        case UTHREAD_CLOCK_PROCESS_CPU:
+        case UTHREAD_CLOCK_THREAD_CPU:
+            break;
+        default:
+            return ErrorHandler::libError(THREAD_LIB_ERROR_INPUT);
+    }
+
+    return init_instance(&default_sched, quantum_nsecs, policy, clock);
+}
+
+/*
+* Description: This function initializes the thread library like uthread_init,
+* and runs the threads on nworkers kernel threads (workers), the calling one
+* included. Quantums are measured on the CPU time of each worker.
+* @param quantum_usecs
+* @param nworkers
+* @return On success, return 0. On failure, return -1.
+*/
+int uthread_init_mp(int quantum_usecs, int nworkers) {
+    if(quantum_usecs <= BAD_USEC)
+    {
+        ErrorHandler::sysCallError(THREAD_SYS_CALL_ERROR_TIMER);
+    }
+    if(nworkers < 1 || nworkers > MAX_WORKERS)
+    {
+        return ErrorHandler::libError(THREAD_LIB_ERROR_INPUT);
+    }
+
+    // A single worker works exactly like uthread_init.
+    int clock = (nworkers == 1) ? UTHREAD_CLOCK_VIRTUAL :
+                UTHREAD_CLOCK_THREAD_CPU;
+    if(uthread_init_clock((long long) quantum_usecs * NSECS_PER_USEC,
+                          UTHREAD_POLICY_RR, clock) == FAILURE)
+    {
+        return FAILURE;
+    }
+    if(nworkers == 1)
+    {
+        return SUCCESS;
+    }
+
+    enter_library();
+    default_sched.scheduler->addWorkers(nworkers);
+    default_sched.workers = nworkers;
+    leave_library();
+
+    for(int index = 1; index < nworkers; ++index)
+    {
+        pthread_t worker;
+        if(pthread_create(&worker, NULL, &worker_main,
+                          (void *) (intptr_t) index))
+        {
+            ErrorHandler::sysCallError(THREAD_SYS_CALL_ERROR_WORKER);
+        }
+        pthread_detach(worker);
+    }
+    return SUCCESS;
+}
+
+/*
+* Description: This function creates a scheduler instance run by the calling
+* kernel thread, which must not run one already (the instance set up by
+* uthread_init included). The calling context becomes the main thread
+* (tid == 0) of the instance, and quantums of quantum_usecs micro-seconds are
+* measured on the CPU time of the calling kernel thread. From then on the
+* uthread_* functions called on this kernel thread act on the new instance.
+* Each instance has its own threads, IDs and quantum counters, so several
+* kernel threads may each run one independently.
+* Return value: On success, return the instance. On failure, return NULL.
+*/
+uthread_sched_t *uthread_sched_create(int quantum_usecs, int policy)
+{
+    if(quantum_usecs <= BAD_USEC)
+    {
+        ErrorHandler::libError(THREAD_LIB_ERROR_NEGATIVE_QUANTUM);
+        return nullptr;
+    }
+    if(current_sched != nullptr)
+    {
+        ErrorHandler::libError(THREAD_LIB_ERROR_SCHED_EXISTS);
+        return nullptr;
+    }
+
+    uthread_sched_t *sched = new(nothrow) uthread_sched_t;
+    Scheduler *scheduler = new(nothrow) Scheduler(MAX_THREAD_NUM, STACK_SIZE);
+    if(sched == nullptr || scheduler == nullptr)
+    {
+        delete scheduler;
+        delete sched;
+        ErrorHandler::sysCallError(THREAD_SYS_CALL_ERROR_BAD_ALLOC);
+    }
+    *sched = {scheduler, 0, UTHREAD_CLOCK_THREAD_CPU, 1, false, 0};
+
+    if(init_instance(sched, (long long) quantum_usecs * NSECS_PER_USEC,
+                     policy, UTHREAD_CLOCK_THREAD_CPU) == FAILURE)
+    {
+        current_sched = nullptr;
+        delete scheduler;
+        delete sched;
+        return nullptr;
+    }
+    return sched;
+}
+
+/*
+* Description: This function destroys a scheduler instance created by
+* uthread_sched_create, releasing its threads and their resources. It must
+* be called by the main thread (tid == 0) of the instance, on the kernel
+* thread that runs it, which may then create another one. (Terminating the
+* main thread terminates the entire process instead.)
+* Return value: On success, return 0. On failure, return -1.
+*/
+int uthread_sched_destroy(uthread_sched_t *sched)
+{
+    if(sched == nullptr || sched == &default_sched)
+    {
+        return ErrorHandler::libError(THREAD_LIB_ERROR_INPUT);
+    }
+    if(sched != current_sched)
+    {
+        return ErrorHandler::libError(THREAD_LIB_ERROR_NOT_OWNER);
+    }
+
+    enter_library();
+    if(sched->scheduler->getRunningThreadID(NO_PARAM) != MAIN_THREAD_ID)
+    {
+        leave_library();
+        return ErrorHandler::libError(THREAD_LIB_ERROR_ILLEGAL_MAIN_OP);
+    }
+
+    // No quantum expires from here on, so the flags may be reset.
+    stop_timer();
+    if (timer_delete(posix_timer))
+    {
+        ErrorHandler::sysCallError(THREAD_SYS_CALL_ERROR_TIMER_FAILED);
+    }
+    current_sched = nullptr;
+    delete sched->scheduler;
+    delete sched;
+    preemption_pending = 0;
+    in_library = 0;
+    return SUCCESS;
+}
+
+/*
+* Description: This function returns the scheduler instance run by the
+* calling kernel thread.
+* Return value: The instance, or NULL if the kernel thread runs none.
+*/
+uthread_sched_t *uthread_sched_current(void)
+{
+    return current_sched;
+}
+
+/*
+* Description: This function creates a new thread, whose entry point is the
+* function f with the signature void f(void). The thread is added to the end
+* of the READY threads list. The uthread_spawn function should fail if it
+* would cause the number of concurrent threads to exceed the limit
+* (MAX_THREAD_NUM). Each thread should be allocated with a stack of size
+* STACK_SIZE bytes.
+* Return value: On success, return the ID of the created thread.
+* On failure, return -1.
+*/
+int uthread_spawn(FunctionPointer f)
+{
+    return invoke_member_function(current_scheduler(),
+                                  nullptr, f,
+                                  SPAWN, NO_PARAM);
+}
+
+/*
+* Description: This function creates a new thread like uthread_spawn, whose
+* entry point is the function f with the signature void f(void *arg), called
+* with arg. Returning from f exits the thread like uthread_exit(NULL).
+* Return value: On success, return the ID of the created thread.
+* On failure, return -1.
+*/
+int uthread_spawn_arg(uthread_arg_fn f, void *arg)
+{
+    if(f == nullptr)
+    {
+        return ErrorHandler::libError(THREAD_LIB_ERROR_INPUT);
+    }
+
+    enter_library();
+    int tid = current_scheduler()->addThread(f, arg);
+    leave_library();
+    return tid;
+}
+
+/*
+* Description: This function creates a new thread like uthread_spawn_arg,
+* whose entry point is run, called with a callable the thread keeps: move
+* moves the callable at closure (of UTHREAD_CLOSURE_SIZE bytes at most) into
+* the storage of the thread, with no allocation. destroy (unless NULL)
+* destroys the kept callable once run returns, or once the thread is
+* deleted if it exits or is terminated before then. move runs inside the
+* library, and so does destroy when the thread ended early: they must not
+* call uthread_* functions. The C++ overload of uthread_spawn for callables
+* is built on it.
+* Return value: On success, return the ID of the created thread.
+* On failure, return -1.
+*/
+int uthread_spawn_closure(uthread_arg_fn run, uthread_move_fn move,
+                          uthread_destroy_fn destroy, void *closure)
+{
+    if(run == nullptr || move == nullptr || closure == nullptr)
+    {
+        return ErrorHandler::libError(THREAD_LIB_ERROR_INPUT);
+    }
+
+    enter_library();
+    int tid = current_scheduler()->addThread(run, move, destroy, closure);
+    leave_library();
+    return tid;
+}
+
+/*
+* Description: This function terminates the thread with ID tid and deletes
+* it from all relevant control structures. All the resources allocated by
+* the library for this thread should be released. If no thread with ID tid
+* exists it is considered as an error. Terminating the main thread
+* (tid == 0) will result in the termination of the entire process using
+* exit(0) [after releasing the assigned library memory].
+* Return value: The function returns 0 if the thread was successfully
+* terminated and -1 otherwise. If a thread terminates itself or the main
+* thread is terminated, the function does not return.
+*/
+int uthread_terminate(int tid)
+{
+    void *values[UTHREAD_KEYS_MAX];
+    bool taken = false;
+    int retVal;
+
+    // A thread that terminates itself cleans up its own uthread-local
+    // storage first.
+    if(tid != MAIN_THREAD_ID && tid == uthread_get_tid())
+    {
+        run_key_destructors(uthread_running_slots);
+        return invoke_member_function(current_scheduler(),
+                                      &Scheduler::removeThread, nullptr,
+                                      NOT_SPAWN, tid);
+    }
+
+    // The values of another thread are taken in the library call that
+    // removes it, and cleaned up by the caller once it left the library.
+    enter_library();
+    Scheduler *scheduler = current_scheduler();
+    if(tid != MAIN_THREAD_ID)
+    {
+        taken = scheduler->takeSpecific(tid, values);
+    }
+    retVal = scheduler->removeThread(tid);
+    leave_library();
+
+    if(taken)
+    {
+        run_key_destructors(values);
+    }
+    return retVal;
+}
+
+
+/*
+* Description: This function makes the RUNNING thread exit with an exit
+* value, which the thread that joins it collects. A thread whose function
+* returns exits with NULL. A detached thread is released at once; a
+* joinable one keeps its ID until it is joined, but its stack and other
+* resources are released at once. The main thread (tid == 0) exiting
+* terminates the process like uthread_terminate(0).
+* Return value: The function does not return.
+*/
+void uthread_exit(void *value)
+{
+    run_key_destructors(uthread_running_slots);
+
+    enter_library();
+    current_scheduler()->exitThread(value);
+    schedule_new_quantum();
+}
+
+/*
+* Description: This function waits until the thread with ID tid exits, and
+* stores its exit value in *value (unless value is NULL). If the thread
+* exited already, its exit value is collected at once. A thread terminated
+* with uthread_terminate hands over NULL. Once joined, the ID is released.
+* Only one thread may join a thread, and it is an error to join the main
+* thread (tid == 0), the RUNNING thread or a detached thread. A scheduling
+* decision is made immediately if the RUNNING thread waits.
+* Return value: On success, return 0. On failure, return -1.
+*/
+int uthread_join(int tid, void **value)
+{
+    int retVal;
+    void *exitValue = nullptr;
+
+    enter_library();
+    retVal = current_scheduler()->joinThread(tid, &exitValue);
+    // The exit value is stored in exitValue by the exiting thread.
+    if(current_scheduler()->getScenario() == TOWAIT)
+    {
+        schedule_new_quantum();
+    }
+    leave_library();
+
+    if(retVal == SUCCESS && value != nullptr)
+    {
+        *value = exitValue;
+    }
+    return retVal;
+}
+
+/*
+* Description: This function detaches the thread with ID tid, which is
+* released as soon as it exits instead of waiting to be joined. A thread
+* that exited already is released at once. It is an error to detach the
+* main thread (tid == 0), a detached thread or one another thread joins.
+* Return value: On success, return 0. On failure, return -1.
+*/
+int uthread_detach(int tid)
+{
+    return invoke_member_function(current_scheduler(),
+                                  &Scheduler::detachThread, nullptr,
+                                  NOT_SPAWN, tid);
+}
+
+
+/*
+* Description: This function blocks the thread with ID tid. The thread may
+* be resumed later using uthread_resume. If no thread with ID tid exists it
+* is considered as an error. In addition, it is an error to try blocking the
+* main thread (tid == 0). If a thread blocks itself, a scheduling decision
+* should be made. Blocking a thread in BLOCKED or SLEEPING states has no
+* effect and is not considered as an error.
+* Return value: On success, return 0. On failure, return -1.
+*/
+int uthread_block(int tid)
+{
+    return invoke_member_function(current_scheduler(),
+                                  &Scheduler::blockThread, nullptr,
+                                  NOT_SPAWN, tid);
+}
+
+
+/*
+* Description: This function resumes a blocked thread with ID tid and moves
+* it to the READY state. Resuming a thread in the RUNNING, READY or SLEEPING
 * state has no effect and is not considered as an error. If no thread with
 * ID tid exists it is considered as an error.
 * Return value: On success, return 0. On failure, return -1.
 */
-int uthread_resume(int tid)
+int uthread_resume(int tid)
+{
+    return invoke_member_function(current_scheduler(),
+                                  &Scheduler::resumeThread, nullptr,
+                                  NOT_SPAWN, tid);
+}
+
+/*
+* Description: This function puts the RUNNING thread to sleep for a period
+* of num_quantums (not including the current quantum) after which it is moved
+* to the READY state. num_quantums must be a positive number. It is an error
+* to try to put the main thread (tid==0) to sleep. Immediately after a thread
+* transitions to the SLEEPING state a scheduling decision should be made.
+* Return value: On success, return 0. On failure, return -1.
+*/
+int uthread_sleep(int num_quantums)
+{
+    if(current_lib()->quantumNsecs <= BAD_USEC)
+    {
+        return ErrorHandler::libError(THREAD_LIB_ERROR_NEGATIVE_QUANTUM);
+    }
+    return invoke_member_function(current_scheduler(),
+                                  &Scheduler::sleepThread, nullptr,
+                                  NOT_SPAWN, num_quantums);
+}
+
+/*
+* Description: This function puts the RUNNING thread to sleep until the
+* total number of quantums (see uthread_get_total_quantums) reaches
+* total_quantum. The thread is moved to the READY state so that it may run
+* from that quantum on. total_quantum must be larger than the current total
+* number of quantums. It is an error to try to put the main thread (tid==0)
+* to sleep. A scheduling decision is made immediately.
+* Return value: On success, return 0. On failure, return -1.
+*/
+int uthread_sleep_until(int total_quantum)
+{
+    return invoke_member_function(current_scheduler(),
+                                  &Scheduler::sleepUntil, nullptr,
+                                  NOT_SPAWN, total_quantum);
+}
+
+/*
+* Description: This function puts the RUNNING thread to sleep for at least
+* usecs micro-seconds, rounded up to a whole number of quantums. usecs must
+* be a positive number. It is an error to try to put the main thread (tid==0)
+* to sleep. A scheduling decision is made immediately.
+* Return value: On success, return 0. On failure, return -1.
+*/
+int uthread_sleep_usecs(int usecs)
+{
+    long long quantum_nsecs = current_lib()->quantumNsecs;
+    if(quantum_nsecs <= BAD_USEC)
+    {
+        return ErrorHandler::libError(THREAD_LIB_ERROR_NEGATIVE_QUANTUM);
+    }
+    if(usecs <= BAD_USEC)
+    {
+        return ErrorHandler::libError(THREAD_LIB_ERROR_INPUT);
+    }
+    long long nsecs = (long long) usecs * NSECS_PER_USEC;
+    int num_quantums = (nsecs + quantum_nsecs - 1) / quantum_nsecs;
+    return invoke_member_function(current_scheduler(),
+                                  &Scheduler::sleepThread, nullptr,
+                                  NOT_SPAWN, num_quantums);
+}
+
+/*
+* Description: This function sets the priority level of the thread with ID
+* tid under UTHREAD_POLICY_MLFQ. Level 0 is the highest, and the first thread
+* of the highest level with READY threads runs next. The policy keeps moving
+* the thread between levels afterwards. If no thread with ID tid exists, the
+* level is out of range, or another policy is used, it is considered as an
+* error.
+* Return value: On success, return 0. On failure, return -1.
+*/
+int uthread_set_priority(int tid, int level)
+{
+    int retVal;
+
+    enter_library();
+    retVal = current_scheduler()->setPriority(tid, level);
+    leave_library();
+    return retVal;
+}
+
+/*
+* Description: This function moves the RUNNING thread to the end of the READY
+* threads, and a scheduling decision is made immediately. The thread that
+* runs next gets the rest of the current quantum. If no other thread is
+* READY, the calling thread keeps running.
+* Return value: On success, return 0. On failure, return -1.
+*/
+int uthread_yield(void)
+{
+    // A yield only touches the ready threads of the worker, so the
+    // scheduling decision takes the Scheduler's lock only if it needs it.
+    enter_worker_section();
+    current_scheduler()->yieldThread(NO_PARAM);
+    schedule();
+    leave_library();
+    return SUCCESS;
+}
+
+/*
+* Description: This function switches from the RUNNING thread directly to the
+* READY thread with ID tid, regardless of the order of the READY threads. The
+* calling thread moves to the end of the READY threads, and the thread with
+* ID tid runs out the rest of the current quantum. Yielding to the calling
+* thread itself has no effect. If no thread with ID tid exists, or it is not
+* READY, it is considered as an error.
+* Return value: On success, return 0. On failure, return -1.
+*/
+int uthread_yield_to(int tid)
+{
+    return invoke_member_function(current_scheduler(),
+                                  &Scheduler::yieldTo, nullptr,
+                                  NOT_SPAWN, tid);
+}
+
+/*
+* Description: This function turns the tickless mode on (enabled != 0) or
+* off. In tickless mode the quantum timer is stopped while no thread but the
+* RUNNING one is READY or SLEEPING, and started again once a thread is
+* spawned, resumed or woken up. While the timer is stopped no new quantums
+* start, so the quantum counters do not advance.
+* Return value: On success, return 0. On failure, return -1.
+*/
+int uthread_set_tickless(int enabled)
+{
+    enter_library();
+    uthread_sched_t *lib = current_lib();
+    lib->tickless = (enabled != 0);
+    // Without tickless mode the timer always runs.
+    if (!lib->tickless && !timer_armed)
+    {
+        reset_timer();
+    }
+    leave_library();
+    return SUCCESS;
+}
+
+/*
+* Description: This function sets the weight of the thread with ID tid under
+* UTHREAD_POLICY_FAIR. Runnable threads share the CPU in proportion to their
+* weights, and every thread starts with a weight of 1024. If no thread with
+* ID tid exists, the weight is not positive, or another policy is used, it
+* is considered as an error.
+* Return value: On success, return 0. On failure, return -1.
+*/
+int uthread_set_weight(int tid, int weight)
+{
+    int retVal;
+
+    enter_library();
+    retVal = current_scheduler()->setWeight(tid, weight);
+    leave_library();
+    return retVal;
+}
+
+/*
+* Description: This function returns the number of quantums until the thread
+* with id tid wakes up including the current quantum. If no thread with ID
+* tid exists it is considered as an error. If the thread is not sleeping,
+* the function should return 0.
+* Return value: Number of quantums (including current quantum) until wakeup.
+*/
+int uthread_get_time_until_wakeup(int tid)
+{
+    return invoke_member_function(current_scheduler(),
+                                  &Scheduler::getTimeToWakeUp, nullptr,
+                                  NOT_SPAWN, tid);
+}
+
+/*
+* Description: This function returns the thread ID of the calling thread.
+* Return value: The ID of the calling thread.
+*/
+int uthread_get_tid(void)
+{
+    return invoke_member_function(current_scheduler(),
+                                  &Scheduler::getRunningThreadID, nullptr,
+                                  NOT_SPAWN, NO_PARAM);
+}
+
+/*
+* Description: This function returns the total number of quantums that were
+* started since the library was initialized, including the current quantum.
+* Right after the call to uthread_init, the value should be 1.
+* Each time a new quantum starts, regardless of the reason, this number
+* should be increased by 1.
+* Return value: The total number of quantums.
+*/
+int uthread_get_total_quantums()
+{
+    return invoke_member_function(current_scheduler(),
+                                  &Scheduler::getTotalQuantumCounter, nullptr,
+                                  NOT_SPAWN, NO_PARAM);
+}
+
+
+/*
+* Description: This function returns the number of quantums the thread with
+* ID tid was in RUNNING state. On the first time a thread runs, the function
+* should return 1. Every additional quantum that the thread starts should
+* increase this value by 1 (so if the thread with ID tid is in RUNNING state
+* when this function is called, include also the current quantum). If no
+* thread with ID tid exists it is considered as an error.
+* Return value: On success, return the number of quantums of the thread with ID
+* tid. On failure, return -1.
+*/
+int uthread_get_quantums(int tid)
+{
+    return invoke_member_function(current_scheduler(),
+                                  &Scheduler::getNumOfQuantums, nullptr,
+                                  NOT_SPAWN, tid);
+}
+/*
+* Description: This function initializes a mutex, which is then unlocked.
+* Return value: On success, return 0. On failure, return -1.
+*/
+int uthread_mutex_init(uthread_mutex_t *mutex)
+{
+    if(mutex == nullptr)
+    {
+        return ErrorHandler::libError(THREAD_LIB_ERROR_INPUT);
+    }
+    mutex->state = MUTEX_UNLOCKED;
+    mutex->waiters = nullptr;
+    return SUCCESS;
+}
+
+/*
+* Description: This function releases the resources of a mutex. It is an
+* error to destroy a locked mutex.
+* Return value: On success, return 0. On failure, return -1.
+*/
+int uthread_mutex_destroy(uthread_mutex_t *mutex)
+{
+    if(mutex == nullptr)
+    {
+        return ErrorHandler::libError(THREAD_LIB_ERROR_INPUT);
+    }
+    if(__atomic_load_n(&mutex->state, __ATOMIC_ACQUIRE) != MUTEX_UNLOCKED)
+    {
+        return ErrorHandler::libError(THREAD_LIB_ERROR_LOCKED);
+    }
+    // Nothing waits for an unlocked mutex.
+    delete static_cast<LockWaiters *>(mutex->waiters);
+    mutex->waiters = nullptr;
+    return SUCCESS;
+}
+
+/*
+* Description: This function locks a mutex. If it is locked, the RUNNING
+* thread waits until the mutex is handed over to it by uthread_mutex_unlock,
+* and a scheduling decision is made immediately. Waiting threads take the
+* mutex in the order they came, and uthread_resume does not wake them up.
+* Return value: On success, return 0. On failure, return -1.
+*/
+int uthread_mutex_lock(uthread_mutex_t *mutex)
+{
+    if(mutex == nullptr)
+    {
+        return ErrorHandler::libError(THREAD_LIB_ERROR_INPUT);
+    }
+    // A free mutex is taken without entering the library.
+    int expected = MUTEX_UNLOCKED;
+    if(__atomic_compare_exchange_n(&mutex->state, &expected, MUTEX_LOCKED,
+                                   false, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED))
+    {
+        return SUCCESS;
+    }
+    return lock_contended(mutex, nullptr);
+}
+
+/*
+* Description: This function locks a mutex if it is unlocked, and never
+* waits.
+* Return value: On success, return 0. If the mutex is locked, return
+* UTHREAD_BUSY. On failure, return -1.
+*/
+int uthread_mutex_trylock(uthread_mutex_t *mutex)
+{
+    if(mutex == nullptr)
+    {
+        return ErrorHandler::libError(THREAD_LIB_ERROR_INPUT);
+    }
+    int expected = MUTEX_UNLOCKED;
+    if(__atomic_compare_exchange_n(&mutex->state, &expected, MUTEX_LOCKED,
+                                   false, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED))
+    {
+        return SUCCESS;
+    }
+    return UTHREAD_BUSY;
+}
+
+/*
+* Description: This function locks a mutex for waiter. If it is locked, the
+* waiter is queued instead of the RUNNING thread, which goes on, and
+* waiter->wake(waiter->arg) is called once uthread_mutex_unlock hands the
+* mutex over to it. The waiter must stay valid until then.
+* Return value: If the mutex was locked at once, return 0. If the waiter was
+* queued, return UTHREAD_BUSY. On failure, return -1.
+*/
+int uthread_mutex_lock_waiter(uthread_mutex_t *mutex,
+                              uthread_waiter_t *waiter)
+{
+    if(mutex == nullptr || waiter == nullptr || waiter->wake == nullptr)
+    {
+        return ErrorHandler::libError(THREAD_LIB_ERROR_INPUT);
+    }
+    int expected = MUTEX_UNLOCKED;
+    if(__atomic_compare_exchange_n(&mutex->state, &expected, MUTEX_LOCKED,
+                                   false, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED))
+    {
+        return SUCCESS;
+    }
+    return lock_contended(mutex, waiter);
+}
+
+/*
+* Description: This function unlocks a mutex locked by the RUNNING thread. If
+* threads wait for it, it is handed over to the first of them, which becomes
+* READY, or to the first waiter (see uthread_mutex_lock_waiter) when it is
+* its turn. It is an error to unlock a mutex that is not locked.
+* Return value: On success, return 0. On failure, return -1.
+*/
+int uthread_mutex_unlock(uthread_mutex_t *mutex)
+{
+    if(mutex == nullptr)
+    {
+        return ErrorHandler::libError(THREAD_LIB_ERROR_INPUT);
+    }
+    // A mutex no thread waits for is released without entering the library.
+    int expected = MUTEX_LOCKED;
+    if(__atomic_compare_exchange_n(&mutex->state, &expected, MUTEX_UNLOCKED,
+                                   false, __ATOMIC_RELEASE, __ATOMIC_RELAXED))
+    {
+        return SUCCESS;
+    }
+    if(expected == MUTEX_UNLOCKED)
+    {
+        return ErrorHandler::libError(THREAD_LIB_ERROR_NOT_LOCKED);
+    }
+
+    enter_library();
+    hand_over_mutex(mutex);
+    leave_library();
+    return SUCCESS;
+}
+
+/*
+* Description: This function initializes a condition variable.
+* Return value: On success, return 0. On failure, return -1.
+*/
+int uthread_cond_init(uthread_cond_t *cond)
+{
+    if(cond == nullptr)
+    {
+        return ErrorHandler::libError(THREAD_LIB_ERROR_INPUT);
+    }
+    cond->waiters = nullptr;
+    return SUCCESS;
+}
+
+/*
+* Description: This function releases the resources of a condition
+* variable. It is an error to destroy a condition variable threads wait on.
+* Return value: On success, return 0. On failure, return -1.
+*/
+int uthread_cond_destroy(uthread_cond_t *cond)
+{
+    int retVal = SUCCESS;
+
+    if(cond == nullptr)
+    {
+        return ErrorHandler::libError(THREAD_LIB_ERROR_INPUT);
+    }
+
+    enter_library();
+    ThreadQueue *waiters = static_cast<ThreadQueue *>(cond->waiters);
+    if(waiters != nullptr && !waiters->isEmpty())
+    {
+        retVal = ErrorHandler::libError(THREAD_LIB_ERROR_WAITING);
+    }
+    else
+    {
+        delete waiters;
+        cond->waiters = nullptr;
+    }
+    leave_library();
+    return retVal;
+}
+
+/*
+* Description: This function unlocks mutex, which the RUNNING thread must
+* have locked, and makes the thread wait on cond at once. A scheduling
+* decision is made immediately. Once the thread is woken up by
+* uthread_cond_signal or uthread_cond_broadcast, it locks mutex again before
+* returning.
+* Return value: On success, return 0. On failure, return -1.
+*/
+int uthread_cond_wait(uthread_cond_t *cond, uthread_mutex_t *mutex)
+{
+    if(cond == nullptr || mutex == nullptr)
+    {
+        return ErrorHandler::libError(THREAD_LIB_ERROR_INPUT);
+    }
+    return wait_on_cond(cond, mutex, NO_TIMEOUT);
+}
+
+/*
+* Description: This function waits on cond like uthread_cond_wait, for
+* num_quantums quantums at most (not including the current quantum).
+* num_quantums must be a positive number. The mutex is locked again in
+* either case.
+* Return value: On success, return 0. If the timeout expired, return
+* UTHREAD_TIMEDOUT. On failure, return -1.
+*/
+int uthread_cond_timedwait(uthread_cond_t *cond, uthread_mutex_t *mutex,
+                           int num_quantums)
+{
+    if(cond == nullptr || mutex == nullptr || num_quantums <= 0)
+    {
+        return ErrorHandler::libError(THREAD_LIB_ERROR_INPUT);
+    }
+    return wait_on_cond(cond, mutex, num_quantums);
+}
+
+/*
+* Description: This function wakes up the thread that has waited on cond the
+* longest, if there is one.
+* Return value: On success, return 0. On failure, return -1.
+*/
+int uthread_cond_signal(uthread_cond_t *cond)
+{
+    if(cond == nullptr)
+    {
+        return ErrorHandler::libError(THREAD_LIB_ERROR_INPUT);
+    }
+
+    enter_library();
+    if(cond->waiters != nullptr)
+    {
+        current_scheduler()->wakeWaiter(
+                static_cast<ThreadQueue *>(cond->waiters));
+    }
+    leave_library();
+    return SUCCESS;
+}
+
+/*
+* Description: This function wakes up all of the threads that wait on cond,
+* at once and in the order they came.
+* Return value: On success, return 0. On failure, return -1.
+*/
+int uthread_cond_broadcast(uthread_cond_t *cond)
+{
+    if(cond == nullptr)
+    {
+        return ErrorHandler::libError(THREAD_LIB_ERROR_INPUT);
+    }
+
+    enter_library();
+    if(cond->waiters != nullptr)
+    {
+        current_scheduler()->wakeAllWaiters(
+                static_cast<ThreadQueue *>(cond->waiters));
+    }
+    leave_library();
+    return SUCCESS;
+}
+
+/*
+* Description: This function initializes a semaphore with a non-negative
+* value.
+* Return value: On success, return 0. On failure, return -1.
+*/
+int uthread_sem_init(uthread_sem_t *sem, int value)
+{
+    if(sem == nullptr || value < 0)
+    {
+        return ErrorHandler::libError(THREAD_LIB_ERROR_INPUT);
+    }
+    sem->value = value;
+    sem->waiting = 0;
+    sem->waiters = nullptr;
+    return SUCCESS;
+}
+
+/*
+* Description: This function releases the resources of a semaphore. It is an
+* error to destroy a semaphore threads wait on.
+* Return value: On success, return 0. On failure, return -1.
+*/
+int uthread_sem_destroy(uthread_sem_t *sem)
+{
+    int retVal = SUCCESS;
+
+    if(sem == nullptr)
+    {
+        return ErrorHandler::libError(THREAD_LIB_ERROR_INPUT);
+    }
+
+    enter_library();
+    if(__atomic_load_n(&sem->waiting, __ATOMIC_SEQ_CST) > 0)
+    {
+        retVal = ErrorHandler::libError(THREAD_LIB_ERROR_WAITING);
+    }
+    else
+    {
+        delete static_cast<LockWaiters *>(sem->waiters);
+        sem->waiters = nullptr;
+    }
+    leave_library();
+    return retVal;
+}
+
+/*
+* Description: This function decrements a semaphore. If its value is 0, the
+* RUNNING thread waits until uthread_sem_post hands it a unit, and a
+* scheduling decision is made immediately.
+* Return value: On success, return 0. On failure, return -1.
+*/
+int uthread_sem_wait(uthread_sem_t *sem)
+{
+    if(sem == nullptr)
+    {
+        return ErrorHandler::libError(THREAD_LIB_ERROR_INPUT);
+    }
+    return wait_for_sem(sem, NO_TIMEOUT, nullptr);
+}
+
+/*
+* Description: This function decrements a semaphore like uthread_sem_wait,
+* waiting for num_quantums quantums at most (not including the current
+* quantum). num_quantums must be a positive number.
+* Return value: On success, return 0. If the timeout expired, return
+* UTHREAD_TIMEDOUT. On failure, return -1.
+*/
+int uthread_sem_timedwait(uthread_sem_t *sem, int num_quantums)
+{
+    if(sem == nullptr || num_quantums <= 0)
+    {
+        return ErrorHandler::libError(THREAD_LIB_ERROR_INPUT);
+    }
+    return wait_for_sem(sem, num_quantums, nullptr);
+}
+
+/*
+* Description: This function decrements a semaphore if its value is
+* positive, and never waits.
+* Return value: On success, return 0. If the value is 0, return
+* UTHREAD_BUSY. On failure, return -1.
+*/
+int uthread_sem_trywait(uthread_sem_t *sem)
+{
+    if(sem == nullptr)
+    {
+        return ErrorHandler::libError(THREAD_LIB_ERROR_INPUT);
+    }
+    return take_sem(sem) ? SUCCESS : UTHREAD_BUSY;
+}
+
+/*
+* Description: This function decrements a semaphore for waiter. If its value
+* is 0, the waiter is queued instead of the RUNNING thread, which goes on,
+* and waiter->wake(waiter->arg) is called once uthread_sem_post hands it a
+* unit. The waiter must stay valid until then.
+* Return value: If the semaphore was decremented at once, return 0. If the
+* waiter was queued, return UTHREAD_BUSY. On failure, return -1.
+*/
+int uthread_sem_wait_waiter(uthread_sem_t *sem, uthread_waiter_t *waiter)
+{
+    if(sem == nullptr || waiter == nullptr || waiter->wake == nullptr)
+    {
+        return ErrorHandler::libError(THREAD_LIB_ERROR_INPUT);
+    }
+    return wait_for_sem(sem, NO_TIMEOUT, waiter);
+}
+
+/*
+* Description: This function increments a semaphore. If threads wait on it,
+* the unit is handed to the one that has waited the longest, which becomes
+* READY, or to the first waiter (see uthread_sem_wait_waiter) when it is its
+* turn.
+* Return value: On success, return 0. On failure, return -1.
+*/
+int uthread_sem_post(uthread_sem_t *sem)
+{
+    if(sem == nullptr)
+    {
+        return ErrorHandler::libError(THREAD_LIB_ERROR_INPUT);
+    }
+
+    int value = __atomic_load_n(&sem->value, __ATOMIC_RELAXED);
+    do
+    {
+        if(value == INT_MAX)
+        {
+            return ErrorHandler::libError(THREAD_LIB_ERROR_SEM_OVERFLOW);
+        }
+    } while(!__atomic_compare_exchange_n(&sem->value, &value, value + 1,
+                                         false, __ATOMIC_SEQ_CST,
+                                         __ATOMIC_RELAXED));
+
+    // A semaphore no thread waits on is posted without entering the library.
+    if(__atomic_load_n(&sem->waiting, __ATOMIC_SEQ_CST) == 0)
+    {
+        return SUCCESS;
+    }
+
+    // The unit goes to the first waiting thread, unless another thread took
+    // it meanwhile.
+    enter_library();
+    LockWaiters *waiters = static_cast<LockWaiters *>(sem->waiters);
+    if(waiters != nullptr && has_lock_waiters(waiters) && take_sem(sem))
+    {
+        wake_lock_waiter(waiters);
+        __atomic_sub_fetch(&sem->waiting, 1, __ATOMIC_SEQ_CST);
+    }
+    leave_library();
+    return SUCCESS;
+}
+
+/*
+* Description: This function creates a channel of values of elem_size bytes,
+* which buffers up to capacity values. A channel of capacity 0 is
+* unbuffered: every send waits for a receiver, and every receive for a
+* sender. The buffer is allocated once, rounded up to a power of two values.
+* Return value: On success, return the channel. On failure, return NULL.
+*/
+uthread_chan_t *uthread_chan_create(int elem_size, int capacity)
+{
+    if(elem_size <= 0 || capacity < 0 || capacity > MAX_CHANNEL_CAPACITY)
+    {
+        ErrorHandler::libError(THREAD_LIB_ERROR_INPUT);
+        return nullptr;
+    }
+
+    Channel *channel = new(nothrow) Channel(elem_size, capacity);
+    if(channel == nullptr)
+    {
+        ErrorHandler::sysCallError(THREAD_SYS_CALL_ERROR_BAD_ALLOC);
+    }
+    return reinterpret_cast<uthread_chan_t *>(channel);
+}
+
+/*
+* Description: This function releases the resources of a channel, with the
+* values left in it. It is an error to destroy a channel threads wait on.
+* Return value: On success, return 0. On failure, return -1.
+*/
+int uthread_chan_destroy(uthread_chan_t *chan)
+{
+    int retVal = SUCCESS;
+
+    if(chan == nullptr)
+    {
+        return ErrorHandler::libError(THREAD_LIB_ERROR_INPUT);
+    }
+
+    enter_library();
+    Channel *channel = reinterpret_cast<Channel *>(chan);
+    if(channel->hasWaiters())
+    {
+        retVal = ErrorHandler::libError(THREAD_LIB_ERROR_WAITING);
+    }
+    else
+    {
+        delete channel;
+    }
+    leave_library();
+    return retVal;
+}
+
+/*
+* Description: This function sends the value value points to on a channel.
+* If a thread waits to receive, the value is copied straight to it and the
+* thread becomes READY. Otherwise the value is buffered, and if the buffer is
+* full, the RUNNING thread waits until a receiver takes the value, and a
+* scheduling decision is made immediately. It is an error to send on a
+* closed channel, including one closed while the thread waited.
+* Return value: On success, return 0. On failure, return -1.
+*/
+int uthread_chan_send(uthread_chan_t *chan, const void *value)
+{
+    if(chan == nullptr || value == nullptr)
+    {
+        return ErrorHandler::libError(THREAD_LIB_ERROR_INPUT);
+    }
+    return send_on_chan(chan, value, true);
+}
+
+/*
+* Description: This function receives a value from a channel into value, in
+* the order the values were sent. If the channel is empty, the RUNNING
+* thread waits until a sender hands it a value, and a scheduling decision is
+* made immediately.
+* Return value: On success, return 0. If the channel is closed and empty,
+* return UTHREAD_CLOSED. On failure, return -1.
+*/
+int uthread_chan_recv(uthread_chan_t *chan, void *value)
+{
+    if(chan == nullptr || value == nullptr)
+    {
+        return ErrorHandler::libError(THREAD_LIB_ERROR_INPUT);
+    }
+    return receive_on_chan(chan, value, true);
+}
+
+/*
+* Description: This function sends a value on a channel like
+* uthread_chan_send, if that does not have to wait.
+* Return value: On success, return 0. If the value can not be sent at once,
+* return UTHREAD_BUSY. On failure, return -1.
+*/
+int uthread_chan_try_send(uthread_chan_t *chan, const void *value)
+{
+    if(chan == nullptr || value == nullptr)
+    {
+        return ErrorHandler::libError(THREAD_LIB_ERROR_INPUT);
+    }
+    return send_on_chan(chan, value, false);
+}
+
+/*
+* Description: This function receives a value from a channel like
+* uthread_chan_recv, if that does not have to wait.
+* Return value: On success, return 0. If no value can be received at once,
+* return UTHREAD_BUSY, or UTHREAD_CLOSED if the channel is closed and empty.
+* On failure, return -1.
+*/
+int uthread_chan_try_recv(uthread_chan_t *chan, void *value)
+{
+    if(chan == nullptr || value == nullptr)
+    {
+        return ErrorHandler::libError(THREAD_LIB_ERROR_INPUT);
+    }
+    return receive_on_chan(chan, value, false);
+}
+
+/*
+* Description: This function closes a channel. The threads that wait to
+* send or to receive on it are woken up, and fail. The values buffered in it
+* can still be received. It is an error to close a channel twice.
+* Return value: On success, return 0. On failure, return -1.
+*/
+int uthread_chan_close(uthread_chan_t *chan)
 {
-    return invoke_member_function(sch, &Scheduler::resumeThread, nullptr, \
-                                  NOT_SPAWN, tid);
+    int retVal;
+
+    if(chan == nullptr)
+    {
+        return ErrorHandler::libError(THREAD_LIB_ERROR_INPUT);
+    }
+
+    enter_library();
+    retVal = reinterpret_cast<Channel *>(chan)->close(current_scheduler());
+    leave_library();
+
+    if(retVal == FAILURE)
+    {
+        return ErrorHandler::libError(THREAD_LIB_ERROR_CHAN_CLOSED);
+    }
+    return SUCCESS;
 }
 
 /*
-* Description: This function puts the RUNNING thread to sleep for a period
-* of num_quantums (not including the current quantum) after which it is moved
-* to the READY state. num_quantums must be a positive number. It is an error
-* to try to put the main thread (tid==0) to sleep. Immediately after a thread
-* transitions to the SLEEPING state a scheduling decision should be made.
+* Description: This function runs fn(arg) as a task, on a new detached
+* thread, and returns the future of the value fn returns. Futures are taken
+* from a pool, and go back to it once released (see uthread_future_release)
+* and complete.
+* Return value: On success, return the future. On failure (if the thread
+* can not be spawned), return NULL.
+*/
+uthread_future_t *uthread_async(uthread_task_fn fn, void *arg)
+{
+    if(fn == nullptr)
+    {
+        ErrorHandler::libError(THREAD_LIB_ERROR_INPUT);
+        return nullptr;
+    }
+
+    enter_library();
+    Future *future = Future::acquire(fn, arg);
+    if(spawn_future(future) == FAILURE)
+    {
+        future->discard();
+        future = nullptr;
+    }
+    leave_library();
+    return reinterpret_cast<uthread_future_t *>(future);
+}
+
+/*
+* Description: This function chains a continuation to future: once future
+* is complete, fn(value, arg) runs with its value, and the returned future
+* completes with the value fn returns. The continuation runs on the thread
+* that completed future, right after it, or on a new thread if future is
+* complete already.
+* Return value: On success, return the future of the continuation. On
+* failure, return NULL.
+*/
+uthread_future_t *uthread_future_then(uthread_future_t *future,
+                                      uthread_continuation_fn fn, void *arg)
+{
+    if(future == nullptr || fn == nullptr)
+    {
+        ErrorHandler::libError(THREAD_LIB_ERROR_INPUT);
+        return nullptr;
+    }
+
+    enter_library();
+    Future *continuation = Future::acquire(fn, arg);
+    if(!reinterpret_cast<Future *>(future)->addContinuation(continuation) &&
+       spawn_future(continuation) == FAILURE)
+    {
+        continuation->discard();
+        continuation = nullptr;
+    }
+    leave_library();
+    return reinterpret_cast<uthread_future_t *>(continuation);
+}
+
+/*
+* Description: This function waits (BLOCKED) until future is complete, and
+* stores its value in *value (unless value is NULL). If the RUNNING thread
+* waits, a scheduling decision is made immediately. The thread is woken up
+* by the completion of future, without polling.
 * Return value: On success, return 0. On failure, return -1.
 */
-int uthread_sleep(int num_quantums)
+int uthread_future_get(uthread_future_t *future, void **value)
 {
-    if(lib_quantum_usecs <= BAD_USEC)
+    if(future == nullptr)
     {
-        return ErrorHandler::libError(THREAD_LIB_ERROR_NEGATIVE_QUANTUM);
+        return ErrorHandler::libError(THREAD_LIB_ERROR_INPUT);
+    }
+
+    enter_library();
+    Future *waited = reinterpret_cast<Future *>(future);
+    while(!waited->isComplete())
+    {
+        wait_on(waited->waiters(), NO_TIMEOUT);
+    }
+    if(value != nullptr)
+    {
+        *value = waited->value();
     }
-    return invoke_member_function(sch, &Scheduler::sleepThread,  nullptr, \
-                                  NOT_SPAWN,num_quantums);
+    leave_library();
+    return SUCCESS;
 }
 
 /*
-* Description: This function returns the number of quantums until the thread
-* with id tid wakes up including the current quantum. If no thread with ID
-* tid exists it is considered as an error. If the thread is not sleeping,
-* the function should return 0.
-* Return value: Number of quantums (including current quantum) until wakeup.
+* Description: This function waits (BLOCKED) until any of the count futures
+* is complete, like uthread_future_get.
+* Return value: On success, return the index of a complete future. On
+* failure, return -1.
 */
-int uthread_get_time_until_wakeup(int tid)
+int uthread_future_wait_any(uthread_future_t **futures, int count)
 {
-    return invoke_member_function(sch, &Scheduler::getTimeToWakeUp, nullptr, \
-                                  NOT_SPAWN, tid);
+    if(check_futures(futures, count) == FAILURE)
+    {
+        return ErrorHandler::libError(THREAD_LIB_ERROR_INPUT);
+    }
+
+    enter_library();
+    int index = find_complete(futures, count);
+    if(index == -1)
+    {
+        // The thread waits on a queue of its own, which every future wakes
+        // up once complete. The Scheduler keeps the queue and the watchers,
+        // so that terminating the thread meanwhile unlinks them.
+        ThreadQueue *queue = current_scheduler()->watchFutures(
+                reinterpret_cast<Future **>(futures), count);
+        while((index = find_complete(futures, count)) == -1)
+        {
+            wait_on(queue, NO_TIMEOUT);
+        }
+        current_scheduler()->unwatchFutures();
+    }
+    leave_library();
+    return index;
 }
 
 /*
-* Description: This function returns the thread ID of the calling thread.
-* Return value: The ID of the calling thread.
+* Description: This function waits (BLOCKED) until all of the count futures
+* are complete, like uthread_future_get.
+* Return value: On success, return 0. On failure, return -1.
 */
-int uthread_get_tid(void)
+int uthread_future_wait_all(uthread_future_t **futures, int count)
 {
-    return invoke_member_function(sch, &Scheduler::getRunningThreadID, nullptr,\
-                                  NOT_SPAWN, NO_PARAM);
+    if(check_futures(futures, count) == FAILURE)
+    {
+        return ErrorHandler::libError(THREAD_LIB_ERROR_INPUT);
+    }
+
+    enter_library();
+    for(int i = 0; i < count; ++i)
+    {
+        Future *waited = reinterpret_cast<Future *>(futures[i]);
+        while(!waited->isComplete())
+        {
+            wait_on(waited->waiters(), NO_TIMEOUT);
+        }
+    }
+    leave_library();
+    return SUCCESS;
 }
 
 /*
-* Description: This function returns the total number of quantums that were
-* started since the library was initialized, including the current quantum.
-* Right after the call to uthread_init, the value should be 1.
-* Each time a new quantum starts, regardless of the reason, this number
-* should be increased by 1.
-* Return value: The total number of quantums.
+* Description: This function gives future up. It goes back to the pool at
+* once if it is complete, and otherwise once it completes (its task and
+* continuations still run). A future must be released once, and only when
+* no thread waits for it or will use it.
+* Return value: On success, return 0. On failure, return -1.
 */
-int uthread_get_total_quantums()
+int uthread_future_release(uthread_future_t *future)
+{
+    if(future == nullptr)
+    {
+        return ErrorHandler::libError(THREAD_LIB_ERROR_INPUT);
+    }
+
+    enter_library();
+    reinterpret_cast<Future *>(future)->release();
+    leave_library();
+    return SUCCESS;
+}
+
+/*
+* Description: This function allocates a coroutine frame of size bytes (see
+* uthread_task.h) from the pool of the calling worker, without a lock. The
+* frame is aligned like memory from operator new.
+* Return value: The frame. The process exits if memory runs out.
+*/
+void *uthread_frame_alloc(size_t size)
 {
-    return invoke_member_function(sch, &Scheduler::getTotalQuantumCounter,\
-                                  nullptr, NOT_SPAWN, NO_PARAM);
+    enter_worker_section();
+    void *frame = worker_frame_pool()->allocate(size);
+    leave_worker_section();
+    return frame;
 }
 
+/*
+* Description: This function returns a frame allocated with
+* uthread_frame_alloc(size) to the pool of the calling worker (which may be
+* another worker than the one that allocated it).
+* Return value: None.
+*/
+void uthread_frame_free(void *frame, size_t size)
+{
+    enter_worker_section();
+    worker_frame_pool()->free(frame, size);
+    leave_worker_section();
+}
 
 /*
-* Description: This function returns the number of quantums the thread with
-* ID tid was in RUNNING state. On the first time a thread runs, the function
-* should return 1. Every additional quantum that the thread starts should
-* increase this value by 1 (so if the thread with ID tid is in RUNNING state
-* when this function is called, include also the current quantum). If no
-* thread with ID tid exists it is considered as an error.
-* Return value: On success, return the number of quantums of the thread with ID
-* tid. On failure, return -1.
+* Description: This function reads up to count bytes from fd into buf like
+* read(2), but only the RUNNING thread waits for data: fd is put in
+* non-blocking mode (for every user of its open file description), and
+* while nothing can be read the thread waits (BLOCKED) until the scheduler
+* instance sees fd become readable, and a scheduling decision is made
+* immediately. fd must not be closed while threads wait for it.
+* Return value: Like read(2): the number of bytes read, 0 at the end of the
+* file, or -1 with errno set.
 */
-int uthread_get_quantums(int tid)
+ssize_t uthread_read(int fd, void *buf, size_t count)
+{
+    if(set_nonblocking(fd) == FAILURE)
+    {
+        return SIG_FAILED;
+    }
+
+    for(;;)
+    {
+        ssize_t result = read(fd, buf, count);
+        if(result != SIG_FAILED || (errno != EINTR && !would_block()))
+        {
+            return result;
+        }
+        if(errno != EINTR && wait_for_fd(fd, false, NO_TIMEOUT) == FAILURE)
+        {
+            return SIG_FAILED;
+        }
+    }
+}
+
+/*
+* Description: This function writes count bytes from buf to fd like a
+* blocking write(2), waiting like uthread_read while fd is not writable,
+* until all of the bytes were written or an error occurs.
+* Return value: The number of bytes written, which is less than count only
+* if an error occurred after some were written, or -1 with errno set.
+*/
+ssize_t uthread_write(int fd, const void *buf, size_t count)
 {
-    return invoke_member_function(sch, &Scheduler::getNumOfQuantums,\
-                                  nullptr, NOT_SPAWN, tid);
-}
\ No newline at end of file
+    size_t written = 0;
+
+    if(set_nonblocking(fd) == FAILURE)
+    {
+        return SIG_FAILED;
+    }
+
+    while(written < count)
+    {
+        ssize_t result = write(fd, (const char *) buf + written,
+                               count - written);
+        if(result != SIG_FAILED)
+        {
+            written += result;
+            continue;
+        }
+        if(errno == EINTR)
+        {
+            continue;
+        }
+        if(!would_block() ||
+           wait_for_fd(fd, true, NO_TIMEOUT) == FAILURE)
+        {
+            return written > 0 ? (ssize_t) written : SIG_FAILED;
+        }
+    }
+    return written;
+}
+
+/*
+* Description: This function accepts a connection on the listening socket fd
+* like accept(2), waiting like uthread_read while no connection is pending.
+* The accepted socket is in non-blocking mode.
+* Return value: Like accept(2): the accepted socket, or -1 with errno set.
+*/
+int uthread_accept(int fd, struct sockaddr *addr, socklen_t *addrlen)
+{
+    if(set_nonblocking(fd) == FAILURE)
+    {
+        return SIG_FAILED;
+    }
+
+    for(;;)
+    {
+        int result = accept4(fd, addr, addrlen, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if(result != SIG_FAILED || (errno != EINTR && !would_block()))
+        {
+            return result;
+        }
+        if(errno != EINTR && wait_for_fd(fd, false, NO_TIMEOUT) == FAILURE)
+        {
+            return SIG_FAILED;
+        }
+    }
+}
+
+/*
+* Description: This function connects the socket fd to addr like connect(2),
+* waiting like uthread_read (until fd is writable) while the connection is
+* in progress.
+* Return value: Like connect(2): 0, or -1 with errno set.
+*/
+int uthread_connect(int fd, const struct sockaddr *addr, socklen_t addrlen)
+{
+    if(set_nonblocking(fd) == FAILURE)
+    {
+        return SIG_FAILED;
+    }
+
+    // A connection that can not be made at once goes on in the background,
+    // and its result is reported once the socket is writable.
+    if(connect(fd, addr, addrlen) != SIG_FAILED)
+    {
+        return SUCCESS;
+    }
+    if(errno != EINPROGRESS && errno != EINTR)
+    {
+        return SIG_FAILED;
+    }
+    if(wait_for_fd(fd, true, NO_TIMEOUT) == FAILURE)
+    {
+        return SIG_FAILED;
+    }
+
+    int error = 0;
+    socklen_t length = sizeof(error);
+    if(getsockopt(fd, SOL_SOCKET, SO_ERROR, &error, &length) == SIG_FAILED)
+    {
+        return SIG_FAILED;
+    }
+    if(error != 0)
+    {
+        errno = error;
+        return SIG_FAILED;
+    }
+    return SUCCESS;
+}
+
+/*
+* Description: This function waits until fd is ready for events (either
+* UTHREAD_POLL_IN or UTHREAD_POLL_OUT), for num_quantums quantums at most
+* (not including the current quantum). If num_quantums is 0, it only checks
+* fd, and if it is negative, there is no timeout. A scheduling decision is
+* made immediately if the RUNNING thread waits.
+* Return value: If fd is ready, return 0. If the timeout expired, return
+* UTHREAD_TIMEDOUT. On failure, return -1 (with errno set if fd can not be
+* waited for).
+*/
+int uthread_poll_fd(int fd, int events, int num_quantums)
+{
+    if(events != UTHREAD_POLL_IN && events != UTHREAD_POLL_OUT)
+    {
+        return ErrorHandler::libError(THREAD_LIB_ERROR_INPUT);
+    }
+
+    // A descriptor that is ready already does not wait for the poller.
+    struct pollfd request;
+    request.fd = fd;
+    request.events = (events == UTHREAD_POLL_IN) ? POLLIN : POLLOUT;
+    request.revents = 0;
+    int result = poll(&request, 1, 0);
+    if(result == SIG_FAILED)
+    {
+        return SIG_FAILED;
+    }
+    if(request.revents & POLLNVAL)
+    {
+        errno = EBADF;
+        return SIG_FAILED;
+    }
+    if(result > 0)
+    {
+        return SUCCESS;
+    }
+    if(num_quantums == 0)
+    {
+        return UTHREAD_TIMEDOUT;
+    }
+
+    return wait_for_fd(fd, events == UTHREAD_POLL_OUT,
+                       num_quantums < 0 ? NO_TIMEOUT : num_quantums);
+}
+
+/*
+* Description: This function reads up to count bytes from fd at offset into
+* buf like pread(2), but only the RUNNING thread waits for them: the read
+* is queued on the scheduler instance's io_uring, the thread waits (BLOCKED)
+* until it completes, and a scheduling decision is made immediately. The
+* reads and writes the threads queued since the last scheduling decision are
+* submitted together by the next one. If the kernel does not support
+* io_uring, the calling kernel thread reads itself. A thread terminated
+* while its read is in flight keeps its stack (where buf may be) until the
+* read completes.
+* Return value: Like pread(2): the number of bytes read, 0 at the end of the
+* file, or -1 with errno set.
+*/
+ssize_t uthread_pread(int fd, void *buf, size_t count, off_t offset)
+{
+    ssize_t result;
+
+    if(count > MAX_RING_IO_SIZE)
+    {
+        count = MAX_RING_IO_SIZE;
+    }
+    if(!ring_io(IORING_OP_READ, fd, buf, count, offset, &result))
+    {
+        result = pread(fd, buf, count, offset);
+    }
+    return result;
+}
+
+/*
+* Description: This function writes up to count bytes from buf to fd at
+* offset like pwrite(2), waiting like uthread_pread until the write
+* completes.
+* Return value: Like pwrite(2): the number of bytes written, or -1 with
+* errno set.
+*/
+ssize_t uthread_pwrite(int fd, const void *buf, size_t count, off_t offset)
+{
+    ssize_t result;
+
+    if(count > MAX_RING_IO_SIZE)
+    {
+        count = MAX_RING_IO_SIZE;
+    }
+    if(!ring_io(IORING_OP_WRITE, fd, const_cast<void *>(buf), count, offset,
+                &result))
+    {
+        result = pwrite(fd, buf, count, offset);
+    }
+    return result;
+}
+
+/*
+* Description: This function flushes the data of fd to its storage device
+* like fsync(2), waiting like uthread_pread until the flush completes.
+* Return value: Like fsync(2): 0, or -1 with errno set.
+*/
+int uthread_fsync(int fd)
+{
+    ssize_t result;
+
+    if(!ring_io(IORING_OP_FSYNC, fd, nullptr, 0, 0, &result))
+    {
+        result = fsync(fd);
+    }
+    return (int) result;
+}
+
+/*
+* Description: This function calls fn(arg) on a helper kernel thread of the
+* scheduler instance, for calls that block and can not be made
+* non-blocking (such as getaddrinfo, or open on a slow file system). The
+* RUNNING thread waits (BLOCKED) until the call returns, and a scheduling
+* decision is made immediately, so the other threads keep running. The
+* helpers are started the first time a call is offloaded. fn must not call
+* uthread_* functions. A thread terminated while its call is in progress is
+* deleted once the call returns. While the calls of terminated threads take
+* up every slot of the helpers, fn is called on the kernel thread instead.
+* Return value: On success, return the value fn returned, with errno set to
+* the value fn left it at. On failure, return -1.
+*/
+long uthread_offload(uthread_offload_fn fn, void *arg)
+{
+    int error;
+
+    if(fn == nullptr)
+    {
+        return ErrorHandler::libError(THREAD_LIB_ERROR_INPUT);
+    }
+
+    enter_library();
+    OffloadPool *pool = current_scheduler()->offloadPool();
+    int slot = pool->submit(fn, arg);
+    if(slot == OFFLOAD_POOL_FULL)
+    {
+        leave_library();
+        errno = 0;
+        return fn(arg);
+    }
+    wait_on(pool->waiter(slot), NO_TIMEOUT);
+    // The thread may run on another worker, but the OffloadPool is shared.
+    long result = current_scheduler()->offloadPool()->collect(slot, &error);
+    leave_library();
+
+    // errno belongs to the kernel thread, which may have run other threads.
+    errno = error;
+    return result;
+}
+
+/*
+* Description: This function creates a uthread-local storage key, under
+* which every thread keeps a value of its own, NULL until it sets one. When
+* a thread returns, exits or is terminated, the destructor (if not NULL) is
+* called with each non-NULL value it left.
+* Return value: On success, return 0 and store the key in *key.
+* On failure (no key is left), return -1.
+*/
+int uthread_key_create(uthread_key_t *key,
+                       uthread_key_destructor_fn destructor)
+{
+    if(key == nullptr)
+    {
+        return ErrorHandler::libError(THREAD_LIB_ERROR_INPUT);
+    }
+
+    // The key is reserved first, and handed out once its destructor is set.
+    // No thread keeps a value under it before then.
+    int count = __atomic_load_n(&key_count, __ATOMIC_ACQUIRE);
+    do
+    {
+        if(count >= UTHREAD_KEYS_MAX)
+        {
+            return ErrorHandler::libError(THREAD_LIB_ERROR_KEYS);
+        }
+    } while(!__atomic_compare_exchange_n(&key_count, &count, count + 1,
+                                         false, __ATOMIC_ACQ_REL,
+                                         __ATOMIC_ACQUIRE));
+
+    __atomic_store_n(&key_destructors[count], destructor, __ATOMIC_RELEASE);
+    *key = count;
+    return SUCCESS;
+}
+
+/*
+* Description: This function sets the value the RUNNING thread keeps under
+* key. It does not enter the library: the slots of the RUNNING thread are
+* reached through uthread_running_slots.
+* Return value: On success, return 0. On failure (key was not created, or
+* the calling kernel thread runs no thread), return -1.
+*/
+int uthread_setspecific(uthread_key_t key, const void *value)
+{
+    if(key < 0 || key >= __atomic_load_n(&key_count, __ATOMIC_ACQUIRE))
+    {
+        return ErrorHandler::libError(THREAD_LIB_ERROR_INPUT);
+    }
+    // The slots of a kernel thread that runs no thread are shared, and stay
+    // NULL.
+    if(Thread::noneRunning())
+    {
+        return ErrorHandler::libError(THREAD_LIB_ERROR_NO_THREAD);
+    }
+
+    uthread_running_slots[key] = const_cast<void *>(value);
+    return SUCCESS;
+}
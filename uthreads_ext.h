@@ -0,0 +1,845 @@
+#ifndef EX2_UTHREADS_EXT_H
+#define EX2_UTHREADS_EXT_H
+
+#include "uthreads.h"
+
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+/*
+ * Extensions to the thread library interface declared in uthreads.h.
+ * All of them, except the initialization functions, assume the library was
+ * initialized. They act on the scheduler instance of the calling kernel
+ * thread, or on the default instance if it runs none.
+ */
+
+// Scheduling policies for uthread_init_ex.
+// Round-Robin: every thread runs a quantum in turn (the uthread_init policy).
+#define UTHREAD_POLICY_RR 0
+// Multi-level feedback queue: threads that use their whole quantum drop to a
+// lower priority level, threads that block or sleep early rise a level, and
+// all threads periodically return to the highest level.
+#define UTHREAD_POLICY_MLFQ 1
+// Weighted fair share: the READY thread that has had the least CPU time,
+// relative to its weight, runs next (see uthread_set_weight).
+#define UTHREAD_POLICY_FAIR 2
+
+// Number of priority levels under UTHREAD_POLICY_MLFQ (0 is the highest).
+#define UTHREAD_PRIORITY_LEVELS 8
+
+// Clocks quantums can be measured on, for uthread_init_clock.
+// The CPU time of the process, with micro-second resolution (the uthread_init
+// clock).
+#define UTHREAD_CLOCK_VIRTUAL 0
+// Wall-clock time, which keeps running while the process waits in the kernel.
+#define UTHREAD_CLOCK_MONOTONIC 1
+// The CPU time of the process (all of its kernel threads).
+#define UTHREAD_CLOCK_PROCESS_CPU 2
+// The CPU time of the kernel thread that initialized the library.
+#define UTHREAD_CLOCK_THREAD_CPU 3
+
+// Maximal number of workers (kernel threads) for uthread_init_mp.
+#define UTHREAD_MAX_WORKERS 64
+
+// A scheduler instance (see uthread_sched_create). uthread_init sets up the
+// default one.
+typedef struct uthread_sched uthread_sched_t;
+
+// A mutex. Taking a free mutex and releasing one no thread waits for never
+// enters the scheduler. A thread that finds it locked waits (BLOCKED) until
+// the mutex is handed over to it. The mutex is not recursive, and is not
+// released when its owner terminates.
+typedef struct uthread_mutex
+{
+    // Whether the mutex is locked, and whether threads may wait for it.
+    volatile int state;
+    // The waiting threads and waiters, kept by the library.
+    void *waiters;
+} uthread_mutex_t;
+
+// Initializes a mutex statically, like uthread_mutex_init.
+#define UTHREAD_MUTEX_INITIALIZER {0, 0}
+
+// A condition variable. Threads wait on it in the order they came.
+typedef struct uthread_cond
+{
+    // The waiting threads, kept by the library.
+    void *waiters;
+} uthread_cond_t;
+
+// Initializes a condition variable statically, like uthread_cond_init.
+#define UTHREAD_COND_INITIALIZER {0}
+
+// A counting semaphore. Waiting for a positive semaphore and posting one no
+// thread waits for never enters the scheduler. Threads wait on it in the
+// order they came.
+typedef struct uthread_sem
+{
+    // The value of the semaphore.
+    volatile int value;
+    // The number of threads and waiters that wait, or are about to.
+    volatile int waiting;
+    // The waiting threads and waiters, kept by the library.
+    void *waiters;
+} uthread_sem_t;
+
+// A waiter that is not a thread, such as a task of uthread_task.h: it waits
+// for a mutex or a semaphore (see uthread_mutex_lock_waiter) without
+// blocking the thread it runs on. Waiting threads and waiters take turns.
+typedef struct uthread_waiter
+{
+    // Called with arg once the mutex or a unit was handed over to the
+    // waiter, by the thread that handed it over, inside the library: it must
+    // not wait, nor call the uthread_* functions.
+    void (*wake)(void *arg);
+    void *arg;
+    // The next waiter, kept by the library.
+    struct uthread_waiter *next;
+} uthread_waiter_t;
+
+// A channel of fixed-size values with a fixed capacity (see
+// uthread_chan_create). A value sent while a thread waits to receive is
+// copied straight to that thread.
+typedef struct uthread_chan uthread_chan_t;
+
+// The value a task computes (see uthread_async), which threads wait for.
+typedef struct uthread_future uthread_future_t;
+// The function of a task, and the function of a continuation, which is
+// handed the value of the future it follows (see uthread_future_then).
+typedef void *(*uthread_task_fn)(void *arg);
+typedef void *(*uthread_continuation_fn)(void *value, void *arg);
+
+// Returned by uthread_mutex_trylock, uthread_sem_trywait and the channel
+// try operations when they would have to wait.
+#define UTHREAD_BUSY 1
+// Returned by the timed waits when the timeout expired.
+#define UTHREAD_TIMEDOUT 2
+// Returned by the channel receive operations once the channel is closed and
+// no values are left in it.
+#define UTHREAD_CLOSED 3
+
+// Events a thread waits for with uthread_poll_fd.
+// The file descriptor is readable (or hung up, or has an error).
+#define UTHREAD_POLL_IN 1
+// The file descriptor is writable (or hung up, or has an error).
+#define UTHREAD_POLL_OUT 2
+
+// A blocking call a thread offloads with uthread_offload.
+typedef long (*uthread_offload_fn)(void *arg);
+
+// The function of a thread spawned with an argument (see uthread_spawn_arg),
+// and a function that move-constructs the callable at from at to (see
+// uthread_spawn_closure), and a function that destroys the callable at
+// closure.
+typedef void (*uthread_arg_fn)(void *arg);
+typedef void (*uthread_move_fn)(void *to, void *from);
+typedef void (*uthread_destroy_fn)(void *closure);
+
+// The largest callable a thread keeps, in bytes, and its largest alignment.
+#define UTHREAD_CLOSURE_SIZE 64
+#define UTHREAD_CLOSURE_ALIGN 16
+
+// A uthread-local storage key (see uthread_key_create), and the function
+// called with the value a thread leaves under a key when it ends.
+typedef int uthread_key_t;
+typedef void (*uthread_key_destructor_fn)(void *value);
+
+// Maximal number of uthread-local storage keys. Keys are never deleted.
+#define UTHREAD_KEYS_MAX 32
+
+// The uthread-local storage slots of the thread the calling kernel thread
+// runs, kept by the library on every context switch, so that
+// uthread_getspecific is a single load. A kernel thread that runs no thread
+// points to slots that stay NULL.
+extern __thread void **volatile uthread_running_slots
+        __attribute__((tls_model("initial-exec")));
+
+/*
+* Description: This function initializes the thread library like uthread_init,
+* and selects the scheduling policy (one of the UTHREAD_POLICY_* values).
+* @param quantum_usecs
+* @param policy
+* @return On success, return 0. On failure, return -1.
+*/
+int uthread_init_ex(int quantum_usecs, int policy);
+
+/*
+* Description: This function initializes the thread library like
+* uthread_init_ex, with a quantum of quantum_nsecs nano-seconds measured on
+* the given clock (one of the UTHREAD_CLOCK_* values). Quantums on the
+* UTHREAD_CLOCK_VIRTUAL clock are rounded up to whole micro-seconds. The other
+* clocks use a POSIX timer that signals the kernel thread calling this
+* function, which must be the one running the threads.
+* @param quantum_nsecs
+* @param policy
+* @param clock
+* @return On success, return 0. On failure, return -1.
+*/
+int uthread_init_clock(long long quantum_nsecs, int policy, int clock);
+
+/*
+* Description: This function initializes the thread library like uthread_init,
+* and runs the threads on nworkers kernel threads (workers), the calling one
+* included, so that up to nworkers threads run at the same time. Each worker
+* runs the READY threads it last ran, spawned or resumed first, and takes
+* READY threads from the other workers when it has none. A quantum is
+* measured on the CPU time of the worker running the thread, and the total
+* number of quantums counts the quantums of all workers. Threads may move
+* between workers whenever they are preempted or make a library call, so a
+* thread must not keep pointers to thread-local data of the kernel thread
+* (such as errno) across those. nworkers must be between 1 and
+* UTHREAD_MAX_WORKERS, and should not exceed the number of CPUs, as the
+* workers guard their READY threads, and share the rest of the scheduling
+* state, under spin locks.
+* @param quantum_usecs
+* @param nworkers
+* @return On success, return 0. On failure, return -1.
+*/
+int uthread_init_mp(int quantum_usecs, int nworkers);
+
+/*
+* Description: This function sets the priority level of the thread with ID
+* tid under UTHREAD_POLICY_MLFQ. Level 0 is the highest, and the first thread
+* of the highest level with READY threads runs next. The policy keeps moving
+* the thread between levels afterwards. If no thread with ID tid exists, the
+* level is out of range, or another policy is used, it is considered as an
+* error.
+* Return value: On success, return 0. On failure, return -1.
+*/
+int uthread_set_priority(int tid, int level);
+
+/*
+* Description: This function moves the RUNNING thread to the end of the READY
+* threads, and a scheduling decision is made immediately. The thread that
+* runs next gets the rest of the current quantum. If no other thread is
+* READY, the calling thread keeps running.
+* Return value: On success, return 0. On failure, return -1.
+*/
+int uthread_yield(void);
+
+/*
+* Description: This function switches from the RUNNING thread directly to the
+* READY thread with ID tid, regardless of the order of the READY threads. The
+* calling thread moves to the end of the READY threads, and the thread with
+* ID tid runs out the rest of the current quantum. Yielding to the calling
+* thread itself has no effect. If no thread with ID tid exists, or it is not
+* READY, it is considered as an error.
+* Return value: On success, return 0. On failure, return -1.
+*/
+int uthread_yield_to(int tid);
+
+/*
+* Description: This function turns the tickless mode on (enabled != 0) or
+* off. In tickless mode the quantum timer is stopped while no thread but the
+* RUNNING one is READY or SLEEPING, and started again once a thread is
+* spawned, resumed or woken up. While the timer is stopped no new quantums
+* start, so the quantum counters do not advance.
+* Return value: On success, return 0. On failure, return -1.
+*/
+int uthread_set_tickless(int enabled);
+
+/*
+* Description: This function sets the weight of the thread with ID tid under
+* UTHREAD_POLICY_FAIR. Runnable threads share the CPU in proportion to their
+* weights, and every thread starts with a weight of 1024. If no thread with
+* ID tid exists, the weight is not positive, or another policy is used, it
+* is considered as an error.
+* Return value: On success, return 0. On failure, return -1.
+*/
+int uthread_set_weight(int tid, int weight);
+
+/*
+* Description: This function puts the RUNNING thread to sleep until the
+* total number of quantums (see uthread_get_total_quantums) reaches
+* total_quantum. The thread is moved to the READY state so that it may run
+* from that quantum on. total_quantum must be larger than the current total
+* number of quantums. It is an error to try to put the main thread (tid==0)
+* to sleep. A scheduling decision is made immediately.
+* Return value: On success, return 0. On failure, return -1.
+*/
+int uthread_sleep_until(int total_quantum);
+
+/*
+* Description: This function puts the RUNNING thread to sleep for at least
+* usecs micro-seconds, rounded up to a whole number of quantums. usecs must
+* be a positive number. It is an error to try to put the main thread (tid==0)
+* to sleep. A scheduling decision is made immediately.
+* Return value: On success, return 0. On failure, return -1.
+*/
+int uthread_sleep_usecs(int usecs);
+
+/*
+* Description: This function creates a new thread like uthread_spawn, whose
+* entry point is the function f with the signature void f(void *arg), called
+* with arg. Returning from f exits the thread like uthread_exit(NULL).
+* Return value: On success, return the ID of the created thread.
+* On failure, return -1.
+*/
+int uthread_spawn_arg(uthread_arg_fn f, void *arg);
+
+/*
+* Description: This function creates a new thread like uthread_spawn_arg,
+* whose entry point is run, called with a callable the thread keeps: move
+* moves the callable at closure (of UTHREAD_CLOSURE_SIZE bytes at most) into
+* the storage of the thread, with no allocation. destroy (unless NULL)
+* destroys the kept callable once run returns, or once the thread is
+* deleted if it exits or is terminated before then. move runs inside the
+* library, and so does destroy when the thread ended early: they must not
+* call uthread_* functions. The C++ overload of uthread_spawn for callables
+* is built on it.
+* Return value: On success, return the ID of the created thread.
+* On failure, return -1.
+*/
+int uthread_spawn_closure(uthread_arg_fn run, uthread_move_fn move,
+                          uthread_destroy_fn destroy, void *closure);
+
+/*
+* Description: This function makes the RUNNING thread exit with an exit
+* value, which the thread that joins it collects. A thread whose function
+* returns exits with NULL. A detached thread is released at once; a
+* joinable one keeps its ID until it is joined, but its stack and other
+* resources are released at once. The main thread (tid == 0) exiting
+* terminates the process like uthread_terminate(0).
+* Return value: The function does not return.
+*/
+void uthread_exit(void *value);
+
+/*
+* Description: This function waits until the thread with ID tid exits, and
+* stores its exit value in *value (unless value is NULL). If the thread
+* exited already, its exit value is collected at once. A thread terminated
+* with uthread_terminate hands over NULL. Once joined, the ID is released.
+* Only one thread may join a thread, and it is an error to join the main
+* thread (tid == 0), the RUNNING thread or a detached thread. A scheduling
+* decision is made immediately if the RUNNING thread waits.
+* Return value: On success, return 0. On failure, return -1.
+*/
+int uthread_join(int tid, void **value);
+
+/*
+* Description: This function detaches the thread with ID tid, which is
+* released as soon as it exits instead of waiting to be joined. A thread
+* that exited already is released at once. It is an error to detach the
+* main thread (tid == 0), a detached thread or one another thread joins.
+* Return value: On success, return 0. On failure, return -1.
+*/
+int uthread_detach(int tid);
+
+/*
+* Description: This function creates a scheduler instance run by the calling
+* kernel thread, which must not run one already (the instance set up by
+* uthread_init included). The calling context becomes the main thread
+* (tid == 0) of the instance, and quantums of quantum_usecs micro-seconds are
+* measured on the CPU time of the calling kernel thread. From then on the
+* uthread_* functions called on this kernel thread act on the new instance.
+* Each instance has its own threads, IDs and quantum counters, so several
+* kernel threads may each run one independently.
+* Return value: On success, return the instance. On failure, return NULL.
+*/
+uthread_sched_t *uthread_sched_create(int quantum_usecs, int policy);
+
+/*
+* Description: This function destroys a scheduler instance created by
+* uthread_sched_create, releasing its threads and their resources. It must
+* be called by the main thread (tid == 0) of the instance, on the kernel
+* thread that runs it, which may then create another one. (Terminating the
+* main thread terminates the entire process instead.)
+* Return value: On success, return 0. On failure, return -1.
+*/
+int uthread_sched_destroy(uthread_sched_t *sched);
+
+/*
+* Description: This function returns the scheduler instance run by the
+* calling kernel thread.
+* Return value: The instance, or NULL if the kernel thread runs none.
+*/
+uthread_sched_t *uthread_sched_current(void);
+
+/*
+* Description: This function initializes a mutex, which is then unlocked.
+* Return value: On success, return 0. On failure, return -1.
+*/
+int uthread_mutex_init(uthread_mutex_t *mutex);
+
+/*
+* Description: This function releases the resources of a mutex. It is an
+* error to destroy a locked mutex.
+* Return value: On success, return 0. On failure, return -1.
+*/
+int uthread_mutex_destroy(uthread_mutex_t *mutex);
+
+/*
+* Description: This function locks a mutex. If it is locked, the RUNNING
+* thread waits until the mutex is handed over to it by uthread_mutex_unlock,
+* and a scheduling decision is made immediately. Waiting threads take the
+* mutex in the order they came, and uthread_resume does not wake them up.
+* Return value: On success, return 0. On failure, return -1.
+*/
+int uthread_mutex_lock(uthread_mutex_t *mutex);
+
+/*
+* Description: This function locks a mutex if it is unlocked, and never
+* waits.
+* Return value: On success, return 0. If the mutex is locked, return
+* UTHREAD_BUSY. On failure, return -1.
+*/
+int uthread_mutex_trylock(uthread_mutex_t *mutex);
+
+/*
+* Description: This function locks a mutex for waiter. If it is locked, the
+* waiter is queued instead of the RUNNING thread, which goes on, and
+* waiter->wake(waiter->arg) is called once uthread_mutex_unlock hands the
+* mutex over to it. The waiter must stay valid until then.
+* Return value: If the mutex was locked at once, return 0. If the waiter was
+* queued, return UTHREAD_BUSY. On failure, return -1.
+*/
+int uthread_mutex_lock_waiter(uthread_mutex_t *mutex,
+                              uthread_waiter_t *waiter);
+
+/*
+* Description: This function unlocks a mutex locked by the RUNNING thread. If
+* threads wait for it, it is handed over to the first of them, which becomes
+* READY, or to the first waiter (see uthread_mutex_lock_waiter) when it is
+* its turn. It is an error to unlock a mutex that is not locked.
+* Return value: On success, return 0. On failure, return -1.
+*/
+int uthread_mutex_unlock(uthread_mutex_t *mutex);
+
+/*
+* Description: This function initializes a condition variable.
+* Return value: On success, return 0. On failure, return -1.
+*/
+int uthread_cond_init(uthread_cond_t *cond);
+
+/*
+* Description: This function releases the resources of a condition
+* variable. It is an error to destroy a condition variable threads wait on.
+* Return value: On success, return 0. On failure, return -1.
+*/
+int uthread_cond_destroy(uthread_cond_t *cond);
+
+/*
+* Description: This function unlocks mutex, which the RUNNING thread must
+* have locked, and makes the thread wait on cond at once. A scheduling
+* decision is made immediately. Once the thread is woken up by
+* uthread_cond_signal or uthread_cond_broadcast, it locks mutex again before
+* returning.
+* Return value: On success, return 0. On failure, return -1.
+*/
+int uthread_cond_wait(uthread_cond_t *cond, uthread_mutex_t *mutex);
+
+/*
+* Description: This function waits on cond like uthread_cond_wait, for
+* num_quantums quantums at most (not including the current quantum).
+* num_quantums must be a positive number. The mutex is locked again in
+* either case.
+* Return value: On success, return 0. If the timeout expired, return
+* UTHREAD_TIMEDOUT. On failure, return -1.
+*/
+int uthread_cond_timedwait(uthread_cond_t *cond, uthread_mutex_t *mutex,
+                           int num_quantums);
+
+/*
+* Description: This function wakes up the thread that has waited on cond the
+* longest, if there is one.
+* Return value: On success, return 0. On failure, return -1.
+*/
+int uthread_cond_signal(uthread_cond_t *cond);
+
+/*
+* Description: This function wakes up all of the threads that wait on cond,
+* at once and in the order they came.
+* Return value: On success, return 0. On failure, return -1.
+*/
+int uthread_cond_broadcast(uthread_cond_t *cond);
+
+/*
+* Description: This function initializes a semaphore with a non-negative
+* value.
+* Return value: On success, return 0. On failure, return -1.
+*/
+int uthread_sem_init(uthread_sem_t *sem, int value);
+
+/*
+* Description: This function releases the resources of a semaphore. It is an
+* error to destroy a semaphore threads wait on.
+* Return value: On success, return 0. On failure, return -1.
+*/
+int uthread_sem_destroy(uthread_sem_t *sem);
+
+/*
+* Description: This function decrements a semaphore. If its value is 0, the
+* RUNNING thread waits until uthread_sem_post hands it a unit, and a
+* scheduling decision is made immediately.
+* Return value: On success, return 0. On failure, return -1.
+*/
+int uthread_sem_wait(uthread_sem_t *sem);
+
+/*
+* Description: This function decrements a semaphore like uthread_sem_wait,
+* waiting for num_quantums quantums at most (not including the current
+* quantum). num_quantums must be a positive number.
+* Return value: On success, return 0. If the timeout expired, return
+* UTHREAD_TIMEDOUT. On failure, return -1.
+*/
+int uthread_sem_timedwait(uthread_sem_t *sem, int num_quantums);
+
+/*
+* Description: This function decrements a semaphore if its value is
+* positive, and never waits.
+* Return value: On success, return 0. If the value is 0, return
+* UTHREAD_BUSY. On failure, return -1.
+*/
+int uthread_sem_trywait(uthread_sem_t *sem);
+
+/*
+* Description: This function decrements a semaphore for waiter. If its value
+* is 0, the waiter is queued instead of the RUNNING thread, which goes on,
+* and waiter->wake(waiter->arg) is called once uthread_sem_post hands it a
+* unit. The waiter must stay valid until then.
+* Return value: If the semaphore was decremented at once, return 0. If the
+* waiter was queued, return UTHREAD_BUSY. On failure, return -1.
+*/
+int uthread_sem_wait_waiter(uthread_sem_t *sem, uthread_waiter_t *waiter);
+
+/*
+* Description: This function increments a semaphore. If threads wait on it,
+* the unit is handed to the one that has waited the longest, which becomes
+* READY, or to the first waiter (see uthread_sem_wait_waiter) when it is its
+* turn.
+* Return value: On success, return 0. On failure, return -1.
+*/
+int uthread_sem_post(uthread_sem_t *sem);
+
+/*
+* Description: This function creates a channel of values of elem_size bytes,
+* which buffers up to capacity values. A channel of capacity 0 is
+* unbuffered: every send waits for a receiver, and every receive for a
+* sender. The buffer is allocated once, rounded up to a power of two values.
+* Return value: On success, return the channel. On failure, return NULL.
+*/
+uthread_chan_t *uthread_chan_create(int elem_size, int capacity);
+
+/*
+* Description: This function releases the resources of a channel, with the
+* values left in it. It is an error to destroy a channel threads wait on.
+* Return value: On success, return 0. On failure, return -1.
+*/
+int uthread_chan_destroy(uthread_chan_t *chan);
+
+/*
+* Description: This function sends the value value points to on a channel.
+* If a thread waits to receive, the value is copied straight to it and the
+* thread becomes READY. Otherwise the value is buffered, and if the buffer is
+* full, the RUNNING thread waits until a receiver takes the value, and a
+* scheduling decision is made immediately. It is an error to send on a
+* closed channel, including one closed while the thread waited.
+* Return value: On success, return 0. On failure, return -1.
+*/
+int uthread_chan_send(uthread_chan_t *chan, const void *value);
+
+/*
+* Description: This function receives a value from a channel into value, in
+* the order the values were sent. If the channel is empty, the RUNNING
+* thread waits until a sender hands it a value, and a scheduling decision is
+* made immediately.
+* Return value: On success, return 0. If the channel is closed and empty,
+* return UTHREAD_CLOSED. On failure, return -1.
+*/
+int uthread_chan_recv(uthread_chan_t *chan, void *value);
+
+/*
+* Description: This function sends a value on a channel like
+* uthread_chan_send, if that does not have to wait.
+* Return value: On success, return 0. If the value can not be sent at once,
+* return UTHREAD_BUSY. On failure, return -1.
+*/
+int uthread_chan_try_send(uthread_chan_t *chan, const void *value);
+
+/*
+* Description: This function receives a value from a channel like
+* uthread_chan_recv, if that does not have to wait.
+* Return value: On success, return 0. If no value can be received at once,
+* return UTHREAD_BUSY, or UTHREAD_CLOSED if the channel is closed and empty.
+* On failure, return -1.
+*/
+int uthread_chan_try_recv(uthread_chan_t *chan, void *value);
+
+/*
+* Description: This function closes a channel. The threads that wait to
+* send or to receive on it are woken up, and fail. The values buffered in it
+* can still be received. It is an error to close a channel twice.
+* Return value: On success, return 0. On failure, return -1.
+*/
+int uthread_chan_close(uthread_chan_t *chan);
+
+/*
+* Description: This function runs fn(arg) as a task, on a new detached
+* thread, and returns the future of the value fn returns. Futures are taken
+* from a pool, and go back to it once released (see uthread_future_release)
+* and complete.
+* Return value: On success, return the future. On failure (if the thread
+* can not be spawned), return NULL.
+*/
+uthread_future_t *uthread_async(uthread_task_fn fn, void *arg);
+
+/*
+* Description: This function chains a continuation to future: once future
+* is complete, fn(value, arg) runs with its value, and the returned future
+* completes with the value fn returns. The continuation runs on the thread
+* that completed future, right after it, or on a new thread if future is
+* complete already.
+* Return value: On success, return the future of the continuation. On
+* failure, return NULL.
+*/
+uthread_future_t *uthread_future_then(uthread_future_t *future,
+                                      uthread_continuation_fn fn, void *arg);
+
+/*
+* Description: This function waits (BLOCKED) until future is complete, and
+* stores its value in *value (unless value is NULL). If the RUNNING thread
+* waits, a scheduling decision is made immediately. The thread is woken up
+* by the completion of future, without polling.
+* Return value: On success, return 0. On failure, return -1.
+*/
+int uthread_future_get(uthread_future_t *future, void **value);
+
+/*
+* Description: This function waits (BLOCKED) until any of the count futures
+* is complete, like uthread_future_get.
+* Return value: On success, return the index of a complete future. On
+* failure, return -1.
+*/
+int uthread_future_wait_any(uthread_future_t **futures, int count);
+
+/*
+* Description: This function waits (BLOCKED) until all of the count futures
+* are complete, like uthread_future_get.
+* Return value: On success, return 0. On failure, return -1.
+*/
+int uthread_future_wait_all(uthread_future_t **futures, int count);
+
+/*
+* Description: This function gives future up. It goes back to the pool at
+* once if it is complete, and otherwise once it completes (its task and
+* continuations still run). A future must be released once, and only when
+* no thread waits for it or will use it.
+* Return value: On success, return 0. On failure, return -1.
+*/
+int uthread_future_release(uthread_future_t *future);
+
+/*
+* Description: This function allocates a coroutine frame of size bytes (see
+* uthread_task.h) from the pool of the calling worker, without a lock. The
+* frame is aligned like memory from operator new.
+* Return value: The frame. The process exits if memory runs out.
+*/
+void *uthread_frame_alloc(size_t size);
+
+/*
+* Description: This function returns a frame allocated with
+* uthread_frame_alloc(size) to the pool of the calling worker (which may be
+* another worker than the one that allocated it).
+* Return value: None.
+*/
+void uthread_frame_free(void *frame, size_t size);
+
+/*
+* Description: This function reads up to count bytes from fd into buf like
+* read(2), but only the RUNNING thread waits for data: fd is put in
+* non-blocking mode (for every user of its open file description), and
+* while nothing can be read the thread waits (BLOCKED) until the scheduler
+* instance sees fd become readable, and a scheduling decision is made
+* immediately. fd must not be closed while threads wait for it.
+* Return value: Like read(2): the number of bytes read, 0 at the end of the
+* file, or -1 with errno set.
+*/
+ssize_t uthread_read(int fd, void *buf, size_t count);
+
+/*
+* Description: This function writes count bytes from buf to fd like a
+* blocking write(2), waiting like uthread_read while fd is not writable,
+* until all of the bytes were written or an error occurs.
+* Return value: The number of bytes written, which is less than count only
+* if an error occurred after some were written, or -1 with errno set.
+*/
+ssize_t uthread_write(int fd, const void *buf, size_t count);
+
+/*
+* Description: This function accepts a connection on the listening socket fd
+* like accept(2), waiting like uthread_read while no connection is pending.
+* The accepted socket is in non-blocking mode.
+* Return value: Like accept(2): the accepted socket, or -1 with errno set.
+*/
+int uthread_accept(int fd, struct sockaddr *addr, socklen_t *addrlen);
+
+/*
+* Description: This function connects the socket fd to addr like connect(2),
+* waiting like uthread_read (until fd is writable) while the connection is
+* in progress.
+* Return value: Like connect(2): 0, or -1 with errno set.
+*/
+int uthread_connect(int fd, const struct sockaddr *addr, socklen_t addrlen);
+
+/*
+* Description: This function waits until fd is ready for events (either
+* UTHREAD_POLL_IN or UTHREAD_POLL_OUT), for num_quantums quantums at most
+* (not including the current quantum). If num_quantums is 0, it only checks
+* fd, and if it is negative, there is no timeout. A scheduling decision is
+* made immediately if the RUNNING thread waits.
+* Return value: If fd is ready, return 0. If the timeout expired, return
+* UTHREAD_TIMEDOUT. On failure, return -1 (with errno set if fd can not be
+* waited for).
+*/
+int uthread_poll_fd(int fd, int events, int num_quantums);
+
+/*
+* Description: This function reads up to count bytes from fd at offset into
+* buf like pread(2), but only the RUNNING thread waits for them: the read
+* is queued on the scheduler instance's io_uring, the thread waits (BLOCKED)
+* until it completes, and a scheduling decision is made immediately. The
+* reads and writes the threads queued since the last scheduling decision are
+* submitted together by the next one. If the kernel does not support
+* io_uring, the calling kernel thread reads itself. A thread terminated
+* while its read is in flight keeps its stack (where buf may be) until the
+* read completes.
+* Return value: Like pread(2): the number of bytes read, 0 at the end of the
+* file, or -1 with errno set.
+*/
+ssize_t uthread_pread(int fd, void *buf, size_t count, off_t offset);
+
+/*
+* Description: This function writes up to count bytes from buf to fd at
+* offset like pwrite(2), waiting like uthread_pread until the write
+* completes.
+* Return value: Like pwrite(2): the number of bytes written, or -1 with
+* errno set.
+*/
+ssize_t uthread_pwrite(int fd, const void *buf, size_t count, off_t offset);
+
+/*
+* Description: This function flushes the data of fd to its storage device
+* like fsync(2), waiting like uthread_pread until the flush completes.
+* Return value: Like fsync(2): 0, or -1 with errno set.
+*/
+int uthread_fsync(int fd);
+
+/*
+* Description: This function calls fn(arg) on a helper kernel thread of the
+* scheduler instance, for calls that block and can not be made
+* non-blocking (such as getaddrinfo, or open on a slow file system). The
+* RUNNING thread waits (BLOCKED) until the call returns, and a scheduling
+* decision is made immediately, so the other threads keep running. The
+* helpers are started the first time a call is offloaded. fn must not call
+* uthread_* functions. A thread terminated while its call is in progress is
+* deleted once the call returns. While the calls of terminated threads take
+* up every slot of the helpers, fn is called on the kernel thread instead.
+* Return value: On success, return the value fn returned, with errno set to
+* the value fn left it at. On failure, return -1.
+*/
+long uthread_offload(uthread_offload_fn fn, void *arg);
+
+/*
+* Description: This function creates a uthread-local storage key, under
+* which every thread keeps a value of its own, NULL until it sets one. When
+* a thread returns, exits or is terminated, the destructor (if not NULL) is
+* called with each non-NULL value it left, by the ending thread itself
+* (or, for a thread another one terminates, by the terminating thread, unless
+* the terminated thread is RUNNING on another worker). Keys are shared by
+* all scheduler instances, and are never deleted.
+* Return value: On success, return 0 and store the key in *key.
+* On failure (no key is left), return -1.
+*/
+int uthread_key_create(uthread_key_t *key,
+                       uthread_key_destructor_fn destructor);
+
+/*
+* Description: This function sets the value the RUNNING thread keeps under
+* key.
+* Return value: On success, return 0. On failure (key was not created, or
+* the calling kernel thread runs no thread, as before uthread_init), return
+* -1.
+*/
+int uthread_setspecific(uthread_key_t key, const void *value);
+
+/*
+* Description: This function gets the value the RUNNING thread keeps under
+* key, without entering the library.
+* Return value: The value, or NULL if none was set (or key is not valid, or
+* the calling kernel thread runs no thread).
+*/
+static inline void *uthread_getspecific(uthread_key_t key)
+{
+    if ((unsigned) key >= UTHREAD_KEYS_MAX)
+    {
+        return nullptr;
+    }
+    return uthread_running_slots[key];
+}
+
+/*
+* Description: This function runs the callable a thread keeps (see
+* uthread_spawn).
+* Return value: None.
+*/
+template <typename Callable>
+void uthread_closure_run(void *closure)
+{
+    (*static_cast<Callable *>(closure))();
+}
+
+/*
+* Description: This function move-constructs the callable at from at to
+* (see uthread_spawn_closure).
+* Return value: None.
+*/
+template <typename Callable>
+void uthread_closure_move(void *to, void *from)
+{
+    new (to) Callable(std::move(*static_cast<Callable *>(from)));
+}
+
+/*
+* Description: This function destroys the callable a thread keeps (see
+* uthread_spawn_closure).
+* Return value: None.
+*/
+template <typename Callable>
+void uthread_closure_destroy(void *closure)
+{
+    static_cast<Callable *>(closure)->~Callable();
+}
+
+/*
+* Description: This function creates a new thread like uthread_spawn, whose
+* entry point is a copy of f: a lambda or any other callable invoked with no
+* arguments. The copy is kept inside the thread, with no allocation (see
+* uthread_spawn_closure), and destroyed once it returns, or once the thread
+* is deleted if it exits or is terminated before then (inside the library,
+* so the destructor must not call uthread_* functions then). Functions take
+* the overload above.
+* Return value: On success, return the ID of the created thread.
+* On failure, return -1.
+*/
+template <typename F>
+typename std::enable_if<!std::is_convertible<F, void (*)(void)>::value,
+                        int>::type
+uthread_spawn(F &&f)
+{
+    typedef typename std::decay<F>::type Callable;
+    static_assert(sizeof(Callable) <= UTHREAD_CLOSURE_SIZE,
+                  "the callable does not fit in a thread");
+    static_assert(alignof(Callable) <= UTHREAD_CLOSURE_ALIGN,
+                  "the callable is aligned more than a thread can keep it");
+
+    Callable callable(std::forward<F>(f));
+    return uthread_spawn_closure(&uthread_closure_run<Callable>,
+                                 &uthread_closure_move<Callable>,
+                                 &uthread_closure_destroy<Callable>,
+                                 &callable);
+}
+
+#endif //EX2_UTHREADS_EXT_H